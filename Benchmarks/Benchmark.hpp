@@ -0,0 +1,92 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file Benchmarks/Benchmark.hpp
+ * \brief Functions shared by the benchmark programs.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#ifndef VIPERS_BENCHMARK_HPP
+#define VIPERS_BENCHMARK_HPP
+
+#include <PACC/Util/Timer.hpp>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace Benchmark
+{
+
+  using namespace std;
+
+  //! Get the number of iterations given as first argument of the program (inDefault if none or invalid)
+  inline unsigned long getIterations(int argc, char** argv, unsigned long inDefault)
+  {
+    if(argc<2)
+      return inDefault;
+    long lIterations = atol(argv[1]);
+    return (lIterations>0) ? static_cast<unsigned long>(lIterations) : inDefault;
+  }
+
+  //! Print the time per iteration of a variant, and its speedup over a reference time per iteration (0 for none)
+  inline double printTime(const string& inName, double inSeconds, unsigned long inIterations, double inReference = 0)
+  {
+    double lTime = (inIterations>0) ? inSeconds/inIterations : 0;
+
+    cout << "  " << left << setw(40) << inName << right << fixed;
+    if(lTime<1e-3)
+      cout << setprecision(1) << setw(10) << lTime*1e9 << " ns";
+    else
+      cout << setprecision(3) << setw(10) << lTime*1e3 << " ms";
+    if(inReference>0 && lTime>0)
+      cout << setprecision(2) << setw(8) << inReference/lTime << "x";
+    cout << endl;
+
+    return lTime;
+  }
+
+  //! Print whether the variants gave the same results, and get the value the program returns
+  inline int printCheck(const string& inName, unsigned long inNbMismatches)
+  {
+    if(inNbMismatches==0)
+    {
+      cout << "  " << inName << ": same results" << endl;
+      return 0;
+    }
+    cout << "  " << inName << ": " << inNbMismatches << " different results" << endl;
+    return 1;
+  }
+
+  //! Timer of the benchmarks (always running, see PACC::Timer)
+  typedef PACC::Timer Timer;
+
+}
+
+#endif //VIPERS_BENCHMARK_HPP
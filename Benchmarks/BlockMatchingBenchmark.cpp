@@ -0,0 +1,321 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file Benchmarks/BlockMatchingBenchmark.cpp
+ * \brief Benchmark of the block matching of the "bm" algorithm of OpticalFlowModule.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ *
+ * A source %Module moves a window over a smoothed noise texture by a constant displacement every frame.  Each
+ * iteration matches the blocks of one frame with the previous one: with cvCalcOpticalFlowBM() as the %Module did
+ * before, with an exhaustive scan of the range comparing blocks with PixelKernels::blockSad(), and with the
+ * predictive search of OpticalFlowModule (one thread, then the whole thread pool).  Every variant must find the
+ * displacement of the window for every block that stays in the image, at every frame (checks are not timed).
+ *
+ * Usage: vipersbench-blockmatching [iterations]
+ */
+
+#include "Benchmark.hpp"
+
+#include <OpticalFlow.hpp>
+#include <PixelKernels.hpp>
+#include <ThreadPool.hpp>
+
+#define VIPERS_UTILS_OPENCV
+#include <ImageUtils.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+using namespace VIPERS;
+using namespace std;
+
+#define BENCHMARK_DEFAULT_ITERATIONS 30
+#define BENCHMARK_WIDTH 640
+#define BENCHMARK_HEIGHT 480
+#define BENCHMARK_BLOCK_SIZE 16
+#define BENCHMARK_SHIFT_SIZE 8
+#define BENCHMARK_MAX_RANGE 8
+//! Displacement of the window over the texture every frame (the blocks move by the opposite)
+#define BENCHMARK_MOTION_X 2
+#define BENCHMARK_MOTION_Y 1
+
+namespace
+{
+
+  //! %Module producing a window over a texture, moved by a constant displacement every frame
+  class SourceModule : public Module
+  {
+    public:
+
+      SourceModule(unsigned long inNbFrames)
+        :Module("source", "Source", "1.0"),
+        mTextureWidth(BENCHMARK_WIDTH+BENCHMARK_MOTION_X*inNbFrames),
+        mTextureHeight(BENCHMARK_HEIGHT+BENCHMARK_MOTION_Y*inNbFrames),
+        mTexture(mTextureWidth*mTextureHeight),
+        mOutputImage(NULL)
+      {
+        mOutputSlot = newSlot(new ModuleSlot(this, "output-image", "Output image", "Window over the texture", &mOutputImage));
+
+        // Noise smoothed by a 3x3 box, so the difference between blocks grows with their distance
+        vector<unsigned char> lNoise(mTexture.size());
+        srand(1);
+        for(unsigned int i=0; i<lNoise.size(); i++)
+          lNoise[i] = static_cast<unsigned char>(rand());
+        for(unsigned int y=0; y<mTextureHeight; y++)
+          for(unsigned int x=0; x<mTextureWidth; x++)
+          {
+            unsigned int lSum = 0;
+            for(int j=-1; j<=1; j++)
+              for(int i=-1; i<=1; i++)
+                lSum += lNoise[clamp(y+j, mTextureHeight)*mTextureWidth + clamp(x+i, mTextureWidth)];
+            mTexture[y*mTextureWidth+x] = static_cast<unsigned char>(lSum/9);
+          }
+      }
+
+      ~SourceModule()
+      {
+        delete mOutputImage;
+      }
+
+      //! Get the image of a frame
+      const Image& getFrame(unsigned int inFrameNumber)
+      {
+        if(!mOutputImage)
+          mOutputImage = new Image(false);
+        unsigned char* lData = &mTexture[BENCHMARK_MOTION_Y*inFrameNumber*mTextureWidth + BENCHMARK_MOTION_X*inFrameNumber];
+        mOutputImage->create(BENCHMARK_WIDTH, BENCHMARK_HEIGHT, Image::eDepth8U, Image::eChannel1, false, reinterpret_cast<char*>(lData), mTextureWidth);
+        mOutputImage->setModel(Image::eModelGray);
+        return *mOutputImage;
+      }
+
+    protected:
+
+      void initFunction() { getFrame(0); }
+      void startFunction() {}
+      void pauseFunction() {}
+      void processFunction(unsigned int inFrameNumber) { getFrame(inFrameNumber); }
+      void stopFunction() {}
+      void resetFunction() {}
+      void updateParametersFunction() {}
+      string verifyParameterFunction(const Parameter& /*inParameter*/) const throw() { return ""; }
+
+      //! Clamp a coordinate to [0, inSize)
+      static unsigned int clamp(int inValue, unsigned int inSize)
+      {
+        return (inValue<0) ? 0 : ((inValue>=static_cast<int>(inSize)) ? inSize-1 : inValue);
+      }
+
+      unsigned int mTextureWidth; //!< Width of the texture
+      unsigned int mTextureHeight; //!< Height of the texture
+      vector<unsigned char> mTexture; //!< Smoothed noise
+      ModuleSlot* mOutputSlot; //!< Output slot
+      Image* mOutputImage; //!< Window over the texture (does not own its data)
+  };
+
+  //! Match the blocks of an image with another one by scanning the whole range, as the velocities of the optical flow
+  void matchExhaustive(const Image& inPrevious, const Image& inCurrent, IplImage* outVelX, IplImage* outVelY)
+  {
+    int lMaxX = inPrevious.getWidth()-BENCHMARK_BLOCK_SIZE;
+    int lMaxY = inPrevious.getHeight()-BENCHMARK_BLOCK_SIZE;
+
+    for(int j=0; j<outVelX->height; j++)
+    {
+      float* lVelX = reinterpret_cast<float*>(outVelX->imageData + j*outVelX->widthStep);
+      float* lVelY = reinterpret_cast<float*>(outVelY->imageData + j*outVelY->widthStep);
+      int lY = j*BENCHMARK_SHIFT_SIZE;
+
+      for(int i=0; i<outVelX->width; i++)
+      {
+        int lX = i*BENCHMARK_SHIFT_SIZE;
+        unsigned int lBest = 0xFFFFFFFF;
+        int lBestDX = 0;
+        int lBestDY = 0;
+
+        for(int lDY=-min(BENCHMARK_MAX_RANGE, lY); lDY<=min(BENCHMARK_MAX_RANGE, lMaxY-lY); lDY++)
+          for(int lDX=-min(BENCHMARK_MAX_RANGE, lX); lDX<=min(BENCHMARK_MAX_RANGE, lMaxX-lX); lDX++)
+          {
+            unsigned int lSad = PixelKernels::blockSad(reinterpret_cast<const unsigned char*>(inPrevious.getRow(lY))+lX, inPrevious.getRowLengthBytes(),
+                                                       reinterpret_cast<const unsigned char*>(inCurrent.getRow(lY+lDY))+lX+lDX, inCurrent.getRowLengthBytes(),
+                                                       BENCHMARK_BLOCK_SIZE, BENCHMARK_BLOCK_SIZE, lBest);
+            if(lSad<lBest)
+            {
+              lBest = lSad;
+              lBestDX = lDX;
+              lBestDY = lDY;
+            }
+          }
+
+        lVelX[i] = static_cast<float>(lBestDX);
+        lVelY[i] = static_cast<float>(lBestDY);
+      }
+    }
+  }
+
+  //! Count the blocks staying in the image whose velocity is not the displacement of the texture
+  unsigned long countWrongBlocks(const IplImage* inVelX, const IplImage* inVelY)
+  {
+    unsigned long lNbWrongBlocks = 0;
+
+    for(int j=0; j<inVelX->height; j++)
+    {
+      const float* lVelX = reinterpret_cast<const float*>(inVelX->imageData + j*inVelX->widthStep);
+      const float* lVelY = reinterpret_cast<const float*>(inVelY->imageData + j*inVelY->widthStep);
+      int lY = j*BENCHMARK_SHIFT_SIZE-BENCHMARK_MOTION_Y;
+
+      for(int i=0; i<inVelX->width; i++)
+      {
+        int lX = i*BENCHMARK_SHIFT_SIZE-BENCHMARK_MOTION_X;
+        if(lX<0 || lY<0)
+          continue;
+        lNbWrongBlocks += (cvRound(lVelX[i])!=-BENCHMARK_MOTION_X || cvRound(lVelY[i])!=-BENCHMARK_MOTION_Y);
+      }
+    }
+    return lNbWrongBlocks;
+  }
+
+  //! Get the value of a square size parameter
+  string getSizeString(unsigned int inSize)
+  {
+    ostringstream lSizeStr;
+    lSizeStr << inSize << " " << inSize;
+    return lSizeStr.str();
+  }
+
+  //! Get the velocity images of an output slot of the optical flow as an IplImage header
+  IplImage* getVelocityIplImage(Module& inModule, const string& inSlotName)
+  {
+    IplImage* lIplImage = NULL;
+    setToIplImage(*inModule.getOutputSlots().find(inSlotName)->second->getImage(), &lIplImage);
+    return lIplImage;
+  }
+
+}
+
+/*! \todo
+*/
+int main(int argc, char** argv)
+{
+  static const unsigned int lNbThreads[] = {1, 0};
+  unsigned long lIterations = Benchmark::getIterations(argc, argv, BENCHMARK_DEFAULT_ITERATIONS);
+  CvSize lVelocitySize = cvSize((BENCHMARK_WIDTH-BENCHMARK_BLOCK_SIZE)/BENCHMARK_SHIFT_SIZE, (BENCHMARK_HEIGHT-BENCHMARK_BLOCK_SIZE)/BENCHMARK_SHIFT_SIZE);
+  IplImage* lVelX = cvCreateImage(lVelocitySize, IPL_DEPTH_32F, 1);
+  IplImage* lVelY = cvCreateImage(lVelocitySize, IPL_DEPTH_32F, 1);
+  IplImage* lPreviousIpl = NULL;
+  IplImage* lCurrentIpl = NULL;
+  SourceModule lSource(lIterations);
+  Image lPrevious(false);
+  Benchmark::Timer lTimer;
+  unsigned long lMismatches = 0;
+  double lSeconds;
+  double lReference;
+  unsigned long i;
+
+  cout << "Block matching, " << BENCHMARK_WIDTH << "x" << BENCHMARK_HEIGHT << ", blocks of " << BENCHMARK_BLOCK_SIZE << " shifted by " << BENCHMARK_SHIFT_SIZE << ", range " << BENCHMARK_MAX_RANGE << ", " << lIterations << " iterations" << endl;
+
+  // cvCalcOpticalFlowBM(), which the module called before
+  lSeconds = 0;
+  for(i=1; i<=lIterations; i++)
+  {
+    const Image& lCurrent = lSource.getFrame(i-1);
+    lPrevious.create(lCurrent.getWidth(), lCurrent.getHeight(), Image::eDepth8U, Image::eChannel1, false, lCurrent.getData(), lCurrent.getRowLengthBytes());
+    setToIplImage(lPrevious, &lPreviousIpl);
+    setToIplImage(lSource.getFrame(i), &lCurrentIpl);
+    lTimer.reset();
+    cvCalcOpticalFlowBM(lPreviousIpl, lCurrentIpl, cvSize(BENCHMARK_BLOCK_SIZE, BENCHMARK_BLOCK_SIZE), cvSize(BENCHMARK_SHIFT_SIZE, BENCHMARK_SHIFT_SIZE), cvSize(BENCHMARK_MAX_RANGE, BENCHMARK_MAX_RANGE), 0, lVelX, lVelY);
+    lSeconds += lTimer.getValue();
+    cvReleaseImageHeader(&lPreviousIpl);
+    cvReleaseImageHeader(&lCurrentIpl);
+    lMismatches += countWrongBlocks(lVelX, lVelY);
+  }
+  lReference = Benchmark::printTime("cvCalcOpticalFlowBM", lSeconds, lIterations);
+
+  // Exhaustive scan with the SAD kernel
+  lSeconds = 0;
+  for(i=1; i<=lIterations; i++)
+  {
+    const Image& lCurrent = lSource.getFrame(i-1);
+    lPrevious.create(lCurrent.getWidth(), lCurrent.getHeight(), Image::eDepth8U, Image::eChannel1, false, lCurrent.getData(), lCurrent.getRowLengthBytes());
+    const Image& lNext = lSource.getFrame(i);
+    lTimer.reset();
+    matchExhaustive(lPrevious, lNext, lVelX, lVelY);
+    lSeconds += lTimer.getValue();
+    lMismatches += countWrongBlocks(lVelX, lVelY);
+  }
+  Benchmark::printTime("exhaustive, blockSad", lSeconds, lIterations, lReference);
+
+  // Predictive search of the module, with the previous velocities, on one thread then one per processor
+  for(unsigned int j=0; j<sizeof(lNbThreads)/sizeof(lNbThreads[0]); j++)
+  {
+    OpticalFlowModule lOpticalFlow;
+    IplImage* lModuleVelX;
+    IplImage* lModuleVelY;
+
+    ThreadPool::getInstance().setNumberThreads(lNbThreads[j]);
+    lOpticalFlow.setParameterValue("algorithm", "bm");
+    lOpticalFlow.setParameterValue("block-size", getSizeString(BENCHMARK_BLOCK_SIZE));
+    lOpticalFlow.setParameterValue("shift-size", getSizeString(BENCHMARK_SHIFT_SIZE));
+    lOpticalFlow.setParameterValue("max-range", getSizeString(BENCHMARK_MAX_RANGE));
+    lOpticalFlow.setParameterValue("use-previous", "1");
+    lOpticalFlow.connect(ModuleSlot::eSlotTypeInput, "input-gray-image", &lSource, "output-image");
+
+    lSource.init();
+    lSource.start();
+    lOpticalFlow.init();
+    lOpticalFlow.start();
+
+    // The module starts from a black previous image, frame 0 makes it match frame i with frame i-1 as the others
+    lSource.process(0);
+    lOpticalFlow.process(0);
+
+    lSeconds = 0;
+    for(i=1; i<=lIterations; i++)
+    {
+      lTimer.reset();
+      lSource.process(i);
+      lOpticalFlow.process(i);
+      lSeconds += lTimer.getValue();
+
+      lModuleVelX = getVelocityIplImage(lOpticalFlow, "output-velx");
+      lModuleVelY = getVelocityIplImage(lOpticalFlow, "output-vely");
+      lMismatches += countWrongBlocks(lModuleVelX, lModuleVelY);
+      cvReleaseImageHeader(&lModuleVelX);
+      cvReleaseImageHeader(&lModuleVelY);
+    }
+    Benchmark::printTime((lNbThreads[j]==1) ? "predictive, OpticalFlowModule, 1 thread" : "predictive, OpticalFlowModule, pool", lSeconds, lIterations, lReference);
+
+    lOpticalFlow.stop();
+    lSource.stop();
+    lOpticalFlow.disconnectAll();
+  }
+
+  cvReleaseImage(&lVelX);
+  cvReleaseImage(&lVelY);
+
+  return Benchmark::printCheck("Displacements of the blocks", lMismatches);
+}
@@ -0,0 +1,310 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file Benchmarks/CompositionBenchmark.cpp
+ * \brief Benchmark of the composition of a foreground over a background through a plain mask.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ *
+ * Each iteration composes one color frame, as the plain mask modes of Translucency (foreground weight below 255) and
+ * Embedding (weight 255) do, at 1280x720, 1920x1080 and 3840x2160.  The one-pass PixelKernels::composeMask(), scalar
+ * and vectorized, is compared with the passes the modules made before: copy of the background, scaling of both images
+ * in 8 bits temporary images and masked addition for Translucency, copy of the background then masked copy of the
+ * foreground for Embedding.  When built with OpenCV (BENCHMARK_OPENCV), these passes are the cvCopy(),
+ * cvConvertScale() and cvAdd() calls the modules made; otherwise, they are written the same way with lookup tables.
+ *
+ * Every frame is checked against a frame composed in floating point, each channel rounded once to the nearest
+ * integer.  composeMask() must give it exactly; the multi-pass composition rounds the scaled images before adding
+ * them, so it may differ by 1.
+ *
+ * Usage: vipersbench-compose [iterations]
+ */
+
+#include "Benchmark.hpp"
+
+#include <PixelKernels.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#ifdef BENCHMARK_OPENCV
+  #include <cv.h>
+#endif
+
+using namespace VIPERS;
+using namespace std;
+
+#define BENCHMARK_DEFAULT_ITERATIONS 20
+#define BENCHMARK_NB_CHANNELS 3
+//! Number of pixels of the runs of the mask, all selected or all not selected
+#define BENCHMARK_MASK_RUN 8
+
+namespace
+{
+
+  //! Images of a frame size, rows without padding
+  struct Frames
+  {
+    unsigned int mWidth; //!< Width in pixels
+    unsigned int mHeight; //!< Height in pixels
+    vector<unsigned char> mBackground; //!< Background color image
+    vector<unsigned char> mForeground; //!< Foreground color image
+    vector<unsigned char> mMask; //!< Plain mask, 0 or 255 by runs of pixels
+    vector<unsigned char> mExact; //!< Frame composed in floating point
+    vector<unsigned char> mFrame; //!< Frame composed by the variant being measured
+  };
+
+  //! Compose in floating point, each channel rounded once to the nearest integer (never a tie, 255 being odd)
+  void composeExact(Frames& ioFrames, unsigned char inForegroundWeight)
+  {
+    for(unsigned int i=0; i<ioFrames.mBackground.size(); i++)
+    {
+      if(ioFrames.mMask[i/BENCHMARK_NB_CHANNELS])
+        ioFrames.mExact[i] = static_cast<unsigned char>(floor((ioFrames.mBackground[i]*(255.0-inForegroundWeight) + ioFrames.mForeground[i]*static_cast<double>(inForegroundWeight))/255.0 + 0.5));
+      else
+        ioFrames.mExact[i] = ioFrames.mBackground[i];
+    }
+  }
+
+#ifdef BENCHMARK_OPENCV
+
+  //! OpenCV images over the images of a frame size, and the temporary images of the scaled background and foreground
+  struct MultiPassImages
+  {
+    MultiPassImages(Frames& ioFrames)
+    {
+      CvSize lSize = cvSize(ioFrames.mWidth, ioFrames.mHeight);
+      mBackground = cvCreateImageHeader(lSize, IPL_DEPTH_8U, BENCHMARK_NB_CHANNELS);
+      cvSetData(mBackground, &ioFrames.mBackground[0], ioFrames.mWidth*BENCHMARK_NB_CHANNELS);
+      mForeground = cvCreateImageHeader(lSize, IPL_DEPTH_8U, BENCHMARK_NB_CHANNELS);
+      cvSetData(mForeground, &ioFrames.mForeground[0], ioFrames.mWidth*BENCHMARK_NB_CHANNELS);
+      mMask = cvCreateImageHeader(lSize, IPL_DEPTH_8U, 1);
+      cvSetData(mMask, &ioFrames.mMask[0], ioFrames.mWidth);
+      mFrame = cvCreateImageHeader(lSize, IPL_DEPTH_8U, BENCHMARK_NB_CHANNELS);
+      cvSetData(mFrame, &ioFrames.mFrame[0], ioFrames.mWidth*BENCHMARK_NB_CHANNELS);
+      mTmp1 = cvCreateImage(lSize, IPL_DEPTH_8U, BENCHMARK_NB_CHANNELS);
+      mTmp2 = cvCreateImage(lSize, IPL_DEPTH_8U, BENCHMARK_NB_CHANNELS);
+    }
+    ~MultiPassImages()
+    {
+      cvReleaseImageHeader(&mBackground);
+      cvReleaseImageHeader(&mForeground);
+      cvReleaseImageHeader(&mMask);
+      cvReleaseImageHeader(&mFrame);
+      cvReleaseImage(&mTmp1);
+      cvReleaseImage(&mTmp2);
+    }
+
+    IplImage* mBackground; //!< Background color image
+    IplImage* mForeground; //!< Foreground color image
+    IplImage* mMask; //!< Plain mask
+    IplImage* mFrame; //!< Composed frame
+    IplImage* mTmp1; //!< Scaled background
+    IplImage* mTmp2; //!< Scaled foreground
+  };
+
+  //! Compose as Translucency (weight below 255) or Embedding (weight 255) did with OpenCV
+  void composeMultiPass(Frames& /*ioFrames*/, MultiPassImages& ioImages, unsigned char inForegroundWeight)
+  {
+    cvCopy(ioImages.mBackground, ioImages.mFrame);
+    if(inForegroundWeight==255)
+      cvCopy(ioImages.mForeground, ioImages.mFrame, ioImages.mMask);
+    else
+    {
+      cvConvertScale(ioImages.mBackground, ioImages.mTmp1, (255-inForegroundWeight)/255.0);
+      cvConvertScale(ioImages.mForeground, ioImages.mTmp2, inForegroundWeight/255.0);
+      cvAdd(ioImages.mTmp1, ioImages.mTmp2, ioImages.mFrame, ioImages.mMask);
+    }
+  }
+
+  #define BENCHMARK_MULTI_PASS_NAME "OpenCV passes"
+
+#else
+
+  //! Temporary images of the scaled background and foreground
+  struct MultiPassImages
+  {
+    MultiPassImages(Frames& ioFrames)
+      :mTmp1(ioFrames.mBackground.size()),
+      mTmp2(ioFrames.mBackground.size())
+    {
+    }
+
+    vector<unsigned char> mTmp1; //!< Scaled background
+    vector<unsigned char> mTmp2; //!< Scaled foreground
+  };
+
+  //! Compose with the passes Translucency (weight below 255) or Embedding (weight 255) made, 8 bits images being scaled through a table as OpenCV does
+  void composeMultiPass(Frames& ioFrames, MultiPassImages& ioImages, unsigned char inForegroundWeight)
+  {
+    unsigned int lNbPixels = ioFrames.mWidth*ioFrames.mHeight;
+    unsigned int lNbBytes = lNbPixels*BENCHMARK_NB_CHANNELS;
+    unsigned char lBackgroundTable[256];
+    unsigned char lForegroundTable[256];
+    unsigned int i, c;
+
+    memcpy(&ioFrames.mFrame[0], &ioFrames.mBackground[0], lNbBytes);
+    if(inForegroundWeight==255)
+    {
+      for(i=0; i<lNbPixels; i++)
+      {
+        if(ioFrames.mMask[i])
+          memcpy(&ioFrames.mFrame[i*BENCHMARK_NB_CHANNELS], &ioFrames.mForeground[i*BENCHMARK_NB_CHANNELS], BENCHMARK_NB_CHANNELS);
+      }
+      return;
+    }
+
+    for(i=0; i<256; i++)
+    {
+      lBackgroundTable[i] = static_cast<unsigned char>(floor(i*(255-inForegroundWeight)/255.0 + 0.5));
+      lForegroundTable[i] = static_cast<unsigned char>(floor(i*inForegroundWeight/255.0 + 0.5));
+    }
+    for(i=0; i<lNbBytes; i++)
+      ioImages.mTmp1[i] = lBackgroundTable[ioFrames.mBackground[i]];
+    for(i=0; i<lNbBytes; i++)
+      ioImages.mTmp2[i] = lForegroundTable[ioFrames.mForeground[i]];
+    for(i=0; i<lNbPixels; i++)
+    {
+      if(!ioFrames.mMask[i])
+        continue;
+      for(c=0; c<BENCHMARK_NB_CHANNELS; c++)
+      {
+        unsigned int lSum = ioImages.mTmp1[i*BENCHMARK_NB_CHANNELS+c] + ioImages.mTmp2[i*BENCHMARK_NB_CHANNELS+c];
+        ioFrames.mFrame[i*BENCHMARK_NB_CHANNELS+c] = static_cast<unsigned char>((lSum>255) ? 255 : lSum);
+      }
+    }
+  }
+
+  #define BENCHMARK_MULTI_PASS_NAME "multi-pass"
+
+#endif
+
+  //! Compose in one pass, one row at a time
+  void composeRows(Frames& ioFrames, unsigned char inForegroundWeight)
+  {
+    unsigned int lRowBytes = ioFrames.mWidth*BENCHMARK_NB_CHANNELS;
+
+    for(unsigned int y=0; y<ioFrames.mHeight; y++)
+      PixelKernels::composeMask(&ioFrames.mBackground[y*lRowBytes], &ioFrames.mForeground[y*lRowBytes], &ioFrames.mMask[y*ioFrames.mWidth], &ioFrames.mFrame[y*lRowBytes], ioFrames.mWidth, BENCHMARK_NB_CHANNELS, inForegroundWeight, false);
+  }
+
+  //! Count the bytes of the composed frame differing from the exact frame by more than inTolerance, and keep the largest difference
+  unsigned long countDifferences(const Frames& inFrames, unsigned int inTolerance, unsigned int& ioMaxDifference)
+  {
+    unsigned long lNbDifferences = 0;
+    for(unsigned int i=0; i<inFrames.mFrame.size(); i++)
+    {
+      unsigned int lDifference = (inFrames.mFrame[i]>inFrames.mExact[i]) ? inFrames.mFrame[i]-inFrames.mExact[i] : inFrames.mExact[i]-inFrames.mFrame[i];
+      lNbDifferences += (lDifference>inTolerance);
+      if(lDifference>ioMaxDifference)
+        ioMaxDifference = lDifference;
+    }
+    return lNbDifferences;
+  }
+
+  //! Compose frames of a size with every variant, and count the frames that do not match the exact frame
+  unsigned long runSize(unsigned int inWidth, unsigned int inHeight, unsigned long inIterations)
+  {
+    static const unsigned char lWeights[] = {128, 255};
+    PixelKernels::InstructionSet lInstructionSet = PixelKernels::getSupportedInstructionSet();
+    Frames lFrames;
+    Benchmark::Timer lTimer;
+    unsigned long lMismatches = 0;
+    unsigned int lMaxDifference = 0;
+    double lReferenceTime;
+    unsigned long i;
+    unsigned int j;
+
+    lFrames.mWidth = inWidth;
+    lFrames.mHeight = inHeight;
+    lFrames.mBackground.resize(inWidth*inHeight*BENCHMARK_NB_CHANNELS);
+    lFrames.mForeground.resize(lFrames.mBackground.size());
+    lFrames.mMask.resize(inWidth*inHeight);
+    lFrames.mExact.resize(lFrames.mBackground.size());
+    lFrames.mFrame.resize(lFrames.mBackground.size());
+
+    srand(1);
+    for(i=0; i<lFrames.mBackground.size(); i++)
+    {
+      lFrames.mBackground[i] = static_cast<unsigned char>(rand());
+      lFrames.mForeground[i] = static_cast<unsigned char>(rand());
+    }
+    for(i=0; i<lFrames.mMask.size(); i+=BENCHMARK_MASK_RUN)
+      memset(&lFrames.mMask[i], (rand()%2) ? 255 : 0, (lFrames.mMask.size()-i<BENCHMARK_MASK_RUN) ? lFrames.mMask.size()-i : BENCHMARK_MASK_RUN);
+
+    MultiPassImages lMultiPassImages(lFrames);
+
+    cout << "Plain mask composition, " << inWidth << "x" << inHeight << " color, " << inIterations << " iterations" << endl;
+
+    for(j=0; j<sizeof(lWeights)/sizeof(lWeights[0]); j++)
+    {
+      ostringstream lPrefix;
+      lPrefix << "weight " << static_cast<unsigned int>(lWeights[j]) << ", ";
+      composeExact(lFrames, lWeights[j]);
+
+      lTimer.reset();
+      for(i=0; i<inIterations; i++)
+        composeMultiPass(lFrames, lMultiPassImages, lWeights[j]);
+      lReferenceTime = Benchmark::printTime(lPrefix.str() + BENCHMARK_MULTI_PASS_NAME, lTimer.getValue(), inIterations);
+      lMismatches += countDifferences(lFrames, 1, lMaxDifference);
+
+      PixelKernels::setInstructionSet(PixelKernels::eInstructionSetScalar);
+      lTimer.reset();
+      for(i=0; i<inIterations; i++)
+        composeRows(lFrames, lWeights[j]);
+      Benchmark::printTime(lPrefix.str() + "composeMask, scalar", lTimer.getValue(), inIterations, lReferenceTime);
+      lMismatches += countDifferences(lFrames, 0, lMaxDifference);
+
+      PixelKernels::setInstructionSet(lInstructionSet);
+      lTimer.reset();
+      for(i=0; i<inIterations; i++)
+        composeRows(lFrames, lWeights[j]);
+      Benchmark::printTime(lPrefix.str() + "composeMask, vectorized", lTimer.getValue(), inIterations, lReferenceTime);
+      lMismatches += countDifferences(lFrames, 0, lMaxDifference);
+    }
+
+    cout << "  largest difference of the multi-pass frames to the exact ones: " << lMaxDifference << endl;
+    return lMismatches;
+  }
+
+}
+
+/*! \todo
+*/
+int main(int argc, char** argv)
+{
+  static const unsigned int lSizes[][2] = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+  unsigned long lIterations = Benchmark::getIterations(argc, argv, BENCHMARK_DEFAULT_ITERATIONS);
+  unsigned long lMismatches = 0;
+
+  for(unsigned int i=0; i<sizeof(lSizes)/sizeof(lSizes[0]); i++)
+    lMismatches += runSize(lSizes[i][0], lSizes[i][1], lIterations);
+
+  return Benchmark::printCheck("One-pass and multi-pass compositions against the exact frame", lMismatches);
+}
@@ -0,0 +1,193 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file Benchmarks/ConversionBenchmark.cpp
+ * \brief Benchmark of the number conversions of Converter and Variable.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ *
+ * Each iteration formats a number to a string and parses it back.  Converter and Variable are compared with the
+ * string streams they used before (same precision and notation), and must read back every value exactly.
+ *
+ * Usage: vipersbench-conversion [iterations]
+ */
+
+#include "Benchmark.hpp"
+
+#include <Converter.hpp>
+#include <Variable.hpp>
+
+#include <sstream>
+#include <vector>
+
+using namespace VIPERS;
+using namespace std;
+
+#define BENCHMARK_DEFAULT_ITERATIONS 200000
+#define BENCHMARK_NB_VALUES 4096
+
+namespace
+{
+
+  //! Format and parse a number with a string stream, as Converter did before
+  template <class T>
+  T convertWithStream(T inValue, int inPrecision)
+  {
+    ostringstream lOutStr;
+    if(inPrecision>0)
+    {
+      lOutStr.precision(inPrecision);
+      lOutStr.setf(ios::scientific, ios::floatfield);
+    }
+    lOutStr << inValue;
+
+    T lValue = 0;
+    istringstream lInStr(lOutStr.str());
+    lInStr >> lValue;
+    return lValue;
+  }
+
+  //! Get a random integer covering the whole range of an int
+  int getRandomInt()
+  {
+    return static_cast<int>((static_cast<unsigned int>(rand()) << 16) ^ static_cast<unsigned int>(rand()));
+  }
+
+  //! Get a random double with a random exponent
+  double getRandomDouble()
+  {
+    double lMantissa = static_cast<double>(rand())/RAND_MAX + static_cast<double>(rand())/RAND_MAX/RAND_MAX;
+    int lExponent = rand()%41 - 20;
+    double lValue = lMantissa;
+    for(int i=0; i<lExponent; i++)
+      lValue *= 10;
+    for(int i=0; i>lExponent; i--)
+      lValue /= 10;
+    return (rand()%2) ? lValue : -lValue;
+  }
+
+}
+
+/*! \todo
+*/
+int main(int argc, char** argv)
+{
+  unsigned long lIterations = Benchmark::getIterations(argc, argv, BENCHMARK_DEFAULT_ITERATIONS);
+  vector<int> lInts(BENCHMARK_NB_VALUES);
+  vector<float> lFloats(BENCHMARK_NB_VALUES);
+  vector<double> lDoubles(BENCHMARK_NB_VALUES);
+  Variable lIntVariable("value", Variable::eVariableTypeInt, "Value", "Integer value");
+  Variable lDoubleVariable("value", Variable::eVariableTypeDouble, "Value", "Double value");
+  Benchmark::Timer lTimer;
+  unsigned long lMismatches = 0;
+  double lSum = 0;
+  double lReference;
+  unsigned long i;
+
+  srand(1);
+  for(i=0; i<BENCHMARK_NB_VALUES; i++)
+  {
+    lInts[i] = getRandomInt();
+    lDoubles[i] = getRandomDouble();
+    lFloats[i] = static_cast<float>(getRandomDouble());
+  }
+
+  cout << "Number conversions, format then parse, " << lIterations << " iterations" << endl;
+
+  // Integers
+  lTimer.reset();
+  for(i=0; i<lIterations; i++)
+    lSum += convertWithStream(lInts[i%BENCHMARK_NB_VALUES], 0);
+  lReference = Benchmark::printTime("int, string streams", lTimer.getValue(), lIterations);
+
+  lTimer.reset();
+  for(i=0; i<lIterations; i++)
+  {
+    int lValue = Converter(Converter(lInts[i%BENCHMARK_NB_VALUES]).toString()).toInt();
+    lMismatches += (lValue!=lInts[i%BENCHMARK_NB_VALUES]);
+    lSum += lValue;
+  }
+  Benchmark::printTime("int, Converter", lTimer.getValue(), lIterations, lReference);
+
+  lTimer.reset();
+  for(i=0; i<lIterations; i++)
+  {
+    lIntVariable.setValue(lInts[i%BENCHMARK_NB_VALUES]);
+    lIntVariable.setValueStr(lIntVariable.toString());
+    int lValue = lIntVariable.toInt();
+    lMismatches += (lValue!=lInts[i%BENCHMARK_NB_VALUES]);
+    lSum += lValue;
+  }
+  Benchmark::printTime("int, Variable", lTimer.getValue(), lIterations, lReference);
+
+  // Floats
+  lTimer.reset();
+  for(i=0; i<lIterations; i++)
+    lSum += convertWithStream(lFloats[i%BENCHMARK_NB_VALUES], 6);
+  lReference = Benchmark::printTime("float, string streams", lTimer.getValue(), lIterations);
+
+  lTimer.reset();
+  for(i=0; i<lIterations; i++)
+  {
+    float lValue = Converter(Converter(lFloats[i%BENCHMARK_NB_VALUES]).toString()).toFloat();
+    lMismatches += (lValue!=lFloats[i%BENCHMARK_NB_VALUES]);
+    lSum += lValue;
+  }
+  Benchmark::printTime("float, Converter", lTimer.getValue(), lIterations, lReference);
+
+  // Doubles
+  lTimer.reset();
+  for(i=0; i<lIterations; i++)
+    lSum += convertWithStream(lDoubles[i%BENCHMARK_NB_VALUES], 15);
+  lReference = Benchmark::printTime("double, string streams", lTimer.getValue(), lIterations);
+
+  lTimer.reset();
+  for(i=0; i<lIterations; i++)
+  {
+    double lValue = Converter(Converter(lDoubles[i%BENCHMARK_NB_VALUES]).toString()).toDouble();
+    lMismatches += (lValue!=lDoubles[i%BENCHMARK_NB_VALUES]);
+    lSum += lValue;
+  }
+  Benchmark::printTime("double, Converter", lTimer.getValue(), lIterations, lReference);
+
+  lTimer.reset();
+  for(i=0; i<lIterations; i++)
+  {
+    lDoubleVariable.setValue(lDoubles[i%BENCHMARK_NB_VALUES]);
+    lDoubleVariable.setValueStr(lDoubleVariable.toString());
+    double lValue = lDoubleVariable.toDouble();
+    lMismatches += (lValue!=lDoubles[i%BENCHMARK_NB_VALUES]);
+    lSum += lValue;
+  }
+  Benchmark::printTime("double, Variable", lTimer.getValue(), lIterations, lReference);
+
+  // The sum keeps the compiler from removing the loops
+  if(lSum==0)
+    cout << "  (sum is 0)" << endl;
+
+  return Benchmark::printCheck("Exact round trips", lMismatches);
+}
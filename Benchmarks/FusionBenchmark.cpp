@@ -0,0 +1,467 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file Benchmarks/FusionBenchmark.cpp
+ * \brief Benchmark of the processing of module chains by strips of rows (operator fusion).
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ *
+ * A source %Module feeds a chain of modules with pointwise kernels, alternating vertical smoothings that read a row
+ * halo and per pixel mappings.  Each iteration processes one frame of the chain, either one %Module after the other
+ * over whole frames (unfused), or by strips of rows with Kernel::processModuleChain() (fused).  The fused chain is
+ * also processed with its per pixel mappings written in place over the intermediate image they read, as the kernel
+ * does for chains (see Kernel::updateInPlaceOutputs()), which leaves fewer images for the chain to write.  Every
+ * variant must give the same last image.
+ *
+ * Usage: vipersbench-fusion [iterations]
+ */
+
+#include "Benchmark.hpp"
+
+#include <Kernel.hpp>
+#include <Image.hpp>
+
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <vector>
+
+using namespace VIPERS;
+using namespace std;
+
+#define BENCHMARK_DEFAULT_ITERATIONS 100
+#define BENCHMARK_WIDTH 1920
+#define BENCHMARK_HEIGHT 1080
+#define BENCHMARK_NB_STAGES 3
+
+#define SLOT_NAME_INPUT "input-image"
+#define SLOT_NAME_OUTPUT "output-image"
+
+namespace
+{
+
+  //! %Kernel giving access to the processing of a chain by strips
+  class BenchmarkKernel : public Kernel
+  {
+    public:
+
+      void init() {}
+      void start() {}
+      void pause() {}
+      void stop() {}
+      void refresh() {}
+      void step() {}
+      void reset() {}
+
+      //! Process one frame of a chain by strips of rows
+      void processChain(const ModuleChain& inModuleChain, unsigned int inFrameNumber)
+      {
+        processModuleChain(inModuleChain, inFrameNumber);
+      }
+      //! Write the intermediate images of a chain in place when its modules can, or make them all use their own image again
+      void setChainInPlace(const SortedLevelModuleMap& inSortedLevelModuleMap, const ModuleChain& inModuleChain, bool inInPlace)
+      {
+        ModuleChainMap lModuleChainMap;
+        lModuleChainMap[inModuleChain.front()] = inModuleChain;
+        if(inInPlace)
+          updateInPlaceOutputs(inSortedLevelModuleMap, lModuleChainMap, true);
+        else
+          clearInPlaceOutputs();
+      }
+  };
+
+  //! %Module producing the same gray scale noise image every frame
+  class SourceModule : public Module
+  {
+    public:
+
+      SourceModule()
+        :Module("source", "Source", "1.0"),
+        mOutputImage(NULL)
+      {
+        mOutputSlot = newSlot(new ModuleSlot(this, SLOT_NAME_OUTPUT, "Output image", "Noise image", &mOutputImage));
+      }
+
+      ~SourceModule()
+      {
+        delete mOutputImage;
+      }
+
+    protected:
+
+      void initFunction()
+      {
+        delete mOutputImage;
+        mOutputImage = new Image();
+        mOutputImage->create(BENCHMARK_WIDTH, BENCHMARK_HEIGHT, Image::eDepth8U, Image::eChannel1);
+        mOutputImage->setModel(Image::eModelGray);
+
+        srand(1);
+        for(unsigned int y=0; y<BENCHMARK_HEIGHT; y++)
+        {
+          unsigned char* lRow = reinterpret_cast<unsigned char*>(mOutputImage->getData() + y*mOutputImage->getRowLengthBytes());
+          for(unsigned int x=0; x<BENCHMARK_WIDTH; x++)
+            lRow[x] = static_cast<unsigned char>(rand());
+        }
+      }
+      void startFunction() {}
+      void pauseFunction() {}
+      void processFunction(unsigned int /*inFrameNumber*/) {}
+      void stopFunction() {}
+      void resetFunction() {}
+      void updateParametersFunction() {}
+      string verifyParameterFunction(const Parameter& /*inParameter*/) const throw() { return ""; }
+
+      ModuleSlot* mOutputSlot; //!< Output slot
+      Image* mOutputImage; //!< Noise image
+  };
+
+  //! %Module with a pointwise kernel computing each row of a gray scale image from the rows around it
+  class StageModule : public Module
+  {
+    public:
+
+      StageModule(const string& inName, unsigned int inRowHalo)
+        :Module(inName, inName, "1.0"),
+        mInputImage(NULL),
+        mOutputImage(NULL)
+      {
+        mInputSlot = newSlot(new ModuleSlot(this, SLOT_NAME_INPUT, "Input image", "Gray scale image"));
+        mOutputSlot = newSlot(new ModuleSlot(this, SLOT_NAME_OUTPUT, "Output image", "Gray scale image", &mOutputImage));
+        // Rows without a halo are only read before being written, they can be written over the input image
+        if(inRowHalo==0)
+          mOutputSlot->setInPlaceInput(mInputSlot);
+        setPointwiseKernel(true);
+        setRowHalo(inRowHalo);
+        setPlannedOutputs(true);
+      }
+
+      ~StageModule()
+      {
+        delete mOutputImage;
+      }
+
+    protected:
+
+      //! Compute one row of the output image
+      virtual void processRow(unsigned int inRow) = 0;
+
+      void initFunction()
+      {
+        if(!mInputSlot->isConnected())
+          throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" is not connected to an output slot") ));
+      }
+      void startFunction() {}
+      void pauseFunction() {}
+      void processFunction(unsigned int inFrameNumber)
+      {
+        mInputSlot->lock();
+        mOutputSlot->lock();
+
+        try
+        {
+          beginPointwiseFunction(inFrameNumber);
+          processPointwiseFunction(0, mOutputImage->getHeight());
+          endPointwiseFunction();
+        }
+        catch(...)
+        {
+          mOutputSlot->unlock();
+          mInputSlot->unlock();
+          throw;
+        }
+
+        mOutputSlot->unlock();
+        mInputSlot->unlock();
+      }
+      void stopFunction() {}
+      void resetFunction() {}
+      void updateParametersFunction() {}
+      string verifyParameterFunction(const Parameter& /*inParameter*/) const throw() { return ""; }
+
+      void beginPointwiseFunction(unsigned int /*inFrameNumber*/)
+      {
+        mInputImage = mInputSlot->getImage();
+        if(!mInputImage)
+          throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" does not have a valid image pointer (NULL)") ));
+
+        if(mOutputSlot->isInPlace())
+        {
+          if(mOutputImage && mOutputImage->getData()==mInputImage->getData() && mOutputImage->getWidth()==mInputImage->getWidth() && mOutputImage->getHeight()==mInputImage->getHeight())
+            return;
+          delete mOutputImage;
+          mOutputImage = new Image(false);
+          mOutputImage->create(mInputImage->getWidth(), mInputImage->getHeight(), Image::eDepth8U, Image::eChannel1, false, mInputImage->getData(), mInputImage->getRowLengthBytes());
+          mOutputImage->setModel(Image::eModelGray);
+        }
+        else if(!mOutputImage || !mOutputImage->isManaged() || mOutputImage->getWidth()!=mInputImage->getWidth() || mOutputImage->getHeight()!=mInputImage->getHeight())
+        {
+          delete mOutputImage;
+          mOutputImage = new Image();
+          mOutputImage->create(mInputImage->getWidth(), mInputImage->getHeight(), Image::eDepth8U, Image::eChannel1);
+          mOutputImage->setModel(Image::eModelGray);
+        }
+      }
+      void processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow)
+      {
+        for(unsigned int y=inFirstRow; y<inEndRow; y++)
+          processRow(y);
+      }
+      void endPointwiseFunction() {}
+
+      //! Get a row of the input image, clamped to the image
+      const unsigned char* getInputRow(int inRow) const
+      {
+        if(inRow<0)
+          inRow = 0;
+        else if(inRow>=mInputImage->getHeight())
+          inRow = mInputImage->getHeight()-1;
+        return reinterpret_cast<const unsigned char*>(mInputImage->getData() + inRow*mInputImage->getRowLengthBytes());
+      }
+      //! Get a row of the output image
+      unsigned char* getOutputRow(unsigned int inRow) const
+      {
+        return reinterpret_cast<unsigned char*>(mOutputImage->getData() + inRow*mOutputImage->getRowLengthBytes());
+      }
+
+      ModuleSlot* mInputSlot; //!< Input slot
+      ModuleSlot* mOutputSlot; //!< Output slot
+      const Image* mInputImage; //!< Input image of the current frame
+      Image* mOutputImage; //!< Output image
+  };
+
+  //! Vertical box filter over the 2*halo+1 rows around each row
+  class SmoothModule : public StageModule
+  {
+    public:
+
+      SmoothModule(const string& inName, unsigned int inRowHalo)
+        :StageModule(inName, inRowHalo),
+        mQuotients((2*inRowHalo+1)*256)
+      {
+        for(unsigned int i=0; i<mQuotients.size(); i++)
+          mQuotients[i] = static_cast<unsigned char>((i+inRowHalo)/(2*inRowHalo+1));
+      }
+
+    protected:
+
+      void processRow(unsigned int inRow)
+      {
+        int lHalo = getRowHalo();
+        unsigned int lWidth = mOutputImage->getWidth();
+        unsigned char* lOutputRow = getOutputRow(inRow);
+
+        mSums.assign(lWidth, 0);
+        for(int i=-lHalo; i<=lHalo; i++)
+        {
+          const unsigned char* lInputRow = getInputRow(static_cast<int>(inRow)+i);
+          for(unsigned int x=0; x<lWidth; x++)
+            mSums[x] += lInputRow[x];
+        }
+        for(unsigned int x=0; x<lWidth; x++)
+          lOutputRow[x] = mQuotients[mSums[x]];
+      }
+
+      vector<unsigned short> mSums; //!< Sum of the rows around the current row, for each column
+      vector<unsigned char> mQuotients; //!< Rounded mean of each sum
+  };
+
+  //! Per pixel contrast stretch through a lookup table
+  class StretchModule : public StageModule
+  {
+    public:
+
+      StretchModule(const string& inName)
+        :StageModule(inName, 0)
+      {
+        for(int i=0; i<256; i++)
+        {
+          int lValue = 128 + 2*(i-128);
+          mTable[i] = static_cast<unsigned char>(lValue<0 ? 0 : (lValue>255 ? 255 : lValue));
+        }
+      }
+
+    protected:
+
+      void processRow(unsigned int inRow)
+      {
+        const unsigned char* lInputRow = getInputRow(inRow);
+        unsigned char* lOutputRow = getOutputRow(inRow);
+        for(unsigned int x=0; x<mOutputImage->getWidth(); x++)
+          lOutputRow[x] = mTable[lInputRow[x]];
+      }
+
+      unsigned char mTable[256]; //!< Stretched value of each gray level
+  };
+
+  //! Count the bytes that differ between two gray scale images
+  unsigned long countDifferences(const Image& inImage, const vector<unsigned char>& inReference)
+  {
+    unsigned long lNbDifferences = 0;
+    for(int y=0; y<inImage.getHeight(); y++)
+    {
+      const unsigned char* lRow = reinterpret_cast<const unsigned char*>(inImage.getData() + y*inImage.getRowLengthBytes());
+      for(int x=0; x<inImage.getWidth(); x++)
+        lNbDifferences += (lRow[x]!=inReference[y*inImage.getWidth()+x]);
+    }
+    return lNbDifferences;
+  }
+
+  //! Copy a gray scale image without its row padding
+  void copyImage(const Image& inImage, vector<unsigned char>& outData)
+  {
+    outData.resize(inImage.getWidth()*inImage.getHeight());
+    for(int y=0; y<inImage.getHeight(); y++)
+      memcpy(&outData[y*inImage.getWidth()], inImage.getData() + y*inImage.getRowLengthBytes(), inImage.getWidth());
+  }
+
+  //! Count the distinct images written by the modules of a chain
+  unsigned int countImages(const ModuleChain& inModuleChain)
+  {
+    set<const char*> lDataSet;
+    for(unsigned int i=0; i<inModuleChain.size(); i++)
+      lDataSet.insert(inModuleChain[i]->getOutputSlots().begin()->second->getImage()->getData());
+    return lDataSet.size();
+  }
+
+  //! Process frames of a chain, unfused or fused, and check its last image against the unfused one (kept in ioReference the first time)
+  void runChain(BenchmarkKernel& ioKernel, SourceModule& ioSource, const SortedLevelModuleMap& inSortedLevelModuleMap, const ModuleChain& inModuleChain, unsigned int inRowHalo, unsigned long inIterations, vector<unsigned char>& ioReference, unsigned long& ioMismatches)
+  {
+    static const unsigned int lStripHeights[] = {0, 16, 1};
+    ostringstream lName;
+    Benchmark::Timer lTimer;
+    double lReference;
+    unsigned long i;
+    unsigned int j;
+
+    ioReference.clear();
+
+    lTimer.reset();
+    for(i=0; i<inIterations; i++)
+    {
+      ioSource.process(i);
+      for(j=0; j<inModuleChain.size(); j++)
+        inModuleChain[j]->process(i);
+    }
+    lName << "halo " << inRowHalo << ", unfused";
+    lReference = Benchmark::printTime(lName.str(), lTimer.getValue(), inIterations);
+    copyImage(*inModuleChain.back()->getOutputSlots().begin()->second->getImage(), ioReference);
+
+    for(j=0; j<sizeof(lStripHeights)/sizeof(lStripHeights[0]); j++)
+    {
+      ioKernel.setStripHeight(lStripHeights[j]);
+      lTimer.reset();
+      for(i=0; i<inIterations; i++)
+      {
+        ioSource.process(i);
+        ioKernel.processChain(inModuleChain, i);
+      }
+      lName.str("");
+      lName << "halo " << inRowHalo << ", fused, strips of ";
+      if(lStripHeights[j]==0)
+        lName << "L2 size";
+      else
+        lName << lStripHeights[j] << " rows";
+      Benchmark::printTime(lName.str(), lTimer.getValue(), inIterations, lReference);
+      ioMismatches += countDifferences(*inModuleChain.back()->getOutputSlots().begin()->second->getImage(), ioReference);
+    }
+
+    ioKernel.setStripHeight(0);
+    ioKernel.setChainInPlace(inSortedLevelModuleMap, inModuleChain, true);
+    lTimer.reset();
+    for(i=0; i<inIterations; i++)
+    {
+      ioSource.process(i);
+      ioKernel.processChain(inModuleChain, i);
+    }
+    lName.str("");
+    lName << "halo " << inRowHalo << ", fused in place, images: " << countImages(inModuleChain);
+    Benchmark::printTime(lName.str(), lTimer.getValue(), inIterations, lReference);
+    ioMismatches += countDifferences(*inModuleChain.back()->getOutputSlots().begin()->second->getImage(), ioReference);
+    ioKernel.setChainInPlace(inSortedLevelModuleMap, inModuleChain, false);
+  }
+
+}
+
+/*! \todo
+*/
+int main(int argc, char** argv)
+{
+  static const unsigned int lRowHalos[] = {0, 1, 2};
+  unsigned long lIterations = Benchmark::getIterations(argc, argv, BENCHMARK_DEFAULT_ITERATIONS);
+  BenchmarkKernel lKernel;
+  vector<unsigned char> lReference;
+  unsigned long lMismatches = 0;
+  unsigned int i, j;
+
+  cout << "Chain of " << 2*BENCHMARK_NB_STAGES << " modules with pointwise kernels, " << BENCHMARK_WIDTH << "x" << BENCHMARK_HEIGHT << " gray scale, " << lIterations << " iterations" << endl;
+
+  for(i=0; i<sizeof(lRowHalos)/sizeof(lRowHalos[0]); i++)
+  {
+    SourceModule lSource;
+    vector<Module*> lModules;
+    SortedLevelModuleMap lSortedLevelModuleMap;
+    Module* lPreviousModule = &lSource;
+
+    lSortedLevelModuleMap.insert(make_pair(0, lPreviousModule));
+    for(j=0; j<2*BENCHMARK_NB_STAGES; j++)
+    {
+      ostringstream lName;
+      lName << ((j%2==0) ? "smooth" : "stretch") << j/2;
+      if(j%2==0)
+        lModules.push_back(new SmoothModule(lName.str(), lRowHalos[i]));
+      else
+        lModules.push_back(new StretchModule(lName.str()));
+      lModules.back()->connect(ModuleSlot::eSlotTypeInput, SLOT_NAME_INPUT, lPreviousModule, SLOT_NAME_OUTPUT);
+      lSortedLevelModuleMap.insert(make_pair(j+1, lModules.back()));
+      lPreviousModule = lModules.back();
+    }
+
+    lSource.init();
+    lSource.start();
+    for(j=0; j<lModules.size(); j++)
+    {
+      lModules[j]->init();
+      lModules[j]->start();
+    }
+
+    // The whole chain after the source must be found by the kernel
+    ModuleChainMap lModuleChainMap = lKernel.computeFusedModuleChains(lSortedLevelModuleMap);
+    if(lModuleChainMap.size()!=1 || lModuleChainMap.begin()->second.size()!=lModules.size())
+    {
+      cout << "  halo " << lRowHalos[i] << ": the modules were not fused in a single chain" << endl;
+      lMismatches++;
+    }
+    else
+      runChain(lKernel, lSource, lSortedLevelModuleMap, lModuleChainMap.begin()->second, lRowHalos[i], lIterations, lReference, lMismatches);
+
+    for(j=0; j<lModules.size(); j++)
+      delete lModules[j];
+  }
+
+  return Benchmark::printCheck("Fused and unfused last images", lMismatches);
+}
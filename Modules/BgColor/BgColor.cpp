@@ -108,7 +108,7 @@ BgColorModule::~BgColorModule()
 
 	if(mOutputImageIpl)
 	{
-		cvReleaseImage(&mOutputImageIpl);
+		releaseIplImage(&mOutputImageIpl);
     delete mOutputImage;
 	}
 }
@@ -159,11 +159,11 @@ void BgColorModule::processFunction(unsigned int inFrameNumber)
 		mParamImageSize->setValue(lSize);
 		if(mOutputImageIpl)
 		{
-			cvReleaseImage(&mOutputImageIpl);
+			releaseIplImage(&mOutputImageIpl);
 		  delete mOutputImage;
 		}
 
-		mOutputImageIpl = cvCreateImage(cvSize(lSize[0], lSize[1]), IPL_DEPTH_8U, 3);
+		mOutputImageIpl = createIplImage(cvSize(lSize[0], lSize[1]), IPL_DEPTH_8U, 3);
 		mOutputImage = new Image(false);
 		setFromIplImage(mOutputImageIpl, *mOutputImage);
 		mOutputImage->setModel(Image::eModelRGB);
@@ -196,7 +196,7 @@ void BgColorModule::processFunction(unsigned int inFrameNumber)
 		if(lNeedRedraw)
 			cvSet(mOutputImageIpl, cvScalar(lColor[2], lColor[1], lColor[0]));
 	}
-
+	stampFrameMetadata(*mOutputImage, inFrameNumber);
 
 	mOutputSlot->unlock();
 
@@ -216,7 +216,7 @@ void BgColorModule::resetFunction()
 	if(mOutputImage)
 	{
 		mOutputSlot->lock();
-		cvReleaseImage(&mOutputImageIpl);
+		releaseIplImage(&mOutputImageIpl);
 		mOutputImageIpl = NULL;
 		delete mOutputImage;
 		mOutputImage = NULL;
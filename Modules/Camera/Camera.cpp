@@ -52,6 +52,7 @@ using namespace std;
 #define PARAMETER_NAME_FRAMESIZE "frame-size"
 #define PARAMETER_NAME_FRAMERATE "frame-rate"
 #define PARAMETER_NAME_CAMERAINDEX "camera-index"
+#define PARAMETER_NAME_OUTPUTFORMAT "output-format"
 
 /*! TODO:
 */
@@ -59,7 +60,8 @@ CameraModule::CameraModule()
 	:Module(MODULE_NAME, MODULE_DISPLAY_NAME, CAMERAMODULE_VERSION),
 	 mParamCameraIndex(PARAMETER_NAME_CAMERAINDEX, Variable::eVariableTypeInt, "Camera index", "Camera index (starts from 0)", false),
 	 mParamFrameSize(PARAMETER_NAME_FRAMESIZE, Variable::eVariableTypeSize, "Size", "Frame size", false),
-	 mParamFrameRate(PARAMETER_NAME_FRAMERATE, Variable::eVariableTypeDouble, "FPS", "Frame rate of the camera", false)
+	 mParamFrameRate(PARAMETER_NAME_FRAMERATE, Variable::eVariableTypeDouble, "FPS", "Frame rate of the camera", false),
+	 mParamOutputFormat(PARAMETER_NAME_OUTPUTFORMAT, Variable::eVariableTypeString, "Output format", "Format of the output frame", false)
 {
 	mShortDescription = "Module for acquiring frames from a camera";
 	mLongDescription = "This is a simple module to acquire frames from a camera that is known to work with OpenCV";
@@ -73,9 +75,23 @@ CameraModule::CameraModule()
 	mParamFrameRate.setMinValue("0");
 	mParamFrameRate.setMaxValue("200");
 
+	ValueSet lTmpFormatName;
+	lTmpFormatName.insert(Value("interleaved", "Interleaved", "Interleaved color frame, as acquired"));
+	lTmpFormatName.insert(Value("i420", "YUV 4:2:0 (I420)", "Planar luma and subsampled chroma; the first plane can be used as a gray scale image"));
+	lTmpFormatName.insert(Value("nv12", "YUV 4:2:0 (NV12)", "Luma plane and interleaved subsampled chroma plane; the first plane can be used as a gray scale image"));
+	lTmpFormatName.insert(Value("planar-rgb", "Planar RGB", "Red, green and blue planes"));
+	mParamOutputFormat.setPossibleValues(lTmpFormatName);
+	mParamOutputFormat.setValueStr("interleaved");
+
+	mOutputFormatMap["interleaved"] = Image::eModelRGB;
+	mOutputFormatMap["i420"] = Image::eModelI420;
+	mOutputFormatMap["nv12"] = Image::eModelNV12;
+	mOutputFormatMap["planar-rgb"] = Image::eModelPlanarRGB;
+
 	newParameter(mParamCameraIndex);
 	newParameter(mParamFrameSize);
 	newParameter(mParamFrameRate);
+	newParameter(mParamOutputFormat);
 
 	mOutputSlot = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_FRAME, OUTPUT_SLOT_DISPLAYNAME_FRAME, "Frame coming from the specified camera", &mOutputFrame));
 
@@ -89,10 +105,9 @@ CameraModule::CameraModule()
 CameraModule::~CameraModule()
 {
 	if(mOutputFrameIpl)
-	{
-		cvReleaseImage(&mOutputFrameIpl);
-	  delete mOutputFrameIpl;
-	}
+		releaseIplImage(&mOutputFrameIpl);
+	if(mOutputFrame)
+		delete mOutputFrame;
 	if(mCameraCapture)
 		cvReleaseCapture(&mCameraCapture);
 }
@@ -108,6 +123,7 @@ void CameraModule::initFunction()
 	Parameter lParamCameraIndex = getLockedParameter(PARAMETER_NAME_CAMERAINDEX);
 	Parameter lParamFrameSize = getLockedParameter(PARAMETER_NAME_FRAMESIZE);
 	Parameter lParamFrameRate = getLockedParameter(PARAMETER_NAME_FRAMERATE);
+	Parameter lParamOutputFormat = getLockedParameter(PARAMETER_NAME_OUTPUTFORMAT);
 	unlockParameters();
 
 	if(mCameraCapture)
@@ -143,19 +159,46 @@ void CameraModule::initFunction()
 	mParamCameraIndex = lParamCameraIndex;
 	mParamFrameSize = lParamFrameSize;
 	mParamFrameRate = lParamFrameRate;
+	mParamOutputFormat = lParamOutputFormat;
 
 	mOutputSlot->lock();
 
 	if(mOutputFrameIpl)
 	{
-		cvReleaseImage(&mOutputFrameIpl);
+		releaseIplImage(&mOutputFrameIpl);
+		mOutputFrameIpl = NULL;
+	}
+	if(mOutputFrame)
+	{
 		delete mOutputFrame;
+		mOutputFrame = NULL;
 	}
 
-	mOutputFrameIpl = cvCloneImage(lTmpImage);
-	mOutputFrame = new Image(false);
-	setFromIplImage(mOutputFrameIpl, *mOutputFrame);
-	mOutputFrame->setModel(Image::eModelRGB);
+	Image::Model lOutputModel = mOutputFormatMap[mParamOutputFormat.toString()];
+	if(lOutputModel==Image::eModelRGB)
+	{
+		mOutputFrameIpl = cloneIplImage(lTmpImage);
+		mOutputFrame = new Image(false);
+		setFromIplImage(mOutputFrameIpl, *mOutputFrame);
+		mOutputFrame->setModel(Image::eModelRGB);
+	}
+	else
+	{
+		// Planar frames are converted once here, so downstream modules can use a single plane without any copy
+		mOutputFrame = new Image(lTmpImage->width, lTmpImage->height, lOutputModel);
+		if(!convertFromIplImage(lTmpImage, *mOutputFrame))
+		{
+			delete mOutputFrame;
+			mOutputFrame = NULL;
+			mOutputSlot->unlock();
+			cvReleaseCapture(&mCameraCapture);
+			mCameraCapture = NULL;
+			ostringstream lStr;
+			lStr << "Module \"" << getLabel().c_str() << "\" cannot convert camera frames to the \"" << mParamOutputFormat.toString().c_str() << "\" format.";
+			throw(Exception(Exception::eCodeUseModule, lStr.str().c_str()));
+		}
+	}
+	stampFrameMetadata(*mOutputFrame, 0);
 
 	mOutputSlot->unlock();
 
@@ -193,7 +236,8 @@ void CameraModule::processFunction(unsigned int inFrameNumber)
 	if(!lTmpImage)
 	{
 		cvReleaseCapture(&mCameraCapture);
-		cvReleaseImage(&mOutputFrameIpl);
+		if(mOutputFrameIpl)
+			releaseIplImage(&mOutputFrameIpl);
 		mCameraCapture = NULL;
 		mOutputFrameIpl = NULL;
 		delete mOutputFrame;
@@ -204,7 +248,11 @@ void CameraModule::processFunction(unsigned int inFrameNumber)
 	}
 
 	mOutputSlot->lock();
-	cvCopy(lTmpImage, mOutputFrameIpl);
+	if(mOutputFrameIpl)
+		cvCopy(lTmpImage, mOutputFrameIpl);
+	else
+		convertFromIplImage(lTmpImage, *mOutputFrame);
+	stampFrameMetadata(*mOutputFrame, inFrameNumber);
 	mOutputSlot->unlock();
 
 }
@@ -220,10 +268,11 @@ void CameraModule::stopFunction()
 */
 void CameraModule::resetFunction()
 {
-	if(mOutputFrameIpl)
+	if(mOutputFrame)
 	{
 		mOutputSlot->lock();
-		cvReleaseImage(&mOutputFrameIpl);
+		if(mOutputFrameIpl)
+			releaseIplImage(&mOutputFrameIpl);
 		delete mOutputFrame;
 		mOutputFrameIpl = NULL;
 		mOutputFrame = NULL;
@@ -40,6 +40,8 @@
 #include <Image.hpp>
 #include <cv.h>
 #include <highgui.h>
+#include <map>
+#include <string>
 
 using namespace VIPERS;
 using namespace PACC;
@@ -52,6 +54,8 @@ class CameraModule: public Module
 {
 	public:
 
+	typedef map<string, Image::Model> OutputFormatMap;
+
 	//! Default constructor
 	CameraModule();
 	//! Virtual destructor
@@ -81,13 +85,16 @@ class CameraModule: public Module
 
 	ModuleSlot* mOutputSlot; //!< Output frame slot
 
-	Image* mOutputFrame;
-	IplImage* mOutputFrameIpl; //!< Output frame
+	Image* mOutputFrame; //!< Output frame
+	IplImage* mOutputFrameIpl; //!< Output frame (interleaved output format only)
 	CvCapture* mCameraCapture; //!< Capture structure
 
 	Parameter mParamFrameSize; //!< Camera frame size
 	Parameter mParamFrameRate; //!< Camera frame rate
 	Parameter mParamCameraIndex; //!< Camera index
+	Parameter mParamOutputFormat; //!< Output frame format
+
+	OutputFormatMap mOutputFormatMap; //!< Map of the output formats
 
 };
 
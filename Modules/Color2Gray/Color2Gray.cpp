@@ -38,6 +38,8 @@
 #define VIPERS_UTILS_OPENCV
 #include <ImageUtils.hpp>
 
+#include <cstring>
+
 using namespace VIPERS;
 using namespace std;
 
@@ -63,17 +65,22 @@ Color2GrayModule::Color2GrayModule()
 
 	mOutImgIpl = NULL;
 	mOutImg = NULL;
+	mOutputInPlace = false;
+
+	mInputImage = NULL;
+	mColorLayout = PixelKernels::eColorLayoutBGR;
+	mLumaPlane = false;
+
+	mOutputSlot->setInPlaceInput(mInputSlot);
+	setPointwiseKernel(true);
+	setPlannedOutputs(true);
 }
 
 /*! TODO:
 */
 Color2GrayModule::~Color2GrayModule()
 {
-	if(mOutImgIpl)
-	{
-		cvReleaseImage(&mOutImgIpl);
-		delete mOutImg;
-	}
+	releaseOutputImage();
 }
 
 /*! TODO:
@@ -108,57 +115,125 @@ void Color2GrayModule::pauseFunction()
 */
 void Color2GrayModule::processFunction(unsigned int inFrameNumber)
 {
-  const Image* lTmpImage = NULL;
-	IplImage* lTmpImageIpl = NULL;
+	mInputSlot->lock();
+	mOutputSlot->lock();
+
+	try
+	{
+		beginPointwiseFunction(inFrameNumber);
+		processPointwiseFunction(0, mOutImg->getHeight());
+		endPointwiseFunction();
+	}
+	catch(...)
+	{
+		mInputImage = NULL;
+		mOutputSlot->unlock();
+		mInputSlot->unlock();
+		throw;
+	}
+
+	mOutputSlot->unlock();
+	mInputSlot->unlock();
+}
+
+/*! TODO:
+*/
+void Color2GrayModule::beginPointwiseFunction(unsigned int inFrameNumber)
+{
+	const Image* lTmpImage = NULL;
 
 	if(!mInputSlot->isConnected())
 		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" is not connected to an output slot") ));
 
-	mInputSlot->lock();
-
 	lTmpImage = mInputSlot->getImage();
 	if(!lTmpImage)
-	{
-		mInputSlot->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" does not have a valid image pointer (NULL)") ));
-	}
 
-  if(lTmpImage->getNbChannels()!=Image::eChannel3 || lTmpImage->getDepth()!=Image::eDepth8U)
-  {
-    mInputSlot->unlock();
-    throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" is not a valid color image with 3 channels and a depth of 8 unsigned bits") ));
-  }
+	if(lTmpImage->getDepth()!=Image::eDepth8U)
+		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" is not a valid color image with a depth of 8 unsigned bits") ));
 
-	setToIplImage(*lTmpImage, &lTmpImageIpl);
+	mLumaPlane = false;
+	switch(lTmpImage->getModel())
+	{
+		case Image::eModelRGB:
+			mColorLayout = PixelKernels::eColorLayoutRGB;
+			break;
+		case Image::eModelRGBA:
+			mColorLayout = PixelKernels::eColorLayoutRGBA;
+			break;
+		case Image::eModelBGRA:
+			mColorLayout = PixelKernels::eColorLayoutBGRA;
+			break;
+		case Image::eModelYCrCb:
+			mColorLayout = PixelKernels::eColorLayoutYCrCb;
+			break;
+		case Image::eModelI420:
+		case Image::eModelNV12:
+			mLumaPlane = true;
+			break;
+		default:
+			mColorLayout = (lTmpImage->getNbChannels()==Image::eChannel4) ? PixelKernels::eColorLayoutBGRA : PixelKernels::eColorLayoutBGR;
+			break;
+	}
 
-	mOutputSlot->lock();
+	if(!mLumaPlane && lTmpImage->getNbChannels()!=((mColorLayout==PixelKernels::eColorLayoutRGBA || mColorLayout==PixelKernels::eColorLayoutBGRA) ? Image::eChannel4 : Image::eChannel3))
+		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" is not a valid color image with 3 channels (RGB, BGR, YCrCb) or 4 channels (RGBA, BGRA), or a planar YUV image") ));
 
-	if(!mOutImgIpl)
+	// Only reader of the input image: each gray row is written over the start of the same color row, which is
+	// read before being overwritten since gray pixels are narrower (see ModuleSlot::isInPlace())
+	if(mOutputSlot->isInPlace() && !mLumaPlane)
 	{
-		mOutImgIpl = cvCreateImage(cvSize(lTmpImage->getWidth(), lTmpImage->getHeight()), IPL_DEPTH_8U, 1);
-		mOutImg = new Image(false);
-		setFromIplImage(mOutImgIpl, *mOutImg);
-		mOutImg->setModel(Image::eModelGray);
+		if(!mOutputInPlace || mOutImg->getData()!=lTmpImage->getData() || lTmpImage->getWidth()!=mOutImg->getWidth() || lTmpImage->getHeight()!=mOutImg->getHeight() || lTmpImage->getRowLengthBytes()!=mOutImg->getRowLengthBytes())
+		{
+			releaseOutputImage();
+			mOutImg = new Image(false);
+			mOutImg->create(lTmpImage->getWidth(), lTmpImage->getHeight(), Image::eDepth8U, Image::eChannel1, false, lTmpImage->getData(), lTmpImage->getRowLengthBytes());
+			mOutImg->setModel(Image::eModelGray);
+			setToIplImage(*mOutImg, &mOutImgIpl);
+			mOutputInPlace = true;
+		}
 	}
-	else if(lTmpImage->getWidth()!=mOutImg->getWidth() || lTmpImage->getWidth()!=mOutImg->getHeight())
+	else
 	{
-		cvReleaseImage(&mOutImgIpl);
-		delete mOutImg;
-		mOutImgIpl = cvCreateImage(cvSize(lTmpImage->getWidth(), lTmpImage->getHeight()), IPL_DEPTH_8U, 1);
-		mOutImg = new Image(false);
-    setFromIplImage(mOutImgIpl, *mOutImg);
-    mOutImg->setModel(lTmpImage->getModel());
+		if(mOutImgIpl && (mOutputInPlace || lTmpImage->getWidth()!=mOutImg->getWidth() || lTmpImage->getHeight()!=mOutImg->getHeight() || isPlannedIplImageStale(mOutputSlot, mOutImgIpl)))
+			releaseOutputImage();
+
+		if(!mOutImgIpl)
+		{
+			mOutImgIpl = createPlannedIplImage(mOutputSlot, cvSize(lTmpImage->getWidth(), lTmpImage->getHeight()), IPL_DEPTH_8U, 1);
+			mOutImg = new Image(false);
+			setFromIplImage(mOutImgIpl, *mOutImg);
+			mOutImg->setModel(Image::eModelGray);
+		}
 	}
 
-	if(lTmpImage->getModel()==Image::eModelRGB)
-	  cvCvtColor(lTmpImageIpl, mOutImgIpl, CV_RGB2GRAY);
-	else
-	  cvCvtColor(lTmpImageIpl, mOutImgIpl, CV_BGR2GRAY);
+	mInputImage = lTmpImage;
+}
 
-	cvReleaseImageHeader(&lTmpImageIpl);
+/*! Gray rows are computed by PixelKernels::convertToGray(), which reads each color row once and may write it in
+    place.  The Y plane of planar YUV images is already the gray image, its rows are copied.
+*/
+void Color2GrayModule::processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow)
+{
+	if(inEndRow>(unsigned int)mOutImg->getHeight())
+		inEndRow = mOutImg->getHeight();
 
-	mOutputSlot->unlock();
-	mInputSlot->unlock();
+	for(unsigned int i = inFirstRow; i < inEndRow; i++)
+	{
+		if(mLumaPlane)
+			memcpy(mOutImg->getRow(i), mInputImage->getRow(i), mOutImg->getWidth());
+		else
+			PixelKernels::convertToGray((const unsigned char*)mInputImage->getRow(i), (unsigned char*)mOutImg->getRow(i), mOutImg->getWidth(), mColorLayout);
+	}
+}
+
+/*! TODO:
+*/
+void Color2GrayModule::endPointwiseFunction()
+{
+	if(mInputImage)
+		mOutImg->propagateMetadata(*mInputImage);
+	mInputImage = NULL;
 }
 
 /*! TODO:
@@ -175,14 +250,28 @@ void Color2GrayModule::resetFunction()
 	if(mOutImgIpl)
 	{
 		mOutputSlot->lock();
-		cvReleaseImage(&mOutImgIpl);
-		delete mOutImg;
-		mOutImgIpl = NULL;
-		mOutImg = NULL;
+		releaseOutputImage();
 		mOutputSlot->unlock();
 	}
 }
 
+/*! TODO:
+*/
+void Color2GrayModule::releaseOutputImage()
+{
+	if(!mOutImgIpl)
+		return;
+
+	if(mOutputInPlace)
+		cvReleaseImageHeader(&mOutImgIpl);
+	else
+		releaseIplImage(&mOutImgIpl);
+	delete mOutImg;
+	mOutImgIpl = NULL;
+	mOutImg = NULL;
+	mOutputInPlace = false;
+}
+
 /*!
 */
 void Color2GrayModule::updateParametersFunction()
@@ -38,6 +38,7 @@
 #include <VIPERS.hpp>
 #include <Module.hpp>
 #include <Image.hpp>
+#include <PixelKernels.hpp>
 #include <cv.h>
 
 using namespace VIPERS;
@@ -70,6 +71,16 @@ class Color2GrayModule: public Module
 	//! Resetting the module as it was when created
 	void resetFunction();
 
+	//! Check input and allocate output for a frame processed by strips
+	void beginPointwiseFunction(unsigned int inFrameNumber);
+	//! Convert rows of the input image
+	void processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow);
+	//! Complete a frame processed by strips
+	void endPointwiseFunction();
+
+	//! Release the output image (only the headers when converting in place)
+	void releaseOutputImage();
+
 	//! Update %Module parameters
 	void updateParametersFunction();
 	//! Verify if Parameter value is valid without actually changing the value
@@ -82,6 +93,11 @@ class Color2GrayModule: public Module
 
 	IplImage* mOutImgIpl;
 	Image* mOutImg;
+	bool mOutputInPlace; //!< Output image is stored over the data of the input image
+
+	const Image* mInputImage; //!< Input image of the frame being processed
+	PixelKernels::ColorLayout mColorLayout; //!< Order of the channels of the input image of the frame being processed
+	bool mLumaPlane; //!< Input image of the frame being processed is planar YUV, its Y plane is copied
 
 };
 
@@ -0,0 +1,256 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *	Crop Module
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Departement of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file Crop.cpp
+ * \brief CropModule class functions definition.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#include "Crop.hpp"
+#include "CropConfig.hpp"
+
+#include <iostream>
+
+using namespace VIPERS;
+using namespace std;
+
+#define MODULE_NAME "crop"
+#define MODULE_DISPLAY_NAME "Crop"
+
+#define INPUT_SLOT_NAME_IMAGE "input-image"
+#define INPUT_SLOT_DISPLAYNAME_IMAGE "Input image"
+
+#define OUTPUT_SLOT_NAME_CROPPED_IMAGE "output-cropped"
+#define OUTPUT_SLOT_DISPLAYNAME_CROPPED_IMAGE "Cropped image"
+
+#define PARAMETER_NAME_POSITION_X "position-x"
+#define PARAMETER_NAME_POSITION_Y "position-y"
+#define PARAMETER_NAME_SIZE "size"
+
+/*! TODO:
+*/
+CropModule::CropModule()
+	:Module(MODULE_NAME, MODULE_DISPLAY_NAME, CROPMODULE_VERSION),
+	mParamPositionX(PARAMETER_NAME_POSITION_X, Variable::eVariableTypeUInt, "Position X", "Horizontal position of the top left corner of the region", true),
+	mParamPositionY(PARAMETER_NAME_POSITION_Y, Variable::eVariableTypeUInt, "Position Y", "Vertical position of the top left corner of the region", true),
+	mParamSize(PARAMETER_NAME_SIZE, Variable::eVariableTypeSize, "Size", "Size of the region", true)
+{
+	mShortDescription = "Module for extracting a region of an image";
+	mLongDescription = "This module extracts a rectangular region of an image without copying it. The output image refers to the input image data, so the region is clipped to the input image";
+
+	mParamPositionX.setValue(0);
+	mParamPositionX.setMinValue("0");
+	mParamPositionY.setValue(0);
+	mParamPositionY.setMinValue("0");
+	mParamSize.setValue(Size(320,240));
+
+	newParameter(mParamPositionX);
+	newParameter(mParamPositionY);
+	newParameter(mParamSize);
+
+	mInputSlot = newSlot(new ModuleSlot(this, INPUT_SLOT_NAME_IMAGE, INPUT_SLOT_DISPLAYNAME_IMAGE, "Image to be cropped"));
+	mOutputSlot = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_CROPPED_IMAGE, OUTPUT_SLOT_DISPLAYNAME_CROPPED_IMAGE, "Cropped image", &mOutputImage));
+
+	mOutputImage = NULL;
+}
+
+/*! TODO:
+*/
+CropModule::~CropModule()
+{
+	if(mOutputImage)
+		delete mOutputImage;
+}
+
+/*! TODO:
+*/
+void CropModule::initFunction()
+{
+	try
+	{
+		processFunction(0);
+	}
+	catch(...)
+	{
+		throw;
+	}
+}
+
+/*! TODO:
+*/
+void CropModule::startFunction()
+{
+
+}
+
+/*! TODO:
+*/
+void CropModule::pauseFunction()
+{
+
+}
+
+/*! TODO:
+*/
+void CropModule::processFunction(unsigned int inFrameNumber)
+{
+	const Image* lTmpImage = NULL;
+	unsigned int lX, lY, lWidth, lHeight;
+	Size lSize;
+
+	mInputSlot->lock();
+
+	if(!mInputSlot->isConnected())
+	{
+		mInputSlot->unlock();
+		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" is not connected to an output slot") ));
+	}
+
+	lTmpImage = mInputSlot->getImage();
+	if(!lTmpImage || !lTmpImage->isValid())
+	{
+		mInputSlot->unlock();
+		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" does not have a valid image pointer (NULL)") ));
+	}
+
+	lockParameters();
+	lX = getLockedParameter(PARAMETER_NAME_POSITION_X).toUInt();
+	lY = getLockedParameter(PARAMETER_NAME_POSITION_Y).toUInt();
+	lSize = getLockedParameter(PARAMETER_NAME_SIZE).toSize();
+	unlockParameters();
+
+	// Clip region to the input image
+	if(lX>=static_cast<unsigned int>(lTmpImage->getWidth()))
+		lX = lTmpImage->getWidth()-1;
+	if(lY>=static_cast<unsigned int>(lTmpImage->getHeight()))
+		lY = lTmpImage->getHeight()-1;
+	lWidth = (lSize[0]>0) ? lSize[0] : 1;
+	lHeight = (lSize[1]>0) ? lSize[1] : 1;
+	if(lX+lWidth>static_cast<unsigned int>(lTmpImage->getWidth()))
+		lWidth = lTmpImage->getWidth()-lX;
+	if(lY+lHeight>static_cast<unsigned int>(lTmpImage->getHeight()))
+		lHeight = lTmpImage->getHeight()-lY;
+
+	// Subsampled planar models only have views at even positions
+	if(lTmpImage->getModel()==Image::eModelI420 || lTmpImage->getModel()==Image::eModelNV12)
+	{
+		lX -= lX%2;
+		lY -= lY%2;
+	}
+
+	// The view is taken again every frame, and only its planes are kept in the output image:
+	// the input image may be deleted or created again by its producer before the next frame.
+	Image lView(false);
+	if(!lView.createView(*lTmpImage, lX, lY, lWidth, lHeight))
+	{
+		mInputSlot->unlock();
+		throw(Exception(Exception::eCodeUseModule, string("Cannot crop the image of ") + mInputSlot->getFullName().c_str()));
+	}
+
+	mOutputSlot->lock();
+
+	if(!mOutputImage)
+		mOutputImage = new Image(false);
+
+	if(lView.isPlanar())
+	{
+		char* lPlaneData[Image::eMaxNbPlanes];
+		unsigned int lPlaneRowLengthBytes[Image::eMaxNbPlanes];
+		for(unsigned int p=0; p<lView.getNbPlanes(); p++)
+		{
+			lPlaneData[p] = lView.getPlane(p);
+			lPlaneRowLengthBytes[p] = lView.getPlaneRowLengthBytes(p);
+		}
+		mOutputImage->createPlanar(lWidth, lHeight, lView.getModel(), lPlaneData, lPlaneRowLengthBytes);
+	}
+	else
+	{
+		mOutputImage->create(lWidth, lHeight, lView.getDepth(), lView.getNbChannels(), false, lView.getData(), lView.getRowLengthBytes());
+		mOutputImage->setModel(lView.getModel());
+	}
+	mOutputImage->setOrigin(lView.getOrigin());
+	mOutputImage->propagateMetadata(*lTmpImage);
+
+	mOutputSlot->unlock();
+	mInputSlot->unlock();
+}
+
+/*! TODO:
+*/
+void CropModule::stopFunction()
+{
+	// Nothing to do
+}
+
+/*! TODO:
+*/
+void CropModule::resetFunction()
+{
+	if(mOutputImage)
+	{
+		mOutputSlot->lock();
+		delete mOutputImage;
+		mOutputImage = NULL;
+		mOutputSlot->unlock();
+	}
+}
+
+/*!
+*/
+void CropModule::updateParametersFunction()
+{
+	// Nothing to do, since no parameter has influence on other parameters
+}
+
+/*!
+*/
+string CropModule::verifyParameterFunction(const Parameter& inParameter) const throw()
+{
+	string lResult = "";
+
+	if(inParameter.getName()==PARAMETER_NAME_SIZE)
+	{
+		try
+		{
+			Size lSize = inParameter.toSize();
+			if(lSize[0]==0 || lSize[1]==0)
+				lResult = "Region size must be greater than 0";
+		}
+		catch(...)
+		{
+			lResult = "Invalid region size";
+		}
+	}
+
+	return lResult;
+}
+
+//Create entry points and modules functions
+VIPERS_MODULE_ENTRY_POINT
+VIPERS_MODULE_FUNCTIONS(CropModule)
@@ -0,0 +1,91 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *	Crop Module
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Departement of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file Crop.hpp
+ * \brief CropModule class module header.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#ifndef VIPERS_CROPMODULE_HPP
+#define VIPERS_CROPMODULE_HPP
+
+#include <VIPERS.hpp>
+#include <Module.hpp>
+#include <Image.hpp>
+#include <string>
+
+using namespace VIPERS;
+
+/*! \brief %CropModule class.
+	\author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+	The output image is a view on the input image data: no pixel is copied.
+*/
+class CropModule: public Module
+{
+	public:
+
+	//! Default constructor
+	CropModule();
+	//! Virtual destructor
+	virtual ~CropModule();
+
+	protected:
+
+	//! Verifies inputs and initializes outputs
+	void initFunction();
+	//! Put the module in a ready state for processing
+	void startFunction();
+	//! Put the module in a paused state
+	void pauseFunction();
+	//! Processes current inputs and/or generates outputs for one cycle
+	void processFunction(unsigned int inFrameNumber);
+	//! Put the module in a stopped state (no more ready for processing)
+	void stopFunction();
+	//! Resetting the module as it was when created
+	void resetFunction();
+
+	//! Update %Module parameters
+	void updateParametersFunction();
+	//! Verify if Parameter value is valid without actually changing the value
+	string verifyParameterFunction(const Parameter& inParameter) const throw();
+
+	private:
+
+	Parameter mParamPositionX; //!< Horizontal position of the region
+	Parameter mParamPositionY; //!< Vertical position of the region
+	Parameter mParamSize; //!< Size of the region
+
+	ModuleSlot* mInputSlot; //!< Image input slot
+	ModuleSlot* mOutputSlot; //!< Image output slot
+
+	Image* mOutputImage; //!< Output image (view on the input image)
+
+};
+
+#endif //VIPERS_CROPMODULE_HPP
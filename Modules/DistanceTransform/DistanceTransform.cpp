@@ -36,9 +36,13 @@
 #include "DistanceTransformConfig.hpp"
 
 #include <sstream>
+#include <vector>
+#include <cmath>
+#include <cfloat>
 
 #define VIPERS_UTILS_OPENCV
 #include <ImageUtils.hpp>
+#include <PACC/Threading/Mutex.hpp>
 
 using namespace VIPERS;
 using namespace std;
@@ -57,6 +61,195 @@ using namespace std;
 #define PARAMETER_NAME_MASKSIZE "mask-size"
 #define PARAMETER_NAME_INVERT "invert"
 
+//! Number of columns of the distance map transformed together, so the column pass reads and writes rows by blocks
+#define DISTANCE_COLUMN_BLOCK 16
+//! Smallest number of rows transformed by a thread in the row pass
+#define DISTANCE_GRAIN_ROWS 16
+
+namespace
+{
+	/*! Row pass of the separable distance transforms: distance of each pixel of rows of the mask to the nearest zero
+	    pixel of its row (squared for the L2 distance).  Pixels of rows without zero pixels get the width plus the
+	    height of the image, more than any distance in it.
+	*/
+	class RowDistanceTask: public ParallelTask
+	{
+		public:
+
+		RowDistanceTask(const Image* inMask, Image* outDistance, bool inSquared)
+			: mMask(inMask), mDistance(outDistance), mSquared(inSquared) {}
+
+		void run(unsigned int inFirst, unsigned int inEnd)
+		{
+			unsigned int lWidth = mMask->getWidth();
+			unsigned int lNone = lWidth + mMask->getHeight();
+
+			for(unsigned int i = inFirst; i < inEnd; i++)
+			{
+				const unsigned char* lMask = (const unsigned char*)mMask->getRow(i);
+				float* lDistance = (float*)mDistance->getRow(i);
+				unsigned int lLast = lNone;
+
+				// Nearest zero pixel on the left, then on the right
+				for(unsigned int x = 0; x < lWidth; x++)
+				{
+					lLast = lMask[x] ? ((lLast<lNone) ? lLast+1 : lNone) : 0;
+					lDistance[x] = (float)lLast;
+				}
+				lLast = lNone;
+				for(unsigned int x = lWidth; x-- > 0;)
+				{
+					lLast = lMask[x] ? ((lLast<lNone) ? lLast+1 : lNone) : 0;
+					if(lLast<lDistance[x])
+						lDistance[x] = (float)lLast;
+					if(mSquared)
+						lDistance[x] *= lDistance[x];
+				}
+			}
+		}
+
+		private:
+
+		const Image* mMask; //!< Mask, distances are computed to its zero pixels
+		Image* mDistance; //!< Distance map
+		bool mSquared; //!< Square the distances (L2 distance)
+	};
+
+	/*! Column pass of the separable distance transforms, over blocks of DISTANCE_COLUMN_BLOCK columns of the map
+	    computed by the row pass.  The exact L2 distance is the lower envelope of the parabolas rooted at the squared
+	    row distances (Felzenszwalb and Huttenlocher); the L1 distance adds the distance along the column.  The range
+	    of the distances is tracked while they are written.
+	*/
+	class ColumnDistanceTask: public ParallelTask
+	{
+		public:
+
+		ColumnDistanceTask(Image* ioDistance, bool inEuclidean)
+			: mDistance(ioDistance), mEuclidean(inEuclidean), mMin(FLT_MAX), mMax(0) {}
+
+		void run(unsigned int inFirst, unsigned int inEnd)
+		{
+			unsigned int lWidth = mDistance->getWidth();
+			unsigned int lHeight = mDistance->getHeight();
+			if(lHeight==0)
+				return;
+			vector<float> lColumns(DISTANCE_COLUMN_BLOCK*lHeight);
+			vector<float> lEnvelope(lHeight);
+			vector<unsigned int> lRoots(lHeight);
+			vector<double> lBounds(lHeight+1);
+			float lMin = FLT_MAX;
+			float lMax = 0;
+
+			for(unsigned int b = inFirst; b < inEnd; b++)
+			{
+				unsigned int lFirstColumn = b*DISTANCE_COLUMN_BLOCK;
+				unsigned int lNbColumns = (lWidth-lFirstColumn>DISTANCE_COLUMN_BLOCK) ? DISTANCE_COLUMN_BLOCK : lWidth-lFirstColumn;
+
+				for(unsigned int y = 0; y < lHeight; y++)
+				{
+					const float* lRow = (const float*)mDistance->getRow(y) + lFirstColumn;
+					for(unsigned int c = 0; c < lNbColumns; c++)
+						lColumns[c*lHeight+y] = lRow[c];
+				}
+
+				for(unsigned int c = 0; c < lNbColumns; c++)
+				{
+					float* lColumn = &lColumns[c*lHeight];
+					if(mEuclidean)
+					{
+						transformParabolas(lColumn, &lEnvelope[0], lHeight, &lRoots[0], &lBounds[0]);
+						for(unsigned int y = 0; y < lHeight; y++)
+							lColumn[y] = sqrt(lEnvelope[y]);
+					}
+					else
+					{
+						for(unsigned int y = 1; y < lHeight; y++)
+							if(lColumn[y-1]+1<lColumn[y])
+								lColumn[y] = lColumn[y-1]+1;
+						for(unsigned int y = lHeight-1; y-- > 0;)
+							if(lColumn[y+1]+1<lColumn[y])
+								lColumn[y] = lColumn[y+1]+1;
+					}
+				}
+
+				for(unsigned int y = 0; y < lHeight; y++)
+				{
+					float* lRow = (float*)mDistance->getRow(y) + lFirstColumn;
+					for(unsigned int c = 0; c < lNbColumns; c++)
+					{
+						float lValue = lColumns[c*lHeight+y];
+						lRow[c] = lValue;
+						if(lValue<lMin)
+							lMin = lValue;
+						if(lValue>lMax)
+							lMax = lValue;
+					}
+				}
+			}
+
+			mRangeMutex.lock();
+			if(lMin<mMin)
+				mMin = lMin;
+			if(lMax>mMax)
+				mMax = lMax;
+			mRangeMutex.unlock();
+		}
+
+		//! Get the smallest distance written
+		float getMin() const {return mMin;}
+		//! Get the largest distance written
+		float getMax() const {return mMax;}
+
+		private:
+
+		// Abscissa of the intersection of the parabolas rooted at p and q (p < q)
+		static double intersectParabolas(const float* inSquared, unsigned int inP, unsigned int inQ)
+		{
+			return ((inSquared[inQ] + (double)inQ*inQ) - (inSquared[inP] + (double)inP*inP))/(2.0*inQ - 2.0*inP);
+		}
+
+		// outEnvelope[q] = min over p of inSquared[p] + (q-p)^2, with ioRoots and ioBounds holding the roots of the
+		// parabolas of the lower envelope and the bounds of their intervals
+		static void transformParabolas(const float* inSquared, float* outEnvelope, unsigned int inSize, unsigned int* ioRoots, double* ioBounds)
+		{
+			unsigned int k = 0;
+
+			ioRoots[0] = 0;
+			ioBounds[0] = -DBL_MAX;
+			ioBounds[1] = DBL_MAX;
+			for(unsigned int q = 1; q < inSize; q++)
+			{
+				// Drop the parabolas hidden by parabola q (the first one never is, its interval starts at -infinity)
+				double lIntersection = intersectParabolas(inSquared, ioRoots[k], q);
+				while(lIntersection<=ioBounds[k])
+				{
+					k--;
+					lIntersection = intersectParabolas(inSquared, ioRoots[k], q);
+				}
+				k++;
+				ioRoots[k] = q;
+				ioBounds[k] = lIntersection;
+				ioBounds[k+1] = DBL_MAX;
+			}
+
+			k = 0;
+			for(unsigned int q = 0; q < inSize; q++)
+			{
+				while(ioBounds[k+1]<q)
+					k++;
+				double lOffset = (double)q - ioRoots[k];
+				outEnvelope[q] = (float)(lOffset*lOffset + inSquared[ioRoots[k]]);
+			}
+		}
+
+		Image* mDistance; //!< Distance map
+		bool mEuclidean; //!< L2 distance (L1 otherwise)
+		float mMin; //!< Smallest distance written
+		float mMax; //!< Largest distance written
+		PACC::Threading::Mutex mRangeMutex; //!< Protect the range of the distances
+	};
+}
+
 /*! TODO:
 */
 DistanceTransformModule::DistanceTransformModule()
@@ -65,31 +258,30 @@ DistanceTransformModule::DistanceTransformModule()
 	mParamMaskSize(PARAMETER_NAME_MASKSIZE, Variable::eVariableTypeUInt, "Mask size", "Size of the mask used to compute the distance", true),
 	mParamInvert(PARAMETER_NAME_INVERT, Variable::eVariableTypeBool, "Invert gray image", "Invert gray image so the minimum distance is white", true)
 {
+	mParamVersion = 0;
 	mShortDescription = "Module for computing distance transform image";
-	mLongDescription = "This module computes a distance transform on a binary image";
+	mLongDescription = "This module computes a distance transform on a binary image: the distance of each non zero pixel to the nearest zero pixel.  L1 and L2 distances are exact.";
 
 	ValueSet lTypeValues;
-	lTypeValues.insert(Value("l1", "L1", "L1 distance"));
-	lTypeValues.insert(Value("l2", "L2", "L2 distance"));
-	lTypeValues.insert(Value("c", "C", "C distance"));
-
-	mDistanceTypeMap["l1"] = CV_DIST_L1;
-	mDistanceTypeMap["l2"] = CV_DIST_L2;
-	mDistanceTypeMap["c"] = CV_DIST_C;
+	lTypeValues.insert(Value("l1", "L1", "L1 distance", CV_DIST_L1));
+	lTypeValues.insert(Value("l2", "L2", "L2 distance", CV_DIST_L2));
+	lTypeValues.insert(Value("c", "C", "C distance", CV_DIST_C));
 
 	ValueSet lSizeValues;
-	lSizeValues.insert(Value("3x3", "3x3", "3x3 mask"));
-	lSizeValues.insert(Value("5x5", "5x5", "5x5 mask"));
-
-	mMaskSizeMap["3x3"] = 3;
-	mMaskSizeMap["5x5"] = 5;
+	lSizeValues.insert(Value("3x3", "3x3", "3x3 mask", 3));
+	lSizeValues.insert(Value("5x5", "5x5", "5x5 mask", 5));
 
 	mParamDistanceType.setPossibleValues(lTypeValues);
 	mParamMaskSize.setPossibleValues(lSizeValues);
 
 	mParamDistanceType.setValueStr("l2");
-	mParamMaskSize.setValue(3);
+	mParamMaskSize.setValueStr("3x3");
 	mParamInvert.setValue(false);
+	mParamMaskSize.setEnabled(false);
+
+	NameSet lDependentParameterSet;
+	lDependentParameterSet.insert(PARAMETER_NAME_MASKSIZE);
+	mParamDistanceType.setDependentParameterNameSet(lDependentParameterSet);
 
 	newParameter(mParamDistanceType);
 	newParameter(mParamMaskSize);
@@ -111,12 +303,12 @@ DistanceTransformModule::~DistanceTransformModule()
 {
 	if(mOutputDistanceTransformIpl)
 	{
-		cvReleaseImage(&mOutputDistanceTransformIpl);
+		releaseIplImage(&mOutputDistanceTransformIpl);
 		delete mOutputDistanceTransform;
 	}
 	if(mOutputDistanceTransformGrayIpl)
 	{
-		cvReleaseImage(&mOutputDistanceTransformGrayIpl);
+		releaseIplImage(&mOutputDistanceTransformGrayIpl);
 		delete mOutputDistanceTransformGray;
 	}
 }
@@ -155,17 +347,21 @@ void DistanceTransformModule::processFunction(unsigned int inFrameNumber)
 {
 	const Image* lMaskImage;
 	IplImage* lMaskImageIpl;
-	double lMinDist;
-	double lMaxDist;
+	int lDistanceType;
+	double lMinDist = 0;
+	double lMaxDist = 0;
 
 	if(!mInputSlotMask->isConnected())
 		throw(Exception(Exception::eCodeUseModule, mInputSlotMask->getFullName().c_str() + string(" is not connected to an output slot") ));
 
-	lockParameters();
-	mParamDistanceType = getLockedParameter(PARAMETER_NAME_DISTTYPE);
-	mParamMaskSize = getLockedParameter(PARAMETER_NAME_MASKSIZE);
-	mParamInvert = getLockedParameter(PARAMETER_NAME_INVERT);
-	unlockParameters();
+	if(parametersChanged(mParamVersion))
+	{
+		lockParameters();
+		mParamDistanceType = getLockedParameter(PARAMETER_NAME_DISTTYPE);
+		mParamMaskSize = getLockedParameter(PARAMETER_NAME_MASKSIZE);
+		mParamInvert = getLockedParameter(PARAMETER_NAME_INVERT);
+		unlockParameters();
+	}
 
 	mInputSlotMask->lock();
 
@@ -177,10 +373,10 @@ void DistanceTransformModule::processFunction(unsigned int inFrameNumber)
 	   throw(Exception(Exception::eCodeUseModule, mInputSlotMask->getFullName().c_str() + string(" does not have a valid image") ));
 	}
 
-	if(lMaskImage->getNbChannels()!=Image::eChannel1)
+	if(lMaskImage->getNbChannels()!=Image::eChannel1 || lMaskImage->getDepth()!=Image::eDepth8U)
 	{
 		mInputSlotMask->unlock();
-		throw(Exception(Exception::eCodeUseModule, mInputSlotMask->getFullName().c_str() + string(" must be a 1 channel image mask") ));
+		throw(Exception(Exception::eCodeUseModule, mInputSlotMask->getFullName().c_str() + string(" must be a unsigned 8 bits 1 channel image mask") ));
 	}
 
 	setToIplImage(*lMaskImage, &lMaskImageIpl);
@@ -188,35 +384,73 @@ void DistanceTransformModule::processFunction(unsigned int inFrameNumber)
 	mOutputSlotDistanceTransform->lock();
 	mOutputSlotDistanceTransformGray->lock();
 
+	if(mOutputDistanceTransformIpl && (mOutputDistanceTransformIpl->width!=lMaskImageIpl->width || mOutputDistanceTransformIpl->height!=lMaskImageIpl->height))
+	{
+		releaseIplImage(&mOutputDistanceTransformIpl);
+		releaseIplImage(&mOutputDistanceTransformGrayIpl);
+		delete mOutputDistanceTransform;
+		delete mOutputDistanceTransformGray;
+		mOutputDistanceTransformIpl = NULL;
+		mOutputDistanceTransformGrayIpl = NULL;
+		mOutputDistanceTransform = NULL;
+		mOutputDistanceTransformGray = NULL;
+	}
+
 	if(!mOutputDistanceTransformIpl)
 	{
-		mOutputDistanceTransformIpl = cvCreateImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_32F, 1);
-		mOutputDistanceTransformGrayIpl = cvCreateImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_8U, 1);
+		mOutputDistanceTransformIpl = createIplImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_32F, 1);
+		mOutputDistanceTransformGrayIpl = createIplImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_8U, 1);
 		mOutputDistanceTransform = new Image(false);
 		mOutputDistanceTransformGray = new Image(false);
 		setFromIplImage(mOutputDistanceTransformIpl, *mOutputDistanceTransform);
 		setFromIplImage(mOutputDistanceTransformGrayIpl, *mOutputDistanceTransformGray);
 	}
-	else if(mOutputDistanceTransformIpl->width!=lMaskImageIpl->width || mOutputDistanceTransformIpl->height!=lMaskImageIpl->height)
+
+	lDistanceType = mParamDistanceType.toEnum();
+
+	try
 	{
-		cvReleaseImage(&mOutputDistanceTransformIpl);
-		cvReleaseImage(&mOutputDistanceTransformGrayIpl);
-		mOutputDistanceTransformIpl = cvCreateImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_32F, 1);
-		mOutputDistanceTransformGrayIpl = cvCreateImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_8U, 1);
+		if(lDistanceType==CV_DIST_C)
+		{
+			// Exact with a 3x3 mask, no separable transform needed
+			cvDistTransform(lMaskImageIpl, mOutputDistanceTransformIpl, lDistanceType, mParamMaskSize.toEnum());
+			if(isOutputUsed(mOutputSlotDistanceTransformGray))
+				cvMinMaxLoc(mOutputDistanceTransformIpl, &lMinDist, &lMaxDist);
+		}
+		else
+		{
+			// Exact L1 or L2 distance, by rows then by columns
+			RowDistanceTask lRowDistanceTask(lMaskImage, mOutputDistanceTransform, lDistanceType==CV_DIST_L2);
+			ColumnDistanceTask lColumnDistanceTask(mOutputDistanceTransform, lDistanceType==CV_DIST_L2);
+			parallelFor(0, lMaskImage->getHeight(), lRowDistanceTask, DISTANCE_GRAIN_ROWS);
+			parallelFor(0, (lMaskImage->getWidth()+DISTANCE_COLUMN_BLOCK-1)/DISTANCE_COLUMN_BLOCK, lColumnDistanceTask);
+			lMinDist = lColumnDistanceTask.getMin();
+			lMaxDist = lColumnDistanceTask.getMax();
+		}
 	}
+	catch(...)
+	{
+		cvReleaseImageHeader(&lMaskImageIpl);
+		mOutputSlotDistanceTransformGray->unlock();
+		mOutputSlotDistanceTransform->unlock();
+		mInputSlotMask->unlock();
+		throw;
+	}
+	mOutputDistanceTransform->propagateMetadata(*lMaskImage);
 
-	cvDistTransform(lMaskImageIpl, mOutputDistanceTransformIpl, mDistanceTypeMap[mParamDistanceType.toString()], mMaskSizeMap[mParamMaskSize.toString()]);
-
-	if(mOutputSlotDistanceTransformGray->getUseCount())
+	if(isOutputUsed(mOutputSlotDistanceTransformGray))
 	{
-		cvMinMaxLoc(mOutputDistanceTransformIpl, &lMinDist, &lMaxDist);
-		if(lMaxDist>0 || lMinDist>0)
+		// Distances scaled from their range to [0, 255], or [255, 0] inverted
+		if(lMaxDist>lMinDist)
 		{
 			if(mParamInvert.toBool())
-				cvConvertScale(mOutputDistanceTransformIpl, mOutputDistanceTransformGrayIpl, -255.0/((lMaxDist-lMinDist)), 255);
+				cvConvertScale(mOutputDistanceTransformIpl, mOutputDistanceTransformGrayIpl, -255.0/(lMaxDist-lMinDist), 255.0+lMinDist*255.0/(lMaxDist-lMinDist));
 			else
-				cvConvertScale(mOutputDistanceTransformIpl, mOutputDistanceTransformGrayIpl, 255.0/(lMaxDist-lMinDist), lMinDist*255.0/(lMaxDist-lMinDist));
+				cvConvertScale(mOutputDistanceTransformIpl, mOutputDistanceTransformGrayIpl, 255.0/(lMaxDist-lMinDist), -lMinDist*255.0/(lMaxDist-lMinDist));
 		}
+		else
+			cvSetZero(mOutputDistanceTransformGrayIpl);
+		mOutputDistanceTransformGray->propagateMetadata(*lMaskImage);
 	}
 
 	cvReleaseImageHeader(&lMaskImageIpl);
@@ -240,7 +474,7 @@ void DistanceTransformModule::resetFunction()
 	if(mOutputDistanceTransformIpl)
 	{
 		mOutputSlotDistanceTransform->lock();
-		cvReleaseImage(&mOutputDistanceTransformIpl);
+		releaseIplImage(&mOutputDistanceTransformIpl);
 		delete mOutputDistanceTransform;
 		mOutputDistanceTransformIpl = NULL;
 		mOutputDistanceTransform = NULL;
@@ -249,7 +483,7 @@ void DistanceTransformModule::resetFunction()
 	if(mOutputDistanceTransformGrayIpl)
 	{
 		mOutputSlotDistanceTransformGray->lock();
-		cvReleaseImage(&mOutputDistanceTransformGrayIpl);
+		releaseIplImage(&mOutputDistanceTransformGrayIpl);
 		delete mOutputDistanceTransformGray;
 		mOutputDistanceTransformGrayIpl = NULL;
 		mOutputDistanceTransformGray = NULL;
@@ -261,7 +495,17 @@ void DistanceTransformModule::resetFunction()
 */
 void DistanceTransformModule::updateParametersFunction()
 {
+	lockParameters();
+
+	mParamDistanceType = getLockedParameter(PARAMETER_NAME_DISTTYPE);
+	mParamMaskSize = getLockedParameter(PARAMETER_NAME_MASKSIZE);
+
+	// L1 and L2 distances are exact, whatever the mask size
+	mParamMaskSize.setEnabled(mParamDistanceType.toString()=="c");
 
+	setLockedParameter(mParamMaskSize);
+
+	unlockParameters();
 }
 
 /*!
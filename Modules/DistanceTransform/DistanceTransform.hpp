@@ -53,11 +53,6 @@ class DistanceTransformModule: public Module
 {
 	public:
 
-	//! Map of distance type
-	typedef map<string,int> DistanceTypeMap;
-	//! Map of mask size
-	typedef map<string,int> MaskSizeMap;
-
 	//! Default constructor
 	DistanceTransformModule();
 	//! Virtual destructor
@@ -88,6 +83,7 @@ class DistanceTransformModule: public Module
 	Parameter mParamDistanceType; //!< Distance type use for DistanceTransform duration
 	Parameter mParamMaskSize; //!< Mask size parameter
 	Parameter mParamInvert; //!< Invert gray image
+	unsigned long mParamVersion; //!< Version of the parameters last read
 
 	ModuleSlot* mInputSlotMask; //!< Mask slot
 	ModuleSlot* mOutputSlotDistanceTransform; //!< DistanceTransform slot
@@ -98,9 +94,6 @@ class DistanceTransformModule: public Module
 
 	Image* mOutputDistanceTransform;
 	Image* mOutputDistanceTransformGray;
-
-	DistanceTypeMap mDistanceTypeMap; //!< Distance type map
-	MaskSizeMap mMaskSizeMap; //!< Make size map
 };
 
 #endif //VIPERS_DISTRANSFORMMODULE_HPP
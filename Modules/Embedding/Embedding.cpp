@@ -39,6 +39,7 @@
 
 #define VIPERS_UTILS_OPENCV
 #include <ImageUtils.hpp>
+#include <PixelKernels.hpp>
 
 using namespace VIPERS;
 using namespace std;
@@ -72,6 +73,14 @@ EmbeddingModule::EmbeddingModule()
 
 	mOutputFrame = NULL;
 	mOutputFrameIpl = NULL;
+
+	mBackgroundColorImage = NULL;
+	mBackgroundColorImageIpl = NULL;
+	mEmbeddingColorImageIpl = NULL;
+	mEmbeddingMaskImageIpl = NULL;
+
+	setPointwiseKernel(true);
+	setPlannedOutputs(true);
 }
 
 /*! TODO:
@@ -80,7 +89,7 @@ EmbeddingModule::~EmbeddingModule()
 {
 	if(mOutputFrameIpl)
 	{
-		cvReleaseImage(&mOutputFrameIpl);
+		releaseIplImage(&mOutputFrameIpl);
 		delete mOutputFrame;
 	}
 }
@@ -116,13 +125,49 @@ void EmbeddingModule::pauseFunction()
 /*! TODO:
 */
 void EmbeddingModule::processFunction(unsigned int inFrameNumber)
+{
+	if(!mInputSlotBackgroundColorImage->isConnected())
+		throw(Exception(Exception::eCodeUseModule, mInputSlotBackgroundColorImage->getFullName().c_str() + string(" is not connected to an output slot") ));
+	if(!mInputSlotEmbeddingColorImage->isConnected())
+		throw(Exception(Exception::eCodeUseModule, mInputSlotEmbeddingColorImage->getFullName().c_str() + string(" is not connected to an output slot") ));
+	if(!mInputSlotEmbeddingMaskImage->isConnected())
+		throw(Exception(Exception::eCodeUseModule, mInputSlotEmbeddingMaskImage->getFullName().c_str() + string(" is not connected to an output slot") ));
+
+	mInputSlotBackgroundColorImage->lock();
+	mInputSlotEmbeddingColorImage->lock();
+	mInputSlotEmbeddingMaskImage->lock();
+	mOutputSlot->lock();
+
+	try
+	{
+		beginPointwiseFunction(inFrameNumber);
+		processPointwiseFunction(0, mOutputFrame->getHeight());
+		endPointwiseFunction();
+	}
+	catch(...)
+	{
+		mBackgroundColorImage = NULL;
+		endPointwiseFunction();
+		mOutputSlot->unlock();
+		mInputSlotEmbeddingMaskImage->unlock();
+		mInputSlotEmbeddingColorImage->unlock();
+		mInputSlotBackgroundColorImage->unlock();
+		throw;
+	}
+
+	mOutputSlot->unlock();
+	mInputSlotEmbeddingMaskImage->unlock();
+	mInputSlotEmbeddingColorImage->unlock();
+	mInputSlotBackgroundColorImage->unlock();
+}
+
+/*! TODO:
+*/
+void EmbeddingModule::beginPointwiseFunction(unsigned int inFrameNumber)
 {
   const Image* lBackgroundColorImage;
   const Image* lEmbeddingColorImage;
   const Image* lEmbeddingMaskImage;
-	IplImage* lBackgroundColorImageIpl;
-	IplImage* lEmbeddingColorImageIpl;
-	IplImage* lEmbeddingMaskImageIpl;
 
 	unsigned int lWidth;
 	unsigned int lHeight;
@@ -136,40 +181,17 @@ void EmbeddingModule::processFunction(unsigned int inFrameNumber)
 	if(!mInputSlotEmbeddingMaskImage->isConnected())
 		throw(Exception(Exception::eCodeUseModule, mInputSlotEmbeddingMaskImage->getFullName().c_str() + string(" is not connected to an output slot") ));
 
-	mInputSlotBackgroundColorImage->lock();
-	mInputSlotEmbeddingColorImage->lock();
-	mInputSlotEmbeddingMaskImage->lock();
-	mOutputSlot->lock();
-
 	lBackgroundColorImage = mInputSlotBackgroundColorImage->getImage();
 	lEmbeddingColorImage = mInputSlotEmbeddingColorImage->getImage();
 	lEmbeddingMaskImage = mInputSlotEmbeddingMaskImage->getImage();
 
 	// Check validity of image
 	if(!lBackgroundColorImage)
-	{
-		mOutputSlot->unlock();
-		mInputSlotEmbeddingMaskImage->unlock();
-		mInputSlotEmbeddingColorImage->unlock();
-		mInputSlotBackgroundColorImage->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotBackgroundColorImage->getFullName().c_str() + string(" does not have a valid image pointer (NULL)") ));
-	}
 	if(!lEmbeddingColorImage)
-	{
-		mOutputSlot->unlock();
-		mInputSlotEmbeddingMaskImage->unlock();
-		mInputSlotEmbeddingColorImage->unlock();
-		mInputSlotBackgroundColorImage->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotEmbeddingColorImage->getFullName().c_str() + string(" does not have a valid image pointer (NULL)") ));
-	}
 	if(!lEmbeddingMaskImage)
-	{
-		mOutputSlot->unlock();
-		mInputSlotEmbeddingMaskImage->unlock();
-		mInputSlotEmbeddingColorImage->unlock();
-		mInputSlotBackgroundColorImage->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotEmbeddingMaskImage->getFullName().c_str() + string(" does not have a valid image pointer (NULL)") ));
-	}
 
 	lWidth = lBackgroundColorImage->getWidth();
 	lHeight = lBackgroundColorImage->getHeight();
@@ -178,94 +200,74 @@ void EmbeddingModule::processFunction(unsigned int inFrameNumber)
 
 	//Verify image depth and number of channels
 	if(lWidth!=lEmbeddingColorImage->getWidth() || lHeight!=lEmbeddingColorImage->getHeight())
-	{
-		mOutputSlot->unlock();
-		mInputSlotEmbeddingMaskImage->unlock();
-		mInputSlotEmbeddingColorImage->unlock();
-		mInputSlotBackgroundColorImage->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotBackgroundColorImage->getFullName().c_str() + string(" and ") + mInputSlotEmbeddingColorImage->getFullName().c_str() + string(" must have the same dimension") ));
-	}
 
 	//Verify image depth and number of channels
 	if(lDepth!=lEmbeddingColorImage->getDepth())
-	{
-		mOutputSlot->unlock();
-		mInputSlotEmbeddingMaskImage->unlock();
-		mInputSlotEmbeddingColorImage->unlock();
-		mInputSlotBackgroundColorImage->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotBackgroundColorImage->getFullName().c_str() + string(" and ") + mInputSlotEmbeddingColorImage->getFullName().c_str() + string(" must have the same depth") ));
-	}
 
 	//Verify image depth and number of channels
 	if(lChannels!=lEmbeddingColorImage->getNbChannels())
-	{
-		mOutputSlot->unlock();
-		mInputSlotEmbeddingMaskImage->unlock();
-		mInputSlotEmbeddingColorImage->unlock();
-		mInputSlotBackgroundColorImage->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotBackgroundColorImage->getFullName().c_str() + string(" and ") + mInputSlotEmbeddingColorImage->getFullName().c_str() + string(" must have the same number of channels") ));
-	}
 
 	//Verify image depth and number of channels
 	if(lWidth!=lEmbeddingMaskImage->getWidth() || lHeight!=lEmbeddingMaskImage->getHeight())
-	{
-		mOutputSlot->unlock();
-		mInputSlotEmbeddingMaskImage->unlock();
-		mInputSlotEmbeddingColorImage->unlock();
-		mInputSlotBackgroundColorImage->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotBackgroundColorImage->getFullName().c_str() + string(" and ") + mInputSlotEmbeddingMaskImage->getFullName().c_str() + string(" must have the same dimension") ));
-	}
 
 	if(lEmbeddingMaskImage->getNbChannels()!=Image::eChannel1 || lEmbeddingMaskImage->getDepth()!=Image::eDepth8U)
-	{
-		mOutputSlot->unlock();
-		mInputSlotEmbeddingMaskImage->unlock();
-		mInputSlotEmbeddingColorImage->unlock();
-		mInputSlotBackgroundColorImage->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotEmbeddingMaskImage->getFullName().c_str() + string(" must be a unsigned 8 bits 1 channel image") ));
-	}
 
-	setToIplImage(*lBackgroundColorImage, &lBackgroundColorImageIpl);
-	setToIplImage(*lEmbeddingColorImage, &lEmbeddingColorImageIpl);
-	setToIplImage(*lEmbeddingMaskImage, &lEmbeddingMaskImageIpl);
+	setToIplImage(*lBackgroundColorImage, &mBackgroundColorImageIpl);
+	setToIplImage(*lEmbeddingColorImage, &mEmbeddingColorImageIpl);
+	setToIplImage(*lEmbeddingMaskImage, &mEmbeddingMaskImageIpl);
+	mBackgroundColorImage = lBackgroundColorImage;
+
+	if(mOutputFrameIpl && (mOutputFrameIpl->width!=mBackgroundColorImageIpl->width || mOutputFrameIpl->height!=mBackgroundColorImageIpl->height || mOutputFrameIpl->nChannels!=mBackgroundColorImageIpl->nChannels || mOutputFrameIpl->depth!=mBackgroundColorImageIpl->depth || isPlannedIplImageStale(mOutputSlot, mOutputFrameIpl)))
+	{
+		releaseIplImage(&mOutputFrameIpl);
+		delete mOutputFrame;
+		mOutputFrameIpl = NULL;
+		mOutputFrame = NULL;
+	}
 
 	// Create output image
 	if(!mOutputFrameIpl)
 	{
-		mOutputFrameIpl = cvCloneImage(lBackgroundColorImageIpl);
+		mOutputFrameIpl = createPlannedIplImage(mOutputSlot, cvGetSize(mBackgroundColorImageIpl), mBackgroundColorImageIpl->depth, mBackgroundColorImageIpl->nChannels);
 		mOutputFrame = new Image(false);
 		setFromIplImage(mOutputFrameIpl, *mOutputFrame);
 		mOutputFrame->setModel(lBackgroundColorImage->getModel());
 	}
-	else
-	{
-		if(mOutputFrameIpl->width!=lWidth || mOutputFrameIpl->height!=lHeight || mOutputFrameIpl->nChannels!=lChannels || mOutputFrameIpl->depth!=lDepth)
-		{
-			cvReleaseImage(&mOutputFrameIpl);
-			delete mOutputFrame;
-			mOutputFrameIpl = cvCloneImage(lBackgroundColorImageIpl);
-	    mOutputFrame = new Image(false);
-	    setFromIplImage(mOutputFrameIpl, *mOutputFrame);
-	    mOutputFrame->setModel(lBackgroundColorImage->getModel());
-		}
-		else
-		{
-			cvCopy(lBackgroundColorImageIpl, mOutputFrameIpl);
-		}
-	}
+}
 
-	// Embed image
-	cvCopy(lEmbeddingColorImageIpl, mOutputFrameIpl, lEmbeddingMaskImageIpl);
+/*! TODO:
+*/
+void EmbeddingModule::processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow)
+{
+	unsigned int lPixelBytes = mOutputFrameIpl->nChannels*((mOutputFrameIpl->depth & 255)/8);
 
-	cvReleaseImageHeader(&lBackgroundColorImageIpl);
-	cvReleaseImageHeader(&lEmbeddingColorImageIpl);
-	cvReleaseImageHeader(&lEmbeddingMaskImageIpl);
+	if(inEndRow>(unsigned int)mOutputFrameIpl->height)
+		inEndRow = mOutputFrameIpl->height;
 
-	mOutputSlot->unlock();
-	mInputSlotEmbeddingMaskImage->unlock();
-	mInputSlotEmbeddingColorImage->unlock();
-	mInputSlotBackgroundColorImage->unlock();
+	// Embed image, copying whole pixels whatever the depth
+	for(unsigned int i = inFirstRow; i < inEndRow; i++)
+		PixelKernels::composeMask((const unsigned char*)mBackgroundColorImageIpl->imageData + i*mBackgroundColorImageIpl->widthStep, (const unsigned char*)mEmbeddingColorImageIpl->imageData + i*mEmbeddingColorImageIpl->widthStep, (const unsigned char*)mEmbeddingMaskImageIpl->imageData + i*mEmbeddingMaskImageIpl->widthStep, (unsigned char*)mOutputFrameIpl->imageData + i*mOutputFrameIpl->widthStep, mOutputFrameIpl->width, lPixelBytes, 255, false);
+}
 
+/*! TODO:
+*/
+void EmbeddingModule::endPointwiseFunction()
+{
+	if(mBackgroundColorImage)
+		mOutputFrame->propagateMetadata(*mBackgroundColorImage);
+	mBackgroundColorImage = NULL;
+
+	if(mBackgroundColorImageIpl)
+		cvReleaseImageHeader(&mBackgroundColorImageIpl);
+	if(mEmbeddingColorImageIpl)
+		cvReleaseImageHeader(&mEmbeddingColorImageIpl);
+	if(mEmbeddingMaskImageIpl)
+		cvReleaseImageHeader(&mEmbeddingMaskImageIpl);
 }
 
 /*! TODO:
@@ -282,7 +284,7 @@ void EmbeddingModule::resetFunction()
 	if(mOutputFrameIpl)
 	{
 		mOutputSlot->lock();
-		cvReleaseImage(&mOutputFrameIpl);
+		releaseIplImage(&mOutputFrameIpl);
 		delete mOutputFrame;
 		mOutputFrameIpl = NULL;
 		mOutputFrame = NULL;
@@ -72,6 +72,13 @@ class EmbeddingModule: public Module
 	//! Resetting the module as it was when created
 	void resetFunction();
 
+	//! Check inputs and allocate output for a frame processed by strips
+	void beginPointwiseFunction(unsigned int inFrameNumber);
+	//! Embed rows of the embedding image into the same rows of the background image
+	void processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow);
+	//! Complete a frame processed by strips
+	void endPointwiseFunction();
+
 	//! Update %Module parameters
 	void updateParametersFunction();
 	//! Verify if Parameter value is valid without actually changing the value
@@ -86,6 +93,11 @@ class EmbeddingModule: public Module
 
 	IplImage* mOutputFrameIpl; //!< Output frame
 	Image* mOutputFrame;
+
+	const Image* mBackgroundColorImage; //!< Background image of the frame being processed
+	IplImage* mBackgroundColorImageIpl; //!< Header on the background image of the frame being processed
+	IplImage* mEmbeddingColorImageIpl; //!< Header on the embedding image of the frame being processed
+	IplImage* mEmbeddingMaskImageIpl; //!< Header on the embedding mask of the frame being processed
 };
 
 #endif //VIPERS_EMBEDDINGMODULE_HPP
@@ -39,6 +39,7 @@
 
 #define VIPERS_UTILS_OPENCV
 #include <ImageUtils.hpp>
+#include <PixelKernels.hpp>
 
 using namespace VIPERS;
 using namespace std;
@@ -53,32 +54,67 @@ using namespace std;
 
 #define OUTPUT_SLOT_NAME_FRAME "output-frame"
 #define OUTPUT_SLOT_DISPLAYNAME_FRAME "Output difference image"
+#define OUTPUT_SLOT_NAME_BITS "output-motion-bits"
+#define OUTPUT_SLOT_DISPLAYNAME_BITS "Output packed motion mask"
+
+#define PARAMETER_NAME_THRESHOLD "threshold"
+#define PARAMETER_NAME_THRESHOLD_VALUE "threshold-value"
 
 /*! TODO:
 */
 ImageDifferenceModule::ImageDifferenceModule()
-	:Module(MODULE_NAME, MODULE_DISPLAY_NAME, IMAGEDIFFERENCEMODULE_VERSION)
+	:Module(MODULE_NAME, MODULE_DISPLAY_NAME, IMAGEDIFFERENCEMODULE_VERSION),
+	mParamThreshold(PARAMETER_NAME_THRESHOLD, Variable::eVariableTypeBool, "Threshold", "Threshold the difference (255 if greater than the threshold value, 0 otherwise)", true),
+	mParamThresholdValue(PARAMETER_NAME_THRESHOLD_VALUE, Variable::eVariableTypeInt, "Threshold value", "Threshold value", true)
 {
+	mParamVersion = 0;
+	mThreshold = -1;
 	mShortDescription = "Module for computing images difference";
-	mLongDescription = "This module computes the difference of two images";
+	mLongDescription = "This module computes the difference of two images, the largest one over the channels of color images.  The difference can be thresholded in the same pass, and the resulting motion mask packed in bits (8 pixels per byte, the first one in the least significant bit).";
+
+	NameSet lDependentParameterSet;
+	lDependentParameterSet.insert(PARAMETER_NAME_THRESHOLD_VALUE);
+	mParamThreshold.setDependentParameterNameSet(lDependentParameterSet);
+
+	mParamThreshold.setValue(false);
+	mParamThresholdValue.setValue(30);
+	mParamThresholdValue.setMinValue("0");
+	mParamThresholdValue.setMaxValue("255");
+	mParamThresholdValue.setEnabled(false);
+
+	newParameter(mParamThreshold);
+	newParameter(mParamThresholdValue);
 
 	mInputSlotImage1 = newSlot(new ModuleSlot(this, INPUT_SLOT_NAME_IMAGE_ONE, INPUT_SLOT_DISPLAYNAME_IMAGE_ONE, "First image"));
 	mInputSlotImage2 = newSlot(new ModuleSlot(this, INPUT_SLOT_NAME_IMAGE_TWO, INPUT_SLOT_DISPLAYNAME_IMAGE_TWO, "Second image"));
 
 	mOutputSlot = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_FRAME, OUTPUT_SLOT_DISPLAYNAME_FRAME, "Difference image", &mOutputFrame));
+	mOutputSlotBits = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_BITS, OUTPUT_SLOT_DISPLAYNAME_BITS, "Non zero pixels of the difference image, packed 8 per byte", &mOutputBits));
 
 	mOutputFrame = NULL;
 	mOutputFrameIpl = NULL;
+	mOutputInPlace = false;
+	mOutputBits = NULL;
+	mOutputBitsIpl = NULL;
+
+	mImageOne = NULL;
+	mImageOneIpl = NULL;
+	mImageTwoIpl = NULL;
+
+	mOutputSlot->setInPlaceInput(mInputSlotImage1);
+	setPointwiseKernel(true);
+	setPlannedOutputs(true);
 }
 
 /*! TODO:
 */
 ImageDifferenceModule::~ImageDifferenceModule()
 {
-	if(mOutputFrameIpl)
+	releaseOutputImage();
+	if(mOutputBitsIpl)
 	{
-		cvReleaseImage(&mOutputFrameIpl);
-		delete mOutputFrame;
+		releaseIplImage(&mOutputBitsIpl);
+		delete mOutputBits;
 	}
 }
 
@@ -113,45 +149,67 @@ void ImageDifferenceModule::pauseFunction()
 /*! TODO:
 */
 void ImageDifferenceModule::processFunction(unsigned int inFrameNumber)
+{
+	if(!mInputSlotImage1->isConnected())
+		throw(Exception(Exception::eCodeUseModule, mInputSlotImage1->getFullName().c_str() + string(" is not connected to an output slot") ));
+	if(!mInputSlotImage2->isConnected())
+		throw(Exception(Exception::eCodeUseModule, mInputSlotImage2->getFullName().c_str() + string(" is not connected to an output slot") ));
+
+	mInputSlotImage1->lock();
+	mInputSlotImage2->lock();
+	mOutputSlot->lock();
+	mOutputSlotBits->lock();
+
+	try
+	{
+		beginPointwiseFunction(inFrameNumber);
+		processPointwiseFunction(0, mOutputFrame->getHeight());
+		endPointwiseFunction();
+	}
+	catch(...)
+	{
+		if(mImageOneIpl)
+			cvReleaseImageHeader(&mImageOneIpl);
+		if(mImageTwoIpl)
+			cvReleaseImageHeader(&mImageTwoIpl);
+		mOutputSlotBits->unlock();
+		mOutputSlot->unlock();
+		mInputSlotImage2->unlock();
+		mInputSlotImage1->unlock();
+		throw;
+	}
+
+	mOutputSlotBits->unlock();
+	mOutputSlot->unlock();
+	mInputSlotImage2->unlock();
+	mInputSlotImage1->unlock();
+}
+
+/*! TODO:
+*/
+void ImageDifferenceModule::beginPointwiseFunction(unsigned int inFrameNumber)
 {
 	const Image* lImageOne;
 	const Image* lImageTwo;
-	IplImage* lImageOneIpl;
-	IplImage* lImageTwoIpl;
 
 	unsigned int lWidth;
 	unsigned int lHeight;
 	Image::Channel lChannels;
 	Image::Depth lDepth;
-	
+
 	if(!mInputSlotImage1->isConnected())
 		throw(Exception(Exception::eCodeUseModule, mInputSlotImage1->getFullName().c_str() + string(" is not connected to an output slot") ));
 	if(!mInputSlotImage2->isConnected())
 		throw(Exception(Exception::eCodeUseModule, mInputSlotImage2->getFullName().c_str() + string(" is not connected to an output slot") ));
 
-	mInputSlotImage1->lock();
-	mInputSlotImage2->lock();
-	mOutputSlot->lock();
-
 	lImageOne = mInputSlotImage1->getImage();
 	lImageTwo = mInputSlotImage2->getImage();
 
 	// Check validity of image
 	if(!lImageOne)
-	{
-		mOutputSlot->unlock();
-		mInputSlotImage2->unlock();
-		mInputSlotImage1->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotImage1->getFullName().c_str() + string(" does not have a valid image pointer (NULL)") ));
-	}
 	if(!lImageTwo)
-	{
-		mOutputSlot->unlock();
-		mInputSlotImage2->unlock();
-		mInputSlotImage1->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotImage2->getFullName().c_str() + string(" does not have a valid image pointer (NULL)") ));
-	}
-
 
 	lWidth = lImageOne->getWidth();
 	lHeight = lImageOne->getHeight();
@@ -160,60 +218,107 @@ void ImageDifferenceModule::processFunction(unsigned int inFrameNumber)
 
 	//Verify image depth and number of channels
 	if(lWidth!=lImageTwo->getWidth() || lHeight!=lImageTwo->getHeight())
-	{
-		mOutputSlot->unlock();
-		mInputSlotImage2->unlock();
-		mInputSlotImage1->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotImage1->getFullName().c_str() + string(" and ") + mInputSlotImage2->getFullName().c_str() + string(" must have the same dimension") ));
-	}
 
 	//Verify image depth and number of channels
 	if(lDepth!=lImageTwo->getDepth())
-	{
-		mOutputSlot->unlock();
-		mInputSlotImage2->unlock();
-		mInputSlotImage1->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotImage1->getFullName().c_str() + string(" and ") + mInputSlotImage2->getFullName().c_str() + string(" must have the same depth (8 bits)") ));
-	}
 
 	//Verify image depth and number of channels
 	if(lChannels!=lImageTwo->getNbChannels())
-	{
-		mOutputSlot->unlock();
-		mInputSlotImage2->unlock();
-		mInputSlotImage1->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlotImage1->getFullName().c_str() + string(" and ") + mInputSlotImage2->getFullName().c_str() + string(" must have the same number of channels") ));
+
+	if(lChannels==Image::eChannel0 || lDepth!=Image::eDepth8U)
+		throw(Exception(Exception::eCodeUseModule, mInputSlotImage1->getFullName().c_str() + string(" and ") + mInputSlotImage2->getFullName().c_str() + string(" must be unsigned 8 bits images") ));
+
+	if(parametersChanged(mParamVersion))
+	{
+		lockParameters();
+		mParamThreshold = getLockedParameter(PARAMETER_NAME_THRESHOLD);
+		mParamThresholdValue = getLockedParameter(PARAMETER_NAME_THRESHOLD_VALUE);
+		unlockParameters();
 	}
+	mThreshold = mParamThreshold.toBool() ? mParamThresholdValue.toInt() : -1;
 
-	if(lChannels!=Image::eChannel1 || lDepth!=Image::eDepth8U)
+	// Only reader of the first image: each difference row is written over the start of the same row of the first
+	// image, which is read before being overwritten since difference pixels are not wider (see ModuleSlot::isInPlace())
+	if(mOutputSlot->isInPlace())
 	{
-		mOutputSlot->unlock();
-		mInputSlotImage2->unlock();
-		mInputSlotImage1->unlock();
-		throw(Exception(Exception::eCodeUseModule, mInputSlotImage1->getFullName().c_str() + string(" and ") + mInputSlotImage2->getFullName().c_str() + string(" must be a unsigned 8 bits 1 channel images") ));
+		if(!mOutputInPlace || mOutputFrame->getData()!=lImageOne->getData() || lImageOne->getWidth()!=mOutputFrame->getWidth() || lImageOne->getHeight()!=mOutputFrame->getHeight() || lImageOne->getRowLengthBytes()!=mOutputFrame->getRowLengthBytes())
+		{
+			releaseOutputImage();
+			mOutputFrame = new Image(false);
+			mOutputFrame->create(lWidth, lHeight, Image::eDepth8U, Image::eChannel1, false, lImageOne->getData(), lImageOne->getRowLengthBytes());
+			mOutputFrame->setModel(Image::eModelGray);
+			setToIplImage(*mOutputFrame, &mOutputFrameIpl);
+			mOutputInPlace = true;
+		}
+	}
+	else
+	{
+		if(mOutputFrameIpl && (mOutputInPlace || mOutputFrameIpl->width!=(int)lWidth || mOutputFrameIpl->height!=(int)lHeight || isPlannedIplImageStale(mOutputSlot, mOutputFrameIpl)))
+			releaseOutputImage();
+
+		// Create output image
+		if(!mOutputFrameIpl)
+		{
+			mOutputFrameIpl = createPlannedIplImage(mOutputSlot, cvSize(lWidth, lHeight), IPL_DEPTH_8U, 1);
+			mOutputFrame = new Image(false);
+			setFromIplImage(mOutputFrameIpl, *mOutputFrame);
+			mOutputFrame->setModel(Image::eModelGray);
+		}
 	}
 
-	setToIplImage(*lImageOne, &lImageOneIpl);
-	setToIplImage(*lImageTwo, &lImageTwoIpl);
+	if(mOutputBitsIpl && (mOutputBitsIpl->width!=(int)(lWidth+7)/8 || mOutputBitsIpl->height!=(int)lHeight || isPlannedIplImageStale(mOutputSlotBits, mOutputBitsIpl)))
+	{
+		releaseIplImage(&mOutputBitsIpl);
+		delete mOutputBits;
+		mOutputBitsIpl = NULL;
+		mOutputBits = NULL;
+	}
 
-	// Create output image
-	if(!mOutputFrameIpl)
+	// Create packed motion mask, one bit per pixel
+	if(!mOutputBitsIpl)
 	{
-		mOutputFrameIpl = cvCreateImage(cvGetSize(lImageOneIpl), IPL_DEPTH_8U, 1);
-		mOutputFrame = new Image(false);
-		setFromIplImage(mOutputFrameIpl, *mOutputFrame);
-		mOutputFrame->setModel(Image::eModelGray);
+		mOutputBitsIpl = createPlannedIplImage(mOutputSlotBits, cvSize((lWidth+7)/8, lHeight), IPL_DEPTH_8U, 1);
+		mOutputBits = new Image(false);
+		setFromIplImage(mOutputBitsIpl, *mOutputBits);
 	}
 
-	// Embed image
-	cvAbsDiff(lImageOneIpl, lImageTwoIpl, mOutputFrameIpl);
+	mImageOne = lImageOne;
+	setToIplImage(*lImageOne, &mImageOneIpl);
+	setToIplImage(*lImageTwo, &mImageTwoIpl);
+}
 
-	cvReleaseImageHeader(&lImageOneIpl);
-	cvReleaseImageHeader(&lImageTwoIpl);
+/*! TODO:
+*/
+void ImageDifferenceModule::processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow)
+{
+	// The packed motion mask is only computed when some module reads it
+	bool lBits = isOutputUsed(mOutputSlotBits);
 
-	mOutputSlot->unlock();
-	mInputSlotImage2->unlock();
-	mInputSlotImage1->unlock();
+	if(inEndRow>(unsigned int)mOutputFrameIpl->height)
+		inEndRow = mOutputFrameIpl->height;
+
+	for(unsigned int i = inFirstRow; i < inEndRow; i++)
+		PixelKernels::differenceMask((const unsigned char*)mImageOneIpl->imageData + i*mImageOneIpl->widthStep, (const unsigned char*)mImageTwoIpl->imageData + i*mImageTwoIpl->widthStep, (unsigned char*)mOutputFrameIpl->imageData + i*mOutputFrameIpl->widthStep, lBits ? (unsigned char*)mOutputBitsIpl->imageData + i*mOutputBitsIpl->widthStep : NULL, mOutputFrameIpl->width, mImageOneIpl->nChannels, mThreshold);
+}
+
+/*! TODO:
+*/
+void ImageDifferenceModule::endPointwiseFunction()
+{
+	if(mImageOne)
+	{
+		mOutputFrame->propagateMetadata(*mImageOne);
+		mOutputBits->propagateMetadata(*mImageOne);
+	}
+	mImageOne = NULL;
+
+	if(mImageOneIpl)
+		cvReleaseImageHeader(&mImageOneIpl);
+	if(mImageTwoIpl)
+		cvReleaseImageHeader(&mImageTwoIpl);
 }
 
 /*! TODO:
@@ -230,19 +335,51 @@ void ImageDifferenceModule::resetFunction()
 	if(mOutputFrameIpl)
 	{
 		mOutputSlot->lock();
-		cvReleaseImage(&mOutputFrameIpl);
-		delete mOutputFrame;
-		mOutputFrameIpl = NULL;
-		mOutputFrame = NULL;
+		releaseOutputImage();
 		mOutputSlot->unlock();
 	}
+	if(mOutputBitsIpl)
+	{
+		mOutputSlotBits->lock();
+		releaseIplImage(&mOutputBitsIpl);
+		delete mOutputBits;
+		mOutputBitsIpl = NULL;
+		mOutputBits = NULL;
+		mOutputSlotBits->unlock();
+	}
+}
+
+/*! TODO:
+*/
+void ImageDifferenceModule::releaseOutputImage()
+{
+	if(!mOutputFrameIpl)
+		return;
+
+	if(mOutputInPlace)
+		cvReleaseImageHeader(&mOutputFrameIpl);
+	else
+		releaseIplImage(&mOutputFrameIpl);
+	delete mOutputFrame;
+	mOutputFrameIpl = NULL;
+	mOutputFrame = NULL;
+	mOutputInPlace = false;
 }
 
 /*!
 */
 void ImageDifferenceModule::updateParametersFunction()
 {
+	lockParameters();
+
+	mParamThreshold = getLockedParameter(PARAMETER_NAME_THRESHOLD);
+	mParamThresholdValue = getLockedParameter(PARAMETER_NAME_THRESHOLD_VALUE);
+
+	mParamThresholdValue.setEnabled(mParamThreshold.toBool());
+
+	setLockedParameter(mParamThresholdValue);
 
+	unlockParameters();
 }
 
 /*!
@@ -72,6 +72,16 @@ class ImageDifferenceModule: public Module
 	//! Resetting the module as it was when created
 	void resetFunction();
 
+	//! Check inputs and allocate output for a frame processed by strips
+	void beginPointwiseFunction(unsigned int inFrameNumber);
+	//! Compute the difference of rows of the input images, thresholded and packed in the same pass
+	void processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow);
+	//! Complete a frame processed by strips
+	void endPointwiseFunction();
+
+	//! Release the output image, or only its header if it is written in place
+	void releaseOutputImage();
+
 	//! Update %Module parameters
 	void updateParametersFunction();
 	//! Verify if Parameter value is valid without actually changing the value
@@ -83,8 +93,22 @@ class ImageDifferenceModule: public Module
 	ModuleSlot* mInputSlotImage2; //!< Input image 2
 	ModuleSlot* mOutputSlot; //!< Difference image slot
 
+	ModuleSlot* mOutputSlotBits; //!< Packed motion mask slot
+
+	Parameter mParamThreshold; //!< Threshold the difference parameter
+	Parameter mParamThresholdValue; //!< Threshold value parameter
+	unsigned long mParamVersion; //!< Version of the parameters last read
+	int mThreshold; //!< Threshold of the frame being processed (negative for no threshold)
+
 	IplImage* mOutputFrameIpl; //!< Output frame
 	Image* mOutputFrame;
+	bool mOutputInPlace; //!< Output frame is the first input image, written in place
+	IplImage* mOutputBitsIpl; //!< Output packed motion mask
+	Image* mOutputBits;
+
+	const Image* mImageOne; //!< First input image of the frame being processed
+	IplImage* mImageOneIpl; //!< Header on the first input image of the frame being processed
+	IplImage* mImageTwoIpl; //!< Header on the second input image of the frame being processed
 };
 
 #endif //VIPERS_IMAGEDIFFERENCEMODULE_HPP
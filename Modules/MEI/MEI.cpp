@@ -79,7 +79,7 @@ MEIModule::~MEIModule()
 {
 	if(mOutputMEIIpl)
 	{
-		cvReleaseImage(&mOutputMEIIpl);
+		releaseIplImage(&mOutputMEIIpl);
 		delete mOutputMEI;
 	}
 
@@ -148,16 +148,16 @@ void MEIModule::processFunction(unsigned int inFrameNumber)
 
 		if(!mOutputMEIIpl)
 		{
-			mOutputMEIIpl = cvCreateImage(cvSize(lMaskImage->getWidth(), lMaskImage->getHeight()), IPL_DEPTH_8U, 1);
+			mOutputMEIIpl = createIplImage(cvSize(lMaskImage->getWidth(), lMaskImage->getHeight()), IPL_DEPTH_8U, 1);
 			mOutputMEI = new Image(false);
 			setFromIplImage(mOutputMEIIpl, *mOutputMEI);
 			mOutputMEI->setModel(Image::eModelGray);
 		}
 		else if(mOutputMEI->getWidth()!=lMaskImage->getWidth() || mOutputMEI->getHeight()!=lMaskImage->getHeight())
 		{
-			cvReleaseImage(&mOutputMEIIpl);
+			releaseIplImage(&mOutputMEIIpl);
 			delete mOutputMEI;
-			mOutputMEIIpl = cvCreateImage(cvSize(lMaskImage->getWidth(), lMaskImage->getHeight()), IPL_DEPTH_8U, 1);
+			mOutputMEIIpl = createIplImage(cvSize(lMaskImage->getWidth(), lMaskImage->getHeight()), IPL_DEPTH_8U, 1);
       mOutputMEI = new Image(false);
       setFromIplImage(mOutputMEIIpl, *mOutputMEI);
       mOutputMEI->setModel(Image::eModelGray);
@@ -165,6 +165,7 @@ void MEIModule::processFunction(unsigned int inFrameNumber)
 
 		setToIplImage(*lMaskImage, &lMaskImageIpl);
 		cvCopy(lMaskImageIpl, mOutputMEIIpl, lMaskImageIpl);
+		mOutputMEI->propagateMetadata(*lMaskImage);
 		cvReleaseImageHeader(&lMaskImageIpl);
 
 		mOutputSlotMEI->unlock();
@@ -205,22 +206,23 @@ void MEIModule::processFunction(unsigned int inFrameNumber)
 
 		if(!mOutputMEIIpl)
 		{
-			mOutputMEIIpl = cvCreateImage(cvSize(lColorImageIpl->width, lColorImageIpl->height), lColorImageIpl->depth, lColorImageIpl->nChannels);
+			mOutputMEIIpl = createIplImage(cvSize(lColorImageIpl->width, lColorImageIpl->height), lColorImageIpl->depth, lColorImageIpl->nChannels);
 			mOutputMEI = new Image(false);
 			setFromIplImage(mOutputMEIIpl, *mOutputMEI);
 			mOutputMEI->setModel(Image::eModelRGB);
 		}
 		else if(mOutputMEIIpl->width!=lColorImageIpl->width || mOutputMEIIpl->height!=lColorImageIpl->height || mOutputMEIIpl->nChannels!=lColorImageIpl->nChannels || mOutputMEIIpl->depth!=lColorImageIpl->depth )
 		{
-			cvReleaseImage(&mOutputMEIIpl);
+			releaseIplImage(&mOutputMEIIpl);
 			delete mOutputMEI;
-			mOutputMEIIpl = cvCreateImage(cvSize(lColorImageIpl->width, lColorImageIpl->height), lColorImageIpl->depth, lColorImageIpl->nChannels);
+			mOutputMEIIpl = createIplImage(cvSize(lColorImageIpl->width, lColorImageIpl->height), lColorImageIpl->depth, lColorImageIpl->nChannels);
 			mOutputMEI = new Image(false);
 			setFromIplImage(mOutputMEIIpl, *mOutputMEI);
 			mOutputMEI->setModel(Image::eModelRGB);
 		}
 
 		cvCopy(lColorImageIpl, mOutputMEIIpl, lMaskImageIpl);
+		mOutputMEI->propagateMetadata(*lColorImage);
 
 		cvReleaseImageHeader(&lColorImageIpl);
     cvReleaseImageHeader(&lMaskImageIpl);
@@ -245,7 +247,7 @@ void MEIModule::resetFunction()
 	if(mOutputMEIIpl)
 	{
 		mOutputSlotMEI->lock();
-		cvReleaseImage(&mOutputMEIIpl);
+		releaseIplImage(&mOutputMEIIpl);
 		delete mOutputMEI;
 		mOutputMEIIpl = NULL;
 		mOutputMEI = NULL;
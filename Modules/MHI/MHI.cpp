@@ -37,8 +37,10 @@
 
 #define VIPERS_UTILS_OPENCV
 #include <ImageUtils.hpp>
+#include <PixelKernels.hpp>
 
 #include <sstream>
+#include <cmath>
 
 using namespace VIPERS;
 using namespace std;
@@ -56,6 +58,40 @@ using namespace std;
 #define PARAMETER_NAME_UNITS "units"
 #define PARAMETER_NAME_DURATION "duration"
 
+//! Number of stamps in the duration when it is in seconds (half the stamps, so frames can be up to a duration apart)
+#define MHI_SECONDS_DURATION_STAMPS 16384
+//! Largest duration in stamps, so stamps stay unambiguous when they advance by up to a duration between frames
+#define MHI_MAX_DURATION_STAMPS 32767
+//! Smallest number of rows updated by a thread
+#define MHI_GRAIN_ROWS 16
+
+namespace
+{
+	/*! Updates rows of the motion history and of its gray visualization, reading and writing each of them once
+	*/
+	class HistoryUpdateTask: public ParallelTask
+	{
+		public:
+
+		HistoryUpdateTask(const Image* inMask, Image* ioStamps, Image* outGray, unsigned short inStamp, unsigned short inDuration)
+			: mMask(inMask), mStamps(ioStamps), mGray(outGray), mStamp(inStamp), mDuration(inDuration) {}
+
+		void run(unsigned int inFirst, unsigned int inEnd)
+		{
+			for(unsigned int i = inFirst; i < inEnd; i++)
+				PixelKernels::updateMotionHistory((const unsigned char*)mMask->getRow(i), (unsigned short*)mStamps->getRow(i), mGray ? (unsigned char*)mGray->getRow(i) : NULL, mStamps->getWidth(), mStamp, mDuration);
+		}
+
+		private:
+
+		const Image* mMask; //!< Motion mask
+		Image* mStamps; //!< Motion history stamps
+		Image* mGray; //!< Gray visualization (NULL if not computed)
+		unsigned short mStamp; //!< Stamp of the frame
+		unsigned short mDuration; //!< Duration of the history, in stamps
+	};
+}
+
 /*! TODO:
 */
 MHIModule::MHIModule()
@@ -63,8 +99,9 @@ MHIModule::MHIModule()
 	mParamUnits(PARAMETER_NAME_UNITS, Variable::eVariableTypeString, "Duration units", "Units are either seconds or frames", false),
 	mParamDuration(PARAMETER_NAME_DURATION, Variable::eVariableTypeDouble, "Duration", "Duration parameter for MHI, in seconds or in frames", true)
 {
+	mParamVersion = 0;
 	mShortDescription = "Module for computing motion history image";
-	mLongDescription = "This module computes a motion history image from binary images";
+	mLongDescription = "This module computes a motion history image from binary images.  The history holds 16 bits stamps: 0 where there was no motion for the duration, and the stamp of the last frame with motion elsewhere.  Stamps count from 1 to 65535 then wrap to 1; the current stamp and the duration in stamps are given by the \"mhi-stamp\" and \"mhi-duration\" metadata properties of the history.";
 
 	ValueSet lUnitsValues;
 	lUnitsValues.insert(Value("frames", "Frames", "Elapsed time is counted in frames"));
@@ -81,7 +118,7 @@ MHIModule::MHIModule()
 	newParameter(mParamDuration);
 
 	mInputSlotMask = newSlot(new ModuleSlot(this, INPUT_SLOT_NAME_MASK, INPUT_SLOT_DISPLAYNAME_MASK, "Input mask image used to compute MHI"));
-	mOutputSlotMHI = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_MHI, OUTPUT_SLOT_DISPLAYNAME_MHI, "Output MHI image (floating point)", &mOutputMHI));
+	mOutputSlotMHI = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_MHI, OUTPUT_SLOT_DISPLAYNAME_MHI, "Output MHI image (16 bits stamps)", &mOutputMHI));
 	mOutputSlotMHIGray = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_MHI_GRAY, OUTPUT_SLOT_DISPLAYNAME_MHI_GRAY, "Output MHI image (gray scale image)", &mOutputMHIGray));
 
   mOutputMHIIpl = NULL;
@@ -89,6 +126,9 @@ MHIModule::MHIModule()
 	mOutputMHI = NULL;
 	mOutputMHIGray = NULL;
 	mEllapsedTime = 0;
+	mStamp = 0;
+	mStampScale = 0;
+	mStampTime = 0;
 }
 
 /*! TODO:
@@ -97,12 +137,12 @@ MHIModule::~MHIModule()
 {
 	if(mOutputMHIIpl)
 	{
-		cvReleaseImage(&mOutputMHIIpl);
+		releaseIplImage(&mOutputMHIIpl);
 		delete mOutputMHI;
 	}
 	if(mOutputMHIGrayIpl)
 	{
-		cvReleaseImage(&mOutputMHIGrayIpl);
+		releaseIplImage(&mOutputMHIGrayIpl);
 		delete mOutputMHIGray;
 	}
 }
@@ -143,62 +183,64 @@ void MHIModule::pauseFunction()
 void MHIModule::processFunction(unsigned int inFrameNumber)
 {
 	const Image* lMaskImage;
-	IplImage* lMaskImageIpl;
-	string lUnits;
+	string lUnits = mParamUnits.toString();
+	double lStampScale;
+	double lDurationStamps;
+	double lStampTime;
+	double lAdvance;
 
 	if(!mInputSlotMask->isConnected())
 		throw(Exception(Exception::eCodeUseModule, mInputSlotMask->getFullName().c_str() + string(" is not connected to an output slot") ));
 
-	lockParameters();
-	lUnits = getLockedParameter(PARAMETER_NAME_UNITS).toString();
-	mParamDuration = getLockedParameter(PARAMETER_NAME_DURATION);
-	unlockParameters();
+	if(parametersChanged(mParamVersion))
+	{
+		lockParameters();
+		lUnits = getLockedParameter(PARAMETER_NAME_UNITS).toString();
+		mParamDuration = getLockedParameter(PARAMETER_NAME_DURATION);
+		unlockParameters();
+	}
 
 	mInputSlotMask->lock();
 
 	lMaskImage = mInputSlotMask->getImage();
 
-	if(lMaskImage->getNbChannels()!=Image::eChannel1)
+	if(lMaskImage->getNbChannels()!=Image::eChannel1 || lMaskImage->getDepth()!=Image::eDepth8U)
 	{
 		mInputSlotMask->unlock();
-		throw(Exception(Exception::eCodeUseModule, mInputSlotMask->getFullName().c_str() + string(" must be a 1 channel image mask") ));
+		throw(Exception(Exception::eCodeUseModule, mInputSlotMask->getFullName().c_str() + string(" must be a unsigned 8 bits 1 channel image mask") ));
 	}
 
 	mOutputSlotMHI->lock();
 	mOutputSlotMHIGray->lock();
 
-	setToIplImage(*lMaskImage, &lMaskImageIpl);
+	if(mOutputMHIIpl && (mOutputMHIIpl->width!=(int)lMaskImage->getWidth() || mOutputMHIIpl->height!=(int)lMaskImage->getHeight()))
+	{
+		releaseIplImage(&mOutputMHIIpl);
+		delete mOutputMHI;
+		releaseIplImage(&mOutputMHIGrayIpl);
+		delete mOutputMHIGray;
+		mOutputMHIIpl = NULL;
+		mEllapsedTime = 0;
+		mTimer.reset();
+	}
 
 	if(!mOutputMHIIpl)
 	{
-		mOutputMHIIpl = cvCreateImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_32F, 1);
+		mOutputMHIIpl = createIplImage(cvSize(lMaskImage->getWidth(), lMaskImage->getHeight()), IPL_DEPTH_16U, 1);
 		mOutputMHI = new Image(false);
 		setFromIplImage(mOutputMHIIpl, *mOutputMHI);
-		mOutputMHIGrayIpl = cvCreateImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_8U, 1);
+		mOutputMHIGrayIpl = createIplImage(cvSize(lMaskImage->getWidth(), lMaskImage->getHeight()), IPL_DEPTH_8U, 1);
 		mOutputMHIGray = new Image(false);
 		setFromIplImage(mOutputMHIGrayIpl, *mOutputMHIGray);
-	}
-	else if(mOutputMHIIpl->width!=lMaskImageIpl->width || mOutputMHIIpl->height!=lMaskImageIpl->height)
-	{
-		cvReleaseImage(&mOutputMHIIpl);
-		delete mOutputMHI;
-		cvReleaseImage(&mOutputMHIGrayIpl);
-		delete mOutputMHIGray;
-		mOutputMHIIpl = cvCreateImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_32F, 1);
-    mOutputMHI = new Image(false);
-    setFromIplImage(mOutputMHIIpl, *mOutputMHI);
-		mOutputMHIGrayIpl = cvCreateImage(cvSize(lMaskImageIpl->width, lMaskImageIpl->height), IPL_DEPTH_8U, 1);
-    mOutputMHIGray = new Image(false);
-    setFromIplImage(mOutputMHIGrayIpl, *mOutputMHIGray);
-		mEllapsedTime = 0;
-		mTimer.reset();
+		mOutputMHIGray->setModel(Image::eModelGray);
+		// No stamps yet, cleared below
+		mStampScale = 0;
 	}
 
 	if(lUnits!=mParamUnits.toString())
 	{
 		mParamUnits.setValueStr(lUnits);
-		cvSetZero(mOutputMHIIpl);
-		cvSetZero(mOutputMHIGrayIpl);
+		mStampScale = 0;
 		mEllapsedTime = 0;
 		mTimer.reset();
 	}
@@ -206,18 +248,60 @@ void MHIModule::processFunction(unsigned int inFrameNumber)
 	if(lUnits=="frames")
 	{
 		mEllapsedTime++;
-		cvUpdateMotionHistory(lMaskImageIpl, mOutputMHIIpl, inFrameNumber, mParamDuration.toDouble());
+		lStampScale = 1;
 	}
 	else
 	{
 		mEllapsedTime = mTimer.getValue();
-		cvUpdateMotionHistory(lMaskImageIpl, mOutputMHIIpl, mEllapsedTime, mParamDuration.toDouble());
+		lStampScale = MHI_SECONDS_DURATION_STAMPS/((mParamDuration.toDouble()>0) ? mParamDuration.toDouble() : 1.0);
+	}
+
+	lDurationStamps = floor(mParamDuration.toDouble()*lStampScale);
+	if(lDurationStamps<1)
+		lDurationStamps = 1;
+	else if(lDurationStamps>MHI_MAX_DURATION_STAMPS)
+		lDurationStamps = MHI_MAX_DURATION_STAMPS;
+
+	// Advance the stamp by the whole number of stamps elapsed since the last frame.  When the scale changed, time
+	// went back or all the stamps are older than the duration, the history is cleared instead.
+	lStampTime = floor(mEllapsedTime*lStampScale);
+	lAdvance = lStampTime-mStampTime;
+	if(lStampScale!=mStampScale || lAdvance<0 || lAdvance>lDurationStamps)
+	{
+		cvSetZero(mOutputMHIIpl);
+		cvSetZero(mOutputMHIGrayIpl);
+		mStamp = 1;
+	}
+	else
+		mStamp = (unsigned short)((mStamp-1+(unsigned long)lAdvance)%65535+1);
+	mStampScale = lStampScale;
+	mStampTime = lStampTime;
+
+	try
+	{
+		// The gray visualization is computed in the same pass, only when some module reads it
+		HistoryUpdateTask lHistoryUpdateTask(lMaskImage, mOutputMHI, isOutputUsed(mOutputSlotMHIGray) ? mOutputMHIGray : NULL, mStamp, (unsigned short)lDurationStamps);
+		parallelFor(0, mOutputMHI->getHeight(), lHistoryUpdateTask, MHI_GRAIN_ROWS);
 	}
+	catch(...)
+	{
+		mOutputSlotMHIGray->unlock();
+		mOutputSlotMHI->unlock();
+		mInputSlotMask->unlock();
+		throw;
+	}
+
+	ostringstream lStamp;
+	ostringstream lDuration;
+	lStamp << mStamp;
+	lDuration << lDurationStamps;
 
-	if(mOutputSlotMHIGray->getUseCount() && mEllapsedTime>mParamDuration.toDouble())
-		cvConvertScale(mOutputMHIIpl, mOutputMHIGrayIpl, 255.0/mParamDuration.toDouble(), -(inFrameNumber-mParamDuration.toDouble())*( 255.0/mParamDuration.toDouble()) );
+	mOutputMHI->propagateMetadata(*lMaskImage);
+	mOutputMHI->getMetadata().setProperty("mhi-stamp", lStamp.str());
+	mOutputMHI->getMetadata().setProperty("mhi-duration", lDuration.str());
 
-	cvReleaseImageHeader(&lMaskImageIpl);
+	if(isOutputUsed(mOutputSlotMHIGray))
+		mOutputMHIGray->propagateMetadata(*lMaskImage);
 
 	mOutputSlotMHIGray->unlock();
 	mOutputSlotMHI->unlock();
@@ -241,7 +325,7 @@ void MHIModule::resetFunction()
 	if(mOutputMHIIpl)
 	{
 		mOutputSlotMHI->lock();
-		cvReleaseImage(&mOutputMHIIpl);
+		releaseIplImage(&mOutputMHIIpl);
 		delete mOutputMHI;
 		mOutputMHIIpl = NULL;
 		mOutputMHI = NULL;
@@ -250,7 +334,7 @@ void MHIModule::resetFunction()
 	if(mOutputMHIGrayIpl)
 	{
 		mOutputSlotMHIGray->lock();
-		cvReleaseImage(&mOutputMHIGrayIpl);
+		releaseIplImage(&mOutputMHIGrayIpl);
 		delete mOutputMHIGray;
 		mOutputMHIGrayIpl = NULL;
 		mOutputMHIGray = NULL;
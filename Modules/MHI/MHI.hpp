@@ -82,17 +82,21 @@ class MHIModule: public Module
 
 	Parameter mParamUnits; //!< Units use for MHI duration
 	Parameter mParamDuration; //!< MHI duration parameter
+	unsigned long mParamVersion; //!< Version of the parameters last read
 
 	ModuleSlot* mInputSlotMask; //!< Mask slot
 	ModuleSlot* mOutputSlotMHI; //!< MHI slot
 	ModuleSlot* mOutputSlotMHIGray; //!< MHI gray image slot
 
-	IplImage* mOutputMHIIpl; //!< Output MHI
+	IplImage* mOutputMHIIpl; //!< Output MHI (16 bits stamps)
 	IplImage* mOutputMHIGrayIpl; //!< Output MHI gray image
   Image* mOutputMHI;
   Image* mOutputMHIGray;
 
 	double mEllapsedTime; //!< Ellapsed time
+	unsigned short mStamp; //!< Stamp of the last frame
+	double mStampScale; //!< Number of stamps per unit of elapsed time (0 if the history is cleared)
+	double mStampTime; //!< Elapsed time of the last frame, in whole stamps
 	Timer mTimer; //!< Duration timer
 };
 
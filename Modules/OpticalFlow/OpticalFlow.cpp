@@ -35,9 +35,13 @@
 #include "OpticalFlow.hpp"
 #include "OpticalFlowConfig.hpp"
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <sstream>
 
 #define VIPERS_UTILS_OPENCV
 #include <ImageUtils.hpp>
+#include <PixelKernels.hpp>
 
 using namespace VIPERS;
 using namespace std;
@@ -47,6 +51,8 @@ using namespace std;
 
 #define INPUT_SLOT_NAME "input-gray-image"
 #define INPUT_SLOT_DISPLAYNAME "Gray image"
+#define INPUT_SLOT_NAME_FEATURES "input-features"
+#define INPUT_SLOT_DISPLAYNAME_FEATURES "Features"
 #define OUTPUT_SLOT_NAME_VEL_X "output-velx"
 #define OUTPUT_SLOT_DISPLAYNAME_VEL_X "X velocity"
 #define OUTPUT_SLOT_NAME_VEL_Y "output-vely"
@@ -57,6 +63,8 @@ using namespace std;
 #define OUTPUT_SLOT_DISPLAYNAME_VEL_NORM_GRAY "Velocity norm gray"
 #define OUTPUT_SLOT_NAME_VEL_VECTORS "output-vel-vectors"
 #define OUTPUT_SLOT_DISPLAYNAME_VEL_VECTORS "Velocity vectors"
+#define OUTPUT_SLOT_NAME_FEATURES "output-features"
+#define OUTPUT_SLOT_DISPLAYNAME_FEATURES "Tracked features"
 
 #define PARAMETER_NAME_ALGORITHM "algorithm"
 #define PARAMETER_DISPLAYNAME_ALGORITHM "Algorithm"
@@ -76,28 +84,223 @@ using namespace std;
 #define PARAMETER_DISPLAYNAME_CRITERION_MAX_ITER "Maximum iteration"
 #define PARAMETER_NAME_CRITERION_EPSILON "criterion-epsilon"
 #define PARAMETER_DISPLAYNAME_CRITERION_EPSILON "Epsilon"
+#define PARAMETER_NAME_MAX_FEATURES "max-features"
+#define PARAMETER_DISPLAYNAME_MAX_FEATURES "Maximum features"
+#define PARAMETER_NAME_QUALITY_LEVEL "quality-level"
+#define PARAMETER_DISPLAYNAME_QUALITY_LEVEL "Quality level"
+#define PARAMETER_NAME_MIN_DISTANCE "min-distance"
+#define PARAMETER_DISPLAYNAME_MIN_DISTANCE "Minimum distance"
+#define PARAMETER_NAME_PYRAMID_LEVELS "pyramid-levels"
+#define PARAMETER_DISPLAYNAME_PYRAMID_LEVELS "Pyramid levels"
+
+//! Distance in pixels between the velocities drawn in the velocity vectors image (BM, HS, LK)
+#define OPTICAL_FLOW_VECTOR_SPACING 8
+
+//! Name of the metadata property giving the number of features in the tracked features image
+#define PROPERTY_NAME_FEATURE_COUNT "feature-count"
+
+//! Smallest number of rows of blocks matched by a thread
+#define BLOCK_MATCHING_GRAIN_ROWS 4
+//! Mean absolute difference of the pixels of a block under which a displacement is accepted without searching further
+#define BLOCK_MATCHING_SMALL_DIFF 2
+//! Mean absolute difference of the pixels of a block over which the predictive search falls back to scanning the range
+#define BLOCK_MATCHING_BIG_DIFF 8
+
+namespace
+{
+	//! State of the search of the displacement of a block
+	struct BlockSearch
+	{
+		int mX; //!< Column of the block in the previous image
+		int mY; //!< Row of the block in the previous image
+		int mMinDX; //!< Smallest horizontal displacement keeping the block in the image and in range
+		int mMaxDX; //!< Largest horizontal displacement keeping the block in the image and in range
+		int mMinDY; //!< Smallest vertical displacement keeping the block in the image and in range
+		int mMaxDY; //!< Largest vertical displacement keeping the block in the image and in range
+		int mBestDX; //!< Horizontal displacement of the best match found
+		int mBestDY; //!< Vertical displacement of the best match found
+		unsigned int mBest; //!< Sum of absolute differences of the best match found
+	};
+
+	/*! Block matching of rows of blocks: each block of the previous image is searched for in the current image with a
+	    predictive diamond search instead of scanning the whole range.  The search starts from the best of the null
+	    displacement, the displacement of the block on the left and, when a previous velocity field is given, the
+	    previous displacements of the block and of its neighbors.  It then follows the large diamond pattern while it
+	    finds better matches and ends with the small diamond.  The first block of each row, and the blocks whose best
+	    match still differs by BLOCK_MATCHING_BIG_DIFF or more on average, scan the rest of their range.  Blocks are
+	    compared by the sum of absolute differences of their pixels, and the search stops as soon as their mean
+	    difference is below BLOCK_MATCHING_SMALL_DIFF.
+	*/
+	class BlockMatchingTask: public ParallelTask
+	{
+		public:
+
+		BlockMatchingTask(const Image* inPrevious, const Image* inCurrent, const Image* inPreviousVelX, const Image* inPreviousVelY, Image* outVelX, Image* outVelY, CvSize inBlockSize, CvSize inShiftSize, CvSize inMaxRange)
+			: mPrevious(inPrevious), mCurrent(inCurrent), mPreviousVelX(inPreviousVelX), mPreviousVelY(inPreviousVelY), mVelX(outVelX), mVelY(outVelY),
+			  mBlockSize(inBlockSize), mShiftSize(inShiftSize), mMaxRange(inMaxRange) {}
+
+		void run(unsigned int inFirst, unsigned int inEnd)
+		{
+			static const int sLargeDiamond[8][2] = {{0,-2}, {1,-1}, {2,0}, {1,1}, {0,2}, {-1,1}, {-2,0}, {-1,-1}};
+			static const int sSmallDiamond[4][2] = {{0,-1}, {1,0}, {0,1}, {-1,0}};
+
+			int lNbBlocks = mVelX->getWidth();
+			int lNbRows = mVelX->getHeight();
+			int lMaxX = mPrevious->getWidth()-mBlockSize.width;
+			int lMaxY = mPrevious->getHeight()-mBlockSize.height;
+			unsigned int lAccept = BLOCK_MATCHING_SMALL_DIFF*mBlockSize.width*mBlockSize.height;
+			unsigned int lEscape = BLOCK_MATCHING_BIG_DIFF*mBlockSize.width*mBlockSize.height;
+			vector<unsigned int> lVisited((2*mMaxRange.width+1)*(2*mMaxRange.height+1), 0);
+			unsigned int lMark = 0;
+
+			for(int j = inFirst; j < (int)inEnd; j++)
+			{
+				float* lVelX = (float*)mVelX->getRow(j);
+				float* lVelY = (float*)mVelY->getRow(j);
+
+				for(int i = 0; i < lNbBlocks; i++)
+				{
+					BlockSearch lSearch;
+					lSearch.mX = i*mShiftSize.width;
+					lSearch.mY = j*mShiftSize.height;
+					lSearch.mMinDX = -std::min(mMaxRange.width, lSearch.mX);
+					lSearch.mMaxDX = std::min(mMaxRange.width, lMaxX-lSearch.mX);
+					lSearch.mMinDY = -std::min(mMaxRange.height, lSearch.mY);
+					lSearch.mMaxDY = std::min(mMaxRange.height, lMaxY-lSearch.mY);
+					lSearch.mBestDX = 0;
+					lSearch.mBestDY = 0;
+					lSearch.mBest = 0xFFFFFFFF;
+					lMark++;
+
+					// Predicted displacements
+					int lCandidates[6][2];
+					int lNbCandidates = 0;
+					lCandidates[lNbCandidates][0] = 0;
+					lCandidates[lNbCandidates++][1] = 0;
+					if(i>0)
+					{
+						lCandidates[lNbCandidates][0] = cvRound(lVelX[i-1]);
+						lCandidates[lNbCandidates++][1] = cvRound(lVelY[i-1]);
+					}
+					if(mPreviousVelX)
+					{
+						const float* lPreviousVelX = (const float*)mPreviousVelX->getRow(j);
+						const float* lPreviousVelY = (const float*)mPreviousVelY->getRow(j);
+						lCandidates[lNbCandidates][0] = cvRound(lPreviousVelX[i]);
+						lCandidates[lNbCandidates++][1] = cvRound(lPreviousVelY[i]);
+						if(i+1<lNbBlocks)
+						{
+							lCandidates[lNbCandidates][0] = cvRound(lPreviousVelX[i+1]);
+							lCandidates[lNbCandidates++][1] = cvRound(lPreviousVelY[i+1]);
+						}
+						if(j>0)
+						{
+							lCandidates[lNbCandidates][0] = cvRound(((const float*)mPreviousVelX->getRow(j-1))[i]);
+							lCandidates[lNbCandidates++][1] = cvRound(((const float*)mPreviousVelY->getRow(j-1))[i]);
+						}
+						if(j+1<lNbRows)
+						{
+							lCandidates[lNbCandidates][0] = cvRound(((const float*)mPreviousVelX->getRow(j+1))[i]);
+							lCandidates[lNbCandidates++][1] = cvRound(((const float*)mPreviousVelY->getRow(j+1))[i]);
+						}
+					}
+					for(int k = 0; k < lNbCandidates && lSearch.mBest>=lAccept; k++)
+						compare(lSearch, lCandidates[k][0], lCandidates[k][1], lVisited, lMark);
+
+
+					// Large diamond around the best match while it moves, then small diamond
+					bool lMoved = true;
+					while(lMoved && lSearch.mBest>=lAccept)
+					{
+						int lCenterX = lSearch.mBestDX;
+						int lCenterY = lSearch.mBestDY;
+						lMoved = false;
+						for(int k = 0; k < 8 && lSearch.mBest>=lAccept; k++)
+							if(compare(lSearch, lCenterX+sLargeDiamond[k][0], lCenterY+sLargeDiamond[k][1], lVisited, lMark))
+								lMoved = true;
+					}
+					int lCenterX = lSearch.mBestDX;
+					int lCenterY = lSearch.mBestDY;
+					for(int k = 0; k < 4 && lSearch.mBest>=lAccept; k++)
+						compare(lSearch, lCenterX+sSmallDiamond[k][0], lCenterY+sSmallDiamond[k][1], lVisited, lMark);
+
+					// The first block of a row has no neighbor to start from, and a poor match is likely a local minimum:
+					// the rest of the range is scanned
+					if(i==0 || lSearch.mBest>=lEscape)
+						for(int lDY = lSearch.mMinDY; lDY <= lSearch.mMaxDY && lSearch.mBest>=lAccept; lDY++)
+							for(int lDX = lSearch.mMinDX; lDX <= lSearch.mMaxDX && lSearch.mBest>=lAccept; lDX++)
+								compare(lSearch, lDX, lDY, lVisited, lMark);
+
+					lVelX[i] = (float)lSearch.mBestDX;
+					lVelY[i] = (float)lSearch.mBestDY;
+				}
+			}
+		}
+
+		private:
+
+		//! Compare the block with the one at a displacement in the current image, if in range and not already compared; returns true if it is the best match so far
+		bool compare(BlockSearch& ioSearch, int inDX, int inDY, vector<unsigned int>& ioVisited, unsigned int inMark) const
+		{
+			if(inDX<ioSearch.mMinDX || inDX>ioSearch.mMaxDX || inDY<ioSearch.mMinDY || inDY>ioSearch.mMaxDY)
+				return false;
+
+			unsigned int& lVisited = ioVisited[(inDY+mMaxRange.height)*(2*mMaxRange.width+1) + inDX+mMaxRange.width];
+			if(lVisited==inMark)
+				return false;
+			lVisited = inMark;
+
+			unsigned int lSad = PixelKernels::blockSad((const unsigned char*)mPrevious->getRow(ioSearch.mY)+ioSearch.mX, mPrevious->getRowLengthBytes(),
+			                                           (const unsigned char*)mCurrent->getRow(ioSearch.mY+inDY)+ioSearch.mX+inDX, mCurrent->getRowLengthBytes(),
+			                                           mBlockSize.width, mBlockSize.height, ioSearch.mBest);
+			if(lSad>=ioSearch.mBest)
+				return false;
+
+			ioSearch.mBest = lSad;
+			ioSearch.mBestDX = inDX;
+			ioSearch.mBestDY = inDY;
+			return true;
+		}
+
+		const Image* mPrevious; //!< Previous gray image, where the blocks are taken
+		const Image* mCurrent; //!< Current gray image, where the blocks are searched for
+		const Image* mPreviousVelX; //!< Previous horizontal velocities (NULL if not used)
+		const Image* mPreviousVelY; //!< Previous vertical velocities (NULL if not used)
+		Image* mVelX; //!< Horizontal velocities, one per block
+		Image* mVelY; //!< Vertical velocities, one per block
+		CvSize mBlockSize; //!< Size of the blocks
+		CvSize mShiftSize; //!< Distance between the blocks
+		CvSize mMaxRange; //!< Largest displacement searched
+	};
+}
 
 /*! TODO:
 */
 OpticalFlowModule::OpticalFlowModule()
 	:Module(MODULE_NAME, MODULE_DISPLAY_NAME, OPTICALFLOWMODULE_VERSION),
 	mParamAlgorithm(PARAMETER_NAME_ALGORITHM, Variable::eVariableTypeString, PARAMETER_DISPLAYNAME_ALGORITHM, "Optical flow algorithm", false),
-	mParamBlockSize(PARAMETER_NAME_BLOCK_SIZE, Variable::eVariableTypeSize, PARAMETER_DISPLAYNAME_BLOCK_SIZE, "Size of the compared block (BM); Size of averaging window (LK)", false),
-	mParamShiftSize(PARAMETER_NAME_SHIFT_SIZE, Variable::eVariableTypeSize, PARAMETER_DISPLAYNAME_SHIFT_SIZE, "Block coordinate increments", false),
-  mParamMaxRange(PARAMETER_NAME_MAX_RANGE, Variable::eVariableTypeSize, PARAMETER_DISPLAYNAME_MAX_RANGE, "Size of the scanned neighborhood in pixels around the block", false),
+	mParamBlockSize(PARAMETER_NAME_BLOCK_SIZE, Variable::eVariableTypeSize, PARAMETER_DISPLAYNAME_BLOCK_SIZE, "Size of the compared block (BM); Size of averaging window (LK, PLK)", true),
+	mParamShiftSize(PARAMETER_NAME_SHIFT_SIZE, Variable::eVariableTypeSize, PARAMETER_DISPLAYNAME_SHIFT_SIZE, "Block coordinate increments", true),
+  mParamMaxRange(PARAMETER_NAME_MAX_RANGE, Variable::eVariableTypeSize, PARAMETER_DISPLAYNAME_MAX_RANGE, "Size of the scanned neighborhood in pixels around the block", true),
   mParamUsePrevious(PARAMETER_NAME_USE_PREVIOUS, Variable::eVariableTypeBool, PARAMETER_DISPLAYNAME_USE_PREVIOUS, "Uses the previous velocity field", true),
   mParamLambda(PARAMETER_NAME_LAMBDA, Variable::eVariableTypeDouble, PARAMETER_DISPLAYNAME_LAMBDA, "The Lagrangian multiplier in the Horn & Schunck algorithm", true),
   mParamCriterionType(PARAMETER_NAME_CRITERION_TYPE, Variable::eVariableTypeString, PARAMETER_DISPLAYNAME_CRITERION_TYPE, "The type of termination criterion", true),
   mParamCriterionMaxIter(PARAMETER_NAME_CRITERION_MAX_ITER, Variable::eVariableTypeUInt, PARAMETER_DISPLAYNAME_CRITERION_MAX_ITER, "Maximum number of iteration (termination criterion)", true),
-  mParamCriterionEpsilon(PARAMETER_NAME_CRITERION_EPSILON, Variable::eVariableTypeDouble, PARAMETER_DISPLAYNAME_CRITERION_EPSILON, "Epsilon (termination criterion)", true)
+  mParamCriterionEpsilon(PARAMETER_NAME_CRITERION_EPSILON, Variable::eVariableTypeDouble, PARAMETER_DISPLAYNAME_CRITERION_EPSILON, "Epsilon (termination criterion)", true),
+  mParamMaxFeatures(PARAMETER_NAME_MAX_FEATURES, Variable::eVariableTypeUInt, PARAMETER_DISPLAYNAME_MAX_FEATURES, "Maximum number of tracked features (PLK)", true),
+  mParamQualityLevel(PARAMETER_NAME_QUALITY_LEVEL, Variable::eVariableTypeDouble, PARAMETER_DISPLAYNAME_QUALITY_LEVEL, "Smallest quality of a detected feature, relative to the best one (PLK)", true),
+  mParamMinDistance(PARAMETER_NAME_MIN_DISTANCE, Variable::eVariableTypeDouble, PARAMETER_DISPLAYNAME_MIN_DISTANCE, "Smallest distance in pixels between detected features (PLK)", true),
+  mParamPyramidLevels(PARAMETER_NAME_PYRAMID_LEVELS, Variable::eVariableTypeUInt, PARAMETER_DISPLAYNAME_PYRAMID_LEVELS, "Number of pyramid levels above the image (PLK)", true)
 {
+	mParamVersion = 0;
 	mShortDescription = "Module for computing optical flow";
-	mLongDescription = "This module computes optical flow from a gray scale image";
+	mLongDescription = "This module computes optical flow from a gray scale image.  Block matching searches each block from the displacements predicted by its neighbors and by the previous velocities (diamond search compared by sums of absolute differences, on all the threads); Horn & Schunck and Lucas & Kanade use OpenCV.  Pyramidal Lucas & Kanade tracks sparse features (detected good features to track, or upstream ones) across reused image pyramids and publishes the tracked points, with one velocity per feature.";
 
 	ValueSet lAlgoValues;
 	lAlgoValues.insert(Value("bm", "Block Matching", "Block matching algorithm"));
 	lAlgoValues.insert(Value("hs", "Horn Schunck", "The Horn & Schunck algorithm"));
 	lAlgoValues.insert(Value("lk", "Lucas Kanade", "The Lucas & Kanade algorithm"));
+	lAlgoValues.insert(Value("pyrlk", "Pyramidal Lucas Kanade", "Sparse pyramidal Lucas & Kanade tracking of features"));
 
 	ValueSet lCriterionValues;
 	lCriterionValues.insert(Value("max-iter", "Maximum iteration", "Maximum number of iteration (termination criterion)"));
@@ -113,6 +316,10 @@ OpticalFlowModule::OpticalFlowModule()
   lAlgorithmDependentParameterSet.insert(PARAMETER_NAME_CRITERION_TYPE);
   lAlgorithmDependentParameterSet.insert(PARAMETER_NAME_CRITERION_MAX_ITER);
   lAlgorithmDependentParameterSet.insert(PARAMETER_NAME_CRITERION_EPSILON);
+  lAlgorithmDependentParameterSet.insert(PARAMETER_NAME_MAX_FEATURES);
+  lAlgorithmDependentParameterSet.insert(PARAMETER_NAME_QUALITY_LEVEL);
+  lAlgorithmDependentParameterSet.insert(PARAMETER_NAME_MIN_DISTANCE);
+  lAlgorithmDependentParameterSet.insert(PARAMETER_NAME_PYRAMID_LEVELS);
 
   NameSet lCriterionTypeDependentParameterSet;
   lCriterionTypeDependentParameterSet.insert(PARAMETER_NAME_CRITERION_MAX_ITER);
@@ -143,6 +350,19 @@ OpticalFlowModule::OpticalFlowModule()
   mParamCriterionMaxIter.setEnabled(false);
   mParamCriterionEpsilon.setValue(1.0e-6);
   mParamCriterionEpsilon.setEnabled(false);
+  mParamMaxFeatures.setValue(400);
+  mParamMaxFeatures.setMinValue("1");
+  mParamMaxFeatures.setEnabled(false);
+  mParamQualityLevel.setValue(0.01);
+  mParamQualityLevel.setMinValue("0.001");
+  mParamQualityLevel.setMaxValue("1");
+  mParamQualityLevel.setEnabled(false);
+  mParamMinDistance.setValue(10.0);
+  mParamMinDistance.setMinValue("0");
+  mParamMinDistance.setEnabled(false);
+  mParamPyramidLevels.setValue(3);
+  mParamPyramidLevels.setMaxValue("8");
+  mParamPyramidLevels.setEnabled(false);
 
 	newParameter(mParamAlgorithm);
   newParameter(mParamBlockSize);
@@ -153,25 +373,33 @@ OpticalFlowModule::OpticalFlowModule()
   newParameter(mParamCriterionType);
   newParameter(mParamCriterionMaxIter);
   newParameter(mParamCriterionEpsilon);
+  newParameter(mParamMaxFeatures);
+  newParameter(mParamQualityLevel);
+  newParameter(mParamMinDistance);
+  newParameter(mParamPyramidLevels);
 
 	mInputSlot = newSlot(new ModuleSlot(this, INPUT_SLOT_NAME, INPUT_SLOT_DISPLAYNAME, "Input gray image used to compute optical flow"));
+	mInputSlotFeatures = newSlot(new ModuleSlot(this, INPUT_SLOT_NAME_FEATURES, INPUT_SLOT_DISPLAYNAME_FEATURES, "Optional input features to track from the image (float image of 2 channels, one x y point per pixel), replacing feature detection (PLK)"));
 	mOutputSlotVelX = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_VEL_X, OUTPUT_SLOT_DISPLAYNAME_VEL_X, "Output X velocity (float image)", &mVelX));
 	mOutputSlotVelY = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_VEL_Y, OUTPUT_SLOT_DISPLAYNAME_VEL_Y, "Output Y velocity (float image)", &mVelY));
 	mOutputSlotVelNorm = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_VEL_NORM, OUTPUT_SLOT_DISPLAYNAME_VEL_NORM, "Output velocity norm (float image)", &mVelNorm));
 	mOutputSlotVelNormGray = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_VEL_NORM_GRAY, OUTPUT_SLOT_DISPLAYNAME_VEL_NORM_GRAY, "Output velocity norm (gray image)", &mVelNormGray));
-	mOutputSlotVelVectors = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_VEL_VECTORS, OUTPUT_SLOT_DISPLAYNAME_VEL_VECTORS, "Output velocity vectors (vectors are drawn in an image)", &mVelVectors));
+	mOutputSlotVelVectors = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_VEL_VECTORS, OUTPUT_SLOT_DISPLAYNAME_VEL_VECTORS, "Output velocity vectors (vectors are drawn over the input image)", &mVelVectors));
+	mOutputSlotFeatures = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_FEATURES, OUTPUT_SLOT_DISPLAYNAME_FEATURES, "Output tracked features (float image of 2 channels and 1 row, one x y point per pixel, the first \"" PROPERTY_NAME_FEATURE_COUNT "\" ones are valid) (PLK)", &mFeatures));
 
   mVelXIpl = NULL;
   mVelYIpl = NULL;
   mVelNormIpl = NULL;
   mVelNormGrayIpl = NULL;
   mVelVectorsIpl = NULL;
+  mFeaturesIpl = NULL;
 
   mVelX = NULL;
   mVelY = NULL;
   mVelNorm = NULL;
   mVelNormGray = NULL;
   mVelVectors = NULL;
+  mFeatures = NULL;
 
   mPrevImageIpl = NULL;
   mPrevImage = NULL;
@@ -179,6 +407,12 @@ OpticalFlowModule::OpticalFlowModule()
   mTmpImg1 = NULL;
   mTmpImg2 = NULL;
 
+  mPrevPyramidIpl = NULL;
+  mPyramidIpl = NULL;
+  mPrevPyramidReady = false;
+  mEigenIpl = NULL;
+  mDetectionTmpIpl = NULL;
+
   mMinDist = 1000000;
   mMaxDist = -1000000;
 }
@@ -189,41 +423,47 @@ OpticalFlowModule::~OpticalFlowModule()
 {
   if(mPrevImageIpl)
   {
-    cvReleaseImage(&mPrevImageIpl);
+    releaseIplImage(&mPrevImageIpl);
     delete mPrevImage;
   }
 	if(mVelXIpl)
 	{
-		cvReleaseImage(&mVelXIpl);
+		releaseIplImage(&mVelXIpl);
 		delete mVelX;
 	}
   if(mVelYIpl)
   {
-    cvReleaseImage(&mVelYIpl);
+    releaseIplImage(&mVelYIpl);
     delete mVelY;
   }
   if(mVelNormIpl)
   {
-    cvReleaseImage(&mVelNormIpl);
+    releaseIplImage(&mVelNormIpl);
     delete mVelNorm;
   }
   if(mVelNormGrayIpl)
   {
-    cvReleaseImage(&mVelNormGrayIpl);
+    releaseIplImage(&mVelNormGrayIpl);
     delete mVelNormGray;
   }
   if(mVelVectorsIpl)
   {
-    cvReleaseImage(&mVelVectorsIpl);
+    releaseIplImage(&mVelVectorsIpl);
     delete mVelVectors;
   }
+  if(mFeaturesIpl)
+  {
+    releaseIplImage(&mFeaturesIpl);
+    delete mFeatures;
+  }
 
   if(mTmpImg1)
-    cvReleaseImage(&mTmpImg1);
+    releaseIplImage(&mTmpImg1);
 
   if(mTmpImg2)
-    cvReleaseImage(&mTmpImg2);
+    releaseIplImage(&mTmpImg2);
 
+  releaseTrackingImages();
 }
 
 /*! TODO:
@@ -240,6 +480,7 @@ void OpticalFlowModule::initFunction()
   mParamAlgorithm = getLockedParameter(PARAMETER_NAME_ALGORITHM);
   mParamBlockSize = getLockedParameter(PARAMETER_NAME_BLOCK_SIZE);
   mParamShiftSize = getLockedParameter(PARAMETER_NAME_SHIFT_SIZE);
+  mParamMaxFeatures = getLockedParameter(PARAMETER_NAME_MAX_FEATURES);
   unlockParameters();
 
   mInputSlot->lock();
@@ -260,16 +501,11 @@ void OpticalFlowModule::initFunction()
 
   resetFunction();
 
-  if(mParamAlgorithm.toString()=="bm")
+  lSize = getVelocitySize(lInputImage->getWidth(), lInputImage->getHeight());
+  if(lSize.width<=0 || lSize.height<=0)
   {
-    Size lBlockSize = mParamBlockSize.toSize();
-    Size lShiftSize = mParamShiftSize.toSize();
-    lSize = cvSize(::floor( ((double)(lInputImage->getWidth()-lBlockSize[0]))/((double)lShiftSize[0]) ),
-                  ::floor( ((double)(lInputImage->getHeight()-lBlockSize[1]))/((double)lShiftSize[1]) ) );
-  }
-  else
-  {
-    lSize = cvSize(lInputImage->getWidth(), lInputImage->getHeight());
+    mInputSlot->unlock();
+    throw(Exception(Exception::eCodeUseModule, string("Block size of module \"") + getLabel() + string("\" is larger than the image of ") + mInputSlot->getFullName().c_str()));
   }
 
   mOutputSlotVelX->lock();
@@ -277,31 +513,15 @@ void OpticalFlowModule::initFunction()
   mOutputSlotVelNorm->lock();
   mOutputSlotVelNormGray->lock();
   mOutputSlotVelVectors->lock();
+  mOutputSlotFeatures->lock();
 
-  mPrevImageIpl = cvCreateImage(cvSize(lInputImage->getWidth(), lInputImage->getHeight()), IPL_DEPTH_8U, 1);
-  mVelXIpl = cvCreateImage(lSize, IPL_DEPTH_32F, 1);
-  mVelYIpl = cvCreateImage(lSize, IPL_DEPTH_32F, 1);
-  mVelNormIpl = cvCreateImage(lSize, IPL_DEPTH_32F, 1);
-  mVelNormGrayIpl = cvCreateImage(lSize, IPL_DEPTH_8U, 1);
-  mVelVectorsIpl = cvCreateImage(lSize, IPL_DEPTH_8U, 3);
-
-  mTmpImg1 = cvCreateImage(lSize, IPL_DEPTH_32F, 1);
-  mTmpImg2 = cvCreateImage(lSize, IPL_DEPTH_32F, 1);
-
+  mPrevImageIpl = createIplImage(cvSize(lInputImage->getWidth(), lInputImage->getHeight()), IPL_DEPTH_8U, 1);
   mPrevImage = new Image(false);
-  mVelX = new Image(false);
-  mVelY = new Image(false);
-  mVelNorm = new Image(false);
-  mVelNormGray = new Image(false);
-  mVelVectors = new Image(false);
-
   setFromIplImage(mPrevImageIpl, *mPrevImage);
-  setFromIplImage(mVelXIpl, *mVelX);
-  setFromIplImage(mVelYIpl, *mVelY);
-  setFromIplImage(mVelNormIpl, *mVelNorm);
-  setFromIplImage(mVelNormGrayIpl, *mVelNormGray);
-  setFromIplImage(mVelVectorsIpl, *mVelVectors);
 
+  createVelocityImages(lSize);
+
+  mOutputSlotFeatures->unlock();
   mOutputSlotVelVectors->unlock();
   mOutputSlotVelNormGray->unlock();
   mOutputSlotVelNorm->unlock();
@@ -319,6 +539,10 @@ void OpticalFlowModule::startFunction()
   cvSetZero(mPrevImageIpl);
   cvSetZero(mVelXIpl);
   cvSetZero(mVelYIpl);
+  cvSetZero(mFeaturesIpl);
+  mFeatures->getMetadata().setProperty(PROPERTY_NAME_FEATURE_COUNT, "0");
+  mPoints.clear();
+  mPrevPyramidReady = false;
   mMinDist = 1000000;
   mMaxDist = -1000000;
 }
@@ -343,16 +567,26 @@ void OpticalFlowModule::processFunction(unsigned int inFrameNumber)
 	if(!mInputSlot->isConnected())
 		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" is not connected to an output slot") ));
 
-	lockParameters();
-  mParamBlockSize = getLockedParameter(PARAMETER_NAME_BLOCK_SIZE);
-  mParamShiftSize = getLockedParameter(PARAMETER_NAME_SHIFT_SIZE);
-  mParamMaxRange = getLockedParameter(PARAMETER_NAME_MAX_RANGE);
-	mParamUsePrevious = getLockedParameter(PARAMETER_NAME_USE_PREVIOUS);
-	mParamLambda = getLockedParameter(PARAMETER_NAME_LAMBDA);
-	mParamCriterionType = getLockedParameter(PARAMETER_NAME_CRITERION_TYPE);
-	mParamCriterionMaxIter = getLockedParameter(PARAMETER_NAME_CRITERION_MAX_ITER);
-	mParamCriterionEpsilon = getLockedParameter(PARAMETER_NAME_CRITERION_EPSILON);
-	unlockParameters();
+	if(parametersChanged(mParamVersion))
+	{
+		lockParameters();
+		mParamBlockSize = getLockedParameter(PARAMETER_NAME_BLOCK_SIZE);
+		mParamShiftSize = getLockedParameter(PARAMETER_NAME_SHIFT_SIZE);
+		mParamMaxRange = getLockedParameter(PARAMETER_NAME_MAX_RANGE);
+		mParamUsePrevious = getLockedParameter(PARAMETER_NAME_USE_PREVIOUS);
+		mParamLambda = getLockedParameter(PARAMETER_NAME_LAMBDA);
+		mParamCriterionType = getLockedParameter(PARAMETER_NAME_CRITERION_TYPE);
+		mParamCriterionMaxIter = getLockedParameter(PARAMETER_NAME_CRITERION_MAX_ITER);
+		mParamCriterionEpsilon = getLockedParameter(PARAMETER_NAME_CRITERION_EPSILON);
+		mParamMaxFeatures = getLockedParameter(PARAMETER_NAME_MAX_FEATURES);
+		mParamQualityLevel = getLockedParameter(PARAMETER_NAME_QUALITY_LEVEL);
+		mParamMinDistance = getLockedParameter(PARAMETER_NAME_MIN_DISTANCE);
+		mParamPyramidLevels = getLockedParameter(PARAMETER_NAME_PYRAMID_LEVELS);
+		unlockParameters();
+
+		// The pyramid of the previous image may have been built with another number of levels
+		mPrevPyramidReady = false;
+	}
 
 	mInputSlot->lock();
 
@@ -370,8 +604,52 @@ void OpticalFlowModule::processFunction(unsigned int inFrameNumber)
 		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" has changed image format since initialization.  Image format (size, depth, nb channels) must not change during processing") ));
 	}
 
+	// Block matching or feature tracking parameters changed since the last frame: the velocity field size may have changed with them
+	if(mParamAlgorithm.toString()=="bm" || mParamAlgorithm.toString()=="pyrlk")
+	{
+		CvSize lSize = getVelocitySize(lInputImage->getWidth(), lInputImage->getHeight());
+		if(lSize.width<=0 || lSize.height<=0)
+		{
+			mInputSlot->unlock();
+			throw(Exception(Exception::eCodeUseModule, string("Block size of module \"") + getLabel() + string("\" is larger than the image of ") + mInputSlot->getFullName().c_str()));
+		}
+
+		if(lSize.width!=mVelXIpl->width || lSize.height!=mVelXIpl->height)
+		{
+			mOutputSlotVelX->lock();
+			mOutputSlotVelY->lock();
+			mOutputSlotVelNorm->lock();
+			mOutputSlotVelNormGray->lock();
+			mOutputSlotVelVectors->lock();
+			mOutputSlotFeatures->lock();
+
+			releaseVelocityImages();
+			createVelocityImages(lSize);
+			cvSetZero(mVelXIpl);
+			cvSetZero(mVelYIpl);
+			cvSetZero(mFeaturesIpl);
+			mFeatures->getMetadata().setProperty(PROPERTY_NAME_FEATURE_COUNT, "0");
+			mMinDist = 1000000;
+			mMaxDist = -1000000;
+
+			mOutputSlotFeatures->unlock();
+			mOutputSlotVelVectors->unlock();
+			mOutputSlotVelNormGray->unlock();
+			mOutputSlotVelNorm->unlock();
+			mOutputSlotVelY->unlock();
+			mOutputSlotVelX->unlock();
+		}
+	}
+
 	setToIplImage(*lInputImage, &lInputImageIpl);
 
+	// Features and pyramids left from feature tracking are stale once another algorithm processed a frame
+	if(mParamAlgorithm.toString()!="pyrlk")
+	{
+		mPoints.clear();
+		mPrevPyramidReady = false;
+	}
+
 	mOutputSlotVelX->lock();
 	mOutputSlotVelY->lock();
 
@@ -381,14 +659,40 @@ void OpticalFlowModule::processFunction(unsigned int inFrameNumber)
 	  Size lShiftSize = mParamShiftSize.toSize();
 	  Size lMaxRange = mParamMaxRange.toSize();
 
-	  cvCalcOpticalFlowBM(mPrevImageIpl,
-                        lInputImageIpl,
-                        cvSize(lBlockSize[0], lBlockSize[1]),
-                        cvSize(lShiftSize[0], lShiftSize[1]),
-                        cvSize(lMaxRange[0], lMaxRange[1]),
-                        mParamUsePrevious.toBool(),
-                        mVelXIpl,
-                        mVelYIpl);
+	  Image lPreviousVelX(false);
+	  Image lPreviousVelY(false);
+	  bool lUsePrevious = mParamUsePrevious.toBool();
+
+	  // The velocities are overwritten block by block, the search reads the previous ones from a copy
+	  if(lUsePrevious)
+	  {
+	    cvCopy(mVelXIpl, mTmpImg1);
+	    cvCopy(mVelYIpl, mTmpImg2);
+	    setFromIplImage(mTmpImg1, lPreviousVelX);
+	    setFromIplImage(mTmpImg2, lPreviousVelY);
+	  }
+
+	  BlockMatchingTask lTask(mPrevImage,
+	                          lInputImage,
+	                          lUsePrevious ? &lPreviousVelX : NULL,
+	                          lUsePrevious ? &lPreviousVelY : NULL,
+	                          mVelX,
+	                          mVelY,
+	                          cvSize(lBlockSize[0], lBlockSize[1]),
+	                          cvSize(lShiftSize[0], lShiftSize[1]),
+	                          cvSize(lMaxRange[0], lMaxRange[1]));
+	  try
+	  {
+	    parallelFor(0, mVelX->getHeight(), lTask, BLOCK_MATCHING_GRAIN_ROWS);
+	  }
+	  catch(...)
+	  {
+	    cvReleaseImageHeader(&lInputImageIpl);
+	    mOutputSlotVelY->unlock();
+	    mOutputSlotVelX->unlock();
+	    mInputSlot->unlock();
+	    throw;
+	  }
 	}
 	else if(mParamAlgorithm.toString()=="hs")
 	{
@@ -410,19 +714,49 @@ void OpticalFlowModule::processFunction(unsigned int inFrameNumber)
                         mVelXIpl,
                         mVelYIpl);
 	}
+	else if(mParamAlgorithm.toString()=="pyrlk")
+	{
+	  mOutputSlotFeatures->lock();
+
+	  try
+	  {
+	    trackFeatures(lInputImageIpl);
+	    updateFeatures(lInputImageIpl);
+	  }
+	  catch(...)
+	  {
+	    mOutputSlotFeatures->unlock();
+	    cvReleaseImageHeader(&lInputImageIpl);
+	    mOutputSlotVelY->unlock();
+	    mOutputSlotVelX->unlock();
+	    mInputSlot->unlock();
+	    throw;
+	  }
+
+	  mFeatures->propagateMetadata(*lInputImage);
+	  ostringstream lCount;
+	  lCount << mTrackedPoints.size();
+	  mFeatures->getMetadata().setProperty(PROPERTY_NAME_FEATURE_COUNT, lCount.str());
+
+	  mOutputSlotFeatures->unlock();
+	}
+
+  mVelX->propagateMetadata(*lInputImage);
+  mVelY->propagateMetadata(*lInputImage);
 
   cvCopy(lInputImageIpl, mPrevImageIpl);
   cvReleaseImageHeader(&lInputImageIpl);
   mInputSlot->unlock();
 
-	// Optionnal outputs
-	if(mOutputSlotVelNorm->getUseCount()>0 || mOutputSlotVelNormGray->getUseCount()>0 || mOutputSlotVelVectors->getUseCount()>0)
+	// Optionnal outputs, computed only for the slots that are read
+	if(isOutputUsed(mOutputSlotVelNorm) || isOutputUsed(mOutputSlotVelNormGray))
 	{
 	  mOutputSlotVelNorm->lock();
 
-	  cvCartToPolar(mVelXIpl, mVelYIpl, mVelNormIpl, mTmpImg1, 0);
+	  cvCartToPolar(mVelXIpl, mVelYIpl, mVelNormIpl, NULL, 0);
+	  mVelNorm->propagateMetadata(*mVelX);
 
-	  if(mOutputSlotVelNormGray->getUseCount()>0)
+	  if(isOutputUsed(mOutputSlotVelNormGray))
 	  {
 	    double lMinDist, lMaxDist;
 
@@ -435,21 +769,28 @@ void OpticalFlowModule::processFunction(unsigned int inFrameNumber)
       if(lMaxDist>mMaxDist)
         mMaxDist = lMaxDist;
 
-	    cvConvertScale(mVelNormIpl, mVelNormGrayIpl, 255.0/(mMaxDist-mMinDist), mMinDist*255.0/(mMaxDist-mMinDist));
+	    if(mMaxDist>mMinDist)
+	      cvConvertScale(mVelNormIpl, mVelNormGrayIpl, 255.0/(mMaxDist-mMinDist), -mMinDist*255.0/(mMaxDist-mMinDist));
+	    else
+	      cvSetZero(mVelNormGrayIpl);
+	    mVelNormGray->propagateMetadata(*mVelX);
 
 	    mOutputSlotVelNormGray->unlock();
 	  }
 
-    if(mOutputSlotVelVectors->getUseCount()>0)
-    {
-      mOutputSlotVelVectors->lock();
-
-      mOutputSlotVelVectors->unlock();
-    }
-
     mOutputSlotVelNorm->unlock();
 	}
 
+  if(isOutputUsed(mOutputSlotVelVectors))
+  {
+    mOutputSlotVelVectors->lock();
+
+    drawVelocityVectors();
+    mVelVectors->propagateMetadata(*mVelX);
+
+    mOutputSlotVelVectors->unlock();
+  }
+
 	mOutputSlotVelY->unlock();
 	mOutputSlotVelX->unlock();
 
@@ -468,63 +809,326 @@ void OpticalFlowModule::resetFunction()
 {
   if(mPrevImageIpl)
   {
-    cvReleaseImage(&mPrevImageIpl);
+    releaseIplImage(&mPrevImageIpl);
     delete mPrevImage;
     mPrevImageIpl = NULL;
     mPrevImage = NULL;
   }
 
+  mOutputSlotVelX->lock();
+  mOutputSlotVelY->lock();
+  mOutputSlotVelNorm->lock();
+  mOutputSlotVelNormGray->lock();
+  mOutputSlotVelVectors->lock();
+  mOutputSlotFeatures->lock();
+
+  releaseVelocityImages();
+
+  mOutputSlotFeatures->unlock();
+  mOutputSlotVelVectors->unlock();
+  mOutputSlotVelNormGray->unlock();
+  mOutputSlotVelNorm->unlock();
+  mOutputSlotVelY->unlock();
+  mOutputSlotVelX->unlock();
+
+  releaseTrackingImages();
+  mPoints.clear();
+  mTrackedPoints.clear();
+  mTrackedStatus.clear();
+}
+
+/*! TODO:
+*/
+CvSize OpticalFlowModule::getVelocitySize(int inWidth, int inHeight) const
+{
+  if(mParamAlgorithm.toString()=="bm")
+  {
+    Size lBlockSize = mParamBlockSize.toSize();
+    Size lShiftSize = mParamShiftSize.toSize();
+    return cvSize(::floor( ((double)(inWidth-(int)lBlockSize[0]))/((double)lShiftSize[0]) ),
+                  ::floor( ((double)(inHeight-(int)lBlockSize[1]))/((double)lShiftSize[1]) ) );
+  }
+  // One velocity per tracked feature
+  if(mParamAlgorithm.toString()=="pyrlk")
+    return cvSize(mParamMaxFeatures.toUInt(), 1);
+
+  return cvSize(inWidth, inHeight);
+}
+
+/*! Output slots must be locked.  The velocity vectors image has the size of the input image, which must be
+    created first.
+*/
+void OpticalFlowModule::createVelocityImages(CvSize inSize)
+{
+  mVelXIpl = createIplImage(inSize, IPL_DEPTH_32F, 1);
+  mVelYIpl = createIplImage(inSize, IPL_DEPTH_32F, 1);
+  mVelNormIpl = createIplImage(inSize, IPL_DEPTH_32F, 1);
+  mVelNormGrayIpl = createIplImage(inSize, IPL_DEPTH_8U, 1);
+  mVelVectorsIpl = createIplImage(cvGetSize(mPrevImageIpl), IPL_DEPTH_8U, 3);
+  mFeaturesIpl = createIplImage(cvSize(mParamMaxFeatures.toUInt(), 1), IPL_DEPTH_32F, 2);
+
+  mTmpImg1 = createIplImage(inSize, IPL_DEPTH_32F, 1);
+  mTmpImg2 = createIplImage(inSize, IPL_DEPTH_32F, 1);
+
+  mVelX = new Image(false);
+  mVelY = new Image(false);
+  mVelNorm = new Image(false);
+  mVelNormGray = new Image(false);
+  mVelVectors = new Image(false);
+  mFeatures = new Image(false);
+
+  setFromIplImage(mVelXIpl, *mVelX);
+  setFromIplImage(mVelYIpl, *mVelY);
+  setFromIplImage(mVelNormIpl, *mVelNorm);
+  setFromIplImage(mVelNormGrayIpl, *mVelNormGray);
+  setFromIplImage(mVelVectorsIpl, *mVelVectors);
+  setFromIplImage(mFeaturesIpl, *mFeatures);
+  mVelVectors->setModel(Image::eModelBGR);
+}
+
+/*! Output slots must be locked.
+*/
+void OpticalFlowModule::releaseVelocityImages()
+{
 	if(mVelXIpl)
 	{
-	  mOutputSlotVelX->lock();
-		cvReleaseImage(&mVelXIpl);
+		releaseIplImage(&mVelXIpl);
 		delete mVelX;
 		mVelXIpl = NULL;
 		mVelX = NULL;
-		mOutputSlotVelX->unlock();
 	}
   if(mVelYIpl)
   {
-    mOutputSlotVelY->lock();
-    cvReleaseImage(&mVelYIpl);
+    releaseIplImage(&mVelYIpl);
     delete mVelY;
     mVelYIpl = NULL;
     mVelY = NULL;
-    mOutputSlotVelY->unlock();
   }
   if(mVelNormIpl)
   {
-    mOutputSlotVelNorm->lock();
-    cvReleaseImage(&mVelNormIpl);
+    releaseIplImage(&mVelNormIpl);
     delete mVelNorm;
     mVelNormIpl = NULL;
     mVelNorm = NULL;
-    mOutputSlotVelNorm->unlock();
   }
   if(mVelNormGrayIpl)
   {
-    mOutputSlotVelNormGray->lock();
-    cvReleaseImage(&mVelNormGrayIpl);
+    releaseIplImage(&mVelNormGrayIpl);
     delete mVelNormGray;
     mVelNormGrayIpl = NULL;
     mVelNormGray = NULL;
-    mOutputSlotVelNormGray->unlock();
   }
   if(mVelVectorsIpl)
   {
-    mOutputSlotVelVectors->lock();
-    cvReleaseImage(&mVelVectorsIpl);
+    releaseIplImage(&mVelVectorsIpl);
     delete mVelVectors;
     mVelVectorsIpl = NULL;
     mVelVectors = NULL;
-    mOutputSlotVelVectors->unlock();
+  }
+  if(mFeaturesIpl)
+  {
+    releaseIplImage(&mFeaturesIpl);
+    delete mFeatures;
+    mFeaturesIpl = NULL;
+    mFeatures = NULL;
   }
 
   if(mTmpImg1)
-    cvReleaseImage(&mTmpImg1);
+    releaseIplImage(&mTmpImg1);
 
   if(mTmpImg2)
-    cvReleaseImage(&mTmpImg2);
+    releaseIplImage(&mTmpImg2);
+}
+
+/*! The velocity vectors output slot must be locked.  The vectors are drawn over the last input image (copied
+    to the previous image): from the center of the blocks (BM), from every OPTICAL_FLOW_VECTOR_SPACING pixels (HS,
+    LK), or to the tracked features (PLK).
+*/
+void OpticalFlowModule::drawVelocityVectors()
+{
+  cvCvtColor(mPrevImageIpl, mVelVectorsIpl, CV_GRAY2BGR);
+
+  if(mParamAlgorithm.toString()=="pyrlk")
+  {
+    const float* lFeatures = (const float*)mFeaturesIpl->imageData;
+    const float* lVelX = (const float*)mVelXIpl->imageData;
+    const float* lVelY = (const float*)mVelYIpl->imageData;
+    for(unsigned int i = 0; i < mTrackedPoints.size(); i++)
+    {
+      CvPoint lPoint = cvPoint(cvRound(lFeatures[2*i]), cvRound(lFeatures[2*i+1]));
+      cvLine(mVelVectorsIpl, cvPoint(cvRound(lFeatures[2*i]-lVelX[i]), cvRound(lFeatures[2*i+1]-lVelY[i])), lPoint, CV_RGB(0,255,0), 1, CV_AA);
+      cvCircle(mVelVectorsIpl, lPoint, 2, CV_RGB(255,0,0), -1);
+    }
+    return;
+  }
+
+  // Position in the image of the velocity at (0,0) and distance between velocities
+  CvPoint lOrigin = cvPoint(0, 0);
+  CvSize lShift = cvSize(1, 1);
+  if(mParamAlgorithm.toString()=="bm")
+  {
+    Size lBlockSize = mParamBlockSize.toSize();
+    Size lShiftSize = mParamShiftSize.toSize();
+    lOrigin = cvPoint(lBlockSize[0]/2, lBlockSize[1]/2);
+    lShift = cvSize(lShiftSize[0], lShiftSize[1]);
+  }
+  int lStepX = std::max(1, (OPTICAL_FLOW_VECTOR_SPACING+lShift.width-1)/lShift.width);
+  int lStepY = std::max(1, (OPTICAL_FLOW_VECTOR_SPACING+lShift.height-1)/lShift.height);
+
+  for(int i = 0; i < mVelXIpl->height; i += lStepY)
+  {
+    const float* lVelX = (const float*)(mVelXIpl->imageData + i*mVelXIpl->widthStep);
+    const float* lVelY = (const float*)(mVelYIpl->imageData + i*mVelYIpl->widthStep);
+    for(int j = 0; j < mVelXIpl->width; j += lStepX)
+    {
+      CvPoint lPoint = cvPoint(lOrigin.x + j*lShift.width, lOrigin.y + i*lShift.height);
+      cvLine(mVelVectorsIpl, lPoint, cvPoint(cvRound(lPoint.x+lVelX[j]), cvRound(lPoint.y+lVelY[j])), CV_RGB(0,255,0), 1, CV_AA);
+    }
+  }
+}
+
+/*! Output slots must be locked.  The features of mPoints, located in the previous image, are searched for in the
+    current one from the top of the pyramids down, the pyramid of the previous image being reused from the last frame
+    when it was built then.  The features found inside the image are written in order to the features image, with
+    their displacement in the velocity images, and kept in mTrackedPoints.
+*/
+void OpticalFlowModule::trackFeatures(const IplImage* inImageIpl)
+{
+  CvSize lPyramidSize = cvSize(inImageIpl->width+8, inImageIpl->height/3);
+  unsigned int lNbPoints = std::min((unsigned int)mPoints.size(), (unsigned int)mFeaturesIpl->width);
+
+  if(mPyramidIpl && (mPyramidIpl->width!=lPyramidSize.width || mPyramidIpl->height!=lPyramidSize.height))
+    releaseTrackingImages();
+  if(!mPyramidIpl)
+  {
+    mPrevPyramidIpl = createIplImage(lPyramidSize, IPL_DEPTH_8U, 1);
+    mPyramidIpl = createIplImage(lPyramidSize, IPL_DEPTH_8U, 1);
+    mPrevPyramidReady = false;
+  }
+
+  cvSetZero(mVelXIpl);
+  cvSetZero(mVelYIpl);
+  cvSetZero(mFeaturesIpl);
+  mTrackedPoints.clear();
+
+  if(lNbPoints==0)
+  {
+    mPrevPyramidReady = false;
+    return;
+  }
+
+  Size lBlockSize = mParamBlockSize.toSize();
+  vector<CvPoint2D32f> lPoints(lNbPoints);
+  mTrackedStatus.resize(lNbPoints);
+
+  // The window size of OpenCV is the half size of the averaging window
+  cvCalcOpticalFlowPyrLK(mPrevImageIpl,
+                         inImageIpl,
+                         mPrevPyramidIpl,
+                         mPyramidIpl,
+                         &mPoints[0],
+                         &lPoints[0],
+                         lNbPoints,
+                         cvSize(std::max((int)lBlockSize[0]/2, 1), std::max((int)lBlockSize[1]/2, 1)),
+                         mParamPyramidLevels.toUInt(),
+                         &mTrackedStatus[0],
+                         NULL,
+                         cvTermCriteria(mCriterionTypeMap[mParamCriterionType.toString()], mParamCriterionMaxIter.toUInt(), mParamCriterionEpsilon.toDouble()),
+                         mPrevPyramidReady ? CV_LKFLOW_PYR_A_READY : 0);
+
+  // The pyramid of the current image is the one of the previous image at the next frame
+  std::swap(mPrevPyramidIpl, mPyramidIpl);
+  mPrevPyramidReady = true;
+
+  float* lFeatures = (float*)mFeaturesIpl->imageData;
+  float* lVelX = (float*)mVelXIpl->imageData;
+  float* lVelY = (float*)mVelYIpl->imageData;
+  for(unsigned int i = 0; i < lNbPoints; i++)
+  {
+    if(!mTrackedStatus[i] || lPoints[i].x<0 || lPoints[i].y<0 || lPoints[i].x>inImageIpl->width-1 || lPoints[i].y>inImageIpl->height-1)
+      continue;
+
+    unsigned int j = mTrackedPoints.size();
+    lFeatures[2*j] = lPoints[i].x;
+    lFeatures[2*j+1] = lPoints[i].y;
+    lVelX[j] = lPoints[i].x - mPoints[i].x;
+    lVelY[j] = lPoints[i].y - mPoints[i].y;
+    mTrackedPoints.push_back(lPoints[i]);
+  }
+}
+
+/*! The features tracked from the current image at the next frame are the ones of the features input slot if it is
+    connected (up to its \"feature-count\" metadata property if it has one), otherwise the features tracked now,
+    replaced by newly detected ones when less than half the maximum number of features are left.
+*/
+void OpticalFlowModule::updateFeatures(const IplImage* inImageIpl)
+{
+  unsigned int lMaxFeatures = mParamMaxFeatures.toUInt();
+
+  if(mInputSlotFeatures->isConnected())
+  {
+    const Image* lFeaturesImage;
+
+    mInputSlotFeatures->lock();
+
+    lFeaturesImage = mInputSlotFeatures->getImage();
+
+    if(!lFeaturesImage || lFeaturesImage->getDepth()!=Image::eDepth32F || lFeaturesImage->getNbChannels()!=Image::eChannel2)
+    {
+      mInputSlotFeatures->unlock();
+      throw(Exception(Exception::eCodeUseModule, mInputSlotFeatures->getFullName().c_str() + string(" must be a 2 channels float image of points") ));
+    }
+
+    unsigned int lCount = lFeaturesImage->getWidth()*lFeaturesImage->getHeight();
+    if(lFeaturesImage->getMetadata().hasProperty(PROPERTY_NAME_FEATURE_COUNT))
+    {
+      unsigned int lPropertyCount = 0;
+      istringstream(lFeaturesImage->getMetadata().getProperty(PROPERTY_NAME_FEATURE_COUNT)) >> lPropertyCount;
+      lCount = std::min(lCount, lPropertyCount);
+    }
+    lCount = std::min(lCount, lMaxFeatures);
+
+    mPoints.clear();
+    for(int i = 0; i < lFeaturesImage->getHeight() && mPoints.size()<lCount; i++)
+    {
+      const float* lRow = (const float*)lFeaturesImage->getRow(i);
+      for(int j = 0; j < lFeaturesImage->getWidth() && mPoints.size()<lCount; j++)
+        mPoints.push_back(cvPoint2D32f(lRow[2*j], lRow[2*j+1]));
+    }
+
+    mInputSlotFeatures->unlock();
+    return;
+  }
+
+  mPoints = mTrackedPoints;
+  if(2*mPoints.size()>=lMaxFeatures)
+    return;
+
+  if(!mEigenIpl)
+  {
+    mEigenIpl = createIplImage(cvGetSize(inImageIpl), IPL_DEPTH_32F, 1);
+    mDetectionTmpIpl = createIplImage(cvGetSize(inImageIpl), IPL_DEPTH_32F, 1);
+  }
+
+  int lCount = lMaxFeatures;
+  mPoints.resize(lMaxFeatures);
+  cvGoodFeaturesToTrack(inImageIpl, mEigenIpl, mDetectionTmpIpl, &mPoints[0], &lCount, mParamQualityLevel.toDouble(), mParamMinDistance.toDouble());
+  mPoints.resize(lCount);
+}
+
+/*!
+*/
+void OpticalFlowModule::releaseTrackingImages()
+{
+  if(mPrevPyramidIpl)
+    releaseIplImage(&mPrevPyramidIpl);
+  if(mPyramidIpl)
+    releaseIplImage(&mPyramidIpl);
+  if(mEigenIpl)
+    releaseIplImage(&mEigenIpl);
+  if(mDetectionTmpIpl)
+    releaseIplImage(&mDetectionTmpIpl);
+  mPrevPyramidReady = false;
 }
 
 /*!
@@ -536,9 +1140,23 @@ void OpticalFlowModule::updateParametersFunction()
   string lAlgo = getLockedParameter(PARAMETER_NAME_ALGORITHM).toString();
   string lCriterionType = getLockedParameter(PARAMETER_NAME_CRITERION_TYPE).toString();
 
+  // Parameters read by processFunction() may be older than the ones set since, refresh before writing them back
+  mParamBlockSize = getLockedParameter(PARAMETER_NAME_BLOCK_SIZE);
+  mParamShiftSize = getLockedParameter(PARAMETER_NAME_SHIFT_SIZE);
+  mParamMaxRange = getLockedParameter(PARAMETER_NAME_MAX_RANGE);
+  mParamUsePrevious = getLockedParameter(PARAMETER_NAME_USE_PREVIOUS);
+  mParamLambda = getLockedParameter(PARAMETER_NAME_LAMBDA);
+  mParamCriterionMaxIter = getLockedParameter(PARAMETER_NAME_CRITERION_MAX_ITER);
+  mParamCriterionEpsilon = getLockedParameter(PARAMETER_NAME_CRITERION_EPSILON);
+  mParamMaxFeatures = getLockedParameter(PARAMETER_NAME_MAX_FEATURES);
+  mParamQualityLevel = getLockedParameter(PARAMETER_NAME_QUALITY_LEVEL);
+  mParamMinDistance = getLockedParameter(PARAMETER_NAME_MIN_DISTANCE);
+  mParamPyramidLevels = getLockedParameter(PARAMETER_NAME_PYRAMID_LEVELS);
+
   if(lAlgo!=mParamAlgorithm.toString())
   {
     mParamAlgorithm.setValueStr(lAlgo.c_str());
+    mParamCriterionType.setValueStr(lCriterionType.c_str());
 
     if(mParamAlgorithm.toString()=="bm")
     {
@@ -550,6 +1168,10 @@ void OpticalFlowModule::updateParametersFunction()
       mParamCriterionType.setEnabled(false);
       mParamCriterionMaxIter.setEnabled(false);
       mParamCriterionEpsilon.setEnabled(false);
+      mParamMaxFeatures.setEnabled(false);
+      mParamQualityLevel.setEnabled(false);
+      mParamMinDistance.setEnabled(false);
+      mParamPyramidLevels.setEnabled(false);
     }
     else if(mParamAlgorithm.toString()=="hs")
     {
@@ -559,6 +1181,10 @@ void OpticalFlowModule::updateParametersFunction()
       mParamUsePrevious.setEnabled(true);
       mParamLambda.setEnabled(true);
       mParamCriterionType.setEnabled(true);
+      mParamMaxFeatures.setEnabled(false);
+      mParamQualityLevel.setEnabled(false);
+      mParamMinDistance.setEnabled(false);
+      mParamPyramidLevels.setEnabled(false);
 
       if(lCriterionType=="both")
       {
@@ -587,6 +1213,39 @@ void OpticalFlowModule::updateParametersFunction()
       mParamCriterionType.setEnabled(false);
       mParamCriterionMaxIter.setEnabled(false);
       mParamCriterionEpsilon.setEnabled(false);
+      mParamMaxFeatures.setEnabled(false);
+      mParamQualityLevel.setEnabled(false);
+      mParamMinDistance.setEnabled(false);
+      mParamPyramidLevels.setEnabled(false);
+    }
+    else if(mParamAlgorithm.toString()=="pyrlk")
+    {
+      mParamBlockSize.setEnabled(true);
+      mParamShiftSize.setEnabled(false);
+      mParamMaxRange.setEnabled(false);
+      mParamUsePrevious.setEnabled(false);
+      mParamLambda.setEnabled(false);
+      mParamCriterionType.setEnabled(true);
+      mParamMaxFeatures.setEnabled(true);
+      mParamQualityLevel.setEnabled(true);
+      mParamMinDistance.setEnabled(true);
+      mParamPyramidLevels.setEnabled(true);
+
+      if(lCriterionType=="both")
+      {
+        mParamCriterionMaxIter.setEnabled(true);
+        mParamCriterionEpsilon.setEnabled(true);
+      }
+      else if(lCriterionType=="max-iter")
+      {
+        mParamCriterionMaxIter.setEnabled(true);
+        mParamCriterionEpsilon.setEnabled(false);
+      }
+      else if(lCriterionType=="epsilon")
+      {
+        mParamCriterionMaxIter.setEnabled(false);
+        mParamCriterionEpsilon.setEnabled(true);
+      }
     }
 
     setLockedParameter(mParamBlockSize);
@@ -597,6 +1256,10 @@ void OpticalFlowModule::updateParametersFunction()
     setLockedParameter(mParamCriterionType);
     setLockedParameter(mParamCriterionMaxIter);
     setLockedParameter(mParamCriterionEpsilon);
+    setLockedParameter(mParamMaxFeatures);
+    setLockedParameter(mParamQualityLevel);
+    setLockedParameter(mParamMinDistance);
+    setLockedParameter(mParamPyramidLevels);
   }
   else if(lCriterionType!=mParamCriterionType.toString())
   {
@@ -42,6 +42,7 @@
 #include <highgui.h>
 #include <string>
 #include <map>
+#include <vector>
 
 using namespace VIPERS;
 using namespace std;
@@ -84,6 +85,21 @@ class OpticalFlowModule: public Module
 
 	private:
 
+	//! Get the size of the velocity images for an input image size, with the current parameters
+	CvSize getVelocitySize(int inWidth, int inHeight) const;
+	//! Create velocity images and their temporary images
+	void createVelocityImages(CvSize inSize);
+	//! Release velocity images and their temporary images
+	void releaseVelocityImages();
+	//! Track the features from the previous image to the current one with the pyramidal Lucas & Kanade algorithm
+	void trackFeatures(const IplImage* inImageIpl);
+	//! Replace the features tracked from the current image by the upstream ones or by newly detected ones if needed
+	void updateFeatures(const IplImage* inImageIpl);
+	//! Release the pyramids and the detection images of the feature tracking
+	void releaseTrackingImages();
+	//! Draw the velocities over the last input image
+	void drawVelocityVectors();
+
 	Parameter mParamAlgorithm;
 	Parameter mParamBlockSize;
 	Parameter mParamShiftSize;
@@ -93,25 +109,34 @@ class OpticalFlowModule: public Module
 	Parameter mParamCriterionType;
 	Parameter mParamCriterionMaxIter;
 	Parameter mParamCriterionEpsilon;
+	Parameter mParamMaxFeatures;
+	Parameter mParamQualityLevel;
+	Parameter mParamMinDistance;
+	Parameter mParamPyramidLevels;
+	unsigned long mParamVersion; //!< Version of the parameters last read
 
 	ModuleSlot* mInputSlot;
+	ModuleSlot* mInputSlotFeatures;
 	ModuleSlot* mOutputSlotVelX;
 	ModuleSlot* mOutputSlotVelY;
 	ModuleSlot* mOutputSlotVelNorm;
 	ModuleSlot* mOutputSlotVelNormGray;
 	ModuleSlot* mOutputSlotVelVectors;
+	ModuleSlot* mOutputSlotFeatures;
 
 	IplImage* mVelXIpl;
 	IplImage* mVelYIpl;
   IplImage* mVelNormIpl;
   IplImage* mVelNormGrayIpl;
   IplImage* mVelVectorsIpl;
+  IplImage* mFeaturesIpl;
 
 	Image* mVelX;
 	Image* mVelY;
   Image* mVelNorm;
   Image* mVelNormGray;
   Image* mVelVectors;
+  Image* mFeatures;
 
   IplImage* mPrevImageIpl;
   Image* mPrevImage;
@@ -119,6 +144,16 @@ class OpticalFlowModule: public Module
   IplImage* mTmpImg1;
   IplImage* mTmpImg2;
 
+  IplImage* mPrevPyramidIpl; //!< Pyramid of the previous image (pyramidal Lucas & Kanade)
+  IplImage* mPyramidIpl; //!< Pyramid of the current image (pyramidal Lucas & Kanade)
+  bool mPrevPyramidReady; //!< The pyramid of the previous image is built
+  IplImage* mEigenIpl; //!< Minimal eigen values of the image, for feature detection
+  IplImage* mDetectionTmpIpl; //!< Temporary image of feature detection
+
+  vector<CvPoint2D32f> mPoints; //!< Features to track, in the previous image
+  vector<CvPoint2D32f> mTrackedPoints; //!< Features tracked in the current image
+  vector<char> mTrackedStatus; //!< Status of the tracked features (found or not)
+
   CriterionTypeMap mCriterionTypeMap;
 
   double mMinDist;
@@ -36,9 +36,12 @@
 #include "ResizeConfig.hpp"
 
 #include <iostream>
+#include <cstring>
+#include <cmath>
 
 #define VIPERS_UTILS_OPENCV
 #include <ImageUtils.hpp>
+#include <PixelKernels.hpp>
 
 using namespace VIPERS;
 using namespace std;
@@ -55,6 +58,149 @@ using namespace std;
 #define PARAMETER_NAME_NEWSIZE "new-size"
 #define PARAMETER_NAME_RESIZE_METHOD "resize-method"
 
+//! Number of bits of the fixed-point bilinear weights (same as OpenCV)
+#define RESIZE_WEIGHT_BITS 11
+#define RESIZE_WEIGHT_SCALE (1 << RESIZE_WEIGHT_BITS)
+//! Smallest number of output rows resized by a thread
+#define RESIZE_GRAIN_ROWS 16
+
+namespace
+{
+	/*! Resizes rows of an 8 bits image with the coefficient tables of the module: nearest neighbor (repeating pixels
+	    and rows for integer factors), bilinear, or area by an integer factor
+	*/
+	class ResizeTask: public ParallelTask
+	{
+		public:
+
+		ResizeTask(const Image* inImage, Image* outImage, int inMethod, const vector<int>& inColumnOffsets, const vector<int>& inColumnWeights, const vector<int>& inRowIndices, const vector<int>& inRowWeights)
+			: mInput(inImage), mOutput(outImage), mMethod(inMethod), mColumnOffsets(inColumnOffsets), mColumnWeights(inColumnWeights), mRowIndices(inRowIndices), mRowWeights(inRowWeights) {}
+
+		void run(unsigned int inFirst, unsigned int inEnd)
+		{
+			if(mMethod==CV_INTER_NN)
+				resizeNearest(inFirst, inEnd);
+			else if(mMethod==CV_INTER_LINEAR)
+				resizeBilinear(inFirst, inEnd);
+			else
+				resizeArea(inFirst, inEnd);
+		}
+
+		private:
+
+		void resizeNearest(unsigned int inFirst, unsigned int inEnd)
+		{
+			unsigned int lNbChannels = mOutput->getNbChannels();
+			unsigned int lWidth = mOutput->getWidth();
+			unsigned int lInputWidth = mInput->getWidth();
+			unsigned int lFactor = (lWidth%lInputWidth==0) ? lWidth/lInputWidth : 0;
+
+			for(unsigned int i = inFirst; i < inEnd; i++)
+			{
+				unsigned char* lOutput = (unsigned char*)mOutput->getRow(i);
+				const unsigned char* lInput = (const unsigned char*)mInput->getRow(mRowIndices[i]);
+
+				// Rows from the same input row are copied
+				if(i>inFirst && mRowIndices[i]==mRowIndices[i-1])
+					memcpy(lOutput, mOutput->getRow(i-1), lWidth*lNbChannels);
+				else if(lFactor==1)
+					memcpy(lOutput, lInput, lWidth*lNbChannels);
+				else if(lFactor)
+					PixelKernels::upscaleNearest(lInput, lOutput, lInputWidth, lNbChannels, lFactor);
+				else if(lNbChannels==1)
+				{
+					for(unsigned int x = 0; x < lWidth; x++)
+						lOutput[x] = lInput[mColumnOffsets[x]];
+				}
+				else
+				{
+					for(unsigned int x = 0; x < lWidth; x++, lOutput += lNbChannels)
+						for(unsigned int c = 0; c < lNbChannels; c++)
+							lOutput[c] = lInput[mColumnOffsets[x]+c];
+				}
+			}
+		}
+
+		// Interpolate an input row along the columns of the output, with weights in 1/RESIZE_WEIGHT_SCALE
+		void interpolateRow(unsigned int inRow, int* outRow) const
+		{
+			unsigned int lNbChannels = mOutput->getNbChannels();
+			unsigned int lWidth = mOutput->getWidth();
+			const unsigned char* lInput = (const unsigned char*)mInput->getRow(inRow);
+
+			for(unsigned int x = 0; x < lWidth; x++, outRow += lNbChannels)
+			{
+				const unsigned char* lFirst = lInput+mColumnOffsets[2*x];
+				const unsigned char* lSecond = lInput+mColumnOffsets[2*x+1];
+				int lWeight = mColumnWeights[x];
+				for(unsigned int c = 0; c < lNbChannels; c++)
+					outRow[c] = lFirst[c]*(RESIZE_WEIGHT_SCALE-lWeight) + lSecond[c]*lWeight;
+			}
+		}
+
+		void resizeBilinear(unsigned int inFirst, unsigned int inEnd)
+		{
+			unsigned int lNbBytes = mOutput->getWidth()*mOutput->getNbChannels();
+			// Interpolated input rows, kept while consecutive output rows use them
+			vector<int> lRows[2];
+			int lRowIndices[2] = {-1, -1};
+
+			lRows[0].resize(lNbBytes);
+			lRows[1].resize(lNbBytes);
+			for(unsigned int i = inFirst; i < inEnd; i++)
+			{
+				int lFirst = mRowIndices[2*i];
+				int lSecond = mRowIndices[2*i+1];
+				int lWeight = mRowWeights[i];
+				unsigned char* lOutput = (unsigned char*)mOutput->getRow(i);
+
+				if(lRowIndices[1]==lFirst)
+				{
+					lRows[0].swap(lRows[1]);
+					lRowIndices[0] = lRowIndices[1];
+					lRowIndices[1] = -1;
+				}
+				if(lRowIndices[0]!=lFirst)
+				{
+					interpolateRow(lFirst, &lRows[0][0]);
+					lRowIndices[0] = lFirst;
+				}
+				if(lRowIndices[1]!=lSecond)
+				{
+					interpolateRow(lSecond, &lRows[1][0]);
+					lRowIndices[1] = lSecond;
+				}
+
+				const int* lFirstRow = &lRows[0][0];
+				const int* lSecondRow = &lRows[1][0];
+				for(unsigned int j = 0; j < lNbBytes; j++)
+					lOutput[j] = (unsigned char)((lFirstRow[j]*(RESIZE_WEIGHT_SCALE-lWeight) + lSecondRow[j]*lWeight + (1 << (2*RESIZE_WEIGHT_BITS-1))) >> (2*RESIZE_WEIGHT_BITS));
+			}
+		}
+
+		void resizeArea(unsigned int inFirst, unsigned int inEnd)
+		{
+			unsigned int lFactor = mInput->getHeight()/mOutput->getHeight();
+			vector<const unsigned char*> lRows(lFactor);
+
+			for(unsigned int i = inFirst; i < inEnd; i++)
+			{
+				for(unsigned int r = 0; r < lFactor; r++)
+					lRows[r] = (const unsigned char*)mInput->getRow(i*lFactor+r);
+				PixelKernels::downscaleBox(&lRows[0], (unsigned char*)mOutput->getRow(i), mOutput->getWidth(), mOutput->getNbChannels(), lFactor);
+			}
+		}
+
+		const Image* mInput; //!< Input image
+		Image* mOutput; //!< Resized image
+		int mMethod; //!< Resize method
+		const vector<int>& mColumnOffsets; //!< Offsets in an input row of the pixels used for each output column
+		const vector<int>& mColumnWeights; //!< Weight of the second pixel of each output column
+		const vector<int>& mRowIndices; //!< Input rows used for each output row
+		const vector<int>& mRowWeights; //!< Weight of the second row of each output row
+	};
+}
+
 /*! TODO:
 */
 ResizeModule::ResizeModule()
@@ -63,21 +209,16 @@ ResizeModule::ResizeModule()
 	mParamResizeMethod(PARAMETER_NAME_RESIZE_METHOD, Variable::eVariableTypeString, "Resize method", "Method used to resize the input image", true)
 {
 	mShortDescription = "Module for resizing image";
-	mLongDescription = "This module resizes an image using common interpolation methods";
+	mLongDescription = "This module resizes an image using common interpolation methods.  Nearest neighbor, bilinear and area resizes by an integer factor of 8 bits images are computed natively by several threads, with coefficient tables computed once for a geometry; other resizes use OpenCV.";
 
 	ValueSet lTmpMethodName;
-	lTmpMethodName.insert(Value("nearest", "Nearest", "Nearest-neigbor interpolation"));
-	lTmpMethodName.insert(Value("bilinear", "Bilinear", "Bilinear interpolation"));
-	lTmpMethodName.insert(Value("area", "Area", "Resampling using pixel area relation"));
-	lTmpMethodName.insert(Value("bicubic", "Bicubic", "Bicubic interpolation"));
+	lTmpMethodName.insert(Value("nearest", "Nearest", "Nearest-neigbor interpolation", CV_INTER_NN));
+	lTmpMethodName.insert(Value("bilinear", "Bilinear", "Bilinear interpolation", CV_INTER_LINEAR));
+	lTmpMethodName.insert(Value("area", "Area", "Resampling using pixel area relation", CV_INTER_AREA));
+	lTmpMethodName.insert(Value("bicubic", "Bicubic", "Bicubic interpolation", CV_INTER_CUBIC));
 
 	mParamResizeMethod.setPossibleValues(lTmpMethodName);
 
-	mResizeMethodMap["nearest"] = CV_INTER_NN;
-	mResizeMethodMap["bilinear"] = CV_INTER_LINEAR;
-	mResizeMethodMap["area"] = CV_INTER_AREA;
-	mResizeMethodMap["bicubic"] = CV_INTER_CUBIC;
-
 	mParamImageNewSize.setValue(Size(640,480));
 	mParamResizeMethod.setValueStr("bilinear");
 
@@ -89,6 +230,15 @@ ResizeModule::ResizeModule()
 
 	mOutputImageIpl = NULL;
 	mOutputImage = NULL;
+
+	mParamVersion = 0;
+
+	mTablesMethod = -1;
+	mTablesInputWidth = 0;
+	mTablesInputHeight = 0;
+	mTablesNbChannels = 0;
+	mTablesWidth = 0;
+	mTablesHeight = 0;
 }
 
 /*! TODO:
@@ -97,7 +247,7 @@ ResizeModule::~ResizeModule()
 {
 	if(mOutputImageIpl)
 	{
-		cvReleaseImage(&mOutputImageIpl);
+		releaseIplImage(&mOutputImageIpl);
 		delete mOutputImage;
 	}
 }
@@ -137,6 +287,10 @@ void ResizeModule::processFunction(unsigned int inFrameNumber)
   const Image* lTmpImage = NULL;
 	IplImage* lTmpImageIpl = NULL;
 	Size lSize;
+	int lMethod;
+	unsigned int lInputWidth;
+	unsigned int lInputHeight;
+	bool lNative;
 
 	mInputSlot->lock();
 
@@ -155,33 +309,64 @@ void ResizeModule::processFunction(unsigned int inFrameNumber)
 
 	setToIplImage(*lTmpImage, &lTmpImageIpl);
 
-	lockParameters();
-	lSize = getLockedParameter(PARAMETER_NAME_NEWSIZE).toSize();
-	mParamResizeMethod = getLockedParameter(PARAMETER_NAME_RESIZE_METHOD);
-	unlockParameters();
+	if(parametersChanged(mParamVersion))
+	{
+		lockParameters();
+		mNewSize = getLockedParameter(PARAMETER_NAME_NEWSIZE).toSize();
+		mParamResizeMethod = getLockedParameter(PARAMETER_NAME_RESIZE_METHOD);
+		unlockParameters();
+	}
+	lSize = mNewSize;
 
 	mOutputSlot->lock();
 
+	if(mOutputImageIpl && (mParamImageNewSize.toSize()!=lSize || mOutputImageIpl->depth!=lTmpImageIpl->depth || mOutputImageIpl->nChannels!=lTmpImageIpl->nChannels))
+	{
+		releaseIplImage(&mOutputImageIpl);
+		delete mOutputImage;
+		mOutputImageIpl = NULL;
+		mOutputImage = NULL;
+	}
+
 	if(!mOutputImageIpl)
 	{
-		mOutputImageIpl = cvCreateImage(cvSize(lSize[0], lSize[1]), lTmpImageIpl->depth, lTmpImageIpl->nChannels);
+		mOutputImageIpl = createIplImage(cvSize(lSize[0], lSize[1]), lTmpImageIpl->depth, lTmpImageIpl->nChannels);
 		mOutputImage = new Image(false);
 		setFromIplImage(mOutputImageIpl, *mOutputImage);
 		mParamImageNewSize.setValue(lSize);
 		mOutputImage->setModel(lTmpImage->getModel());
 	}
-	else if(mParamImageNewSize.toSize()!=lSize)
+
+	lMethod = mParamResizeMethod.toEnum();
+	lInputWidth = lTmpImage->getWidth();
+	lInputHeight = lTmpImage->getHeight();
+
+	// Native resize of interleaved 8 bits images: nearest neighbor, bilinear, and area by an integer factor
+	lNative = lTmpImage->getDepth()==Image::eDepth8U && !lTmpImage->isPlanar() && lSize[0]>0 && lSize[1]>0 && lInputWidth>0 && lInputHeight>0;
+	if(lMethod==CV_INTER_AREA)
+		lNative = lNative && lInputWidth%lSize[0]==0 && lInputHeight%lSize[1]==0 && lInputWidth/lSize[0]==lInputHeight/lSize[1];
+	else if(lMethod!=CV_INTER_NN && lMethod!=CV_INTER_LINEAR)
+		lNative = false;
+
+	try
 	{
-		mParamImageNewSize.setValue(lSize);
-		cvReleaseImage(&mOutputImageIpl);
-		delete mOutputImage;
-		mOutputImageIpl = cvCreateImage(cvSize(lSize[0], lSize[1]), lTmpImageIpl->depth, lTmpImageIpl->nChannels);
-    mOutputImage = new Image(false);
-    setFromIplImage(mOutputImageIpl, *mOutputImage);
-    mOutputImage->setModel(lTmpImage->getModel());
+		if(lNative)
+		{
+			updateTables(lMethod, *lTmpImage, lSize[0], lSize[1]);
+			ResizeTask lResizeTask(lTmpImage, mOutputImage, lMethod, mColumnOffsets, mColumnWeights, mRowIndices, mRowWeights);
+			parallelFor(0, lSize[1], lResizeTask, RESIZE_GRAIN_ROWS);
+		}
+		else
+			cvResize(lTmpImageIpl, mOutputImageIpl, lMethod);
 	}
-
-	cvResize(lTmpImageIpl, mOutputImageIpl, mResizeMethodMap[mParamResizeMethod.toString()]);
+	catch(...)
+	{
+		cvReleaseImageHeader(&lTmpImageIpl);
+		mOutputSlot->unlock();
+		mInputSlot->unlock();
+		throw;
+	}
+	mOutputImage->propagateMetadata(*lTmpImage);
 
 	cvReleaseImageHeader(&lTmpImageIpl);
 
@@ -203,7 +388,7 @@ void ResizeModule::resetFunction()
 	if(mOutputImageIpl)
 	{
 		mOutputSlot->lock();
-		cvReleaseImage(&mOutputImageIpl);
+		releaseIplImage(&mOutputImageIpl);
 		delete mOutputImage;
 		mOutputImageIpl = NULL;
 		mOutputImage = NULL;
@@ -211,6 +396,72 @@ void ResizeModule::resetFunction()
 	}
 }
 
+/*! Tables are kept while the input size, the output size, the number of channels and the method stay the same.
+    Nearest neighbor uses input pixel floor(x*inputWidth/width) for output pixel x (same for rows), and bilinear
+    interpolation samples the input at (x+0.5)*inputWidth/width-0.5, clamped to the image, with weights in fixed
+    point on RESIZE_WEIGHT_BITS bits.  Area resize by an integer factor needs no table.
+*/
+void ResizeModule::updateTables(int inMethod, const Image& inImage, unsigned int inWidth, unsigned int inHeight)
+{
+	unsigned int lInputWidth = inImage.getWidth();
+	unsigned int lInputHeight = inImage.getHeight();
+	unsigned int lNbChannels = inImage.getNbChannels();
+
+	if(inMethod==mTablesMethod && lInputWidth==mTablesInputWidth && lInputHeight==mTablesInputHeight && lNbChannels==mTablesNbChannels && inWidth==mTablesWidth && inHeight==mTablesHeight)
+		return;
+
+	mColumnOffsets.clear();
+	mColumnWeights.clear();
+	mRowIndices.clear();
+	mRowWeights.clear();
+
+	if(inMethod==CV_INTER_NN)
+	{
+		for(unsigned int x = 0; x < inWidth; x++)
+			mColumnOffsets.push_back((int)(((unsigned long)x*lInputWidth/inWidth)*lNbChannels));
+		for(unsigned int y = 0; y < inHeight; y++)
+			mRowIndices.push_back((int)((unsigned long)y*lInputHeight/inHeight));
+	}
+	else if(inMethod==CV_INTER_LINEAR)
+	{
+		for(unsigned int i = 0; i < 2; i++)
+		{
+			unsigned int lInputSize = i ? lInputHeight : lInputWidth;
+			unsigned int lSize = i ? inHeight : inWidth;
+			vector<int>& lIndices = i ? mRowIndices : mColumnOffsets;
+			vector<int>& lWeights = i ? mRowWeights : mColumnWeights;
+			int lScale = i ? 1 : lNbChannels;
+
+			for(unsigned int x = 0; x < lSize; x++)
+			{
+				double lPosition = (x+0.5)*lInputSize/lSize-0.5;
+				int lFirst = (int)floor(lPosition);
+				double lFraction = lPosition-lFirst;
+				if(lFirst<0)
+				{
+					lFirst = 0;
+					lFraction = 0;
+				}
+				if(lFirst>=(int)lInputSize-1)
+				{
+					lFirst = lInputSize-1;
+					lFraction = 0;
+				}
+				lIndices.push_back(lFirst*lScale);
+				lIndices.push_back((lFirst+(lFraction>0 ? 1 : 0))*lScale);
+				lWeights.push_back((int)floor(lFraction*RESIZE_WEIGHT_SCALE+0.5));
+			}
+		}
+	}
+
+	mTablesMethod = inMethod;
+	mTablesInputWidth = lInputWidth;
+	mTablesInputHeight = lInputHeight;
+	mTablesNbChannels = lNbChannels;
+	mTablesWidth = inWidth;
+	mTablesHeight = inHeight;
+}
+
 /*!
 */
 void ResizeModule::updateParametersFunction()
@@ -41,6 +41,7 @@
 #include <cv.h>
 #include <map>
 #include <string>
+#include <vector>
 
 using namespace VIPERS;
 
@@ -52,8 +53,6 @@ class ResizeModule: public Module
 {
 	public:
 
-	typedef map<string, int> ResizeMethodMap;
-
 	//! Default constructor
 	ResizeModule();
 	//! Virtual destructor
@@ -74,6 +73,9 @@ class ResizeModule: public Module
 	//! Resetting the module as it was when created
 	void resetFunction();
 
+	//! Compute the coefficient tables of a native resize, if the geometry or the method changed
+	void updateTables(int inMethod, const Image& inImage, unsigned int inWidth, unsigned int inHeight);
+
 	//! Update %Module parameters
 	void updateParametersFunction();
 	//! Verify if Parameter value is valid without actually changing the value
@@ -83,6 +85,8 @@ class ResizeModule: public Module
 
 	Parameter mParamImageNewSize; //!< Image new size
 	Parameter mParamResizeMethod; //!< Resize method
+	Size mNewSize; //!< Image new size last read from the parameters
+	unsigned long mParamVersion; //!< Version of the parameters last read
 
 	ModuleSlot* mInputSlot; //!< Image input slot
 	ModuleSlot* mOutputSlot; //!< Image output slot
@@ -90,7 +94,17 @@ class ResizeModule: public Module
 	IplImage* mOutputImageIpl; //!< Output image
   Image* mOutputImage; //!< Output image
 
-	ResizeMethodMap mResizeMethodMap; //!< Map of the resize method
+	int mTablesMethod; //!< Resize method of the coefficient tables (-1 if not computed)
+	unsigned int mTablesInputWidth; //!< Input width of the coefficient tables
+	unsigned int mTablesInputHeight; //!< Input height of the coefficient tables
+	unsigned int mTablesNbChannels; //!< Number of channels of the coefficient tables
+	unsigned int mTablesWidth; //!< Output width of the coefficient tables
+	unsigned int mTablesHeight; //!< Output height of the coefficient tables
+	std::vector<int> mColumnOffsets; //!< Offsets in an input row of the pixels used for each output column (two for bilinear)
+	std::vector<int> mColumnWeights; //!< Weight of the second pixel of each output column, in 1/RESIZE_WEIGHT_SCALE (bilinear)
+	std::vector<int> mRowIndices; //!< Input rows used for each output row (two for bilinear)
+	std::vector<int> mRowWeights; //!< Weight of the second row of each output row, in 1/RESIZE_WEIGHT_SCALE (bilinear)
+
 };
 
 #endif //VIPERS_RESIZEMODULE_HPP
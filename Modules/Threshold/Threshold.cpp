@@ -62,18 +62,17 @@ ThresholdModule::ThresholdModule()
 	mParamThresholdType(PARAMETER_NAME_THRESHOLD_TYPE, Variable::eVariableTypeString, "Threshold type", "Type of thresholding", true),
 	mParamThresholdValue(PARAMETER_NAME_THRESHOLD_VALUE, Variable::eVariableTypeInt, "Threshold value", "Threshold value", true)
 {
+	mParamVersion = 0;
+	mThresholdType = CV_THRESH_BINARY;
 	mShortDescription = "Module for applying a threshold on an image";
 	mLongDescription = "This module applies a threshold on a gray scale image";
 
 	ValueSet lTmpTypeName;
-	lTmpTypeName.insert(Value("greater", "Greater than", "Pixel value greater than threshold value"));
-	lTmpTypeName.insert(Value("less", "Less than", "Pixel value less than threshold value"));
+	lTmpTypeName.insert(Value("greater", "Greater than", "Pixel value greater than threshold value", CV_THRESH_BINARY));
+	lTmpTypeName.insert(Value("less", "Less than", "Pixel value less than threshold value", CV_THRESH_BINARY_INV));
 
 	mParamThresholdType.setPossibleValues(lTmpTypeName);
 
-	mThresholdTypeMap["greater"] = CV_THRESH_BINARY;
-	mThresholdTypeMap["less"] = CV_THRESH_BINARY_INV;
-
 	mParamThresholdType.setValueStr("greater");
 
 	mParamThresholdValue.setValue(128);
@@ -88,17 +87,22 @@ ThresholdModule::ThresholdModule()
 
 	mOutputImageIpl = NULL;
 	mOutputImage = NULL;
+
+	mOutputInPlace = false;
+
+	mInputImage = NULL;
+	mInputImageIpl = NULL;
+
+	mOutputSlot->setInPlaceInput(mInputSlot);
+	setPointwiseKernel(true);
+	setPlannedOutputs(true);
 }
 
 /*! TODO:
 */
 ThresholdModule::~ThresholdModule()
 {
-	if(mOutputImageIpl)
-	{
-		cvReleaseImage(&mOutputImageIpl);
-		delete mOutputImage;
-	}
+	releaseOutputImage();
 }
 
 /*! TODO:
@@ -133,53 +137,109 @@ void ThresholdModule::pauseFunction()
 */
 void ThresholdModule::processFunction(unsigned int inFrameNumber)
 {
-	const Image* lTmpImage = NULL;
-	IplImage* lTmpImageIpl = NULL;
-
 	mInputSlot->lock();
-	
-	if(!mInputSlot->isConnected())
+	mOutputSlot->lock();
+
+	try
+	{
+		beginPointwiseFunction(inFrameNumber);
+		processPointwiseFunction(0, mOutputImage->getHeight());
+		endPointwiseFunction();
+	}
+	catch(...)
 	{
+		if(mInputImageIpl)
+			cvReleaseImageHeader(&mInputImageIpl);
+		mOutputSlot->unlock();
 		mInputSlot->unlock();
-		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" is not connected to an output slot") ));
+		throw;
 	}
 
+	mOutputSlot->unlock();
+	mInputSlot->unlock();
+}
+
+/*! TODO:
+*/
+void ThresholdModule::beginPointwiseFunction(unsigned int inFrameNumber)
+{
+	const Image* lTmpImage = NULL;
+
+	if(!mInputSlot->isConnected())
+		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" is not connected to an output slot") ));
+
 	lTmpImage = mInputSlot->getImage();
 	if(!lTmpImage)
-	{
-		mInputSlot->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" does not have a valid image pointer (NULL)") ));
-	}
 
 	if(lTmpImage->getNbChannels()!=Image::eChannel1 || lTmpImage->getDepth()!=Image::eDepth8U)
-	{
-		mInputSlot->unlock();
 		throw(Exception(Exception::eCodeUseModule, mInputSlot->getFullName().c_str() + string(" must be a unsigned 8 bits 1 channel image (gray scale)") ));
+
+	if(parametersChanged(mParamVersion))
+	{
+		lockParameters();
+		mParamThresholdValue = getLockedParameter(PARAMETER_NAME_THRESHOLD_VALUE);
+		mParamThresholdType = getLockedParameter(PARAMETER_NAME_THRESHOLD_TYPE);
+		unlockParameters();
+		// Unknown types are rejected by verifyParameterFunction(), never give cvThreshold() an invalid code
+		mThresholdType = (mParamThresholdType.toEnum()<0) ? CV_THRESH_BINARY : mParamThresholdType.toEnum();
 	}
 
-	setToIplImage(*lTmpImage, &lTmpImageIpl);
+	// Only reader of the input image, threshold it in place (see ModuleSlot::isInPlace())
+	if(mOutputSlot->isInPlace())
+	{
+		if(!mOutputInPlace || mOutputImage->getData()!=lTmpImage->getData() || lTmpImage->getWidth()!=mOutputImage->getWidth() || lTmpImage->getHeight()!=mOutputImage->getHeight() || lTmpImage->getRowLengthBytes()!=mOutputImage->getRowLengthBytes())
+		{
+			releaseOutputImage();
+			mOutputImage = new Image(false);
+			mOutputImage->create(lTmpImage->getWidth(), lTmpImage->getHeight(), Image::eDepth8U, Image::eChannel1, false, lTmpImage->getData(), lTmpImage->getRowLengthBytes());
+			mOutputImage->setModel(Image::eModelGray);
+			setToIplImage(*mOutputImage, &mOutputImageIpl);
+			mOutputInPlace = true;
+		}
+	}
+	else
+	{
+		if(mOutputImageIpl && (mOutputInPlace || mOutputImageIpl->width!=lTmpImage->getWidth() || mOutputImageIpl->height!=lTmpImage->getHeight() || isPlannedIplImageStale(mOutputSlot, mOutputImageIpl)))
+			releaseOutputImage();
+
+		if(!mOutputImageIpl)
+		{
+			mOutputImageIpl = createPlannedIplImage(mOutputSlot, cvSize(lTmpImage->getWidth(), lTmpImage->getHeight()), IPL_DEPTH_8U, 1);
+			mOutputImage = new Image(false);
+			setFromIplImage(mOutputImageIpl, *mOutputImage);
+			mOutputImage->setModel(Image::eModelGray);
+		}
+	}
 
-	lockParameters();
-	mParamThresholdValue = getLockedParameter(PARAMETER_NAME_THRESHOLD_VALUE);
-	mParamThresholdType = getLockedParameter(PARAMETER_NAME_THRESHOLD_TYPE);
-	unlockParameters();
+	mInputImage = lTmpImage;
+	setToIplImage(*mInputImage, &mInputImageIpl);
+}
 
-	mOutputSlot->lock();
+/*! TODO:
+*/
+void ThresholdModule::processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow)
+{
+	CvMat lInputRows;
+	CvMat lOutputRows;
 
-	if(!mOutputImageIpl)
-	{
-		mOutputImageIpl = cvCreateImage(cvGetSize(lTmpImageIpl), IPL_DEPTH_8U, 1);
-		mOutputImage = new Image(false);
-		setFromIplImage(mOutputImageIpl, *mOutputImage);
-		mOutputImage->setModel(Image::eModelGray);
-	}
+	if(!getIplImageRows(mOutputImageIpl, &lOutputRows, inFirstRow, inEndRow))
+		return;
+	getIplImageRows(mInputImageIpl, &lInputRows, inFirstRow, inEndRow);
 
-	cvThreshold(lTmpImageIpl, mOutputImageIpl, mParamThresholdValue.toInt(), 255,  mThresholdTypeMap[mParamThresholdType.toString()]);
+	cvThreshold(&lInputRows, &lOutputRows, mParamThresholdValue.toInt(), 255, mThresholdType);
+}
 
-	cvReleaseImageHeader(&lTmpImageIpl);
+/*! TODO:
+*/
+void ThresholdModule::endPointwiseFunction()
+{
+	if(mInputImage)
+		mOutputImage->propagateMetadata(*mInputImage);
+	mInputImage = NULL;
 
-	mOutputSlot->unlock();
-	mInputSlot->unlock();
+	if(mInputImageIpl)
+		cvReleaseImageHeader(&mInputImageIpl);
 }
 
 /*! TODO:
@@ -196,14 +256,28 @@ void ThresholdModule::resetFunction()
 	if(mOutputImageIpl)
 	{
 		mOutputSlot->lock();
-		cvReleaseImage(&mOutputImageIpl);
-		delete mOutputImage;
-		mOutputImageIpl = NULL;
-		mOutputImage = NULL;
+		releaseOutputImage();
 		mOutputSlot->unlock();
 	}
 }
 
+/*! TODO:
+*/
+void ThresholdModule::releaseOutputImage()
+{
+	if(!mOutputImageIpl)
+		return;
+
+	if(mOutputInPlace)
+		cvReleaseImageHeader(&mOutputImageIpl);
+	else
+		releaseIplImage(&mOutputImageIpl);
+	delete mOutputImage;
+	mOutputImageIpl = NULL;
+	mOutputImage = NULL;
+	mOutputInPlace = false;
+}
+
 /*!
 */
 void ThresholdModule::updateParametersFunction()
@@ -217,6 +291,9 @@ string ThresholdModule::verifyParameterFunction(const Parameter& inParameter) co
 {
 	string lResult = "";
 
+	if(inParameter.getName()==PARAMETER_NAME_THRESHOLD_TYPE && inParameter.toEnum()<0)
+		lResult = string("Unknown threshold type \"") + inParameter.getValue().c_str() + string("\"");
+
 	return lResult;
 }
 
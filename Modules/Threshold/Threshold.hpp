@@ -52,8 +52,6 @@ class ThresholdModule: public Module
 {
 	public:
 
-	typedef map<string, int> ThresholdTypeMap;
-	  
 	//! Default constructor
 	ThresholdModule();
 	//! Virtual destructor
@@ -74,6 +72,16 @@ class ThresholdModule: public Module
 	//! Resetting the module as it was when created
 	void resetFunction();
 
+	//! Check input, read parameters and allocate output for a frame processed by strips
+	void beginPointwiseFunction(unsigned int inFrameNumber);
+	//! Threshold rows of the input image
+	void processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow);
+	//! Complete a frame processed by strips
+	void endPointwiseFunction();
+
+	//! Release the output image, or the header on the input image when thresholding in place
+	void releaseOutputImage();
+
 	//! Update %Module parameters
 	void updateParametersFunction();
 	//! Verify if Parameter value is valid without actually changing the value
@@ -83,14 +91,18 @@ class ThresholdModule: public Module
 
 	Parameter mParamThresholdType; //!< Threshold type
 	Parameter mParamThresholdValue; //!< Threshold value
+	unsigned long mParamVersion; //!< Version of the parameters last read
+	int mThresholdType; //!< OpenCV code of the threshold type, CV_THRESH_BINARY if the type is unknown
 
 	ModuleSlot* mInputSlot; //!< Image input slot
 	ModuleSlot* mOutputSlot; //!< Image output slot
 
 	IplImage* mOutputImageIpl; //!< Output image
 	Image* mOutputImage; //!< Output image
+	bool mOutputInPlace; //!< Output image is the input image, thresholded in place
 
-	ThresholdTypeMap mThresholdTypeMap; //!< Map of the threshold type
+	const Image* mInputImage; //!< Input image of the frame being processed
+	IplImage* mInputImageIpl; //!< Header on the input image of the frame being processed
 	
 };
 
@@ -39,6 +39,7 @@
 
 #define VIPERS_UTILS_OPENCV
 #include <ImageUtils.hpp>
+#include <PixelKernels.hpp>
 
 using namespace VIPERS;
 using namespace std;
@@ -60,6 +61,43 @@ using namespace std;
 #define PARAMETER_NAME_ALPHA "alpha"
 #define PARAMETER_NAME_INVERT "invert"
 
+//! Smallest number of rows blended by a thread in mask modes
+#define MASK_BLEND_GRAIN_ROWS 16
+
+namespace
+{
+	/*! Blends rows of the output in mask modes, reading each input and writing the output once
+	*/
+	class MaskBlendTask: public ParallelTask
+	{
+		public:
+
+		MaskBlendTask(const Image* inBackground, const Image* inForeground, const Image* inMask, Image* outImage, bool inAlphaMask, unsigned char inForegroundWeight, bool inInvert)
+			: mBackground(inBackground), mForeground(inForeground), mMask(inMask), mOutput(outImage), mAlphaMask(inAlphaMask), mForegroundWeight(inForegroundWeight), mInvert(inInvert) {}
+
+		void run(unsigned int inFirst, unsigned int inEnd)
+		{
+			for(unsigned int i = inFirst; i < inEnd; i++)
+			{
+				if(mAlphaMask)
+					PixelKernels::blendAlphaMask((const unsigned char*)mBackground->getRow(i), (const unsigned char*)mForeground->getRow(i), (const unsigned char*)mMask->getRow(i), (unsigned char*)mOutput->getRow(i), mOutput->getWidth(), mOutput->getNbChannels(), mInvert);
+				else
+					PixelKernels::composeMask((const unsigned char*)mBackground->getRow(i), (const unsigned char*)mForeground->getRow(i), (const unsigned char*)mMask->getRow(i), (unsigned char*)mOutput->getRow(i), mOutput->getWidth(), mOutput->getNbChannels(), mForegroundWeight, mInvert);
+			}
+		}
+
+		private:
+
+		const Image* mBackground; //!< Background image
+		const Image* mForeground; //!< Image made translucent
+		const Image* mMask; //!< Plain or alpha mask
+		Image* mOutput; //!< Output image
+		bool mAlphaMask; //!< Mask gives the weight of each pixel instead of selecting pixels
+		unsigned char mForegroundWeight; //!< Weight of the foreground where a plain mask selects pixels
+		bool mInvert; //!< Invert the mask
+	};
+}
+
 /*! TODO:
 */
 TranslucencyModule::TranslucencyModule()
@@ -68,13 +106,14 @@ TranslucencyModule::TranslucencyModule()
 	mParamAlpha(PARAMETER_NAME_ALPHA, Variable::eVariableTypeDouble, "Translucency alpha", "Percentage of translucency (0=opaque, 1=invisible)", true),
 	mParamInvert(PARAMETER_NAME_INVERT, Variable::eVariableTypeBool, "Invert mask", "Invert plain or alpha mask", true)
 {
+	mParamVersion = 0;
 	mShortDescription = "Module for embedding a color image in another one with translucency effect";
 	mLongDescription = "This module embeds an image into another one using an alpha mask (translucency)";
 
 	ValueSet lModeName;
-	lModeName.insert(Value("image", "Whole Image", "Whole image is made translucent using the specified alpha value"));
-	lModeName.insert(Value("plainmask", "Plain Mask", "Only the image pixels where the provided mask is non zero are made translucent using the specified alpha value"));
-	lModeName.insert(Value("alphamask", "Alpha Mask", "Each pixel of the mask specify the alpha value to apply to the corresponding image pixel"));
+	lModeName.insert(Value("image", "Whole Image", "Whole image is made translucent using the specified alpha value", eModeImage));
+	lModeName.insert(Value("plainmask", "Plain Mask", "Only the image pixels where the provided mask is non zero are made translucent using the specified alpha value", eModePlainMask));
+	lModeName.insert(Value("alphamask", "Alpha Mask", "Each pixel of the mask specify the alpha value to apply to the corresponding image pixel", eModeAlphaMask));
 	mParamMode.setPossibleValues(lModeName);
 
   NameSet lDependentParameterSet;
@@ -100,11 +139,6 @@ TranslucencyModule::TranslucencyModule()
 
 	mOutputFrameIpl = NULL;
 	mOutputFrame = NULL;
-	mTmpFrame1 = NULL;
-	mTmpFrame2 = NULL;
-	mTmpFrame3 = NULL;
-	mTmpFrame4 = NULL;
-	mTmpFrame5 = NULL;
 }
 
 /*! TODO:
@@ -113,19 +147,9 @@ TranslucencyModule::~TranslucencyModule()
 {
 	if(mOutputFrameIpl)
 	{
-		cvReleaseImage(&mOutputFrameIpl);
+		releaseIplImage(&mOutputFrameIpl);
 		delete mOutputFrame;
 	}
-	if(mTmpFrame1)
-		cvReleaseImage(&mTmpFrame1);
-	if(mTmpFrame2)
-		cvReleaseImage(&mTmpFrame2);
-	if(mTmpFrame3)
-		cvReleaseImage(&mTmpFrame3);
-	if(mTmpFrame4)
-		cvReleaseImage(&mTmpFrame4);
-	if(mTmpFrame5)
-		cvReleaseImage(&mTmpFrame5);
 }
 
 /*! TODO:
@@ -172,26 +196,27 @@ void TranslucencyModule::processFunction(unsigned int inFrameNumber)
 	unsigned int lHeight;
 	int lChannels;
 	int lDepth;
-	string lMode;
+	int lMode;
 	double lAlpha;
-	double lScale;
-	double lShift;
 
-	lockParameters();
-	mParamMode = getLockedParameter(PARAMETER_NAME_MODE);
-	mParamAlpha = getLockedParameter(PARAMETER_NAME_ALPHA);
-	mParamInvert = getLockedParameter(PARAMETER_NAME_INVERT);
-	unlockParameters();
+	if(parametersChanged(mParamVersion))
+	{
+		lockParameters();
+		mParamMode = getLockedParameter(PARAMETER_NAME_MODE);
+		mParamAlpha = getLockedParameter(PARAMETER_NAME_ALPHA);
+		mParamInvert = getLockedParameter(PARAMETER_NAME_INVERT);
+		unlockParameters();
+	}
 
-	lMode = mParamMode.toString();
+	lMode = mParamMode.toEnum();
 	lAlpha = mParamAlpha.toDouble();
 
 	if(!mInputSlotBackgroundColorImage->isConnected())
 		throw(Exception(Exception::eCodeUseModule, mInputSlotBackgroundColorImage->getFullName().c_str() + string(" is not connected to an output slot") ));
 	if(!mInputSlotTranslucencyColorImage->isConnected())
 		throw(Exception(Exception::eCodeUseModule, mInputSlotTranslucencyColorImage->getFullName().c_str() + string(" is not connected to an output slot") ));
-	if(lMode!="image" && !mInputSlotTranslucencyMaskImage->isConnected())
-		throw(Exception(Exception::eCodeUseModule, mInputSlotTranslucencyMaskImage->getFullName().c_str() + string(" is not connected to an output slot. It is needed in mode \"") + lMode.c_str() + string("\".") ));
+	if(lMode!=eModeImage && !mInputSlotTranslucencyMaskImage->isConnected())
+		throw(Exception(Exception::eCodeUseModule, mInputSlotTranslucencyMaskImage->getFullName().c_str() + string(" is not connected to an output slot. It is needed in mode \"") + mParamMode.toString().c_str() + string("\".") ));
 
 	mInputSlotBackgroundColorImage->lock();
 	mInputSlotTranslucencyColorImage->lock();
@@ -282,6 +307,15 @@ void TranslucencyModule::processFunction(unsigned int inFrameNumber)
 		throw(Exception(Exception::eCodeUseModule, mInputSlotTranslucencyMaskImage->getFullName().c_str() + string(" must be a unsigned 8 bits 1 channel image") ));
 	}
 
+	if(lMode!=eModeImage && (lDepth!=IPL_DEPTH_8U || lChannels!=3))
+	{
+		mOutputSlot->unlock();
+		mInputSlotTranslucencyMaskImage->unlock();
+		mInputSlotTranslucencyColorImage->unlock();
+		mInputSlotBackgroundColorImage->unlock();
+		throw(Exception(Exception::eCodeUseModule, mInputSlotBackgroundColorImage->getFullName().c_str() + string(" and ") + mInputSlotTranslucencyColorImage->getFullName().c_str() + string(" must be unsigned 8 bits 3 channels images in mode \"") + mParamMode.toString().c_str() + string("\".") ));
+	}
+
 	setToIplImage(*lBackgroundColorImage, &lBackgroundColorImageIpl);
 	setToIplImage(*lTranslucencyColorImage, &lTranslucencyColorImageIpl);
 	setToIplImage(*lTranslucencyMaskImage, &lTranslucencyMaskImageIpl);
@@ -289,99 +323,34 @@ void TranslucencyModule::processFunction(unsigned int inFrameNumber)
 	// Create output image
 	if(!mOutputFrameIpl)
 	{
-		mOutputFrameIpl = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_8U, 3);
+		mOutputFrameIpl = createIplImage(cvSize(lWidth, lHeight), IPL_DEPTH_8U, 3);
 		mOutputFrame = new Image(false);
 		setFromIplImage(mOutputFrameIpl, *mOutputFrame);
 		mOutputFrame->setModel(Image::eModelRGB);
-		if(lMode!="image")
-		{
-			if(mTmpFrame1)
-				cvReleaseImage(&mTmpFrame1);
-			mTmpFrame1 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_8U, 3);
-			if(mTmpFrame2)
-				cvReleaseImage(&mTmpFrame2);
-			mTmpFrame2 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_8U, 3);
-			if(lMode=="alphamask")
-			{
-				if(mTmpFrame3)
-					cvReleaseImage(&mTmpFrame3);
-				mTmpFrame3 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_32F, 3);
-				if(mTmpFrame4)
-					cvReleaseImage(&mTmpFrame4);
-				mTmpFrame4 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_32F, 3);
-				if(mTmpFrame5)
-					cvReleaseImage(&mTmpFrame5);
-				mTmpFrame5 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_32F, 3);
-			}
-		}
 	}
 	else if(mOutputFrameIpl->width!=lWidth || mOutputFrameIpl->height!=lHeight || mOutputFrameIpl->nChannels!=lChannels || mOutputFrameIpl->depth!=lDepth)
 	{
-		cvReleaseImage(&mOutputFrameIpl);
+		releaseIplImage(&mOutputFrameIpl);
 		delete mOutputFrame;
-		mOutputFrameIpl = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_8U, 3);
+		mOutputFrameIpl = createIplImage(cvSize(lWidth, lHeight), IPL_DEPTH_8U, 3);
     mOutputFrame = new Image(false);
     setFromIplImage(mOutputFrameIpl, *mOutputFrame);
     mOutputFrame->setModel(Image::eModelRGB);
-
-		if(lMode!="image")
-		{
-			if(mTmpFrame1)
-				cvReleaseImage(&mTmpFrame1);
-			mTmpFrame1 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_8U, 3);
-			if(mTmpFrame2)
-				cvReleaseImage(&mTmpFrame2);
-			mTmpFrame2 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_8U, 3);
-			if(lMode=="alphamask")
-			{
-				if(mTmpFrame3)
-					cvReleaseImage(&mTmpFrame3);
-				mTmpFrame3 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_32F, 3);
-				if(mTmpFrame4)
-					cvReleaseImage(&mTmpFrame4);
-				mTmpFrame4 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_32F, 3);
-				if(mTmpFrame5)
-					cvReleaseImage(&mTmpFrame5);
-				mTmpFrame5 = cvCreateImage(cvSize(lWidth, lHeight), IPL_DEPTH_32F, 3);
-			}
-		}
 	}
 
-	if(lMode=="image")
+	if(lMode==eModeImage)
 	{
 		cvAddWeighted(lBackgroundColorImageIpl, lAlpha, lTranslucencyColorImageIpl, 1-lAlpha, 0.0, mOutputFrameIpl);
 	}
-	else if(lMode=="plainmask")
+	else if(lMode==eModePlainMask)
 	{
-		cvCopy(lBackgroundColorImageIpl, mOutputFrameIpl);
-		cvConvertScale(lBackgroundColorImageIpl, mTmpFrame1, lAlpha);
-		cvConvertScale(lTranslucencyColorImageIpl, mTmpFrame2, 1-lAlpha);
-		cvAdd(mTmpFrame1, mTmpFrame2, mOutputFrameIpl, lTranslucencyMaskImageIpl);
+		MaskBlendTask lMaskBlendTask(lBackgroundColorImage, lTranslucencyColorImage, lTranslucencyMaskImage, mOutputFrame, false, (unsigned char)cvRound((1-lAlpha)*255), mParamInvert.toBool());
+		parallelFor(0, lHeight, lMaskBlendTask, MASK_BLEND_GRAIN_ROWS);
 	}
-	else if(lMode=="alphamask")
+	else if(lMode==eModeAlphaMask)
 	{
-		if(mParamInvert.toBool())
-		{
-			lScale = 1.0/255.0;
-			lShift = 0;
-		}
-		else
-		{
-			lScale = -1.0/255.0;
-			lShift = 1.0;
-		}
-
-		cvConvertScale(lBackgroundColorImageIpl, mTmpFrame3);
-		cvConvertScale(lTranslucencyColorImageIpl, mTmpFrame4);
-
-		cvMerge(lTranslucencyMaskImageIpl, lTranslucencyMaskImageIpl, lTranslucencyMaskImageIpl, NULL, mTmpFrame1);
-		cvConvertScale(mTmpFrame1, mTmpFrame5, lScale, lShift);
-		cvMul(mTmpFrame3, mTmpFrame5, mTmpFrame3);
-		cvConvertScale(mTmpFrame5, mTmpFrame5, -1, 1);
-		cvMul(mTmpFrame4, mTmpFrame5, mTmpFrame4);
-
-		cvAdd(mTmpFrame3, mTmpFrame4, mTmpFrame5);
-		cvConvertScale(mTmpFrame5, mOutputFrameIpl);
+		MaskBlendTask lMaskBlendTask(lBackgroundColorImage, lTranslucencyColorImage, lTranslucencyMaskImage, mOutputFrame, true, 0, mParamInvert.toBool());
+		parallelFor(0, lHeight, lMaskBlendTask, MASK_BLEND_GRAIN_ROWS);
 	}
 	else
 	{
@@ -393,9 +362,11 @@ void TranslucencyModule::processFunction(unsigned int inFrameNumber)
 		mInputSlotTranslucencyMaskImage->unlock();
 		mInputSlotTranslucencyColorImage->unlock();
 		mInputSlotBackgroundColorImage->unlock();
-		throw(Exception(Exception::eCodeUseModule, string("Module \"") + getLabel().c_str() + string("\" does not a a mode named \"") + lMode.c_str() + string("\"")));
+		throw(Exception(Exception::eCodeUseModule, string("Module \"") + getLabel().c_str() + string("\" does not a a mode named \"") + mParamMode.toString().c_str() + string("\"")));
 	}
 
+	mOutputFrame->propagateMetadata(*lBackgroundColorImage);
+
   cvReleaseImageHeader(&lBackgroundColorImageIpl);
   cvReleaseImageHeader(&lTranslucencyColorImageIpl);
   cvReleaseImageHeader(&lTranslucencyMaskImageIpl);
@@ -421,37 +392,12 @@ void TranslucencyModule::resetFunction()
 	if(mOutputFrameIpl)
 	{
 		mOutputSlot->lock();
-		cvReleaseImage(&mOutputFrameIpl);
+		releaseIplImage(&mOutputFrameIpl);
 		delete mOutputFrame;
 		mOutputFrameIpl = NULL;
 		mOutputFrame = NULL;
 		mOutputSlot->unlock();
 	}
-	if(mTmpFrame1)
-	{
-		cvReleaseImage(&mTmpFrame1);
-		mTmpFrame1 = NULL;
-	}
-	if(mTmpFrame2)
-	{
-		cvReleaseImage(&mTmpFrame2);
-		mTmpFrame2 = NULL;
-	}
-	if(mTmpFrame3)
-	{
-		cvReleaseImage(&mTmpFrame3);
-		mTmpFrame3 = NULL;
-	}
-	if(mTmpFrame4)
-	{
-		cvReleaseImage(&mTmpFrame4);
-		mTmpFrame4 = NULL;
-	}
-	if(mTmpFrame5)
-	{
-		cvReleaseImage(&mTmpFrame5);
-		mTmpFrame5 = NULL;
-	}
 }
 
 /*!
@@ -463,6 +409,8 @@ void TranslucencyModule::updateParametersFunction()
   string lMode = getLockedParameter(PARAMETER_NAME_MODE).toString();
 
   mParamMode.setValueStr(lMode.c_str());
+  mParamAlpha = getLockedParameter(PARAMETER_NAME_ALPHA);
+  mParamInvert = getLockedParameter(PARAMETER_NAME_INVERT);
 
   if(lMode=="image")
   {
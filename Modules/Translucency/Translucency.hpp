@@ -51,6 +51,14 @@ class TranslucencyModule: public Module
 {
 	public:
 
+	//! Translucency modes (codes of the mode parameter values)
+	enum Mode
+	{
+		eModeImage, //!< Whole image is made translucent
+		eModePlainMask, //!< Pixels where the mask is non zero are made translucent
+		eModeAlphaMask //!< Mask gives the alpha value of each pixel
+	};
+
 	//! Default constructor
 	TranslucencyModule();
 	//! Virtual destructor
@@ -86,15 +94,11 @@ class TranslucencyModule: public Module
 
 	Image* mOutputFrame; //!< Output frame
 	IplImage* mOutputFrameIpl; //!< Output frame
-	IplImage* mTmpFrame1; //!< Temporary frame
-	IplImage* mTmpFrame2; //!< Temporary frame
-	IplImage* mTmpFrame3; //!< Temporary frame
-	IplImage* mTmpFrame4; //!< Temporary frame
-	IplImage* mTmpFrame5; //!< Temporary frame
 
 	Parameter mParamMode; //!< Translucency mode parameter
 	Parameter mParamAlpha; //!< Translucency alpha parameter
 	Parameter mParamInvert; //!< Translucency inverse parameter
+	unsigned long mParamVersion; //!< Version of the parameters last read
 
 };
 
@@ -51,21 +51,37 @@ using namespace std;
 
 #define PARAMETER_NAME_VIDEO_FILE "video-file"
 #define PARAMETER_NAME_LOOP "loop"
+#define PARAMETER_NAME_OUTPUT_FORMAT "output-format"
 
 /*! TODO:
 */
 VideoReaderModule::VideoReaderModule()
 	:Module(MODULE_NAME, MODULE_DISPLAY_NAME, VIDEOREADERMODULE_VERSION),
 	mParamVideoFile(PARAMETER_NAME_VIDEO_FILE, Variable::eVariableTypeFile, "Video file", "Video of the image to read", false),
-	mParamLoop(PARAMETER_NAME_LOOP, Variable::eVariableTypeBool, "Loop", "Loop on video", false)
+	mParamLoop(PARAMETER_NAME_LOOP, Variable::eVariableTypeBool, "Loop", "Loop on video", false),
+	mParamOutputFormat(PARAMETER_NAME_OUTPUT_FORMAT, Variable::eVariableTypeString, "Output format", "Format of the output image", false)
 {
 	mShortDescription = "Module reading a video from a file";
 	mLongDescription = "This module reads the frames from a video file";
 
 	mParamLoop.setValue(false);
 
+	ValueSet lTmpFormatName;
+	lTmpFormatName.insert(Value("interleaved", "Interleaved", "Interleaved color image, as decoded"));
+	lTmpFormatName.insert(Value("i420", "YUV 4:2:0 (I420)", "Planar luma and subsampled chroma; the first plane can be used as a gray scale image"));
+	lTmpFormatName.insert(Value("nv12", "YUV 4:2:0 (NV12)", "Luma plane and interleaved subsampled chroma plane; the first plane can be used as a gray scale image"));
+	lTmpFormatName.insert(Value("planar-rgb", "Planar RGB", "Red, green and blue planes"));
+	mParamOutputFormat.setPossibleValues(lTmpFormatName);
+	mParamOutputFormat.setValueStr("interleaved");
+
+	mOutputFormatMap["interleaved"] = Image::eModelUndefined;
+	mOutputFormatMap["i420"] = Image::eModelI420;
+	mOutputFormatMap["nv12"] = Image::eModelNV12;
+	mOutputFormatMap["planar-rgb"] = Image::eModelPlanarRGB;
+
 	newParameter(mParamVideoFile);
 	newParameter(mParamLoop);
+	newParameter(mParamOutputFormat);
 
 	mOutputSlot = newSlot(new ModuleSlot(this, OUTPUT_SLOT_NAME_IMAGE, OUTPUT_SLOT_DISPLAYNAME_IMAGE, "Frame read from specified file", &mOutputImage));
 
@@ -81,10 +97,9 @@ VideoReaderModule::VideoReaderModule()
 VideoReaderModule::~VideoReaderModule()
 {
 	if(mOutputImageIpl)
-	{
-		cvReleaseImage(&mOutputImageIpl);
+		releaseIplImage(&mOutputImageIpl);
+	if(mOutputImage)
 		delete mOutputImage;
-	}
 	if(mVideoCapture)
 		cvReleaseCapture(&mVideoCapture);
 }
@@ -99,6 +114,7 @@ void VideoReaderModule::initFunction()
 	lockParameters();
 	mParamVideoFile = getLockedParameter(PARAMETER_NAME_VIDEO_FILE);
 	mParamLoop = getLockedParameter(PARAMETER_NAME_LOOP);
+	mParamOutputFormat = getLockedParameter(PARAMETER_NAME_OUTPUT_FORMAT);
 	unlockParameters();
 
 	mCurrentFrame = 0;
@@ -148,12 +164,38 @@ void VideoReaderModule::initFunction()
 
 	if(mOutputImageIpl)
 	{
-		cvReleaseImage(&mOutputImageIpl);
+		releaseIplImage(&mOutputImageIpl);
+		mOutputImageIpl = NULL;
+	}
+	if(mOutputImage)
+	{
 		delete mOutputImage;
+		mOutputImage = NULL;
+	}
+
+	Image::Model lOutputModel = mOutputFormatMap[mParamOutputFormat.toString()];
+	if(lOutputModel==Image::eModelUndefined)
+	{
+		mOutputImageIpl = cloneIplImage(lTmpImage);
+		mOutputImage = new Image(false);
+		setFromIplImage(mOutputImageIpl, *mOutputImage);
+	}
+	else
+	{
+		// Planar images are converted once here, so downstream modules can use a single plane without any copy
+		mOutputImage = new Image(lTmpImage->width, lTmpImage->height, lOutputModel);
+		if(!convertFromIplImage(lTmpImage, *mOutputImage))
+		{
+			delete mOutputImage;
+			mOutputImage = NULL;
+			mOutputSlot->unlock();
+			cvReleaseCapture(&mVideoCapture);
+			mVideoCapture = NULL;
+			ostringstream lStr;
+			lStr << "Module \"" << getLabel().c_str() << "\" cannot convert frames from file \"" << mParamVideoFile.toString().c_str() << "\" to the \"" << mParamOutputFormat.toString().c_str() << "\" format.";
+			throw(Exception(Exception::eCodeUseModule, lStr.str().c_str()));
+		}
 	}
-	mOutputImageIpl = cvCloneImage(lTmpImage);
-	mOutputImage = new Image(false);
-	setFromIplImage(mOutputImageIpl, *mOutputImage);
 
 	mOutputSlot->unlock();
 
@@ -221,7 +263,11 @@ void VideoReaderModule::processFunction(unsigned int inFrameNumber)
 	}
 
 	mOutputSlot->lock();
-	cvCopy(lTmpImage, mOutputImageIpl);
+	if(mOutputImageIpl)
+		cvCopy(lTmpImage, mOutputImageIpl);
+	else
+		convertFromIplImage(lTmpImage, *mOutputImage);
+	stampFrameMetadata(*mOutputImage, lFrameNumber);
 	mOutputSlot->unlock();
 
 }
@@ -237,10 +283,11 @@ void VideoReaderModule::stopFunction()
 */
 void VideoReaderModule::resetFunction()
 {
-	if(mOutputImageIpl)
+	if(mOutputImage)
 	{
 		mOutputSlot->lock();
-		cvReleaseImage(&mOutputImageIpl);
+		if(mOutputImageIpl)
+			releaseIplImage(&mOutputImageIpl);
 		delete mOutputImage;
 		mOutputImageIpl = NULL;
 		mOutputImage = NULL;
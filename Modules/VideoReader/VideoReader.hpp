@@ -40,6 +40,8 @@
 #include <Image.hpp>
 #include <cv.h>
 #include <highgui.h>
+#include <map>
+#include <string>
 
 using namespace VIPERS;
 
@@ -51,6 +53,8 @@ class VideoReaderModule: public Module
 {
 	public:
 
+	typedef map<string, Image::Model> OutputFormatMap;
+
 	//! Default constructor
 	VideoReaderModule();
 	//! Virtual destructor
@@ -80,16 +84,19 @@ class VideoReaderModule: public Module
 
 	Parameter mParamVideoFile; //!< Video file param
 	Parameter mParamLoop; //!< Loop param
+	Parameter mParamOutputFormat; //!< Output image format param
 
 	ModuleSlot* mOutputSlot; //!< Image output slot
 
 	Image* mOutputImage; //!< Output image
-	IplImage* mOutputImageIpl; //!< Output image
+	IplImage* mOutputImageIpl; //!< Output image (interleaved output format only)
 	CvCapture* mVideoCapture; //!< Capture structure
 
 	unsigned int mCurrentFrame; //!< Store the current frame number
 	unsigned int mNbFrames; //!< Number of frame in the video sequence
 
+	OutputFormatMap mOutputFormatMap; //!< Map of the output formats
+
 };
 
 #endif //VIPERS_VIDEOREADERMODULE_HPP
@@ -0,0 +1,245 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/BufferPlanner.cpp
+ * \brief BufferPlanner class functions definition.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#include "BufferPlanner.hpp"
+#include "MemoryAccounting.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+// Alignment in bytes of the buffers in the arena (one cache line)
+#define BUFFER_PLANNER_ALIGNMENT 64
+
+using namespace VIPERS;
+
+namespace
+{
+  unsigned long alignSize(unsigned long inSizeBytes)
+  {
+    return (inSizeBytes + BUFFER_PLANNER_ALIGNMENT - 1) & ~(unsigned long)(BUFFER_PLANNER_ALIGNMENT - 1);
+  }
+
+  // Largest buffers first, they are the hardest to fit in gaps
+  bool isLarger(const BufferPlanner::Buffer* inBuffer1, const BufferPlanner::Buffer* inBuffer2)
+  {
+    if(inBuffer1->mSizeBytes!=inBuffer2->mSizeBytes)
+      return inBuffer1->mSizeBytes>inBuffer2->mSizeBytes;
+    return inBuffer1->mFirstStep<inBuffer2->mFirstStep;
+  }
+
+  bool isBefore(const BufferPlanner::Buffer* inBuffer1, const BufferPlanner::Buffer* inBuffer2)
+  {
+    return inBuffer1->mOffset<inBuffer2->mOffset;
+  }
+}
+
+/*! \todo
+*/
+BufferPlanner::BufferPlanner()
+{
+  mArenaBlock = NULL;
+  mArena = NULL;
+  mArenaSize = 0;
+  mRetiredArenaBlock = NULL;
+}
+
+/*! \todo
+*/
+BufferPlanner::~BufferPlanner()
+{
+  clear();
+  MemoryAccounting::forgetOwner(this);
+}
+
+/*! Buffers are placed from the largest to the smallest, each one in the smallest gap left between the buffers already
+    placed whose lifetimes overlap its own, or after all of them.  The arena is grown if needed; the previous one is
+    kept until releaseRetiredArena() is called, since images may still point to it until their module recreates them.
+*/
+bool BufferPlanner::plan(const BufferMap& inBufferMap)
+{
+  BufferMap::iterator lBufferMapItr;
+  BufferMap::const_iterator lOtherBufferMapItr;
+  vector<Buffer*> lBuffers;
+  vector<Buffer*> lPlacedBuffers;
+  vector<Buffer*> lOverlappingBuffers;
+  vector<Buffer*>::const_iterator lBuffersItr;
+  vector<Buffer*>::const_iterator lPlacedBuffersItr;
+  unsigned long lArenaSize = 0;
+
+  // Same buffers, same plan
+  if(inBufferMap.size()==mBufferMap.size())
+  {
+    for(lOtherBufferMapItr = inBufferMap.begin(), lBufferMapItr = mBufferMap.begin(); lOtherBufferMapItr != inBufferMap.end(); lOtherBufferMapItr++, lBufferMapItr++)
+    {
+      if(lOtherBufferMapItr->first!=lBufferMapItr->first || !(lOtherBufferMapItr->second==lBufferMapItr->second))
+        break;
+    }
+    if(lOtherBufferMapItr==inBufferMap.end())
+      return false;
+  }
+
+  BufferMap lBufferMap = inBufferMap;
+  for(lBufferMapItr = lBufferMap.begin(); lBufferMapItr != lBufferMap.end(); lBufferMapItr++)
+    lBuffers.push_back(&lBufferMapItr->second);
+  sort(lBuffers.begin(), lBuffers.end(), isLarger);
+
+  for(lBuffersItr = lBuffers.begin(); lBuffersItr != lBuffers.end(); lBuffersItr++)
+  {
+    Buffer* lBuffer = *lBuffersItr;
+    unsigned long lSizeBytes = alignSize(lBuffer->mSizeBytes);
+    unsigned long lOffset = 0;
+    unsigned long lBestOffset = 0;
+    unsigned long lBestGap = 0;
+    bool lGapFound = false;
+
+    lOverlappingBuffers.clear();
+    for(lPlacedBuffersItr = lPlacedBuffers.begin(); lPlacedBuffersItr != lPlacedBuffers.end(); lPlacedBuffersItr++)
+    {
+      if(lBuffer->overlaps(**lPlacedBuffersItr))
+        lOverlappingBuffers.push_back(*lPlacedBuffersItr);
+    }
+    sort(lOverlappingBuffers.begin(), lOverlappingBuffers.end(), isBefore);
+
+    for(lPlacedBuffersItr = lOverlappingBuffers.begin(); lPlacedBuffersItr != lOverlappingBuffers.end(); lPlacedBuffersItr++)
+    {
+      const Buffer* lPlacedBuffer = *lPlacedBuffersItr;
+      if(lPlacedBuffer->mOffset>=lOffset+lSizeBytes && (!lGapFound || lPlacedBuffer->mOffset-lOffset<lBestGap))
+      {
+        lBestOffset = lOffset;
+        lBestGap = lPlacedBuffer->mOffset-lOffset;
+        lGapFound = true;
+      }
+      lOffset = max(lOffset, lPlacedBuffer->mOffset+alignSize(lPlacedBuffer->mSizeBytes));
+    }
+
+    lBuffer->mOffset = lGapFound ? lBestOffset : lOffset;
+    lArenaSize = max(lArenaSize, lBuffer->mOffset+lSizeBytes);
+    lPlacedBuffers.push_back(lBuffer);
+  }
+
+  // Grow the arena, or shrink it if it is more than twice as large as needed
+  if(lArenaSize>mArenaSize || lArenaSize<mArenaSize/2)
+  {
+    releaseRetiredArena();
+    mRetiredArenaBlock = mArenaBlock;
+    mArenaBlock = NULL;
+    mArena = NULL;
+    mArenaSize = 0;
+    if(lArenaSize>0)
+    {
+      mArena = allocateArena(lArenaSize, &mArenaBlock);
+      mArenaSize = lArenaSize;
+    }
+  }
+
+  mBufferMap = lBufferMap;
+  return true;
+}
+
+/*! \todo
+*/
+void BufferPlanner::clear() throw()
+{
+  releaseRetiredArena();
+  releaseArena(&mArenaBlock);
+  mArena = NULL;
+  mArenaSize = 0;
+  mBufferMap.clear();
+}
+
+/*! \todo
+*/
+void BufferPlanner::releaseRetiredArena() throw()
+{
+  releaseArena(&mRetiredArenaBlock);
+}
+
+/*! \todo
+*/
+char* BufferPlanner::getData(const ModuleSlot* inModuleSlot) const throw()
+{
+  BufferMap::const_iterator lBufferMapItr = mBufferMap.find(inModuleSlot);
+  if(lBufferMapItr==mBufferMap.end() || !mArena)
+    return NULL;
+  return mArena + lBufferMapItr->second.mOffset;
+}
+
+/*! \todo
+*/
+const BufferPlanner::BufferMap& BufferPlanner::getBuffers() const throw()
+{
+  return mBufferMap;
+}
+
+/*! \todo
+*/
+unsigned long BufferPlanner::getArenaSize() const throw()
+{
+  return mArenaSize;
+}
+
+/*! \todo
+*/
+unsigned long BufferPlanner::getBuffersSize() const throw()
+{
+  unsigned long lSizeBytes = 0;
+  for(BufferMap::const_iterator lBufferMapItr = mBufferMap.begin(); lBufferMapItr != mBufferMap.end(); lBufferMapItr++)
+    lSizeBytes += lBufferMapItr->second.mSizeBytes;
+  return lSizeBytes;
+}
+
+/*! \todo
+*/
+char* BufferPlanner::allocateArena(unsigned long inSizeBytes, char** outBlock)
+{
+  MemoryAccounting::Scope lMemoryScope(this);
+
+  *outBlock = new char[inSizeBytes + BUFFER_PLANNER_ALIGNMENT - 1];
+  MemoryAccounting::allocate(*outBlock, inSizeBytes);
+
+  size_t lMisalignment = (size_t)*outBlock % BUFFER_PLANNER_ALIGNMENT;
+  return lMisalignment ? *outBlock + (BUFFER_PLANNER_ALIGNMENT - lMisalignment) : *outBlock;
+}
+
+/*! \todo
+*/
+void BufferPlanner::releaseArena(char** ioBlock) throw()
+{
+  if(*ioBlock)
+  {
+    MemoryAccounting::release(*ioBlock);
+    delete[] *ioBlock;
+    *ioBlock = NULL;
+  }
+}
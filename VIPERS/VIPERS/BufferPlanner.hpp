@@ -0,0 +1,123 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/BufferPlanner.hpp
+ * \brief BufferPlanner class header.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#ifndef VIPERS_BUFFER_PLANNER_HPP
+#define VIPERS_BUFFER_PLANNER_HPP
+
+#include <map>
+
+namespace VIPERS
+{
+
+  using namespace std;
+
+  //Forward declaration
+  class ModuleSlot;
+
+  /*! \brief %BufferPlanner class.
+    \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+
+    Assign the output images of modules to regions of a single memory block (the arena) from their lifetimes.  A
+    lifetime is the range of processing steps [first, last] from the step that writes the image to the last step that
+    reads it.  Two buffers whose lifetimes overlap get disjoint regions, the others may share memory, so the arena is
+    usually much smaller than the sum of the buffers for deep graphs.  The arena is attributed to the planner (see
+    MemoryAccounting).
+  */
+  class BufferPlanner
+  {
+    public:
+
+      /*! \brief Size and lifetime of a buffer
+        \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+      */
+      struct Buffer
+      {
+        //! Explicit constructor
+        explicit Buffer(unsigned long inSizeBytes = 0, unsigned int inFirstStep = 0, unsigned int inLastStep = 0)
+          : mSizeBytes(inSizeBytes), mFirstStep(inFirstStep), mLastStep(inLastStep), mOffset(0) {}
+        //! Check if two buffers have the same size and lifetime (offsets are not compared)
+        bool operator==(const Buffer& inBuffer) const {return mSizeBytes==inBuffer.mSizeBytes && mFirstStep==inBuffer.mFirstStep && mLastStep==inBuffer.mLastStep;}
+        //! Check if the lifetimes of two buffers overlap
+        bool overlaps(const Buffer& inBuffer) const {return mFirstStep<=inBuffer.mLastStep && inBuffer.mFirstStep<=mLastStep;}
+        unsigned long mSizeBytes; //!< Size in bytes
+        unsigned int mFirstStep; //!< Step writing the buffer
+        unsigned int mLastStep; //!< Last step reading the buffer
+        unsigned long mOffset; //!< Offset in the arena (set by plan())
+      };
+
+      //! Buffers by output slot
+      typedef map<const ModuleSlot*, Buffer> BufferMap;
+
+      //! Default constructor
+      BufferPlanner();
+      //! Destructor
+      ~BufferPlanner();
+
+      //! Assign regions of the arena to buffers, return false if the buffers were already planned
+      bool plan(const BufferMap& inBufferMap);
+      //! Release the arena and forget all buffers
+      void clear() throw();
+      //! Release the arena replaced by the last plan() that had to grow it
+      void releaseRetiredArena() throw();
+
+      //! Get the data planned for the buffer of an output slot (NULL if there is none)
+      char* getData(const ModuleSlot* inModuleSlot) const throw();
+      //! Get the planned buffers
+      const BufferMap& getBuffers() const throw();
+      //! Get the size in bytes of the arena
+      unsigned long getArenaSize() const throw();
+      //! Get the sum of the sizes in bytes of the planned buffers
+      unsigned long getBuffersSize() const throw();
+
+    private:
+
+      //! Restrict (disable) copy constructor
+      BufferPlanner(const BufferPlanner&);
+      //! Restrict (disable) assignment operator
+      void operator=(const BufferPlanner&);
+
+      //! Allocate an arena of the given size, attributed to the planner
+      char* allocateArena(unsigned long inSizeBytes, char** outBlock);
+      //! Release an arena
+      void releaseArena(char** ioBlock) throw();
+
+      BufferMap mBufferMap; //!< Planned buffers
+      char* mArenaBlock; //!< Allocated block holding the arena
+      char* mArena; //!< Arena (mArenaBlock aligned)
+      unsigned long mArenaSize; //!< Size in bytes of the arena
+      char* mRetiredArenaBlock; //!< Block of the previous arena, kept until the images over it are recreated
+  };
+
+}
+
+#endif //VIPERS_BUFFER_PLANNER_HPP
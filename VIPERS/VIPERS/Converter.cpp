@@ -32,6 +32,7 @@
  */
 
 #include "Converter.hpp"
+#include "NumberConversion.hpp"
 #include <sstream>
 
 using namespace VIPERS;
@@ -48,7 +49,7 @@ Converter::Converter(const Converter& inConverter) throw()
 */
 Converter::Converter(const string& inValue) throw()
 {
-	*this = inValue.c_str();
+	*this = inValue;
 }
 
 /*! \todo
@@ -153,9 +154,7 @@ void Converter::operator=(const string& inValue) throw()
 */
 void Converter::operator=(bool inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(inValue);
 }
 
 /*! \todo
@@ -180,87 +179,63 @@ void Converter::operator=(unsigned char inValue) throw()
 */
 void Converter::operator=(short inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(static_cast<long>(inValue));
 }
 
 /*! \todo
 */
 void Converter::operator=(unsigned short inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(static_cast<unsigned long>(inValue));
 }
 
 /*! \todo
 */
 void Converter::operator=(int inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(static_cast<long>(inValue));
 }
 
 /*! \todo
 */
 void Converter::operator=(unsigned int inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(static_cast<unsigned long>(inValue));
 }
 
 /*! \todo
 */
 void Converter::operator=(long inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(inValue);
 }
 
 /*! \todo
 */
 void Converter::operator=(unsigned long inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(inValue);
 }
 
 /*! \todo
 */
 void Converter::operator=(float inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr.precision(6);
-	lTmpStr.setf(ios::scientific, ios::floatfield);
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(inValue);
 }
 
 /*! \todo
 */
 void Converter::operator=(double inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr.precision(15);
-	lTmpStr.setf(ios::scientific, ios::floatfield);
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(inValue);
 }
 
 /*! \todo
 */
 void Converter::operator=(long double inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr.precision(19);
-	lTmpStr.setf(ios::scientific, ios::floatfield);
-	lTmpStr << inValue;
-	mValue = lTmpStr.str();
+	mValue = convertNumberToString(inValue);
 }
 
 /*! \todo
@@ -275,8 +250,7 @@ Converter::operator string() const throw()
 Converter::operator bool() const throw()
 {
 	bool lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -305,8 +279,7 @@ Converter::operator unsigned char() const throw()
 Converter::operator short() const throw()
 {
 	short lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -315,8 +288,7 @@ Converter::operator short() const throw()
 Converter::operator unsigned short() const throw()
 {
 	unsigned short lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -325,8 +297,7 @@ Converter::operator unsigned short() const throw()
 Converter::operator int() const throw()
 {
 	int lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -335,8 +306,7 @@ Converter::operator int() const throw()
 Converter::operator unsigned int() const throw()
 {
 	unsigned int lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -345,8 +315,7 @@ Converter::operator unsigned int() const throw()
 Converter::operator long() const throw()
 {
 	long lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -355,8 +324,7 @@ Converter::operator long() const throw()
 Converter::operator unsigned long() const throw()
 {
 	unsigned long lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -365,8 +333,7 @@ Converter::operator unsigned long() const throw()
 Converter::operator float() const throw()
 {
 	float lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -375,8 +342,7 @@ Converter::operator float() const throw()
 Converter::operator double() const throw()
 {
 	double lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -385,18 +351,23 @@ Converter::operator double() const throw()
 Converter::operator long double() const throw()
 {
 	long double lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
+/*! \todo
+*/
+string Converter::toString() const throw()
+{
+	return mValue.c_str();
+}
+
 /*! \todo
 */
 bool Converter::toBool() const throw()
 {
 	bool lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -425,8 +396,7 @@ unsigned char Converter::toUChar() const throw()
 short Converter::toShort() const throw()
 {
 	short lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -435,8 +405,7 @@ short Converter::toShort() const throw()
 unsigned short Converter::toUShort() const throw()
 {
 	unsigned short lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -445,8 +414,7 @@ unsigned short Converter::toUShort() const throw()
 int Converter::toInt() const throw()
 {
 	int lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -455,8 +423,7 @@ int Converter::toInt() const throw()
 unsigned int Converter::toUInt() const throw()
 {
 	unsigned int lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -465,8 +432,7 @@ unsigned int Converter::toUInt() const throw()
 long Converter::toLong() const throw()
 {
 	long lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -475,8 +441,7 @@ long Converter::toLong() const throw()
 unsigned long Converter::toULong() const throw()
 {
 	unsigned long lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -485,8 +450,7 @@ unsigned long Converter::toULong() const throw()
 float Converter::toFloat() const throw()
 {
 	float lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -495,8 +459,7 @@ float Converter::toFloat() const throw()
 double Converter::toDouble() const throw()
 {
 	double lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -505,7 +468,6 @@ double Converter::toDouble() const throw()
 long double Converter::toLDouble() const throw()
 {
 	long double lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
@@ -0,0 +1,101 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+
+/*!
+ * \file VIPERS/FrameMetadata.cpp
+ * \brief FrameMetadata class functions definition.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#include "FrameMetadata.hpp"
+#include "PACC/Util/Timer.hpp"
+
+using namespace VIPERS;
+
+/*! \todo
+*/
+FrameMetadata::FrameMetadata()
+{
+  clear();
+}
+
+/*! \todo
+*/
+void FrameMetadata::clear()
+{
+  mTimestamp = 0.0;
+  mSequenceNumber = 0;
+  mSourceLabel.clear();
+  mGeneration = 0;
+  mProperties.clear();
+}
+
+/*! \todo
+*/
+void FrameMetadata::propagate(const FrameMetadata& inMetadata)
+{
+  mTimestamp = inMetadata.mTimestamp;
+  mSequenceNumber = inMetadata.mSequenceNumber;
+  if(mSourceLabel!=inMetadata.mSourceLabel)
+    mSourceLabel = inMetadata.mSourceLabel;
+  if(!mProperties.empty() || !inMetadata.mProperties.empty())
+    mProperties = inMetadata.mProperties;
+}
+
+/*! \todo
+*/
+bool FrameMetadata::hasProperty(const string& inName) const
+{
+  return mProperties.find(inName)!=mProperties.end();
+}
+
+/*! \todo
+*/
+string FrameMetadata::getProperty(const string& inName) const
+{
+  PropertyMap::const_iterator lItr = mProperties.find(inName);
+  if(lItr==mProperties.end())
+    return string();
+  return lItr->second;
+}
+
+/*! \todo
+*/
+void FrameMetadata::setProperty(const string& inName, const string& inValue)
+{
+  mProperties[inName] = inValue;
+}
+
+/*! All sources use the same clock, so timestamps of frames coming from different sources can be compared.
+    The origin of the clock is the first call to this function.
+*/
+double FrameMetadata::getCurrentTime()
+{
+  static PACC::Timer lClock;
+  return lClock.getValue();
+}
@@ -0,0 +1,109 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+
+/*!
+ * \file VIPERS/FrameMetadata.hpp
+ * \brief FrameMetadata class header.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#ifndef VIPERS_FRAME_METADATA_HPP
+#define VIPERS_FRAME_METADATA_HPP
+
+#include <map>
+#include <string>
+
+namespace VIPERS
+{
+
+  using namespace std;
+
+  /*! \brief %FrameMetadata class.
+    \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+
+    Metadata carried by an Image.  The timestamp, sequence number, source label and properties identify the frame,
+    and are set by the source module then propagated by processing modules to their outputs.  The generation counter
+    belongs to the Image buffer itself: it is incremented each time the producer writes new content in the buffer.
+  */
+  class FrameMetadata
+  {
+    public:
+
+      typedef map<string, string> PropertyMap;
+
+      //! Default constructor
+      FrameMetadata();
+
+      //! Clear all metadata
+      void clear();
+
+      //! Copy frame identity (timestamp, sequence number, source label and properties), but not the generation counter
+      void propagate(const FrameMetadata& inMetadata);
+
+      //! Get capture timestamp, in seconds (see getCurrentTime())
+      inline double getTimestamp() const {return mTimestamp;}
+      //! Set capture timestamp, in seconds (see getCurrentTime())
+      inline void setTimestamp(double inTimestamp) {mTimestamp = inTimestamp;}
+      //! Get sequence number of the frame
+      inline unsigned long getSequenceNumber() const {return mSequenceNumber;}
+      //! Set sequence number of the frame
+      inline void setSequenceNumber(unsigned long inSequenceNumber) {mSequenceNumber = inSequenceNumber;}
+      //! Get label of the source of the frame
+      inline const string& getSourceLabel() const {return mSourceLabel;}
+      //! Set label of the source of the frame
+      inline void setSourceLabel(const string& inSourceLabel) {mSourceLabel = inSourceLabel;}
+      //! Get generation counter of the image buffer
+      inline unsigned long getGeneration() const {return mGeneration;}
+      //! Increment generation counter of the image buffer
+      inline void incrementGeneration() {mGeneration++;}
+
+      //! Check if a property is defined
+      bool hasProperty(const string& inName) const;
+      //! Get a property value (empty if not defined)
+      string getProperty(const string& inName) const;
+      //! Set a property value
+      void setProperty(const string& inName, const string& inValue);
+      //! Get all properties
+      inline const PropertyMap& getProperties() const {return mProperties;}
+
+      //! Get current time of the process-wide clock used for timestamps, in seconds
+      static double getCurrentTime();
+
+    private:
+
+      double mTimestamp; //!< Capture timestamp in seconds
+      unsigned long mSequenceNumber; //!< Sequence number of the frame
+      string mSourceLabel; //!< Label of the source of the frame
+      unsigned long mGeneration; //!< Generation counter of the image buffer
+      PropertyMap mProperties; //!< Additional properties
+
+  };
+
+}
+
+#endif //VIPERS_FRAME_METADATA_HPP
@@ -32,6 +32,7 @@
  */
 
 #include "Image.hpp"
+#include "MemoryAccounting.hpp"
 
 #include <cstdlib>
 #include <cstring>
@@ -47,20 +48,15 @@ Image::Image(bool inManaged)
 {
   mManaged = inManaged;
   mData = NULL;
-  mWidth = 0;
-  mHeight = 0;
-  mRowLengthBytes = 0;
-  mSizeBytes = 0;
-  mNbChannels = eChannel0;
-  mDepth = eDepthUndefined;
-  mModel = eModelUndefined;
-  mOrigin = eOriginTopLeft;
+  clear();
 }
 
 /*! \todo
 */
 Image::Image(unsigned int inWidth, unsigned int inHeight, Depth inDepth, Channel inNbChannels, bool inManaged, char* inData)
 {
+  mManaged = inManaged;
+  mData = NULL;
   create(inWidth, inHeight, inDepth, inNbChannels, inManaged, inData);
 }
 
@@ -68,45 +64,19 @@ Image::Image(unsigned int inWidth, unsigned int inHeight, Depth inDepth, Channel
 */
 Image::Image(unsigned int inWidth, unsigned int inHeight, Model inModel, bool inManaged, char* inData)
 {
+  mManaged = inManaged;
+  mData = NULL;
   create(inWidth, inHeight, inModel, inManaged, inData);
 }
 
-/*! \todo
+/*! The copy is always managed and contiguous, even if \c inImage is a view.
 */
 Image::Image(const Image& inImage)
 {
   mManaged = true;
-  mWidth = inImage.mWidth;
-  mHeight = inImage.mHeight;
-  mRowLengthBytes = inImage.mRowLengthBytes;
-  mSizeBytes = inImage.mSizeBytes;
-  mNbChannels = inImage.mNbChannels;
-  mDepth = inImage.mDepth;
-  mModel = inImage.mModel;
-  mOrigin = inImage.mOrigin;
-
-  if(mSizeBytes>0 && inImage.mData)
-  {
-    try
-    {
-      mData = new char[mSizeBytes];
-      ::memcpy(mData, inImage.mData, mSizeBytes);
-    }
-    catch(std::bad_alloc& inBadAlloc)
-    {
-      std::cerr << "VIPERS ERROR: Image Copy Constructor could not allocate " << mSizeBytes << " bytes of memory (" << inBadAlloc.what() << ")" << std::endl;
-      mData = NULL;
-      clear();
-    }
-    catch(std::runtime_error inException)
-    {
-      std::cerr << "ERROR: Image Copy Constructor : " << inException.what() << std::endl;
-    }
-    catch(...)
-    {
-      throw;
-    }
-  }
+  mData = NULL;
+  clear();
+  copyData(inImage);
 }
 
 /*! \todo
@@ -121,7 +91,10 @@ Image::~Image()
 void Image::clear()
 {
   if(mManaged && mData)
+  {
+    MemoryAccounting::release(mData);
     delete [] mData;
+  }
   mData = NULL;
   mWidth = 0;
   mHeight = 0;
@@ -131,15 +104,34 @@ void Image::clear()
   mDepth = eDepthUndefined;
   mModel = eModelUndefined;
   mOrigin = eOriginTopLeft;
+  mNbPlanes = 0;
+  for(unsigned int i=0; i<eMaxNbPlanes; i++)
+  {
+    mPlaneData[i] = NULL;
+    mPlaneRowLengthBytes[i] = 0;
+  }
+  mParent = NULL;
+  mViewX = 0;
+  mViewY = 0;
+  mMetadata.clear();
 }
 
-/*! \todo
+/*! If this image is managed, the data of \c inImage is copied (without row padding).
+    Otherwise, only the data pointers, the row lengths and the view information are copied.
 */
 Image& Image::operator=(const Image& inImage)
 {
+  if(this==&inImage)
+    return *this;
+
   if(mManaged)
   {
     clear();
+    copyData(inImage);
+  }
+  else
+  {
+    mData = inImage.mData;
     mWidth = inImage.mWidth;
     mHeight = inImage.mHeight;
     mRowLengthBytes = inImage.mRowLengthBytes;
@@ -148,47 +140,99 @@ Image& Image::operator=(const Image& inImage)
     mDepth = inImage.mDepth;
     mModel = inImage.mModel;
     mOrigin = inImage.mOrigin;
+    mNbPlanes = inImage.mNbPlanes;
+    for(unsigned int i=0; i<eMaxNbPlanes; i++)
+    {
+      mPlaneData[i] = inImage.mPlaneData[i];
+      mPlaneRowLengthBytes[i] = inImage.mPlaneRowLengthBytes[i];
+    }
+    mParent = inImage.mParent;
+    mViewX = inImage.mViewX;
+    mViewY = inImage.mViewY;
+    mMetadata = inImage.mMetadata;
+  }
+
+  return *this;
+}
 
-    if(mSizeBytes>0 && inImage.mData)
+/*! \todo
+*/
+void Image::copyData(const Image& inImage)
+{
+  mWidth = inImage.mWidth;
+  mHeight = inImage.mHeight;
+  mNbChannels = inImage.mNbChannels;
+  mDepth = inImage.mDepth;
+  mModel = inImage.mModel;
+  mOrigin = inImage.mOrigin;
+  mParent = NULL;
+  mViewX = 0;
+  mViewY = 0;
+  mData = NULL;
+  mMetadata = inImage.mMetadata;
+
+  if(inImage.isPlanar())
+  {
+    mNbPlanes = inImage.mNbPlanes;
+    if(!inImage.mData || !createPlanes(NULL))
     {
-      try
-      {
-        mData = new char[mSizeBytes];
-        ::memcpy(mData, inImage.mData, mSizeBytes);
-      }
-      catch(std::bad_alloc& inBadAlloc)
-      {
-        std::cerr << "VIPERS ERROR: Image::operator= could not allocate " << mSizeBytes << " bytes of memory (" << inBadAlloc.what() << ")" << std::endl;
-        mData = NULL;
-        clear();
-      }
-      catch(std::runtime_error inException)
-      {
-        std::cerr << "VIPERS ERROR: Image::operator= : " << inException.what() << std::endl;
-      }
-      catch(...)
-      {
-        throw;
-      }
+      clear();
+      return;
     }
+    for(unsigned int p=0; p<mNbPlanes; p++)
+      for(unsigned int i=0; i<getPlaneHeight(p); i++)
+        ::memcpy(getPlaneRow(p, i), inImage.getPlaneRow(p, i), getPlaneRowLengthBytes(p));
+    return;
   }
-  else
+
+  mNbPlanes = (mWidth>0 && mHeight>0) ? 1 : 0;
+  mRowLengthBytes = mWidth*getBytesPerPixel();
+  mSizeBytes = mHeight*mRowLengthBytes;
+
+  if(mSizeBytes>0 && inImage.mData)
   {
-    mData = inImage.mData;
-    mWidth = inImage.mWidth;
-    mHeight = inImage.mHeight;
-    mRowLengthBytes = inImage.mRowLengthBytes;
-    mSizeBytes = inImage.mSizeBytes;
-    mNbChannels = inImage.mNbChannels;
-    mDepth = inImage.mDepth;
-    mModel = inImage.mModel;
-    mOrigin = inImage.mOrigin;
+    try
+    {
+      mData = new char[mSizeBytes];
+      MemoryAccounting::allocate(mData, mSizeBytes);
+      if(inImage.isContiguous())
+        ::memcpy(mData, inImage.mData, mSizeBytes);
+      else
+        for(unsigned int i=0; i<mHeight; i++)
+          ::memcpy(getRow(i), inImage.getRow(i), mRowLengthBytes);
+    }
+    catch(std::bad_alloc& inBadAlloc)
+    {
+      std::cerr << "VIPERS ERROR: Image could not allocate " << mSizeBytes << " bytes of memory (" << inBadAlloc.what() << ")" << std::endl;
+      mData = NULL;
+      clear();
+    }
+    catch(const std::runtime_error& inException)
+    {
+      std::cerr << "VIPERS ERROR: Image copy : " << inException.what() << std::endl;
+    }
+    catch(...)
+    {
+      throw;
+    }
   }
+
+  mPlaneData[0] = mData;
+  mPlaneRowLengthBytes[0] = mRowLengthBytes;
 }
 
 /*! \todo
 */
 bool Image::create(unsigned int inWidth, unsigned int inHeight, Depth inDepth, Channel inNbChannels, bool inManaged, char* inData)
+{
+  return create(inWidth, inHeight, inDepth, inNbChannels, inManaged, inData, 0);
+}
+
+/*! When \c inRowLengthBytes is 0, rows of \c inData are assumed to be contiguous. An unmanaged image
+    keeps the given row length, so it can describe a buffer with padded rows (e.g. an IplImage) without copying it.
+    A managed image always stores its rows contiguously.
+*/
+bool Image::create(unsigned int inWidth, unsigned int inHeight, Depth inDepth, Channel inNbChannels, bool inManaged, char* inData, unsigned int inRowLengthBytes)
 {
   clear();
 
@@ -201,17 +245,34 @@ bool Image::create(unsigned int inWidth, unsigned int inHeight, Depth inDepth, C
   mDepth = inDepth;
   mNbChannels = inNbChannels;
   mModel = eModelUndefined;
+  mNbPlanes = 1;
 
-  mRowLengthBytes = mWidth*getBytesPerPixel();
-  mSizeBytes = mHeight*mRowLengthBytes;
+  unsigned int lTightRowLengthBytes = mWidth*getBytesPerPixel();
+  if(inRowLengthBytes==0)
+    inRowLengthBytes = lTightRowLengthBytes;
+  else if(inRowLengthBytes<lTightRowLengthBytes)
+  {
+    clear();
+    return false;
+  }
 
   if(mManaged)
   {
+    mRowLengthBytes = lTightRowLengthBytes;
+    mSizeBytes = mHeight*mRowLengthBytes;
+
     try
     {
       mData = new char[mSizeBytes];
+      MemoryAccounting::allocate(mData, mSizeBytes);
       if(inData)
-        ::memcpy(mData, inData, mSizeBytes);
+      {
+        if(inRowLengthBytes==mRowLengthBytes)
+          ::memcpy(mData, inData, mSizeBytes);
+        else
+          for(unsigned int i=0; i<mHeight; i++)
+            ::memcpy(getRow(i), inData + i*inRowLengthBytes, mRowLengthBytes);
+      }
       else
         ::memset(mData, 0, mSizeBytes);
     }
@@ -234,14 +295,20 @@ bool Image::create(unsigned int inWidth, unsigned int inHeight, Depth inDepth, C
   }
   else
   {
+    mRowLengthBytes = inRowLengthBytes;
+    mSizeBytes = (mHeight-1)*mRowLengthBytes + lTightRowLengthBytes;
     if(inData)
       mData = inData;
   }
 
+  mPlaneData[0] = mData;
+  mPlaneRowLengthBytes[0] = mRowLengthBytes;
+
   return true;
 }
 
-/*! \todo
+/*! For planar models, \c inData (if not NULL) must hold the planes one after the other, without row padding
+    (e.g. the usual I420 or NV12 layout).
 */
 bool Image::create(unsigned int inWidth, unsigned int inHeight, Model inModel, bool inManaged, char* inData)
 {
@@ -250,25 +317,95 @@ bool Image::create(unsigned int inWidth, unsigned int inHeight, Model inModel, b
   if(inWidth==0 || inHeight==0 || inModel<=eModelUndefined || inModel>=eModelInvalid)
     return false;
 
-  mManaged = inManaged;
+  Depth lDepth = getModelDepth(inModel);
+  Channel lNbChannels = getModelNbChannels(inModel);
+
+  if(getModelNbPlanes(inModel)>1)
+  {
+    mManaged = inManaged;
+    mWidth = inWidth;
+    mHeight = inHeight;
+    mDepth = lDepth;
+    mNbChannels = lNbChannels;
+    mModel = inModel;
+    mNbPlanes = getModelNbPlanes(inModel);
+    return createPlanes(inData);
+  }
+
+  if(!create(inWidth, inHeight, lDepth, lNbChannels, inManaged, inData, 0))
+    return false;
+
+  mModel = inModel;
+
+  return true;
+}
+
+/*! The image is never managed: each plane keeps its own data pointer and row length, so planes coming
+    from a capture device or a decoder can be published without copying them.
+*/
+bool Image::createPlanar(unsigned int inWidth, unsigned int inHeight, Model inModel, char* const* inPlaneData, const unsigned int* inPlaneRowLengthBytes)
+{
+  clear();
+
+  if(inWidth==0 || inHeight==0 || getModelNbPlanes(inModel)<2 || !inPlaneData || !inPlaneRowLengthBytes)
+    return false;
+
+  mManaged = false;
   mWidth = inWidth;
   mHeight = inHeight;
+  mDepth = getModelDepth(inModel);
+  mNbChannels = getModelNbChannels(inModel);
   mModel = inModel;
-  mDepth = getModelDepth(mModel);
-  mNbChannels = getModelNbChannels(mModel);
+  mNbPlanes = getModelNbPlanes(inModel);
 
-  mRowLengthBytes = mWidth*getBytesPerPixel();
-  mSizeBytes = mHeight*mRowLengthBytes;
+  for(unsigned int p=0; p<mNbPlanes; p++)
+  {
+    if(!inPlaneData[p] || inPlaneRowLengthBytes[p]<getPlaneTightRowLengthBytes(p))
+    {
+      clear();
+      return false;
+    }
+    mPlaneData[p] = inPlaneData[p];
+    mPlaneRowLengthBytes[p] = inPlaneRowLengthBytes[p];
+    mSizeBytes += (getPlaneHeight(p)-1)*mPlaneRowLengthBytes[p] + getPlaneTightRowLengthBytes(p);
+  }
+
+  mData = mPlaneData[0];
+  mRowLengthBytes = mPlaneRowLengthBytes[0];
+
+  return true;
+}
+
+/*! \todo
+*/
+bool Image::createPlanes(char* inData)
+{
+  unsigned int lOffset[eMaxNbPlanes];
+
+  mSizeBytes = 0;
+  for(unsigned int p=0; p<mNbPlanes; p++)
+  {
+    mPlaneRowLengthBytes[p] = getPlaneTightRowLengthBytes(p);
+    lOffset[p] = mSizeBytes;
+    mSizeBytes += mPlaneRowLengthBytes[p]*getPlaneHeight(p);
+  }
+  mRowLengthBytes = mPlaneRowLengthBytes[0];
 
   if(mManaged)
   {
     try
     {
       mData = new char[mSizeBytes];
+      MemoryAccounting::allocate(mData, mSizeBytes);
       if(inData)
         ::memcpy(mData, inData, mSizeBytes);
       else
+      {
         ::memset(mData, 0, mSizeBytes);
+        // Neutral chroma, so that a new YUV image is black
+        if(mModel==eModelI420 || mModel==eModelNV12)
+          ::memset(mData+lOffset[1], 128, mSizeBytes-lOffset[1]);
+      }
     }
     catch(std::bad_alloc& inBadAlloc)
     {
@@ -288,10 +425,52 @@ bool Image::create(unsigned int inWidth, unsigned int inHeight, Model inModel, b
     }
   }
   else
+    mData = inData;
+
+  for(unsigned int p=0; p<mNbPlanes; p++)
+    mPlaneData[p] = mData ? mData+lOffset[p] : NULL;
+
+  return true;
+}
+
+/*! The view is never managed: it points inside the data of \c inParent and uses the parent row length,
+    so no pixel is copied.  The parent image must stay valid (and must not be recreated) as long as the view is used.
+    The view region must be entirely inside the parent image.  For subsampled planar models (I420 and NV12),
+    the region position must be even.
+*/
+bool Image::createView(const Image& inParent, unsigned int inX, unsigned int inY, unsigned int inWidth, unsigned int inHeight)
+{
+  clear();
+
+  if(!inParent.isValid() || inWidth==0 || inHeight==0 || inX+inWidth>inParent.mWidth || inY+inHeight>inParent.mHeight)
+    return false;
+
+  bool lSubsampled = (inParent.mModel==eModelI420 || inParent.mModel==eModelNV12);
+  if(lSubsampled && (inX%2!=0 || inY%2!=0))
+    return false;
+
+  mManaged = false;
+  mWidth = inWidth;
+  mHeight = inHeight;
+  mDepth = inParent.mDepth;
+  mNbChannels = inParent.mNbChannels;
+  mModel = inParent.mModel;
+  mOrigin = inParent.mOrigin;
+  mNbPlanes = inParent.mNbPlanes;
+  mParent = &inParent;
+  mViewX = inX;
+  mViewY = inY;
+
+  unsigned int lBytesDepth = getBytesPerPixel()/mNbChannels;
+  for(unsigned int p=0; p<mNbPlanes; p++)
   {
-    if(inData)
-      mData = inData;
+    unsigned int lSub = (lSubsampled && p>0) ? 2 : 1;
+    mPlaneRowLengthBytes[p] = inParent.getPlaneRowLengthBytes(p);
+    mPlaneData[p] = inParent.getPlaneRow(p, inY/lSub) + (inX/lSub)*getPlaneNbChannels(p)*lBytesDepth;
+    mSizeBytes += (getPlaneHeight(p)-1)*mPlaneRowLengthBytes[p] + getPlaneTightRowLengthBytes(p);
   }
+  mData = mPlaneData[0];
+  mRowLengthBytes = mPlaneRowLengthBytes[0];
 
   return true;
 }
@@ -316,6 +495,9 @@ unsigned int Image::getBytesPerPixel() const
     case eDepth16S:
       lBytesDepth = 2*mNbChannels;
       break;
+    case eDepth16F:
+      lBytesDepth = 2*mNbChannels;
+      break;
     case eDepth32S:
       lBytesDepth = 4*mNbChannels;
       break;
@@ -334,13 +516,57 @@ unsigned int Image::getBytesPerPixel() const
 
 /*! \todo
 */
+unsigned int Image::getPlaneWidth(unsigned int inPlane) const
+{
+  if(inPlane>=mNbPlanes)
+    return 0;
+  if(inPlane>0 && (mModel==eModelI420 || mModel==eModelNV12))
+    return (mWidth+1)/2;
+  return mWidth;
+}
+
+/*! \todo
+*/
+unsigned int Image::getPlaneHeight(unsigned int inPlane) const
+{
+  if(inPlane>=mNbPlanes)
+    return 0;
+  if(inPlane>0 && (mModel==eModelI420 || mModel==eModelNV12))
+    return (mHeight+1)/2;
+  return mHeight;
+}
+
+/*! \todo
+*/
+unsigned int Image::getPlaneNbChannels(unsigned int inPlane) const
+{
+  if(inPlane>=mNbPlanes)
+    return 0;
+  if(inPlane==1 && mModel==eModelNV12)
+    return 2;
+  return mNbChannels;
+}
+
+/*! \todo
+*/
+unsigned int Image::getPlaneTightRowLengthBytes(unsigned int inPlane) const
+{
+  if(mNbChannels==eChannel0)
+    return 0;
+  return getPlaneWidth(inPlane)*getPlaneNbChannels(inPlane)*(getBytesPerPixel()/mNbChannels);
+}
+
+/*! For planar models, this is the number of channels of each plane (the NV12 chroma plane excepted).
+*/
 Image::Channel Image::getModelNbChannels(Model inModel) const
 {
-  if(mModel==eModelGray || mModel==eModelBayerBG || mModel==eModelBayerGB || mModel==eModelBayerRG || mModel==eModelBayerGR || inModel==eModelBGR555 || mModel==eModelBGR565)
+  if(inModel==eModelGray || inModel==eModelBayerBG || inModel==eModelBayerGB || inModel==eModelBayerRG || inModel==eModelBayerGR || inModel==eModelBGR555 || inModel==eModelBGR565)
     return eChannel1;
-  else if(inModel==eModelRGB || mModel==eModelBGR || mModel==eModelYCrCb || mModel==eModelHSV || mModel==eModelHLS || mModel==eModelLab || mModel==eModelLuv  || mModel==eModelXYZ)
+  else if(inModel==eModelI420 || inModel==eModelNV12 || inModel==eModelPlanarRGB)
+    return eChannel1;
+  else if(inModel==eModelRGB || inModel==eModelBGR || inModel==eModelYCrCb || inModel==eModelHSV || inModel==eModelHLS || inModel==eModelLab || inModel==eModelLuv  || inModel==eModelXYZ)
     return eChannel3;
-  else if(inModel==eModelRGBA || mModel==eModelBGRA)
+  else if(inModel==eModelRGBA || inModel==eModelBGRA)
     return eChannel4;
   else
     return eChannel0;
@@ -350,27 +576,31 @@ Image::Channel Image::getModelNbChannels(Model inModel) const
 */
 unsigned int Image::getModelNbComponents(Model inModel) const
 {
-  if(mModel==eModelGray || mModel==eModelBayerBG || mModel==eModelBayerGB || mModel==eModelBayerRG || mModel==eModelBayerGR)
+  if(inModel==eModelGray || inModel==eModelBayerBG || inModel==eModelBayerGB || inModel==eModelBayerRG || inModel==eModelBayerGR)
     return 1;
-  else if(inModel==eModelRGB || mModel==eModelBGR || mModel==eModelYCrCb || mModel==eModelHSV || mModel==eModelHLS || mModel==eModelLab || mModel==eModelLuv  || mModel==eModelXYZ || inModel==eModelBGR555 || mModel==eModelBGR565)
+  else if(inModel==eModelRGB || inModel==eModelBGR || inModel==eModelYCrCb || inModel==eModelHSV || inModel==eModelHLS || inModel==eModelLab || inModel==eModelLuv  || inModel==eModelXYZ || inModel==eModelBGR555 || inModel==eModelBGR565)
+    return 3;
+  else if(inModel==eModelI420 || inModel==eModelNV12 || inModel==eModelPlanarRGB)
     return 3;
-  else if(inModel==eModelRGBA || mModel==eModelBGRA)
+  else if(inModel==eModelRGBA || inModel==eModelBGRA)
     return 4;
   else
     return 0;
 }
 
-/*! \todo
+/*! For planar models, this is the number of bytes per pixel of the first plane.
 */
 unsigned int Image::getModelBytesPerPixel(Model inModel) const
 {
-  if(mModel==eModelGray || mModel==eModelBayerBG || mModel==eModelBayerGB || mModel==eModelBayerRG || mModel==eModelBayerGR)
+  if(inModel==eModelGray || inModel==eModelBayerBG || inModel==eModelBayerGB || inModel==eModelBayerRG || inModel==eModelBayerGR)
+    return 1;
+  else if(inModel==eModelI420 || inModel==eModelNV12 || inModel==eModelPlanarRGB)
     return 1;
-  else if(inModel==eModelRGB || mModel==eModelBGR || mModel==eModelYCrCb || mModel==eModelHSV || mModel==eModelHLS || mModel==eModelLab || mModel==eModelLuv  || mModel==eModelXYZ)
+  else if(inModel==eModelRGB || inModel==eModelBGR || inModel==eModelYCrCb || inModel==eModelHSV || inModel==eModelHLS || inModel==eModelLab || inModel==eModelLuv  || inModel==eModelXYZ)
     return 3;
-  else if(inModel==eModelRGBA || mModel==eModelBGRA)
+  else if(inModel==eModelRGBA || inModel==eModelBGRA)
     return 4;
-  else if(inModel==eModelBGR555 || mModel==eModelBGR565)
+  else if(inModel==eModelBGR555 || inModel==eModelBGR565)
     return 2;
   else
     return 0;
@@ -380,14 +610,28 @@ unsigned int Image::getModelBytesPerPixel(Model inModel) const
 */
 Image::Depth Image::getModelDepth(Model inModel) const
 {
-  if(mModel<=eModelUndefined || mModel>=eModelInvalid)
+  if(inModel<=eModelUndefined || inModel>=eModelInvalid)
     return eDepthUndefined;
-  else if(inModel==eModelBGR555 || mModel==eModelBGR565)
+  else if(inModel==eModelBGR555 || inModel==eModelBGR565)
     return eDepth16U;
   else
     return eDepth8U;
 }
 
+/*! \todo
+*/
+unsigned int Image::getModelNbPlanes(Model inModel) const
+{
+  if(inModel<=eModelUndefined || inModel>=eModelInvalid)
+    return 0;
+  else if(inModel==eModelI420 || inModel==eModelPlanarRGB)
+    return 3;
+  else if(inModel==eModelNV12)
+    return 2;
+  else
+    return 1;
+}
+
 /*! \todo
 */
 void Image::operator=(char* inImage)
@@ -402,7 +646,7 @@ void Image::operator=(char* inImage)
     {
       ::memcpy(inImage, mData, mSizeBytes);
     }
-    catch(std::runtime_error inException)
+    catch(const std::runtime_error& inException)
     {
       std::cerr << "VIPERS ERROR: Image::operator= : " << inException.what() << std::endl;
     }
@@ -427,7 +671,7 @@ void Image::operator=(short* inImage)
     {
       ::memcpy(reinterpret_cast<char*>(inImage), mData, mSizeBytes);
     }
-    catch(std::runtime_error inException)
+    catch(const std::runtime_error& inException)
     {
       std::cerr << "VIPERS ERROR: Image::operator= : " << inException.what() << std::endl;
     }
@@ -452,7 +696,7 @@ void Image::operator=(int* inImage)
     {
       ::memcpy(reinterpret_cast<char*>(inImage), mData, mSizeBytes);
     }
-    catch(std::runtime_error inException)
+    catch(const std::runtime_error& inException)
     {
       std::cerr << "VIPERS ERROR: Image::operator= : " << inException.what() << std::endl;
     }
@@ -477,7 +721,7 @@ void Image::operator=(unsigned char* inImage)
     {
       ::memcpy(reinterpret_cast<char*>(inImage), mData, mSizeBytes);
     }
-    catch(std::runtime_error inException)
+    catch(const std::runtime_error& inException)
     {
       std::cerr << "VIPERS ERROR: Image::operator= : " << inException.what() << std::endl;
     }
@@ -502,7 +746,7 @@ void Image::operator=(unsigned short* inImage)
     {
       ::memcpy(reinterpret_cast<char*>(inImage), mData, mSizeBytes);
     }
-    catch(std::runtime_error inException)
+    catch(const std::runtime_error& inException)
     {
       std::cerr << "VIPERS ERROR: Image::operator= : " << inException.what() << std::endl;
     }
@@ -527,7 +771,7 @@ void Image::operator=(unsigned int* inImage)
     {
       ::memcpy(reinterpret_cast<char*>(inImage), mData, mSizeBytes);
     }
-    catch(std::runtime_error inException)
+    catch(const std::runtime_error& inException)
     {
       std::cerr << "VIPERS ERROR: Image::operator= : " << inException.what() << std::endl;
     }
@@ -552,7 +796,7 @@ void Image::operator=(float* inImage)
     {
       ::memcpy(reinterpret_cast<char*>(inImage), mData, mSizeBytes);
     }
-    catch(std::runtime_error inException)
+    catch(const std::runtime_error& inException)
     {
       std::cerr << "VIPERS ERROR: Image::operator= : " << inException.what() << std::endl;
     }
@@ -577,7 +821,7 @@ void Image::operator=(double* inImage)
     {
       ::memcpy(reinterpret_cast<char*>(inImage), mData, mSizeBytes);
     }
-    catch(std::runtime_error inException)
+    catch(const std::runtime_error& inException)
     {
       std::cerr << "VIPERS ERROR: Image::operator= : " << inException.what() << std::endl;
     }
@@ -34,6 +34,8 @@
 #ifndef VIPERS_IMAGE_HPP
 #define VIPERS_IMAGE_HPP
 
+#include "FrameMetadata.hpp"
+
 namespace VIPERS
 {
 
@@ -57,7 +59,8 @@ namespace VIPERS
         eDepth32S, //!> 32 bits signed
         eDepth32F, //!> 32 bits float
         eDepth64F,  //!> 64 bits float
-        eDepthInvalid = eDepth64F + 1 //!< Invalid value for this enumeration
+        eDepth16F,  //!> 16 bits float (IEEE 754 half precision, see ImageConversion.hpp for conversions)
+        eDepthInvalid = eDepth16F + 1 //!< Invalid value for this enumeration
       };
 
       //! Image channel
@@ -91,9 +94,15 @@ namespace VIPERS
         eModelBayerGB,   //!< Bayer Pattern Green Blue
         eModelBayerRG,   //!< Bayer Pattern Red Green
         eModelBayerGR,   //!< Bayer Pattern Green Red
-        eModelInvalid = eModelBayerGR + 1 //!< Invalid value for this enumeration
+        eModelI420,      //!< Planar YUV 4:2:0 (Y plane, then U and V planes subsampled by 2)
+        eModelNV12,      //!< Semi-planar YUV 4:2:0 (Y plane, then interleaved UV plane subsampled by 2)
+        eModelPlanarRGB, //!< Planar Red Green Blue (R, G and B planes)
+        eModelInvalid = eModelPlanarRGB + 1 //!< Invalid value for this enumeration
       };
 
+      //! Maximum number of planes of an image
+      enum {eMaxNbPlanes = 3};
+
       //! Image origin
       enum Origin
       {
@@ -122,6 +131,12 @@ namespace VIPERS
       bool create(unsigned int inWidth, unsigned int inHeight, Depth inDepth, Channel inNbChannels, bool inManaged = true, char* inData = 0);
       //! Create image with specified size and color model
       bool create(unsigned int inWidth, unsigned int inHeight, Model inModel, bool inManaged = true, char* inData = 0);
+      //! Create image with specified attributes over data with the given row length (stride) in bytes
+      bool create(unsigned int inWidth, unsigned int inHeight, Depth inDepth, Channel inNbChannels, bool inManaged, char* inData, unsigned int inRowLengthBytes);
+      //! Create an unmanaged planar image over planes with their own row length (stride) in bytes
+      bool createPlanar(unsigned int inWidth, unsigned int inHeight, Model inModel, char* const* inPlaneData, const unsigned int* inPlaneRowLengthBytes);
+      //! Create a view (no data copy) on a region of a parent image
+      bool createView(const Image& inParent, unsigned int inX, unsigned int inY, unsigned int inWidth, unsigned int inHeight);
 
       //! Set image origin
       inline void setOrigin(Origin inOrigin) {mOrigin = inOrigin;}
@@ -142,11 +157,40 @@ namespace VIPERS
       inline Model getModel() const {return mModel;}
       //! Get image size in bytes
       inline unsigned int getSizeBytes() const {return mSizeBytes;}
-      //! Get image row length in bytes
+      //! Get image row length in bytes (stride between two consecutive rows)
       inline unsigned int getRowLengthBytes() const {return mRowLengthBytes;}
-      //! Get bytes per pixel
+      //! Get pointer to the first pixel of a row
+      inline char* getRow(unsigned int inRow) const {return mData + inRow*mRowLengthBytes;}
+      //! Check if rows are stored without padding between them
+      inline bool isContiguous() const {return mRowLengthBytes==mWidth*getBytesPerPixel();}
+      //! Check if image is a view on another image data
+      inline bool isView() const {return mParent!=0;}
+      //! Get parent image of a view (NULL if image is not a view)
+      inline const Image* getParent() const {return mParent;}
+      //! Get horizontal offset of a view in its parent image
+      inline unsigned int getViewX() const {return mViewX;}
+      //! Get vertical offset of a view in its parent image
+      inline unsigned int getViewY() const {return mViewY;}
+      //! Get bytes per pixel (of the first plane for planar images)
       unsigned int getBytesPerPixel() const;
 
+      //! Check if image is stored in more than one plane
+      inline bool isPlanar() const {return mNbPlanes>1;}
+      //! Get number of planes
+      inline unsigned int getNbPlanes() const {return mNbPlanes;}
+      //! Get pointer to the data of a plane (plane 0 is the same as getData())
+      inline char* getPlane(unsigned int inPlane) const {return (inPlane==0) ? mData : ((inPlane<mNbPlanes) ? mPlaneData[inPlane] : 0);}
+      //! Get row length in bytes of a plane
+      inline unsigned int getPlaneRowLengthBytes(unsigned int inPlane) const {return (inPlane==0) ? mRowLengthBytes : ((inPlane<mNbPlanes) ? mPlaneRowLengthBytes[inPlane] : 0);}
+      //! Get pointer to the first pixel of a row of a plane
+      inline char* getPlaneRow(unsigned int inPlane, unsigned int inRow) const {return getPlane(inPlane) + inRow*getPlaneRowLengthBytes(inPlane);}
+      //! Get width of a plane
+      unsigned int getPlaneWidth(unsigned int inPlane) const;
+      //! Get height of a plane
+      unsigned int getPlaneHeight(unsigned int inPlane) const;
+      //! Get number of interleaved channels of a plane
+      unsigned int getPlaneNbChannels(unsigned int inPlane) const;
+
       //! Get model number of channels
       Channel getModelNbChannels(Model inModel) const;
       //! Get model number of components
@@ -155,6 +199,8 @@ namespace VIPERS
       unsigned int getModelBytesPerPixel(Model inModel) const;
       //! Get model depth
       Depth getModelDepth(Model inModel) const;
+      //! Get model number of planes
+      unsigned int getModelNbPlanes(Model inModel) const;
 
       //! Check if image data is managed by this instance
       inline bool isManaged() const {return mManaged;}
@@ -164,6 +210,15 @@ namespace VIPERS
       //! Get pointer to image data
       inline char* getData() const {return mData;}
 
+      //! Get frame metadata
+      inline const FrameMetadata& getMetadata() const {return mMetadata;}
+      //! Get frame metadata
+      inline FrameMetadata& getMetadata() {return mMetadata;}
+      //! Set frame metadata
+      inline void setMetadata(const FrameMetadata& inMetadata) {mMetadata = inMetadata;}
+      //! Copy frame metadata of the image this one was computed from, and increment the generation counter of this image
+      inline void propagateMetadata(const Image& inImage) {mMetadata.propagate(inImage.mMetadata); mMetadata.incrementGeneration();}
+
       //! Set image data pointer (no effect if image is managed)
       void operator=(char* inImage);
       //! Set image data pointer (no effect if image is managed)
@@ -200,6 +255,13 @@ namespace VIPERS
 
     private:
 
+      //! Deep copy of image data, removing row padding
+      void copyData(const Image& inImage);
+      //! Allocate (managed) or map (unmanaged) the planes of a planar image over contiguous data
+      bool createPlanes(char* inData);
+      //! Get row length in bytes of a plane without padding
+      unsigned int getPlaneTightRowLengthBytes(unsigned int inPlane) const;
+
       bool mManaged; //!< Is the image data is managed by this instance
 
       char* mData; //!< Pointer to image data
@@ -207,8 +269,18 @@ namespace VIPERS
       unsigned int mWidth; //!< Image width
       unsigned int mHeight; //!< Image height
 
-      unsigned int mRowLengthBytes; //!< Length of a row in bytes
-      unsigned int mSizeBytes; //!< Image size in bytes
+      unsigned int mRowLengthBytes; //!< Length of a row in bytes, including padding
+      unsigned int mSizeBytes; //!< Image size in bytes, from first pixel to last pixel
+
+      unsigned int mNbPlanes; //!< Number of planes
+      char* mPlaneData[eMaxNbPlanes]; //!< Pointer to the data of each plane (plane 0 is always mData)
+      unsigned int mPlaneRowLengthBytes[eMaxNbPlanes]; //!< Length of a row of each plane in bytes (plane 0 is always mRowLengthBytes)
+
+      FrameMetadata mMetadata; //!< Frame metadata
+
+      const Image* mParent; //!< Parent image of a view (NULL if not a view)
+      unsigned int mViewX; //!< Horizontal offset of a view in its parent
+      unsigned int mViewY; //!< Vertical offset of a view in its parent
 
       Channel mNbChannels; //!< Number of channels
       Depth mDepth; //!< Image depth
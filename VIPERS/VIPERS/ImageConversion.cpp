@@ -0,0 +1,490 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+
+ /*!
+ * \file VIPERS/ImageConversion.cpp
+ * \brief Image conversion functions definition.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ *
+ * Luma and chroma use the full range BT.601 (JPEG) equations, with the same 14 bits fixed-point
+ * weights as OpenCV, so that the Y plane of a YUV image is identical to a gray scale conversion.
+ */
+
+#include "ImageConversion.hpp"
+
+#include <cstring>
+
+#if defined(__F16C__) && defined(__AVX__)
+  #include <immintrin.h>
+  #define VIPERS_CONVERSION_F16C
+#endif
+
+using namespace VIPERS;
+
+#define VIPERS_CONVERSION_SHIFT 14
+#define VIPERS_CONVERSION_ROUND (1 << (VIPERS_CONVERSION_SHIFT-1))
+
+// RGB to YCbCr weights
+#define VIPERS_CONVERSION_R2Y 4899
+#define VIPERS_CONVERSION_G2Y 9617
+#define VIPERS_CONVERSION_B2Y 1868
+#define VIPERS_CONVERSION_B2CB 9241
+#define VIPERS_CONVERSION_R2CR 11682
+
+// YCbCr to RGB weights
+#define VIPERS_CONVERSION_CR2R 22987
+#define VIPERS_CONVERSION_CR2G 11698
+#define VIPERS_CONVERSION_CB2G 5636
+#define VIPERS_CONVERSION_CB2B 29049
+
+/*! \todo
+*/
+static inline unsigned char saturate(int inValue)
+{
+  return static_cast<unsigned char>(inValue<0 ? 0 : (inValue>255 ? 255 : inValue));
+}
+
+/*! Get byte index of red, green and blue components and number of bytes per pixel of an interleaved model.
+*/
+static bool getInterleavedLayout(Image::Model inModel, unsigned int& outR, unsigned int& outG, unsigned int& outB, unsigned int& outBytesPerPixel)
+{
+  switch(inModel)
+  {
+    case Image::eModelRGB:
+      outR = 0; outG = 1; outB = 2; outBytesPerPixel = 3;
+      return true;
+    case Image::eModelBGR:
+      outR = 2; outG = 1; outB = 0; outBytesPerPixel = 3;
+      return true;
+    case Image::eModelRGBA:
+      outR = 0; outG = 1; outB = 2; outBytesPerPixel = 4;
+      return true;
+    case Image::eModelBGRA:
+      outR = 2; outG = 1; outB = 0; outBytesPerPixel = 4;
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*! \todo
+*/
+static inline int computeY(int inR, int inG, int inB)
+{
+  return (inR*VIPERS_CONVERSION_R2Y + inG*VIPERS_CONVERSION_G2Y + inB*VIPERS_CONVERSION_B2Y + VIPERS_CONVERSION_ROUND) >> VIPERS_CONVERSION_SHIFT;
+}
+
+/*! Convert interleaved RGB (any component order) to a gray scale image.
+*/
+static void convertInterleavedToGray(const Image& inImage, Image& ioOutImage, unsigned int inR, unsigned int inG, unsigned int inB, unsigned int inBytesPerPixel)
+{
+  unsigned int lWidth = inImage.getWidth();
+  for(int y=0; y<inImage.getHeight(); y++)
+  {
+    const unsigned char* lSrc = reinterpret_cast<const unsigned char*>(inImage.getRow(y));
+    unsigned char* lDst = reinterpret_cast<unsigned char*>(ioOutImage.getRow(y));
+    for(unsigned int x=0; x<lWidth; x++, lSrc+=inBytesPerPixel)
+      lDst[x] = static_cast<unsigned char>(computeY(lSrc[inR], lSrc[inG], lSrc[inB]));
+  }
+}
+
+/*! Convert interleaved RGB (any component order) to I420 or NV12.  Chroma is averaged over each 2x2 block.
+*/
+static void convertInterleavedToYUV420(const Image& inImage, Image& ioOutImage, unsigned int inR, unsigned int inG, unsigned int inB, unsigned int inBytesPerPixel)
+{
+  unsigned int lWidth = inImage.getWidth();
+  unsigned int lHeight = inImage.getHeight();
+  bool lNV12 = (ioOutImage.getModel()==Image::eModelNV12);
+
+  convertInterleavedToGray(inImage, ioOutImage, inR, inG, inB, inBytesPerPixel);
+
+  for(unsigned int cy=0; cy<ioOutImage.getPlaneHeight(1); cy++)
+  {
+    unsigned int lY0 = 2*cy;
+    unsigned int lY1 = (lY0+1<lHeight) ? lY0+1 : lY0;
+    const unsigned char* lRow0 = reinterpret_cast<const unsigned char*>(inImage.getRow(lY0));
+    const unsigned char* lRow1 = reinterpret_cast<const unsigned char*>(inImage.getRow(lY1));
+    const unsigned char* lLuma0 = reinterpret_cast<const unsigned char*>(ioOutImage.getPlaneRow(0, lY0));
+    const unsigned char* lLuma1 = reinterpret_cast<const unsigned char*>(ioOutImage.getPlaneRow(0, lY1));
+    unsigned char* lU = reinterpret_cast<unsigned char*>(ioOutImage.getPlaneRow(1, cy));
+    unsigned char* lV = lNV12 ? lU+1 : reinterpret_cast<unsigned char*>(ioOutImage.getPlaneRow(2, cy));
+    unsigned int lStep = lNV12 ? 2 : 1;
+
+    for(unsigned int cx=0; cx<ioOutImage.getPlaneWidth(1); cx++)
+    {
+      unsigned int lX0 = 2*cx;
+      unsigned int lX1 = (lX0+1<lWidth) ? lX0+1 : lX0;
+      int lSumR = lRow0[lX0*inBytesPerPixel+inR] + lRow0[lX1*inBytesPerPixel+inR] + lRow1[lX0*inBytesPerPixel+inR] + lRow1[lX1*inBytesPerPixel+inR];
+      int lSumB = lRow0[lX0*inBytesPerPixel+inB] + lRow0[lX1*inBytesPerPixel+inB] + lRow1[lX0*inBytesPerPixel+inB] + lRow1[lX1*inBytesPerPixel+inB];
+      int lSumY = lLuma0[lX0] + lLuma0[lX1] + lLuma1[lX0] + lLuma1[lX1];
+      // Average of the 4 pixels, keeping 2 more bits of precision until the final rounding
+      lU[cx*lStep] = saturate((((lSumB-lSumY)*VIPERS_CONVERSION_B2CB + (VIPERS_CONVERSION_ROUND << 2)) >> (VIPERS_CONVERSION_SHIFT+2)) + 128);
+      lV[cx*lStep] = saturate((((lSumR-lSumY)*VIPERS_CONVERSION_R2CR + (VIPERS_CONVERSION_ROUND << 2)) >> (VIPERS_CONVERSION_SHIFT+2)) + 128);
+    }
+  }
+}
+
+/*! Convert I420 or NV12 to interleaved RGB (any component order).  Alpha, if any, is set to 255.
+*/
+static void convertYUV420ToInterleaved(const Image& inImage, Image& ioOutImage, unsigned int inR, unsigned int inG, unsigned int inB, unsigned int inBytesPerPixel)
+{
+  unsigned int lWidth = inImage.getWidth();
+  bool lNV12 = (inImage.getModel()==Image::eModelNV12);
+  unsigned int lStep = lNV12 ? 2 : 1;
+
+  for(int y=0; y<inImage.getHeight(); y++)
+  {
+    const unsigned char* lLuma = reinterpret_cast<const unsigned char*>(inImage.getPlaneRow(0, y));
+    const unsigned char* lU = reinterpret_cast<const unsigned char*>(inImage.getPlaneRow(1, y/2));
+    const unsigned char* lV = lNV12 ? lU+1 : reinterpret_cast<const unsigned char*>(inImage.getPlaneRow(2, y/2));
+    unsigned char* lDst = reinterpret_cast<unsigned char*>(ioOutImage.getRow(y));
+
+    for(unsigned int x=0; x<lWidth; x++, lDst+=inBytesPerPixel)
+    {
+      int lY = lLuma[x] << VIPERS_CONVERSION_SHIFT;
+      int lCb = lU[(x/2)*lStep] - 128;
+      int lCr = lV[(x/2)*lStep] - 128;
+      lDst[inR] = saturate((lY + lCr*VIPERS_CONVERSION_CR2R + VIPERS_CONVERSION_ROUND) >> VIPERS_CONVERSION_SHIFT);
+      lDst[inG] = saturate((lY - lCr*VIPERS_CONVERSION_CR2G - lCb*VIPERS_CONVERSION_CB2G + VIPERS_CONVERSION_ROUND) >> VIPERS_CONVERSION_SHIFT);
+      lDst[inB] = saturate((lY + lCb*VIPERS_CONVERSION_CB2B + VIPERS_CONVERSION_ROUND) >> VIPERS_CONVERSION_SHIFT);
+      if(inBytesPerPixel==4)
+        lDst[3] = 255;
+    }
+  }
+}
+
+/*! Convert interleaved RGB (any component order) to planar RGB, or the reverse when \c inToPlanar is false.
+*/
+static void convertPlanarRGB(const Image& inInterleaved, const Image& inPlanar, bool inToPlanar, unsigned int inR, unsigned int inG, unsigned int inB, unsigned int inBytesPerPixel)
+{
+  unsigned int lWidth = inInterleaved.getWidth();
+  for(int y=0; y<inInterleaved.getHeight(); y++)
+  {
+    unsigned char* lPixel = reinterpret_cast<unsigned char*>(inInterleaved.getRow(y));
+    unsigned char* lPlaneR = reinterpret_cast<unsigned char*>(inPlanar.getPlaneRow(0, y));
+    unsigned char* lPlaneG = reinterpret_cast<unsigned char*>(inPlanar.getPlaneRow(1, y));
+    unsigned char* lPlaneB = reinterpret_cast<unsigned char*>(inPlanar.getPlaneRow(2, y));
+    for(unsigned int x=0; x<lWidth; x++, lPixel+=inBytesPerPixel)
+    {
+      if(inToPlanar)
+      {
+        lPlaneR[x] = lPixel[inR];
+        lPlaneG[x] = lPixel[inG];
+        lPlaneB[x] = lPixel[inB];
+      }
+      else
+      {
+        lPixel[inR] = lPlaneR[x];
+        lPixel[inG] = lPlaneG[x];
+        lPixel[inB] = lPlaneB[x];
+        if(inBytesPerPixel==4)
+          lPixel[3] = 255;
+      }
+    }
+  }
+}
+
+/*! \todo
+*/
+static void copyPlanes(const Image& inImage, Image& ioOutImage, unsigned int inNbPlanes)
+{
+  for(unsigned int p=0; p<inNbPlanes; p++)
+  {
+    unsigned int lRowLength = inImage.getPlaneWidth(p)*inImage.getPlaneNbChannels(p)*(inImage.getBytesPerPixel()/inImage.getNbChannels());
+    for(unsigned int y=0; y<inImage.getPlaneHeight(p); y++)
+      ::memcpy(ioOutImage.getPlaneRow(p, y), inImage.getPlaneRow(p, y), lRowLength);
+  }
+}
+
+/*! \todo
+*/
+bool VIPERS::isConversionSupported(const Image& inImage, Image::Model inModel)
+{
+  unsigned int lR, lG, lB, lBytesPerPixel;
+  Image::Model lModel = inImage.getModel();
+
+  if(inImage.getDepth()!=Image::eDepth8U)
+    return false;
+  if(lModel==inModel)
+    return true;
+
+  bool lInInterleaved = getInterleavedLayout(lModel, lR, lG, lB, lBytesPerPixel);
+  bool lOutInterleaved = getInterleavedLayout(inModel, lR, lG, lB, lBytesPerPixel);
+  bool lInYUV = (lModel==Image::eModelI420 || lModel==Image::eModelNV12);
+  bool lOutYUV = (inModel==Image::eModelI420 || inModel==Image::eModelNV12);
+
+  if(lInInterleaved)
+    return lOutYUV || inModel==Image::eModelPlanarRGB || inModel==Image::eModelGray;
+  if(lInYUV)
+    return lOutInterleaved || lOutYUV || inModel==Image::eModelGray;
+  if(lModel==Image::eModelPlanarRGB)
+    return lOutInterleaved;
+  return false;
+}
+
+/*! \c ioOutImage must already be created (managed or not) with the destination model and the size of \c inImage.
+    Both images may be views or have padded rows.  Supported conversions are between interleaved RGB models
+    (RGB, BGR, RGBA, BGRA) and the planar models (I420, NV12, planar RGB), from interleaved RGB or YUV to gray scale,
+    between I420 and NV12, and between images of the same model.  Returns false if the conversion is not supported.
+*/
+bool VIPERS::convertImage(const Image& inImage, Image& ioOutImage)
+{
+  unsigned int lR, lG, lB, lBytesPerPixel;
+  Image::Model lInModel = inImage.getModel();
+  Image::Model lOutModel = ioOutImage.getModel();
+
+  if(!inImage.isValid() || !ioOutImage.isValid() || inImage.getWidth()!=ioOutImage.getWidth() || inImage.getHeight()!=ioOutImage.getHeight())
+    return false;
+  if(!isConversionSupported(inImage, lOutModel))
+    return false;
+
+  if(lInModel==lOutModel)
+  {
+    if(inImage.getBytesPerPixel()!=ioOutImage.getBytesPerPixel() || inImage.getNbPlanes()!=ioOutImage.getNbPlanes())
+      return false;
+    copyPlanes(inImage, ioOutImage, inImage.getNbPlanes());
+    return true;
+  }
+
+  if(getInterleavedLayout(lInModel, lR, lG, lB, lBytesPerPixel))
+  {
+    if(lOutModel==Image::eModelGray)
+      convertInterleavedToGray(inImage, ioOutImage, lR, lG, lB, lBytesPerPixel);
+    else if(lOutModel==Image::eModelPlanarRGB)
+      convertPlanarRGB(inImage, ioOutImage, true, lR, lG, lB, lBytesPerPixel);
+    else
+      convertInterleavedToYUV420(inImage, ioOutImage, lR, lG, lB, lBytesPerPixel);
+    return true;
+  }
+
+  if(lInModel==Image::eModelPlanarRGB)
+  {
+    getInterleavedLayout(lOutModel, lR, lG, lB, lBytesPerPixel);
+    convertPlanarRGB(ioOutImage, inImage, false, lR, lG, lB, lBytesPerPixel);
+    return true;
+  }
+
+  // YUV 4:2:0 input
+  if(lOutModel==Image::eModelGray)
+  {
+    copyPlanes(inImage, ioOutImage, 1);
+    return true;
+  }
+  if(getInterleavedLayout(lOutModel, lR, lG, lB, lBytesPerPixel))
+  {
+    convertYUV420ToInterleaved(inImage, ioOutImage, lR, lG, lB, lBytesPerPixel);
+    return true;
+  }
+
+  // I420 <-> NV12: same luma, chroma is (de)interleaved
+  copyPlanes(inImage, ioOutImage, 1);
+  bool lToNV12 = (lOutModel==Image::eModelNV12);
+  for(unsigned int y=0; y<inImage.getPlaneHeight(1); y++)
+  {
+    const Image& lPlanarImage = lToNV12 ? inImage : ioOutImage;
+    const Image& lPackedImage = lToNV12 ? ioOutImage : inImage;
+    unsigned char* lU = reinterpret_cast<unsigned char*>(lPlanarImage.getPlaneRow(1, y));
+    unsigned char* lV = reinterpret_cast<unsigned char*>(lPlanarImage.getPlaneRow(2, y));
+    unsigned char* lUV = reinterpret_cast<unsigned char*>(lPackedImage.getPlaneRow(1, y));
+    for(unsigned int x=0; x<inImage.getPlaneWidth(1); x++)
+    {
+      if(lToNV12)
+      {
+        lUV[2*x] = lU[x];
+        lUV[2*x+1] = lV[x];
+      }
+      else
+      {
+        lU[x] = lUV[2*x];
+        lV[x] = lUV[2*x+1];
+      }
+    }
+  }
+
+  return true;
+}
+
+/*! Values too large for half precision become infinity, and values too small become (signed) zero or denormals.
+*/
+unsigned short VIPERS::convertFloatToHalf(float inValue)
+{
+  unsigned int lBits;
+  ::memcpy(&lBits, &inValue, sizeof(lBits));
+
+  unsigned int lSign = (lBits >> 16) & 0x8000;
+  unsigned int lExponent = (lBits >> 23) & 0xff;
+  unsigned int lMantissa = lBits & 0x7fffff;
+
+  // Infinity and NaN (NaN stays a quiet NaN)
+  if(lExponent==0xff)
+    return static_cast<unsigned short>(lSign | 0x7c00 | (lMantissa ? 0x200 : 0));
+
+  int lHalfExponent = static_cast<int>(lExponent) - 127 + 15;
+
+  // Overflow
+  if(lHalfExponent>=0x1f)
+    return static_cast<unsigned short>(lSign | 0x7c00);
+
+  // Denormal or underflow
+  if(lHalfExponent<=0)
+  {
+    if(lHalfExponent<-10)
+      return static_cast<unsigned short>(lSign);
+    lMantissa |= 0x800000;
+    unsigned int lShift = 14 - lHalfExponent;
+    unsigned int lHalf = lMantissa >> lShift;
+    unsigned int lRemainder = lMantissa & ((1u << lShift) - 1);
+    unsigned int lMiddle = 1u << (lShift - 1);
+    if(lRemainder>lMiddle || (lRemainder==lMiddle && (lHalf & 1)))
+      lHalf++;
+    return static_cast<unsigned short>(lSign | lHalf);
+  }
+
+  // Normal value; a carry from rounding correctly propagates into the exponent (up to infinity)
+  unsigned int lHalf = (static_cast<unsigned int>(lHalfExponent) << 10) | (lMantissa >> 13);
+  unsigned int lRemainder = lMantissa & 0x1fff;
+  if(lRemainder>0x1000 || (lRemainder==0x1000 && (lHalf & 1)))
+    lHalf++;
+  return static_cast<unsigned short>(lSign | lHalf);
+}
+
+/*! \todo
+*/
+float VIPERS::convertHalfToFloat(unsigned short inValue)
+{
+  unsigned int lSign = (static_cast<unsigned int>(inValue) & 0x8000) << 16;
+  unsigned int lExponent = (inValue >> 10) & 0x1f;
+  unsigned int lMantissa = inValue & 0x3ff;
+  unsigned int lBits;
+
+  if(lExponent==0)
+  {
+    if(lMantissa==0)
+      lBits = lSign;
+    else
+    {
+      // Denormal half, normalized in single precision
+      lExponent = 127 - 15 + 1;
+      while(!(lMantissa & 0x400))
+      {
+        lMantissa <<= 1;
+        lExponent--;
+      }
+      lBits = lSign | (lExponent << 23) | ((lMantissa & 0x3ff) << 13);
+    }
+  }
+  else if(lExponent==0x1f)
+    lBits = lSign | 0x7f800000 | (lMantissa << 13);
+  else
+    lBits = lSign | ((lExponent + 127 - 15) << 23) | (lMantissa << 13);
+
+  float lValue;
+  ::memcpy(&lValue, &lBits, sizeof(lValue));
+  return lValue;
+}
+
+/*! Uses the F16C instructions when the library is compiled for them; results are identical to the scalar conversion.
+*/
+void VIPERS::convertFloatToHalf(const float* inSrc, unsigned short* outDst, unsigned int inCount)
+{
+  unsigned int i = 0;
+#ifdef VIPERS_CONVERSION_F16C
+  for(; i+8<=inCount; i+=8)
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(outDst+i), _mm256_cvtps_ph(_mm256_loadu_ps(inSrc+i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+  for(; i<inCount; i++)
+    outDst[i] = convertFloatToHalf(inSrc[i]);
+}
+
+/*! Uses the F16C instructions when the library is compiled for them; results are identical to the scalar conversion.
+*/
+void VIPERS::convertHalfToFloat(const unsigned short* inSrc, float* outDst, unsigned int inCount)
+{
+  unsigned int i = 0;
+#ifdef VIPERS_CONVERSION_F16C
+  for(; i+8<=inCount; i+=8)
+    _mm256_storeu_ps(outDst+i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inSrc+i))));
+#endif
+  for(; i<inCount; i++)
+    outDst[i] = convertHalfToFloat(inSrc[i]);
+}
+
+/*! Supported conversions are from 32F or 64F to 16F, from 16F to 32F or 64F, and between images of the same depth.
+    64F values are first rounded to single precision.  Returns false if the conversion is not supported.
+*/
+bool VIPERS::convertDepth(const Image& inImage, Image& ioOutImage)
+{
+  Image::Depth lInDepth = inImage.getDepth();
+  Image::Depth lOutDepth = ioOutImage.getDepth();
+
+  if(!inImage.isValid() || !ioOutImage.isValid() || inImage.getWidth()!=ioOutImage.getWidth() || inImage.getHeight()!=ioOutImage.getHeight())
+    return false;
+  if(inImage.getNbChannels()!=ioOutImage.getNbChannels() || inImage.getNbPlanes()!=ioOutImage.getNbPlanes())
+    return false;
+
+  if(lInDepth==lOutDepth)
+  {
+    copyPlanes(inImage, ioOutImage, inImage.getNbPlanes());
+    return true;
+  }
+
+  bool lToHalf = (lOutDepth==Image::eDepth16F && (lInDepth==Image::eDepth32F || lInDepth==Image::eDepth64F));
+  bool lFromHalf = (lInDepth==Image::eDepth16F && (lOutDepth==Image::eDepth32F || lOutDepth==Image::eDepth64F));
+  if(!lToHalf && !lFromHalf)
+    return false;
+
+  for(unsigned int p=0; p<inImage.getNbPlanes(); p++)
+  {
+    unsigned int lCount = inImage.getPlaneWidth(p)*inImage.getPlaneNbChannels(p);
+    for(unsigned int y=0; y<inImage.getPlaneHeight(p); y++)
+    {
+      char* lSrc = inImage.getPlaneRow(p, y);
+      char* lDst = ioOutImage.getPlaneRow(p, y);
+      if(lInDepth==Image::eDepth32F)
+        convertFloatToHalf(reinterpret_cast<const float*>(lSrc), reinterpret_cast<unsigned short*>(lDst), lCount);
+      else if(lOutDepth==Image::eDepth32F)
+        convertHalfToFloat(reinterpret_cast<const unsigned short*>(lSrc), reinterpret_cast<float*>(lDst), lCount);
+      else if(lInDepth==Image::eDepth64F)
+      {
+        const double* lSrcDouble = reinterpret_cast<const double*>(lSrc);
+        unsigned short* lDstHalf = reinterpret_cast<unsigned short*>(lDst);
+        for(unsigned int i=0; i<lCount; i++)
+          lDstHalf[i] = convertFloatToHalf(static_cast<float>(lSrcDouble[i]));
+      }
+      else
+      {
+        const unsigned short* lSrcHalf = reinterpret_cast<const unsigned short*>(lSrc);
+        double* lDstDouble = reinterpret_cast<double*>(lDst);
+        for(unsigned int i=0; i<lCount; i++)
+          lDstDouble[i] = convertHalfToFloat(lSrcHalf[i]);
+      }
+    }
+  }
+
+  return true;
+}
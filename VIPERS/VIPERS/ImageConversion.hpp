@@ -0,0 +1,63 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+
+ /*!
+ * \file VIPERS/ImageConversion.hpp
+ * \brief Image conversion functions header.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#ifndef VIPERS_IMAGE_CONVERSION_HPP
+#define VIPERS_IMAGE_CONVERSION_HPP
+
+#include "Image.hpp"
+
+namespace VIPERS
+{
+
+  //! Check if an image can be converted to a color model with convertImage()
+  bool isConversionSupported(const Image& inImage, Image::Model inModel);
+
+  //! Convert an image to the color model of an already created image of the same size
+  bool convertImage(const Image& inImage, Image& ioOutImage);
+
+  //! Convert a single precision float to half precision (IEEE 754 binary16, rounded to nearest even)
+  unsigned short convertFloatToHalf(float inValue);
+  //! Convert a half precision float (IEEE 754 binary16) to single precision (exact)
+  float convertHalfToFloat(unsigned short inValue);
+  //! Convert an array of single precision floats to half precision
+  void convertFloatToHalf(const float* inSrc, unsigned short* outDst, unsigned int inCount);
+  //! Convert an array of half precision floats to single precision
+  void convertHalfToFloat(const unsigned short* inSrc, float* outDst, unsigned int inCount);
+
+  //! Convert an image to the depth of an already created image with the same size and number of channels
+  bool convertDepth(const Image& inImage, Image& ioOutImage);
+
+}
+
+#endif //VIPERS_IMAGE_CONVERSION_HPP
@@ -35,6 +35,9 @@
 #define VIPERS_IMAGE_UTILS_HPP
 
 #include "Image.hpp"
+#include "ImageConversion.hpp"
+#include "MemoryAccounting.hpp"
+#include "ModuleSlot.hpp"
 
 #ifdef VIPERS_UTILS_OPENCV
   #include <cv.h>
@@ -119,11 +122,22 @@ namespace VIPERS
     return lDepth;
   }
 
-  //! Copy IplImage to Image object (deep copy)
+  //! Get pointer to the first pixel of an IplImage, taking its region of interest into account
+  inline char* getIplImageROIData(const IplImage* inIplImage)
+  {
+    if(!inIplImage->roi)
+      return inIplImage->imageData;
+    return inIplImage->imageData + inIplImage->roi->yOffset*inIplImage->widthStep + inIplImage->roi->xOffset*inIplImage->nChannels*((inIplImage->depth & 255)/8);
+  }
+
+  //! Copy IplImage (or its region of interest) to Image object (deep copy)
   inline bool copyFromIplImage(const IplImage* inIplImage, Image& outImage)
   {
     if(inIplImage)
-      return outImage.create(inIplImage->width, inIplImage->height, convertDepthFromIpl(inIplImage->depth), static_cast<Image::Channel>(inIplImage->nChannels), true, inIplImage->imageData);
+    {
+      CvSize lSize = cvGetSize(inIplImage);
+      return outImage.create(lSize.width, lSize.height, convertDepthFromIpl(inIplImage->depth), static_cast<Image::Channel>(inIplImage->nChannels), true, getIplImageROIData(inIplImage), inIplImage->widthStep);
+    }
     else
       return false;
   }
@@ -131,28 +145,158 @@ namespace VIPERS
   //! Copy Image to IplImage (deep copy)
   inline bool copyToIplImage(const Image& inImage, IplImage** outIplImage)
   {
-    if(!outIplImage)
+    if(!outIplImage || !inImage.isValid())
       return false;
     *outIplImage = ::cvCreateImage(cvSize(inImage.getWidth(), inImage.getHeight()), convertDepthToIpl(inImage.getDepth()), inImage.getNbChannels());
-    ::memcpy((*outIplImage)->imageData, inImage.getData(), (*outIplImage)->imageSize);
+    unsigned int lRowBytes = inImage.getWidth()*inImage.getBytesPerPixel();
+    for(unsigned int i=0; i<(unsigned int)inImage.getHeight(); i++)
+      ::memcpy((*outIplImage)->imageData + i*(*outIplImage)->widthStep, inImage.getRow(i), lRowBytes);
+    return true;
   }
 
-  //! Set Image from an IplImage (copy data pointer)
+  //! Set Image from an IplImage or its region of interest (copy data pointer, the Image is a view on the IplImage data)
   inline bool setFromIplImage(const IplImage* inIplImage, Image& outImage)
   {
     if(inIplImage)
-      return outImage.create(inIplImage->width, inIplImage->height, convertDepthFromIpl(inIplImage->depth), static_cast<Image::Channel>(inIplImage->nChannels), false, inIplImage->imageData);
+    {
+      CvSize lSize = cvGetSize(inIplImage);
+      return outImage.create(lSize.width, lSize.height, convertDepthFromIpl(inIplImage->depth), static_cast<Image::Channel>(inIplImage->nChannels), false, getIplImageROIData(inIplImage), inIplImage->widthStep);
+    }
     else
       return false;
   }
 
-  //! Set IplImage to an Image (copy data pointer)
+  //! Set IplImage to an Image (copy data pointer, the row length of the Image is used as widthStep, so views are supported; only the first plane of a planar Image is used)
   inline bool setToIplImage(const Image& inImage, IplImage** outIplImage)
   {
     if(!outIplImage)
       return false;
     *outIplImage = ::cvCreateImageHeader(cvSize(inImage.getWidth(), inImage.getHeight()), convertDepthToIpl(inImage.getDepth()), inImage.getNbChannels());
+    (*outIplImage)->widthStep = inImage.getRowLengthBytes();
+    if(inImage.isView() && inImage.getHeight()>0)
+      (*outIplImage)->imageSize = inImage.getRowLengthBytes()*(inImage.getHeight()-1) + inImage.getWidth()*inImage.getBytesPerPixel(); // last row of a view stops at its right edge, within its parent
+    else
+      (*outIplImage)->imageSize = inImage.getRowLengthBytes()*inImage.getHeight();
     (*outIplImage)->imageData = inImage.getData();
+    (*outIplImage)->imageDataOrigin = inImage.getData();
+    (*outIplImage)->origin = (inImage.getOrigin()==Image::eOriginBottomLeft) ? IPL_ORIGIN_BL : IPL_ORIGIN_TL;
+    return true;
+  }
+
+  //! Set IplImage to one plane of an Image (copy data pointer, plane 0 of a YUV image is its luma)
+  inline bool setPlaneToIplImage(const Image& inImage, unsigned int inPlane, IplImage** outIplImage)
+  {
+    if(!outIplImage || inPlane>=inImage.getNbPlanes())
+      return false;
+    *outIplImage = ::cvCreateImageHeader(cvSize(inImage.getPlaneWidth(inPlane), inImage.getPlaneHeight(inPlane)), convertDepthToIpl(inImage.getDepth()), inImage.getPlaneNbChannels(inPlane));
+    (*outIplImage)->widthStep = inImage.getPlaneRowLengthBytes(inPlane);
+    (*outIplImage)->imageSize = inImage.getPlaneRowLengthBytes(inPlane)*inImage.getPlaneHeight(inPlane);
+    (*outIplImage)->imageData = inImage.getPlane(inPlane);
+    (*outIplImage)->imageDataOrigin = inImage.getPlane(inPlane);
+    return true;
+  }
+
+  //! Convert an IplImage (BGR, BGRA or gray scale, as given by OpenCV) to the color model of an already created Image
+  inline bool convertFromIplImage(const IplImage* inIplImage, Image& ioImage)
+  {
+    Image lTmpImage(false);
+    if(!setFromIplImage(inIplImage, lTmpImage))
+      return false;
+    switch(inIplImage->nChannels)
+    {
+      case 1:
+        lTmpImage.setModel(Image::eModelGray);
+        break;
+      case 3:
+        lTmpImage.setModel(Image::eModelBGR);
+        break;
+      case 4:
+        lTmpImage.setModel(Image::eModelBGRA);
+        break;
+      default:
+        return false;
+    }
+    return convertImage(lTmpImage, ioImage);
+  }
+
+  //! Set IplImage header on the parent data of an Image view, with the view as region of interest
+  inline bool setToIplImageROI(const Image& inImage, IplImage** outIplImage)
+  {
+    if(!inImage.isView())
+      return setToIplImage(inImage, outIplImage);
+    if(!setToIplImage(*inImage.getParent(), outIplImage))
+      return false;
+    cvSetImageROI(*outIplImage, cvRect(inImage.getViewX(), inImage.getViewY(), inImage.getWidth(), inImage.getHeight()));
+    return true;
+  }
+
+  //! Create an IplImage (same as cvCreateImage) with its data attributed to the current owner (see MemoryAccounting)
+  inline IplImage* createIplImage(CvSize inSize, int inDepth, int inNbChannels)
+  {
+    IplImage* lIplImage = cvCreateImage(inSize, inDepth, inNbChannels);
+    if(lIplImage)
+      MemoryAccounting::allocate(lIplImage->imageData, lIplImage->imageSize);
+    return lIplImage;
+  }
+
+  //! Clone an IplImage (same as cvCloneImage) with its data attributed to the current owner (see MemoryAccounting)
+  inline IplImage* cloneIplImage(const IplImage* inIplImage)
+  {
+    IplImage* lIplImage = cvCloneImage(inIplImage);
+    if(lIplImage)
+      MemoryAccounting::allocate(lIplImage->imageData, lIplImage->imageSize);
+    return lIplImage;
+  }
+
+  //! Release an IplImage created with createIplImage() or cloneIplImage() (same as cvReleaseImage)
+  inline void releaseIplImage(IplImage** ioIplImage)
+  {
+    if(ioIplImage && *ioIplImage)
+    {
+      // Blocks are recorded by their data, the data of a planned IplImage belongs to the %Kernel
+      if((*ioIplImage)->imageDataOrigin)
+        MemoryAccounting::release((*ioIplImage)->imageData);
+      cvReleaseImage(ioIplImage);
+    }
+  }
+
+  /*! Create an IplImage for an output slot over the buffer planned for it by the %Kernel, or with its own data
+      (see createIplImage()) if no buffer is planned or it is too small.  Both are released with releaseIplImage().
+  */
+  inline IplImage* createPlannedIplImage(ModuleSlot* ioModuleSlot, CvSize inSize, int inDepth, int inNbChannels)
+  {
+    IplImage* lIplImage = cvCreateImageHeader(inSize, inDepth, inNbChannels);
+    char* lData = ioModuleSlot->getPlannedBuffer(lIplImage->imageSize);
+    if(!lData)
+    {
+      cvReleaseImageHeader(&lIplImage);
+      return createIplImage(inSize, inDepth, inNbChannels);
+    }
+    cvSetData(lIplImage, lData, lIplImage->widthStep);
+    // Not owned: cvReleaseImage() only frees imageDataOrigin
+    lIplImage->imageDataOrigin = NULL;
+    return lIplImage;
+  }
+
+  //! Check if an IplImage created with createPlannedIplImage() must be created again because the buffer planned for the output slot changed
+  inline bool isPlannedIplImageStale(ModuleSlot* ioModuleSlot, const IplImage* inIplImage)
+  {
+    char* lData = ioModuleSlot->getPlannedBuffer(inIplImage->imageSize);
+    if(lData)
+      return inIplImage->imageData!=lData;
+    return inIplImage->imageDataOrigin==NULL;
+  }
+
+  //! Set a matrix header on rows [inFirstRow, inEndRow) of an IplImage (clamped to its height), return false if there is no row left
+  inline bool getIplImageRows(const IplImage* inIplImage, CvMat* outRows, unsigned int inFirstRow, unsigned int inEndRow)
+  {
+    unsigned int lHeight = inIplImage->roi ? inIplImage->roi->height : inIplImage->height;
+    if(inEndRow>lHeight)
+      inEndRow = lHeight;
+    if(inFirstRow>=inEndRow)
+      return false;
+    cvGetRows(inIplImage, outRows, inFirstRow, inEndRow);
+    return true;
   }
 
   #endif //VIPERS_UTILS_OPENCV
@@ -37,21 +37,33 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <algorithm>
+#include <iterator>
 
 using namespace VIPERS;
 using namespace std;
 
+//! Number of bytes of all the images of a module chain processed by each strip, so a strip stays in the L2 cache
+#define KERNEL_STRIP_BYTES (128*1024)
+
 /*! \todo
 */
 Kernel::Kernel()
 {
   mKernelStateNotifier = NULL;
+  mOperatorFusion = false;
+  mStripHeight = 0;
+  mModuleMerging = false;
+  mBufferPlanning = false;
+  mInPlaceProcessing = false;
 }
 
 /*! \todo
 */
 Kernel::~Kernel()
 {
+	unmergeModules();
+	releaseBuffers();
 	clearModules();
 	mModulesManager.clear();
 }
@@ -70,6 +82,9 @@ void Kernel::clearModules() throw()
 {
 	ModuleSet::iterator lModuleItr = mModuleSet.begin();
 	string lModuleName;
+
+	unmergeModules();
+	releaseBuffers();
 	for(lModuleItr; lModuleItr!=mModuleSet.end(); lModuleItr++)
 	{
 	  try
@@ -129,6 +144,9 @@ void Kernel::deleteModule(Module* inModule)
 	if(lState==KernelState::eStateStarted || lState==KernelState::eStatePaused)
 		throw(Exception(Exception::eCodeInvalidOperationKernelState, "Cannot delete module while kernel is running").setFrom("Kernel::deleteModule").setFileLine(__FILE__, __LINE__));
 
+	unmergeModules();
+	releaseBuffers();
+
 	try
 	{
 		mModulesManager.deleteModule(inModule);
@@ -216,6 +234,42 @@ unsigned int Kernel::getModuleCount() const throw()
   return mModuleSet.size();
 }
 
+/*! \todo
+*/
+ModuleMemoryUsageMap Kernel::getModuleMemoryUsage() const throw()
+{
+  ModuleMemoryUsageMap lUsageMap;
+  for(ModuleSet::const_iterator lItr = mModuleSet.begin(); lItr!=mModuleSet.end(); lItr++)
+    lUsageMap[*lItr] = (*lItr)->getMemoryUsage();
+  return lUsageMap;
+}
+
+/*! Images of views, aliases, outputs written in place and planned buffers are not owned by their output slot,
+    so they are not reported here: the same bytes would otherwise be counted more than once.
+*/
+SlotMemoryUsageMap Kernel::getSlotMemoryUsage() const throw()
+{
+  SlotMemoryUsageMap lUsageMap;
+  for(ModuleSet::const_iterator lItr = mModuleSet.begin(); lItr!=mModuleSet.end(); lItr++)
+  {
+    const ModuleSlotMap& lOutputSlotMap = (*lItr)->getOutputSlots();
+    for(ModuleSlotMap::const_iterator lSlotItr = lOutputSlotMap.begin(); lSlotItr!=lOutputSlotMap.end(); lSlotItr++)
+    {
+      unsigned long lSizeBytes = lSlotItr->second->getMemoryUsage();
+      if(lSizeBytes>0)
+        lUsageMap[lSlotItr->second] = lSizeBytes;
+    }
+  }
+  return lUsageMap;
+}
+
+/*! \todo
+*/
+MemoryAccounting::Usage Kernel::getTotalMemoryUsage() const throw()
+{
+  return MemoryAccounting::getTotalUsage();
+}
+
 /*! \todo
 */
 KernelState Kernel::getState() const throw()
@@ -479,3 +533,781 @@ SortedLevelModuleMap Kernel::computeModuleLevel()
 
 	return lSortedLevelModuleMap;
 }
+
+/*! A chain starts with a %Module that has a pointwise kernel, and is extended with a %Module that also has a
+    pointwise kernel and is connected to an output slot of the last %Module of the chain.  Every other input of that
+    %Module must come from the chain itself, or from a %Module processed before the first %Module of the chain, since
+    the whole chain is processed when its first %Module would have been.  Each %Module is part of at most one chain,
+    merged modules (see getMergedModules()) are never part of one, and chains with a single %Module are not returned.
+*/
+ModuleChainMap Kernel::computeFusedModuleChains(const SortedLevelModuleMap& inSortedLevelModuleMap) const throw()
+{
+	ModuleChainMap lModuleChainMap;
+	map<const Module*, unsigned int> lModuleOrderMap;
+	ModuleSetConst lFusedModuleSet;
+	SortedLevelModuleMap::const_iterator lSortedLevelModuleMapItr;
+	ModuleSlotMap::const_iterator lOutputSlotMapItr;
+	ModuleSlotMap::const_iterator lInputSlotMapItr;
+	ModuleSlotSet lModuleSlotSet;
+	ModuleSlotSet::const_iterator lModuleSlotSetItr;
+	unsigned int lOrder = 0;
+
+	for(lSortedLevelModuleMapItr = inSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != inSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
+		lModuleOrderMap[lSortedLevelModuleMapItr->second] = lOrder++;
+
+	// Merged modules are not processed, unless their merge is undone, so they cannot be part of a chain
+	ModuleMergeMap lModuleMergeMap = getMergedModules();
+	for(ModuleMergeMap::const_iterator lModuleMergeMapItr = lModuleMergeMap.begin(); lModuleMergeMapItr != lModuleMergeMap.end(); lModuleMergeMapItr++)
+		lFusedModuleSet.insert(lModuleMergeMapItr->first);
+
+	for(lSortedLevelModuleMapItr = inSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != inSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
+	{
+		Module* lFirstModule = lSortedLevelModuleMapItr->second;
+		if(!lFirstModule->hasPointwiseKernel() || lFusedModuleSet.find(lFirstModule)!=lFusedModuleSet.end())
+			continue;
+
+		ModuleChain lModuleChain;
+		ModuleSetConst lChainModuleSet;
+		unsigned int lFirstOrder = lModuleOrderMap[lFirstModule];
+		lModuleChain.push_back(lFirstModule);
+		lChainModuleSet.insert(lFirstModule);
+
+		while(true)
+		{
+			Module* lNextModule = NULL;
+
+			// Look for a consumer of the last module of the chain that can be appended to it
+			const ModuleSlotMap& lOutputSlotMap = lModuleChain.back()->getOutputSlots();
+			for(lOutputSlotMapItr = lOutputSlotMap.begin(); lOutputSlotMapItr != lOutputSlotMap.end() && !lNextModule; lOutputSlotMapItr++)
+			{
+				lModuleSlotSet = lOutputSlotMapItr->second->getConnectedSlots();
+				for(lModuleSlotSetItr = lModuleSlotSet.begin(); lModuleSlotSetItr != lModuleSlotSet.end() && !lNextModule; lModuleSlotSetItr++)
+				{
+					Module* lCandidate = const_cast<Module*>((*lModuleSlotSetItr)->getModule());
+					bool lFusable = lCandidate->hasPointwiseKernel() && lFusedModuleSet.find(lCandidate)==lFusedModuleSet.end() && lChainModuleSet.find(lCandidate)==lChainModuleSet.end();
+
+					// All the other inputs must be ready when the first module of the chain is processed
+					const ModuleSlotMap& lInputSlotMap = lCandidate->getInputSlots();
+					for(lInputSlotMapItr = lInputSlotMap.begin(); lInputSlotMapItr != lInputSlotMap.end() && lFusable; lInputSlotMapItr++)
+					{
+						if(!lInputSlotMapItr->second->isConnected())
+							continue;
+						const Module* lProducer = (*lInputSlotMapItr->second->getConnectedSlots().begin())->getModule();
+						if(lChainModuleSet.find(lProducer)==lChainModuleSet.end() && lModuleOrderMap[lProducer]>=lFirstOrder)
+							lFusable = false;
+					}
+
+					if(lFusable)
+						lNextModule = lCandidate;
+				}
+			}
+
+			if(!lNextModule)
+				break;
+
+			lModuleChain.push_back(lNextModule);
+			lChainModuleSet.insert(lNextModule);
+		}
+
+		if(lModuleChain.size()>1)
+		{
+			lFusedModuleSet.insert(lChainModuleSet.begin(), lChainModuleSet.end());
+			lModuleChainMap[lFirstModule] = lModuleChain;
+		}
+	}
+
+	return lModuleChainMap;
+}
+
+/*! \todo
+*/
+void Kernel::setOperatorFusion(bool inOperatorFusion) throw()
+{
+	mOperatorFusionMutex.lock();
+	mOperatorFusion = inOperatorFusion;
+	mOperatorFusionMutex.unlock();
+}
+
+/*! \todo
+*/
+bool Kernel::isOperatorFusionEnabled() const throw()
+{
+	bool lOperatorFusion;
+	mOperatorFusionMutex.lock();
+	lOperatorFusion = mOperatorFusion;
+	mOperatorFusionMutex.unlock();
+	return lOperatorFusion;
+}
+
+/*! A fixed height (64 rows for instance) gives the same strips whatever the width of the images, which is easier to
+    compare between configurations, but the rows of a chain with many or wide images may then no longer fit in the
+    cache.
+*/
+void Kernel::setStripHeight(unsigned int inStripHeight) throw()
+{
+	mStripHeightMutex.lock();
+	mStripHeight = inStripHeight;
+	mStripHeightMutex.unlock();
+}
+
+/*! \todo
+*/
+unsigned int Kernel::getStripHeight() const throw()
+{
+	unsigned int lStripHeight;
+	mStripHeightMutex.lock();
+	lStripHeight = mStripHeight;
+	mStripHeightMutex.unlock();
+	return lStripHeight;
+}
+
+/*! Every %Module of the chain prepares the frame, then processes its rows one strip at a time, all modules processing
+    a strip before the next one, so the rows an upstream %Module has just written are still in cache when the
+    downstream %Module reads them.  Unless set with setStripHeight(), the height of a strip is chosen so that the rows
+    of all the images used by the chain fit in KERNEL_STRIP_BYTES.  A %Module with a row halo (see
+    Module::setRowHalo()) lags behind the modules before it in the chain by its halo, so the rows below its strip are
+    already written when it reads them: the first strips only fill the pipeline, and more strips are processed at the
+    end of the frame to drain it.  Intermediate images only read by the next %Module of the chain are written in
+    place when it can (see updateInPlaceOutputs()), so the chain does not keep an image per %Module.  All the slots
+    used by the chain are locked during the whole frame, and monitors are notified once they are unlocked.
+*/
+void Kernel::processModuleChain(const ModuleChain& inModuleChain, unsigned int inFrameNumber)
+{
+	ModuleSetConst lChainModuleSet(inModuleChain.begin(), inModuleChain.end());
+	vector<const ModuleSlot*> lLockedSlots;
+	set<const ModuleSlot*> lLockedSlotSet;
+	ModuleChain::const_iterator lModuleChainItr;
+	ModuleSlotMap::const_iterator lModuleSlotMapItr;
+	unsigned int lNbBegun = 0;
+	unsigned int lNbEnded = 0;
+	unsigned int lHeight = 0;
+	unsigned long lRowBytes = 0;
+	unsigned int lStripRows;
+	unsigned int lFrontRow;
+	vector<unsigned int> lLags(inModuleChain.size());
+	vector<unsigned int> lEndRows(inModuleChain.size());
+	unsigned int i;
+
+	// Inputs coming from outside the chain (locked through the output slot they are connected to), then outputs
+	for(lModuleChainItr = inModuleChain.begin(); lModuleChainItr != inModuleChain.end(); lModuleChainItr++)
+	{
+		const ModuleSlotMap& lInputSlotMap = (*lModuleChainItr)->getInputSlots();
+		for(lModuleSlotMapItr = lInputSlotMap.begin(); lModuleSlotMapItr != lInputSlotMap.end(); lModuleSlotMapItr++)
+		{
+			if(!lModuleSlotMapItr->second->isConnected())
+				continue;
+			const ModuleSlot* lProducerSlot = *lModuleSlotMapItr->second->getConnectedSlots().begin();
+			if(lChainModuleSet.find(lProducerSlot->getModule())!=lChainModuleSet.end())
+				continue;
+			// The output slot of a merged module shares the mutex of the slot it is an alias of
+			if(lProducerSlot->getAlias())
+				lProducerSlot = lProducerSlot->getAlias();
+			if(lLockedSlotSet.insert(lProducerSlot).second)
+				lLockedSlots.push_back(lProducerSlot);
+		}
+	}
+	for(lModuleChainItr = inModuleChain.begin(); lModuleChainItr != inModuleChain.end(); lModuleChainItr++)
+	{
+		const ModuleSlotMap& lOutputSlotMap = (*lModuleChainItr)->getOutputSlots();
+		for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+		{
+			if(lLockedSlotSet.insert(lModuleSlotMapItr->second).second)
+				lLockedSlots.push_back(lModuleSlotMapItr->second);
+		}
+	}
+
+	for(i = 0; i < lLockedSlots.size(); i++)
+		lLockedSlots[i]->lock();
+
+	try
+	{
+		for(lModuleChainItr = inModuleChain.begin(); lModuleChainItr != inModuleChain.end(); lModuleChainItr++, lNbBegun++)
+			(*lModuleChainItr)->beginPointwise(inFrameNumber);
+
+		// Outputs are allocated once every module has begun the frame
+		for(i = 0; i < lLockedSlots.size(); i++)
+		{
+			const Image* lImage = lLockedSlots[i]->getImage();
+			if(lImage && lImage->getHeight()>0)
+			{
+				lRowBytes += lImage->getSizeBytes()/lImage->getHeight();
+				if((unsigned int)lImage->getHeight()>lHeight)
+					lHeight = lImage->getHeight();
+			}
+		}
+
+		lStripRows = getStripHeight();
+		if(lStripRows==0)
+		{
+			lStripRows = 1;
+			if(lRowBytes>0 && KERNEL_STRIP_BYTES/lRowBytes>1)
+				lStripRows = KERNEL_STRIP_BYTES/lRowBytes;
+		}
+
+		// Rows a module lags behind the front of the chain, and rows it has processed so far
+		for(i = 0; i < inModuleChain.size(); i++)
+		{
+			lLags[i] = (i>0) ? lLags[i-1]+inModuleChain[i]->getRowHalo() : 0;
+			lEndRows[i] = 0;
+		}
+
+		for(lFrontRow = 0; lEndRows.back() < lHeight; )
+		{
+			lFrontRow = (lHeight+lLags.back()-lFrontRow>lStripRows) ? lFrontRow+lStripRows : lHeight+lLags.back();
+			for(i = 0; i < inModuleChain.size(); i++)
+			{
+				unsigned int lEndRow = (lFrontRow>lLags[i]) ? lFrontRow-lLags[i] : 0;
+				if(lEndRow>lHeight)
+					lEndRow = lHeight;
+				if(lEndRow>lEndRows[i])
+				{
+					inModuleChain[i]->processPointwise(lEndRows[i], lEndRow);
+					lEndRows[i] = lEndRow;
+				}
+			}
+		}
+
+		while(lNbEnded < lNbBegun)
+			inModuleChain[lNbEnded++]->endPointwise();
+	}
+	catch(...)
+	{
+		// Let modules that have begun the frame release what they hold for it
+		for(i = lNbEnded; i < lNbBegun; i++)
+		{
+			try
+			{
+				inModuleChain[i]->endPointwise();
+			}
+			catch(...)
+			{
+			}
+		}
+
+		for(i = lLockedSlots.size(); i > 0; i--)
+			lLockedSlots[i-1]->unlock();
+		throw;
+	}
+
+	for(i = lLockedSlots.size(); i > 0; i--)
+		lLockedSlots[i-1]->unlock();
+
+	for(lModuleChainItr = inModuleChain.begin(); lModuleChainItr != inModuleChain.end(); lModuleChainItr++)
+		(*lModuleChainItr)->notifyMonitors();
+}
+
+/*! Modules are compared in processing order with the modules kept before them.  A %Module is a duplicate of another
+    one if both have the same name, the same parameter values, and each input slot connected to the same output slot,
+    or to the output slot of a %Module that is itself a duplicate of the other's producer.  Sources (no connected input)
+    and sinks (no output slot) are never merged, since producing or writing frames twice may be intended.  Modules
+    whose outputs are read by the same %Module are not merged either: a merged output slot shares the mutex of the slot
+    it is an alias of, and that %Module would lock it twice.
+*/
+ModuleMergeMap Kernel::computeDuplicateModules(const SortedLevelModuleMap& inSortedLevelModuleMap) const throw()
+{
+	ModuleMergeMap lModuleMergeMap;
+	vector<Module*> lKeptModules;
+	map<Module*, set<const Module*> > lConsumerModuleMap;
+	SortedLevelModuleMap::const_iterator lSortedLevelModuleMapItr;
+	vector<Module*>::const_iterator lKeptModulesItr;
+	ModuleSlotMap::const_iterator lModuleSlotMapItr;
+	ModuleSlotSet::const_iterator lModuleSlotSetItr;
+
+	for(lSortedLevelModuleMapItr = inSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != inSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
+	{
+		Module* lModule = lSortedLevelModuleMapItr->second;
+		set<const Module*> lConsumerModuleSet;
+		bool lMerged = false;
+
+		const ModuleSlotMap& lOutputSlotMap = lModule->getOutputSlots();
+		for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+		{
+			ModuleSlotSet lConnectedSlots = lModuleSlotMapItr->second->getConnectedSlots();
+			for(lModuleSlotSetItr = lConnectedSlots.begin(); lModuleSlotSetItr != lConnectedSlots.end(); lModuleSlotSetItr++)
+				lConsumerModuleSet.insert((*lModuleSlotSetItr)->getModule());
+		}
+
+		if(lModule->isAnyInputSlotConnected() && !lOutputSlotMap.empty())
+		{
+			for(lKeptModulesItr = lKeptModules.begin(); lKeptModulesItr != lKeptModules.end() && !lMerged; lKeptModulesItr++)
+			{
+				set<const Module*>& lKeptConsumerModuleSet = lConsumerModuleMap[*lKeptModulesItr];
+				vector<const Module*> lCommonConsumerModules;
+				set_intersection(lConsumerModuleSet.begin(), lConsumerModuleSet.end(), lKeptConsumerModuleSet.begin(), lKeptConsumerModuleSet.end(), back_inserter(lCommonConsumerModules));
+
+				if(lCommonConsumerModules.empty() && isDuplicateModule(lModule, *lKeptModulesItr, lModuleMergeMap))
+				{
+					lModuleMergeMap[lModule] = *lKeptModulesItr;
+					lKeptConsumerModuleSet.insert(lConsumerModuleSet.begin(), lConsumerModuleSet.end());
+					lMerged = true;
+				}
+			}
+		}
+
+		if(!lMerged)
+		{
+			lKeptModules.push_back(lModule);
+			lConsumerModuleMap[lModule] = lConsumerModuleSet;
+		}
+	}
+
+	return lModuleMergeMap;
+}
+
+/*! \todo
+*/
+bool Kernel::isDuplicateModule(const Module* inModule, const Module* inOtherModule, const ModuleMergeMap& inModuleMergeMap) const throw()
+{
+	ModuleSlotMap::const_iterator lModuleSlotMapItr;
+	ParameterMap::const_iterator lParameterMapItr;
+	ParameterMap::const_iterator lOtherParameterMapItr;
+
+	if(inModule->getName()!=inOtherModule->getName() || inModule->getVersion()!=inOtherModule->getVersion())
+		return false;
+
+	// Same parameter values
+	ParameterMap lParameterMap = inModule->getParameterMap();
+	ParameterMap lOtherParameterMap = inOtherModule->getParameterMap();
+	if(lParameterMap.size()!=lOtherParameterMap.size())
+		return false;
+	for(lParameterMapItr = lParameterMap.begin(), lOtherParameterMapItr = lOtherParameterMap.begin(); lParameterMapItr != lParameterMap.end(); lParameterMapItr++, lOtherParameterMapItr++)
+	{
+		if(lParameterMapItr->first!=lOtherParameterMapItr->first || lParameterMapItr->second.getValue()!=lOtherParameterMapItr->second.getValue())
+			return false;
+	}
+
+	// Same inputs, once the producers that are duplicates are replaced by the module they are merged into
+	const ModuleSlotMap& lInputSlotMap = inModule->getInputSlots();
+	for(lModuleSlotMapItr = lInputSlotMap.begin(); lModuleSlotMapItr != lInputSlotMap.end(); lModuleSlotMapItr++)
+	{
+		const ModuleSlot* lOtherInputSlot = inOtherModule->getInputSlot(lModuleSlotMapItr->first);
+		if(!lOtherInputSlot || lModuleSlotMapItr->second->isConnected()!=lOtherInputSlot->isConnected())
+			return false;
+		if(!lModuleSlotMapItr->second->isConnected())
+			continue;
+
+		const ModuleSlot* lProducerSlot = *lModuleSlotMapItr->second->getConnectedSlots().begin();
+		const ModuleSlot* lOtherProducerSlot = *lOtherInputSlot->getConnectedSlots().begin();
+
+		ModuleMergeMap::const_iterator lModuleMergeMapItr = inModuleMergeMap.find(const_cast<Module*>(lProducerSlot->getModule()));
+		if(lModuleMergeMapItr!=inModuleMergeMap.end())
+			lProducerSlot = static_cast<const Module*>(lModuleMergeMapItr->second)->getOutputSlot(lProducerSlot->getName());
+		lModuleMergeMapItr = inModuleMergeMap.find(const_cast<Module*>(lOtherProducerSlot->getModule()));
+		if(lModuleMergeMapItr!=inModuleMergeMap.end())
+			lOtherProducerSlot = static_cast<const Module*>(lModuleMergeMapItr->second)->getOutputSlot(lOtherProducerSlot->getName());
+
+		if(lProducerSlot!=lOtherProducerSlot)
+			return false;
+	}
+
+	return true;
+}
+
+/*! \todo
+*/
+void Kernel::setModuleMerging(bool inModuleMerging) throw()
+{
+	mModuleMergeMutex.lock();
+	mModuleMerging = inModuleMerging;
+	mModuleMergeMutex.unlock();
+}
+
+/*! \todo
+*/
+bool Kernel::isModuleMergingEnabled() const throw()
+{
+	bool lModuleMerging;
+	mModuleMergeMutex.lock();
+	lModuleMerging = mModuleMerging;
+	mModuleMergeMutex.unlock();
+	return lModuleMerging;
+}
+
+/*! This is the report of the merges made when modules were initialized, less the ones undone since because parameters
+    changed.
+*/
+ModuleMergeMap Kernel::getMergedModules() const throw()
+{
+	ModuleMergeMap lModuleMergeMap;
+	mModuleMergeMutex.lock();
+	lModuleMergeMap = mModuleMergeMap;
+	mModuleMergeMutex.unlock();
+	return lModuleMergeMap;
+}
+
+/*! A merged %Module is still initialized, started and stopped, but not processed: consumers and monitors of its
+    output slots get the images of the %Module it is merged into.
+*/
+void Kernel::mergeModules(const ModuleMergeMap& inModuleMergeMap)
+{
+	ModuleMergeMap::const_iterator lModuleMergeMapItr;
+	ModuleSlotMap::const_iterator lModuleSlotMapItr;
+
+	mModuleMergeMutex.lock();
+	try
+	{
+		for(lModuleMergeMapItr = inModuleMergeMap.begin(); lModuleMergeMapItr != inModuleMergeMap.end(); lModuleMergeMapItr++)
+		{
+			const ModuleSlotMap& lOutputSlotMap = lModuleMergeMapItr->first->getOutputSlots();
+			const ModuleSlotMap& lOtherOutputSlotMap = lModuleMergeMapItr->second->getOutputSlots();
+			for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+				lModuleSlotMapItr->second->setAlias(lOtherOutputSlotMap.find(lModuleSlotMapItr->first)->second);
+
+			mModuleMergeMap[lModuleMergeMapItr->first] = lModuleMergeMapItr->second;
+			mModuleMergeVersionMap[lModuleMergeMapItr->first] = make_pair(lModuleMergeMapItr->first->getParametersVersion(), lModuleMergeMapItr->second->getParametersVersion());
+		}
+	}
+	catch(...)
+	{
+		mModuleMergeMutex.unlock();
+		throw;
+	}
+	mModuleMergeMutex.unlock();
+}
+
+/*! \todo
+*/
+void Kernel::unmergeModules() throw()
+{
+	mModuleMergeMutex.lock();
+	while(!mModuleMergeMap.empty())
+		unmergeModule(mModuleMergeMap.begin()->first);
+	mModuleMergeMutex.unlock();
+}
+
+/*! \todo
+*/
+bool Kernel::isModuleMerged(Module* inModule) const throw()
+{
+	bool lMerged;
+	mModuleMergeMutex.lock();
+	lMerged = mModuleMergeMap.find(inModule)!=mModuleMergeMap.end();
+	mModuleMergeMutex.unlock();
+	return lMerged;
+}
+
+/*! Called before each frame: merges stay valid as long as the parameters of the merged modules are unchanged.  If any
+    changed, or has changes waiting to be applied, all merges are undone since modules downstream may have been merged
+    because of it.  Modules processed again on their own resume any state kept between frames from the frame they were
+    merged.
+*/
+void Kernel::checkMergedModules() throw()
+{
+	ModuleMergeMap::const_iterator lModuleMergeMapItr;
+	bool lChanged = false;
+
+	mModuleMergeMutex.lock();
+	for(lModuleMergeMapItr = mModuleMergeMap.begin(); lModuleMergeMapItr != mModuleMergeMap.end() && !lChanged; lModuleMergeMapItr++)
+	{
+		const pair<unsigned long, unsigned long>& lVersions = mModuleMergeVersionMap[lModuleMergeMapItr->first];
+		lChanged = lVersions.first!=lModuleMergeMapItr->first->getParametersVersion() || lVersions.second!=lModuleMergeMapItr->second->getParametersVersion()
+			|| lModuleMergeMapItr->first->hasPendingParameterValues() || lModuleMergeMapItr->second->hasPendingParameterValues();
+	}
+	if(lChanged)
+	{
+		while(!mModuleMergeMap.empty())
+			unmergeModule(mModuleMergeMap.begin()->first);
+	}
+	mModuleMergeMutex.unlock();
+}
+
+/*! \todo
+*/
+void Kernel::unmergeModule(Module* inModule) throw()
+{
+	ModuleSlotMap::const_iterator lModuleSlotMapItr;
+
+	const ModuleSlotMap& lOutputSlotMap = inModule->getOutputSlots();
+	for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+		lModuleSlotMapItr->second->clearAlias();
+
+	mModuleMergeMap.erase(inModule);
+	mModuleMergeVersionMap.erase(inModule);
+}
+
+/*! \todo
+*/
+void Kernel::setBufferPlanning(bool inBufferPlanning) throw()
+{
+	mBufferPlanningMutex.lock();
+	mBufferPlanning = inBufferPlanning;
+	mBufferPlanningMutex.unlock();
+}
+
+/*! \todo
+*/
+bool Kernel::isBufferPlanningEnabled() const throw()
+{
+	bool lBufferPlanning;
+	mBufferPlanningMutex.lock();
+	lBufferPlanning = mBufferPlanning;
+	mBufferPlanningMutex.unlock();
+	return lBufferPlanning;
+}
+
+/*! \todo
+*/
+BufferPlanner::BufferMap Kernel::getPlannedBuffers() const throw()
+{
+	BufferPlanner::BufferMap lBufferMap;
+	mBufferPlanningMutex.lock();
+	lBufferMap = mBufferPlanner.getBuffers();
+	mBufferPlanningMutex.unlock();
+	return lBufferMap;
+}
+
+/*! \todo
+*/
+unsigned long Kernel::getBufferArenaSize() const throw()
+{
+	unsigned long lArenaSize;
+	mBufferPlanningMutex.lock();
+	lArenaSize = mBufferPlanner.getArenaSize();
+	mBufferPlanningMutex.unlock();
+	return lArenaSize;
+}
+
+/*! Called after each frame.  Each %Module is a step in processing order, a chain of modules processed by strips being
+    a single step.  The buffer of an output slot lives from the step of its %Module to the last step reading it,
+    directly, through an alias or through output slots written in place over it.  Only the output slots of modules with
+    planned outputs that asked for a buffer are planned, except those of merged modules and those watched by a
+    %Monitor, which could read them once other modules reused the memory.  A new plan is only made when a size or a
+    lifetime changed; the modules then create their images over the new buffers during the next frame.
+*/
+void Kernel::planBuffers(const SortedLevelModuleMap& inSortedLevelModuleMap, const ModuleChainMap& inModuleChainMap)
+{
+	map<const Module*, unsigned int> lStepMap;
+	BufferPlanner::BufferMap lBufferMap;
+	BufferPlanner::BufferMap::iterator lBufferMapItr;
+	SortedLevelModuleMap::const_iterator lSortedLevelModuleMapItr;
+	ModuleChainMap::const_iterator lModuleChainMapItr;
+	ModuleChain::const_iterator lModuleChainItr;
+	ModuleSlotMap::const_iterator lModuleSlotMapItr;
+	unsigned int lStep = 0;
+
+	// Steps and buffers asked for
+	for(lSortedLevelModuleMapItr = inSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != inSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
+	{
+		Module* lModule = lSortedLevelModuleMapItr->second;
+		if(lStepMap.find(lModule)==lStepMap.end())
+		{
+			lModuleChainMapItr = inModuleChainMap.find(lModule);
+			if(lModuleChainMapItr!=inModuleChainMap.end())
+			{
+				for(lModuleChainItr = lModuleChainMapItr->second.begin(); lModuleChainItr != lModuleChainMapItr->second.end(); lModuleChainItr++)
+					lStepMap[*lModuleChainItr] = lStep;
+			}
+			else
+				lStepMap[lModule] = lStep;
+			lStep++;
+		}
+
+		if(!lModule->hasPlannedOutputs() || isModuleMerged(lModule))
+			continue;
+
+		const ModuleSlotMap& lOutputSlotMap = lModule->getOutputSlots();
+		for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+		{
+			// Each connection counts as a use, the other uses are monitors
+			unsigned long lRequest = lModuleSlotMapItr->second->getPlannedBufferRequest();
+			if(lRequest>0 && !lModuleSlotMapItr->second->isInPlace() && lModuleSlotMapItr->second->getUseCount()<=lModuleSlotMapItr->second->getConnectedSlots().size())
+				lBufferMap[lModuleSlotMapItr->second] = BufferPlanner::Buffer(lRequest, lStepMap[lModule], lStepMap[lModule]);
+		}
+	}
+
+	// Lifetimes
+	for(lSortedLevelModuleMapItr = inSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != inSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
+	{
+		Module* lModule = lSortedLevelModuleMapItr->second;
+		if(isModuleMerged(lModule))
+			continue;
+
+		const ModuleSlotMap& lInputSlotMap = lModule->getInputSlots();
+		for(lModuleSlotMapItr = lInputSlotMap.begin(); lModuleSlotMapItr != lInputSlotMap.end(); lModuleSlotMapItr++)
+		{
+			if(!lModuleSlotMapItr->second->isConnected())
+				continue;
+			lBufferMapItr = lBufferMap.find(getImageOwnerSlot(*lModuleSlotMapItr->second->getConnectedSlots().begin()));
+			if(lBufferMapItr!=lBufferMap.end() && lBufferMapItr->second.mLastStep<lStepMap[lModule])
+				lBufferMapItr->second.mLastStep = lStepMap[lModule];
+		}
+	}
+
+	mBufferPlanningMutex.lock();
+	try
+	{
+		if(mBufferPlanner.plan(lBufferMap))
+		{
+			for(lSortedLevelModuleMapItr = inSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != inSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
+			{
+				const ModuleSlotMap& lOutputSlotMap = lSortedLevelModuleMapItr->second->getOutputSlots();
+				for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+				{
+					lBufferMapItr = lBufferMap.find(lModuleSlotMapItr->second);
+					lModuleSlotMapItr->second->setPlannedBuffer(mBufferPlanner.getData(lModuleSlotMapItr->second), lBufferMapItr!=lBufferMap.end() ? lBufferMapItr->second.mSizeBytes : 0);
+				}
+			}
+		}
+		else
+			mBufferPlanner.releaseRetiredArena();
+	}
+	catch(...)
+	{
+		mBufferPlanningMutex.unlock();
+		throw;
+	}
+	mBufferPlanningMutex.unlock();
+}
+
+/*! Modules still holding images over the released arena create them again the next time they process a frame,
+    without reading them.
+*/
+void Kernel::releaseBuffers() throw()
+{
+	ModuleSet::const_iterator lModuleSetItr;
+	ModuleSlotMap::const_iterator lModuleSlotMapItr;
+
+	mBufferPlanningMutex.lock();
+	for(lModuleSetItr = mModuleSet.begin(); lModuleSetItr != mModuleSet.end(); lModuleSetItr++)
+	{
+		const ModuleSlotMap& lOutputSlotMap = (*lModuleSetItr)->getOutputSlots();
+		for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+			lModuleSlotMapItr->second->setPlannedBuffer(NULL, 0);
+	}
+	mBufferPlanner.clear();
+	mBufferPlanningMutex.unlock();
+}
+
+/*! \todo
+*/
+void Kernel::setInPlaceProcessing(bool inInPlaceProcessing) throw()
+{
+	mInPlaceProcessingMutex.lock();
+	mInPlaceProcessing = inInPlaceProcessing;
+	mInPlaceProcessingMutex.unlock();
+}
+
+/*! \todo
+*/
+bool Kernel::isInPlaceProcessingEnabled() const throw()
+{
+	bool lInPlaceProcessing;
+	mInPlaceProcessingMutex.lock();
+	lInPlaceProcessing = mInPlaceProcessing;
+	mInPlaceProcessingMutex.unlock();
+	return lInPlaceProcessing;
+}
+
+/*! Called before each frame.  An output slot with an in-place input slot (see ModuleSlot::setInPlaceInput()) is written
+    in place when its %Module is the only reader of the input image: the output slot feeding the input slot, and the
+    slots that are aliases of it, have no other connection and no %Monitor.  The image must not be a view, since its
+    data belongs to another image, nor planar, and the %Module producing it must have planned outputs, so it does not
+    read it back in the next frame.  Output slots watched by a %Monitor are not written in place either, since the
+    image they publish is written again by its producer before the %Module processes the next frame.  A %Module with a
+    row halo never writes in place, since it reads input rows it has already overwritten.
+
+    When inChainsOnly is true (in-place processing disabled, see setInPlaceProcessing()), only the intermediate images
+    of the chains in inModuleChainMap are considered: an output slot is written in place only over an image produced
+    by a %Module of its own chain.  Such an image is read by nothing outside the chain, so it is not kept as an image
+    of its own: the modules of the chain write their strips over the same buffer, which stays in cache.
+
+    Returns true when an output slot starts or stops being written in place.  The lifetimes of the planned buffers
+    then changed, so buffers must be planned again (see planBuffers()) before the frame is processed: otherwise, a
+    buffer written in place could be reused by another %Module while the readers of the output slot still need it.
+*/
+bool Kernel::updateInPlaceOutputs(const SortedLevelModuleMap& inSortedLevelModuleMap, const ModuleChainMap& inModuleChainMap, bool inChainsOnly) throw()
+{
+	map<const ModuleSlot*, unsigned int> lReaderCountMap;
+	map<const Module*, const Module*> lChainMap;
+	bool lChanged = false;
+	SortedLevelModuleMap::const_iterator lSortedLevelModuleMapItr;
+	ModuleChainMap::const_iterator lModuleChainMapItr;
+	ModuleChain::const_iterator lModuleChainItr;
+	ModuleSlotMap::const_iterator lModuleSlotMapItr;
+
+	// First module of the chain of each chained module
+	for(lModuleChainMapItr = inModuleChainMap.begin(); lModuleChainMapItr != inModuleChainMap.end(); lModuleChainMapItr++)
+	{
+		for(lModuleChainItr = lModuleChainMapItr->second.begin(); lModuleChainItr != lModuleChainMapItr->second.end(); lModuleChainItr++)
+			lChainMap[*lModuleChainItr] = lModuleChainMapItr->first;
+	}
+
+	// Readers of each output slot, counting monitors and readers of its aliases
+	for(lSortedLevelModuleMapItr = inSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != inSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
+	{
+		const ModuleSlotMap& lOutputSlotMap = lSortedLevelModuleMapItr->second->getOutputSlots();
+		for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+		{
+			const ModuleSlot* lModuleSlot = lModuleSlotMapItr->second->getAlias() ? lModuleSlotMapItr->second->getAlias() : lModuleSlotMapItr->second;
+			lReaderCountMap[lModuleSlot] += lModuleSlotMapItr->second->getUseCount();
+		}
+	}
+
+	for(lSortedLevelModuleMapItr = inSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != inSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
+	{
+		Module* lModule = lSortedLevelModuleMapItr->second;
+		bool lMerged = isModuleMerged(lModule);
+
+		const ModuleSlotMap& lOutputSlotMap = lModule->getOutputSlots();
+		for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+		{
+			ModuleSlot* lOutputSlot = lModuleSlotMapItr->second;
+			const ModuleSlot* lInputSlot = lOutputSlot->getInPlaceInput();
+			bool lInPlace = false;
+
+			if(lInputSlot && !lMerged && lModule->getRowHalo()==0 && lInputSlot->isConnected() && lOutputSlot->getUseCount()<=lOutputSlot->getConnectedSlots().size())
+			{
+				const ModuleSlot* lProducerSlot = *lInputSlot->getConnectedSlots().begin();
+				if(lProducerSlot->getAlias())
+					lProducerSlot = lProducerSlot->getAlias();
+				const Image* lImage = lProducerSlot->getImage();
+				lInPlace = lReaderCountMap[lProducerSlot]==1 && lProducerSlot->getModule()->hasPlannedOutputs() && lImage && !lImage->isView() && !lImage->isPlanar();
+				if(lInPlace && inChainsOnly)
+				{
+					map<const Module*, const Module*>::const_iterator lChainMapItr = lChainMap.find(lModule);
+					map<const Module*, const Module*>::const_iterator lProducerChainMapItr = lChainMap.find(lProducerSlot->getModule());
+					lInPlace = lChainMapItr!=lChainMap.end() && lProducerChainMapItr!=lChainMap.end() && lChainMapItr->second==lProducerChainMapItr->second;
+				}
+			}
+
+			if(lOutputSlot->isInPlace()!=lInPlace)
+			{
+				lOutputSlot->setInPlace(lInPlace);
+				lChanged = true;
+			}
+		}
+	}
+
+	return lChanged;
+}
+
+/*! Modules with output slots written in place use images of their own again the next time they process a frame.
+*/
+void Kernel::clearInPlaceOutputs() throw()
+{
+	ModuleSet::const_iterator lModuleSetItr;
+	ModuleSlotMap::const_iterator lModuleSlotMapItr;
+
+	for(lModuleSetItr = mModuleSet.begin(); lModuleSetItr != mModuleSet.end(); lModuleSetItr++)
+	{
+		const ModuleSlotMap& lOutputSlotMap = (*lModuleSetItr)->getOutputSlots();
+		for(lModuleSlotMapItr = lOutputSlotMap.begin(); lModuleSlotMapItr != lOutputSlotMap.end(); lModuleSlotMapItr++)
+			lModuleSlotMapItr->second->setInPlace(false);
+	}
+}
+
+/*! \todo
+*/
+const ModuleSlot* Kernel::getImageOwnerSlot(const ModuleSlot* inModuleSlot) const throw()
+{
+	const ModuleSlot* lModuleSlot = inModuleSlot;
+
+	while(true)
+	{
+		if(lModuleSlot->getAlias())
+			lModuleSlot = lModuleSlot->getAlias();
+		if(!lModuleSlot->isInPlace() || !lModuleSlot->getInPlaceInput()->isConnected())
+			return lModuleSlot;
+		lModuleSlot = *lModuleSlot->getInPlaceInput()->getConnectedSlots().begin();
+	}
+}
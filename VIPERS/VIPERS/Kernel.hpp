@@ -39,6 +39,7 @@
 #include "ModulesManager.hpp"
 #include "KernelState.hpp"
 #include "KernelStateNotifier.hpp"
+#include "BufferPlanner.hpp"
 #include "PACC/Threading/Mutex.hpp"
 #include <set>
 #include <map>
@@ -63,6 +64,16 @@ namespace VIPERS
   typedef pair<const Module*, const ModuleSlot*> ModuleSlotPair;
   //! A vector of %ModuleSlotPair used as a stack
   typedef vector<ModuleSlotPair> ModuleSlotPairStack;
+  //! Image memory usage of each %Module
+  typedef map<const Module*, MemoryAccounting::Usage> ModuleMemoryUsageMap;
+  //! Size in bytes of the image owned by each output %ModuleSlot
+  typedef map<const ModuleSlot*, unsigned long> SlotMemoryUsageMap;
+  //! A chain of modules processed together, in processing order
+  typedef vector<Module*> ModuleChain;
+  //! Map of module chains, by the first %Module of each chain
+  typedef map<Module*, ModuleChain> ModuleChainMap;
+  //! Map of duplicate modules, with the %Module each one is merged into
+  typedef map<Module*, Module*> ModuleMergeMap;
 
   /*! \brief %Kernel virtual base class.
 		\author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
@@ -122,6 +133,12 @@ namespace VIPERS
 	    Module* getModule(const string& inLabel) const throw();
 	    //! Get number of modules instantiated
 	    unsigned int getModuleCount() const throw();
+	    //! Get live and peak image memory allocated by each module
+	    ModuleMemoryUsageMap getModuleMemoryUsage() const throw();
+	    //! Get size of the image owned by each output slot (slots that do not own their image are not reported)
+	    SlotMemoryUsageMap getSlotMemoryUsage() const throw();
+	    //! Get live and peak image memory allocated by the whole process
+	    MemoryAccounting::Usage getTotalMemoryUsage() const throw();
 
 	    //! Get kernel state
 	    KernelState getState() const throw();
@@ -135,11 +152,66 @@ namespace VIPERS
 	    void detectModuleGraphCycle() const;
 	    //!Compute module levels
 	    SortedLevelModuleMap computeModuleLevel();
+	    //! Find chains of modules with pointwise kernels that can be processed together, one strip of rows at a time
+	    ModuleChainMap computeFusedModuleChains(const SortedLevelModuleMap& inSortedLevelModuleMap) const throw();
+
+	    //! Enable or disable processing of module chains by strips (taken into account when modules are initialized)
+	    void setOperatorFusion(bool inOperatorFusion) throw();
+	    //! Check if processing of module chains by strips is enabled
+	    bool isOperatorFusionEnabled() const throw();
+	    //! Set the number of rows of the strips of module chains (0 to fit the rows of all the images of a chain in the cache)
+	    void setStripHeight(unsigned int inStripHeight) throw();
+	    //! Get the number of rows of the strips of module chains (0 when computed for each chain)
+	    unsigned int getStripHeight() const throw();
+
+	    //! Find modules identical to a %Module processed before them: same name, parameter values and inputs
+	    ModuleMergeMap computeDuplicateModules(const SortedLevelModuleMap& inSortedLevelModuleMap) const throw();
+	    //! Enable or disable merging of duplicate modules (taken into account when modules are initialized)
+	    void setModuleMerging(bool inModuleMerging) throw();
+	    //! Check if merging of duplicate modules is enabled
+	    bool isModuleMergingEnabled() const throw();
+	    //! Get the duplicate modules currently merged, with the %Module each one is merged into
+	    ModuleMergeMap getMergedModules() const throw();
+
+	    //! Enable or disable planning of the output images of modules with planned outputs in a shared arena (taken into account when modules are initialized)
+	    void setBufferPlanning(bool inBufferPlanning) throw();
+	    //! Check if planning of output images in a shared arena is enabled
+	    bool isBufferPlanningEnabled() const throw();
+	    //! Get the planned buffers, with their size, lifetime and offset in the arena
+	    BufferPlanner::BufferMap getPlannedBuffers() const throw();
+	    //! Get the size in bytes of the arena holding the planned buffers
+	    unsigned long getBufferArenaSize() const throw();
+
+	    //! Enable or disable writing outputs over the input images modules are the only reader of (taken into account when modules are initialized)
+	    void setInPlaceProcessing(bool inInPlaceProcessing) throw();
+	    //! Check if writing outputs over input images is enabled
+	    bool isInPlaceProcessingEnabled() const throw();
 
 	  protected:
 
 	    //! Set the state and broadcast
 	    void setState(KernelState inState) throw();
+	    //! Process one frame of a chain of modules with pointwise kernels, one strip of rows at a time
+	    void processModuleChain(const ModuleChain& inModuleChain, unsigned int inFrameNumber);
+
+	    //! Merge duplicate modules: their output slots become aliases of the output slots of the %Module they are merged into
+	    void mergeModules(const ModuleMergeMap& inModuleMergeMap);
+	    //! Undo all merges
+	    void unmergeModules() throw();
+	    //! Check if a %Module is merged into another one
+	    bool isModuleMerged(Module* inModule) const throw();
+	    //! Undo all merges if the parameters of a merged %Module changed since it was merged
+	    void checkMergedModules() throw();
+
+	    //! Plan the output images of modules with planned outputs from the sizes asked for during the last frame
+	    void planBuffers(const SortedLevelModuleMap& inSortedLevelModuleMap, const ModuleChainMap& inModuleChainMap);
+	    //! Release the arena and the planned buffers of all output slots
+	    void releaseBuffers() throw();
+
+	    //! Decide which output slots are written over the image of their in-place input slot for the next frame (true if any changed)
+	    bool updateInPlaceOutputs(const SortedLevelModuleMap& inSortedLevelModuleMap, const ModuleChainMap& inModuleChainMap, bool inChainsOnly) throw();
+	    //! Make all output slots use their own image again
+	    void clearInPlaceOutputs() throw();
 
 	    ModulesManager mModulesManager; //!< The %ModulesManager
 	    ModuleSet mModuleSet; //!< Module instances
@@ -150,12 +222,35 @@ namespace VIPERS
 	    Kernel(const Kernel&);
 	    //! Restrict (disable) assignment operator
 	    void operator=(const Kernel&);
+	    //! Check if a %Module is a duplicate of another one, given the merges already found for the modules before it
+	    bool isDuplicateModule(const Module* inModule, const Module* inOtherModule, const ModuleMergeMap& inModuleMergeMap) const throw();
+	    //! Undo the merge of a %Module (merges must be locked)
+	    void unmergeModule(Module* inModule) throw();
+	    //! Get the output slot whose image an output slot actually publishes, through aliases and in-place outputs
+	    const ModuleSlot* getImageOwnerSlot(const ModuleSlot* inModuleSlot) const throw();
 
 	    KernelState mState; //!< Current state of the kernel
 	    Threading::Mutex mStateMutex; //!< Mutex for state
 
 	    KernelStateNotifier* mKernelStateNotifier;
 	    Threading::Mutex mKernelStateNotifierMutex; //!< Mutex for notifier access
+
+	    bool mOperatorFusion; //!< Process chains of modules with pointwise kernels by strips
+	    Threading::Mutex mOperatorFusionMutex; //!< Mutex for operator fusion flag
+	    unsigned int mStripHeight; //!< Number of rows of the strips of module chains (0 when computed for each chain)
+	    Threading::Mutex mStripHeightMutex; //!< Mutex for strip height
+
+	    bool mModuleMerging; //!< Merge duplicate modules when they are initialized
+	    ModuleMergeMap mModuleMergeMap; //!< Duplicate modules currently merged
+	    map<Module*, pair<unsigned long, unsigned long> > mModuleMergeVersionMap; //!< Parameters versions of a merged %Module and of the other %Module, when merged
+	    Threading::Mutex mModuleMergeMutex; //!< Mutex for merging flag and merged modules
+
+	    bool mBufferPlanning; //!< Plan output images of modules with planned outputs in a shared arena
+	    BufferPlanner mBufferPlanner; //!< Planner of output images
+	    Threading::Mutex mBufferPlanningMutex; //!< Mutex for planning flag and planner
+
+	    bool mInPlaceProcessing; //!< Write outputs over the input images modules are the only reader of
+	    Threading::Mutex mInPlaceProcessingMutex; //!< Mutex for in-place processing flag
 	};
 
 }
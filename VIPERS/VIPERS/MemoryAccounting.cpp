@@ -0,0 +1,229 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/MemoryAccounting.cpp
+ * \brief MemoryAccounting class functions definition.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#include "MemoryAccounting.hpp"
+#include "PACC/Threading/Mutex.hpp"
+
+#if defined(_MSC_VER)
+  #define VIPERS_THREAD_LOCAL __declspec(thread)
+#else
+  #define VIPERS_THREAD_LOCAL __thread
+#endif
+
+using namespace VIPERS;
+using namespace PACC;
+
+namespace
+{
+  struct Block
+  {
+    const void* mOwner;
+    unsigned long mSizeBytes;
+  };
+
+  typedef map<const void*, Block> BlockMap;
+  typedef map<const void*, MemoryAccounting::Usage> UsageMap;
+
+  struct Registry
+  {
+    BlockMap mBlocks;
+    UsageMap mUsages;
+    MemoryAccounting::Usage mTotal;
+    Threading::Mutex mMutex;
+  };
+
+  // Constructed on first use and never destroyed, so that images allocated or released during static
+  // initialization or destruction are still accounted
+  Registry& getRegistry()
+  {
+    static Registry* sRegistry = new Registry;
+    return *sRegistry;
+  }
+
+  VIPERS_THREAD_LOCAL const void* sCurrentOwner = NULL;
+
+  void add(MemoryAccounting::Usage& ioUsage, unsigned long inSizeBytes)
+  {
+    ioUsage.mLiveBytes += inSizeBytes;
+    ioUsage.mNbBlocks++;
+    if(ioUsage.mLiveBytes>ioUsage.mPeakBytes)
+      ioUsage.mPeakBytes = ioUsage.mLiveBytes;
+  }
+
+  void remove(MemoryAccounting::Usage& ioUsage, unsigned long inSizeBytes)
+  {
+    ioUsage.mLiveBytes -= inSizeBytes;
+    ioUsage.mNbBlocks--;
+  }
+}
+
+/*! \todo
+*/
+MemoryAccounting::Scope::Scope(const void* inOwner)
+{
+  mPreviousOwner = sCurrentOwner;
+  sCurrentOwner = inOwner;
+}
+
+/*! \todo
+*/
+MemoryAccounting::Scope::~Scope()
+{
+  sCurrentOwner = mPreviousOwner;
+}
+
+/*! \todo
+*/
+void MemoryAccounting::allocate(const void* inBlock, unsigned long inSizeBytes)
+{
+  if(!inBlock)
+    return;
+
+  Registry& lRegistry = getRegistry();
+  Block lBlock;
+  lBlock.mOwner = sCurrentOwner;
+  lBlock.mSizeBytes = inSizeBytes;
+
+  lRegistry.mMutex.lock();
+  BlockMap::iterator lItr = lRegistry.mBlocks.find(inBlock);
+  if(lItr!=lRegistry.mBlocks.end())
+  {
+    // Block released without being recorded, then allocated again
+    remove(lRegistry.mUsages[lItr->second.mOwner], lItr->second.mSizeBytes);
+    remove(lRegistry.mTotal, lItr->second.mSizeBytes);
+    lItr->second = lBlock;
+  }
+  else
+    lRegistry.mBlocks.insert(BlockMap::value_type(inBlock, lBlock));
+  add(lRegistry.mUsages[sCurrentOwner], inSizeBytes);
+  add(lRegistry.mTotal, inSizeBytes);
+  lRegistry.mMutex.unlock();
+}
+
+/*! \todo
+*/
+void MemoryAccounting::release(const void* inBlock)
+{
+  if(!inBlock)
+    return;
+
+  Registry& lRegistry = getRegistry();
+  lRegistry.mMutex.lock();
+  BlockMap::iterator lItr = lRegistry.mBlocks.find(inBlock);
+  if(lItr!=lRegistry.mBlocks.end())
+  {
+    remove(lRegistry.mUsages[lItr->second.mOwner], lItr->second.mSizeBytes);
+    remove(lRegistry.mTotal, lItr->second.mSizeBytes);
+    lRegistry.mBlocks.erase(lItr);
+  }
+  lRegistry.mMutex.unlock();
+}
+
+/*! \todo
+*/
+unsigned long MemoryAccounting::getBlockSize(const void* inBlock, const void* inOwner)
+{
+  if(!inBlock)
+    return 0;
+
+  Registry& lRegistry = getRegistry();
+  unsigned long lSizeBytes = 0;
+  lRegistry.mMutex.lock();
+  BlockMap::const_iterator lItr = lRegistry.mBlocks.find(inBlock);
+  if(lItr!=lRegistry.mBlocks.end() && lItr->second.mOwner==inOwner)
+    lSizeBytes = lItr->second.mSizeBytes;
+  lRegistry.mMutex.unlock();
+  return lSizeBytes;
+}
+
+/*! \todo
+*/
+const void* MemoryAccounting::getCurrentOwner()
+{
+  return sCurrentOwner;
+}
+
+/*! \todo
+*/
+MemoryAccounting::Usage MemoryAccounting::getUsage(const void* inOwner)
+{
+  Registry& lRegistry = getRegistry();
+  Usage lUsage;
+  lRegistry.mMutex.lock();
+  UsageMap::const_iterator lItr = lRegistry.mUsages.find(inOwner);
+  if(lItr!=lRegistry.mUsages.end())
+    lUsage = lItr->second;
+  lRegistry.mMutex.unlock();
+  return lUsage;
+}
+
+/*! \todo
+*/
+MemoryAccounting::Usage MemoryAccounting::getTotalUsage()
+{
+  Registry& lRegistry = getRegistry();
+  lRegistry.mMutex.lock();
+  Usage lUsage = lRegistry.mTotal;
+  lRegistry.mMutex.unlock();
+  return lUsage;
+}
+
+/*! \todo
+*/
+void MemoryAccounting::forgetOwner(const void* inOwner)
+{
+  if(!inOwner)
+    return;
+
+  Registry& lRegistry = getRegistry();
+  lRegistry.mMutex.lock();
+  UsageMap::iterator lUsageItr = lRegistry.mUsages.find(inOwner);
+  if(lUsageItr!=lRegistry.mUsages.end())
+  {
+    if(lUsageItr->second.mNbBlocks)
+    {
+      // Leaked blocks are kept, but cannot stay attributed to an address that may be reused
+      Usage& lOrphans = lRegistry.mUsages[NULL];
+      for(BlockMap::iterator lItr = lRegistry.mBlocks.begin(); lItr!=lRegistry.mBlocks.end(); lItr++)
+      {
+        if(lItr->second.mOwner==inOwner)
+        {
+          lItr->second.mOwner = NULL;
+          add(lOrphans, lItr->second.mSizeBytes);
+        }
+      }
+    }
+    lRegistry.mUsages.erase(lUsageItr);
+  }
+  lRegistry.mMutex.unlock();
+}
@@ -0,0 +1,114 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/MemoryAccounting.hpp
+ * \brief MemoryAccounting class header.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#ifndef VIPERS_MEMORY_ACCOUNTING_HPP
+#define VIPERS_MEMORY_ACCOUNTING_HPP
+
+#include <map>
+
+namespace VIPERS
+{
+
+  using namespace std;
+
+  /*! \brief %MemoryAccounting class.
+    \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+
+    Process-wide accounting of image memory.  Each allocated block is attributed to the owner that is current
+    in the calling thread when the block is allocated (see MemoryAccounting::Scope), and is released from that
+    same owner, whatever thread releases it.  %Module sets itself as the owner while running its module specific
+    functions, so that managed %Image buffers and IplImage created through ImageUtils are attributed to it.
+    Blocks allocated outside of any scope are attributed to the NULL owner.
+  */
+  class MemoryAccounting
+  {
+    public:
+
+      /*! \brief Memory usage of an owner
+        \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+      */
+      struct Usage
+      {
+        //! Default constructor
+        Usage() : mLiveBytes(0), mPeakBytes(0), mNbBlocks(0) {}
+
+        unsigned long mLiveBytes; //!< Number of bytes currently allocated
+        unsigned long mPeakBytes; //!< Maximum number of bytes allocated at the same time
+        unsigned long mNbBlocks; //!< Number of blocks currently allocated
+      };
+
+      /*! \brief Set the current owner of the calling thread for the lifetime of the object
+        \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+      */
+      class Scope
+      {
+        public:
+          //! Explicit constructor, set the current owner
+          explicit Scope(const void* inOwner);
+          //! Destructor, restore previous owner
+          ~Scope();
+        private:
+          //! Restrict (disable) copy constructor
+          Scope(const Scope&);
+          //! Restrict (disable) assignment operator
+          void operator=(const Scope&);
+
+          const void* mPreviousOwner; //!< Owner that was current before the scope
+      };
+
+      //! Record a block allocated for the current owner
+      static void allocate(const void* inBlock, unsigned long inSizeBytes);
+      //! Record the release of a block (unknown blocks are ignored)
+      static void release(const void* inBlock);
+
+      //! Get the size in bytes of a block if it is recorded for an owner (0 otherwise)
+      static unsigned long getBlockSize(const void* inBlock, const void* inOwner);
+
+      //! Get current owner of the calling thread
+      static const void* getCurrentOwner();
+      //! Get memory usage of an owner
+      static Usage getUsage(const void* inOwner);
+      //! Get memory usage of all owners
+      static Usage getTotalUsage();
+      //! Move blocks still allocated by an owner to the NULL owner, and forget the owner
+      static void forgetOwner(const void* inOwner);
+
+    private:
+
+      //! Restrict (disable) constructor
+      MemoryAccounting();
+  };
+
+}
+
+#endif //VIPERS_MEMORY_ACCOUNTING_HPP
@@ -36,6 +36,14 @@
 #include <memory>
 #include <iostream>
 
+#if defined(_MSC_VER)
+  #include <intrin.h>
+  #pragma intrinsic(_InterlockedExchangeAdd)
+  #define VIPERS_ATOMIC_FETCH_ADD(inPtr, inValue) _InterlockedExchangeAdd(inPtr, inValue)
+#else
+  #define VIPERS_ATOMIC_FETCH_ADD(inPtr, inValue) __sync_fetch_and_add(inPtr, inValue)
+#endif
+
 using namespace VIPERS;
 using namespace std;
 
@@ -48,7 +56,11 @@ Module::Module(const string& inName, const string& inDisplayName, const string&
 	mVersion = inVersion.c_str();
 	mMaxNumberFrame = 0;
 	mFrameRate = 0.0;
+	mPointwiseKernel = false;
+	mRowHalo = 0;
+	mPlannedOutputs = false;
 	mState = eStateUninitialized;
+	mParametersVersion = 1;
 }
 
 /*! \todo
@@ -69,6 +81,8 @@ Module::~Module()
 	mInputSlots.clear();
 	mOutputSlots.clear();
 	mParameters.clear();
+
+	MemoryAccounting::forgetOwner(this);
 }
 
 /*! \todo
@@ -80,6 +94,7 @@ void Module::init()
   if(lState!=eStateUninitialized && lState!=eStateInitialized && lState!=eStateStopped)
     throw(Exception(Exception::eCodeInvalidOperationModuleState, string("Module \"") + getLabel().c_str() + string("\" cannot be initialized since it is not stopped or uninitialized")));
 
+	MemoryAccounting::Scope lMemoryScope(this);
 	try
 	{
 		initFunction();
@@ -102,6 +117,7 @@ void Module::start()
   if(lState!=eStateInitialized && lState!=eStateStopped && lState!=eStatePaused)
     throw(Exception(Exception::eCodeInvalidOperationModuleState, string("Module \"") + getLabel().c_str() + string("\" cannot be started since it is not stopped, paused, or initialized")));
 
+	MemoryAccounting::Scope lMemoryScope(this);
 	try
 	{
 		startFunction();
@@ -121,6 +137,9 @@ void Module::process(unsigned int inFrameNumber)
   if(lState!=eStateStarted && lState!=eStatePaused)
     throw(Exception(Exception::eCodeInvalidOperationModuleState, string("Module \"") + getLabel().c_str() + string("\" cannot process a frame since it is not started")));
 
+	applyPendingParameterValues();
+
+	MemoryAccounting::Scope lMemoryScope(this);
 	try
 	{
 		processFunction(inFrameNumber);
@@ -132,6 +151,83 @@ void Module::process(unsigned int inFrameNumber)
 	notifyMonitors();
 }
 
+/*! \todo
+*/
+bool Module::hasPointwiseKernel() const throw()
+{
+	return mPointwiseKernel;
+}
+
+/*! \todo
+*/
+unsigned int Module::getRowHalo() const throw()
+{
+	return mRowHalo;
+}
+
+/*! \todo
+*/
+bool Module::hasPlannedOutputs() const throw()
+{
+	return mPlannedOutputs;
+}
+
+/*! Used by the %Kernel to process a chain of modules with pointwise kernels one strip of rows at a time, instead of
+    calling process(): beginPointwise() is called for every %Module of the chain, then processPointwise() for every
+    strip and every %Module, and endPointwise() for every %Module.  The %Kernel locks all the slots used by the chain
+    beforehand, since a %Module cannot lock a slot whose mutex is shared with an upstream %Module of the same chain.
+*/
+void Module::beginPointwise(unsigned int inFrameNumber)
+{
+  State lState = getState();
+  if(lState!=eStateStarted && lState!=eStatePaused)
+    throw(Exception(Exception::eCodeInvalidOperationModuleState, string("Module \"") + getLabel().c_str() + string("\" cannot process a frame since it is not started")));
+  if(!mPointwiseKernel)
+    throw(Exception(Exception::eCodeUseModule, string("Module \"") + getLabel().c_str() + string("\" does not have a pointwise kernel")));
+
+	applyPendingParameterValues();
+
+	MemoryAccounting::Scope lMemoryScope(this);
+	beginPointwiseFunction(inFrameNumber);
+}
+
+/*! \todo
+*/
+void Module::processPointwise(unsigned int inFirstRow, unsigned int inEndRow)
+{
+	MemoryAccounting::Scope lMemoryScope(this);
+	processPointwiseFunction(inFirstRow, inEndRow);
+}
+
+/*! Monitors are not notified, since slots are still locked: the caller must call notifyMonitors() after unlocking them.
+*/
+void Module::endPointwise()
+{
+	MemoryAccounting::Scope lMemoryScope(this);
+	endPointwiseFunction();
+}
+
+/*! \todo
+*/
+void Module::beginPointwiseFunction(unsigned int /*inFrameNumber*/)
+{
+	throw(Exception(Exception::eCodeUseModule, string("Module \"") + getLabel().c_str() + string("\" does not have a pointwise kernel")));
+}
+
+/*! \todo
+*/
+void Module::processPointwiseFunction(unsigned int /*inFirstRow*/, unsigned int /*inEndRow*/)
+{
+	throw(Exception(Exception::eCodeUseModule, string("Module \"") + getLabel().c_str() + string("\" does not have a pointwise kernel")));
+}
+
+/*! \todo
+*/
+void Module::endPointwiseFunction()
+{
+	throw(Exception(Exception::eCodeUseModule, string("Module \"") + getLabel().c_str() + string("\" does not have a pointwise kernel")));
+}
+
 /*! \todo
 */
 void Module::stop()
@@ -141,6 +237,9 @@ void Module::stop()
   if(lState!=eStateStarted && lState!=eStatePaused)
     throw(Exception(Exception::eCodeInvalidOperationModuleState, string("Module \"") + getLabel().c_str() + string("\" cannot be stopped since it is not started or paused")));
 
+	applyPendingParameterValues();
+
+	MemoryAccounting::Scope lMemoryScope(this);
 	try
 	{
 		stopFunction();
@@ -160,6 +259,7 @@ void Module::pause()
   if(lState!=eStateStarted)
     throw(Exception(Exception::eCodeInvalidOperationModuleState, string("Module \"") + getLabel().c_str() + string("\" cannot be paused since it is not started")));
 
+  MemoryAccounting::Scope lMemoryScope(this);
   try
   {
     pauseFunction();
@@ -175,6 +275,7 @@ void Module::pause()
 */
 void Module::reset()
 {
+	MemoryAccounting::Scope lMemoryScope(this);
 	try
 	{
 		resetFunction();
@@ -190,6 +291,7 @@ void Module::reset()
 */
 ParameterList Module::updateParameters()
 {
+	MemoryAccounting::Scope lMemoryScope(this);
 	try
 	{
 		updateParametersFunction();
@@ -250,7 +352,7 @@ void Module::connect(ModuleSlot::SlotType inSlotType, const string& inSlotName,
 	else if(inSlotType==ModuleSlot::eSlotTypeOutput)
 	{
 		ModuleSlotMap::iterator lOutputSlotItr = mOutputSlots.find(inSlotName);
-		if(lOutputSlotItr!=mInputSlots.end())
+		if(lOutputSlotItr!=mOutputSlots.end())
 		{
 			ModuleSlotMap::iterator lInputSlotItr;
 			try
@@ -415,6 +517,13 @@ double Module::getFrameRate() throw()
 	return lTmpFrameRate;
 }
 
+/*! \todo
+*/
+MemoryAccounting::Usage Module::getMemoryUsage() const throw()
+{
+	return MemoryAccounting::getUsage(this);
+}
+
 /*! \todo
 */
 void Module::setLabel(string inLabel) throw()
@@ -479,13 +588,13 @@ Parameter Module::getParameter(const string& inName) const
 	return *lTmpParameterPtr;
 }
 
-/*! \todo
+/*! The value is verified, and set right away.  If values set with setParameterValues() are waiting for the next frame,
+    it joins them instead, and replaces the value waiting for the same parameter: it is then set with them, after them.
 */
 void Module::setParameterValue(const string& inName, const string& inValue)
 {
 	Module::State lState = getState();
 	string lVerifyStr;
-	ValueSet lPossibleValues;
 
 	mParametersMutex.lock();
 
@@ -495,27 +604,20 @@ void Module::setParameterValue(const string& inName, const string& inValue)
 		Parameter lTmpParameter(lParameterMapItr->second);
 		lTmpParameter.setValueStr(inValue.c_str());
 
-		lVerifyStr = verifyParameterFunction(lTmpParameter);
+		lVerifyStr = checkParameterValue(lParameterMapItr->second, lTmpParameter, lState);
 		if(!lVerifyStr.empty())
 		{
 			mParametersMutex.unlock();
 			throw(Exception(Exception::eCodeInvalidParameter, lVerifyStr.c_str()));
 		}
 
-		if((lState==Module::eStateStarted || lState==Module::eStatePaused) && !lParameterMapItr->second.getRunTimeChange())
-		{
-			mParametersMutex.unlock();
-			throw(Exception(Exception::eCodeInvalidParameter, string("Parameter \"") + lTmpParameter.getDisplayName().c_str() + string("\" cannot be changed once the module is started") ));
-		}
-
-		lPossibleValues = lParameterMapItr->second.getPossibleValues();
-		if(lPossibleValues.size() && lPossibleValues.find(lTmpParameter.getValue())==lPossibleValues.end())
+		if(mPendingParameterValues.empty())
 		{
-			mParametersMutex.unlock();
-			throw(Exception(Exception::eCodeInvalidParameter, string("Value \"") + lTmpParameter.getValue().c_str() + string("\" is not valid for parameter ") + lTmpParameter.getDisplayName().c_str() + string("\"") ));
+			lParameterMapItr->second.setValueStr(inValue.c_str());
+			incrementParametersVersion();
 		}
-
-		lParameterMapItr->second.setValueStr(inValue.c_str());
+		else
+			mPendingParameterValues[lParameterMapItr->first] = inValue.c_str();
 		mParametersMutex.unlock();
 	}
 	else
@@ -525,46 +627,170 @@ void Module::setParameterValue(const string& inName, const string& inValue)
 	}
 }
 
-/*! \todo
+/*! Same as setParameterValue(const string&, const string&), with the name and value of \c inParameter.
 */
 void Module::setParameterValue(const Parameter& inParameter)
 {
 	Module::State lState = getState();
 	string lVerifyStr;
-	ValueSet lPossibleValues;
 
 	mParametersMutex.lock();
 
 	ParameterMap::iterator lParameterMapItr = mParameters.find(inParameter.getName().c_str());
 	if(lParameterMapItr!=mParameters.end())
 	{
-		lVerifyStr = verifyParameterFunction(inParameter);
+		lVerifyStr = checkParameterValue(lParameterMapItr->second, inParameter, lState);
 		if(!lVerifyStr.empty())
 		{
 			mParametersMutex.unlock();
 			throw(Exception(Exception::eCodeInvalidParameter, lVerifyStr.c_str()));
 		}
 
-		if((lState==Module::eStateStarted || lState==Module::eStatePaused) && !lParameterMapItr->second.getRunTimeChange())
+		if(mPendingParameterValues.empty())
+		{
+			lParameterMapItr->second.setValueStr(inParameter.getValue());
+			incrementParametersVersion();
+		}
+		else
+			mPendingParameterValues[lParameterMapItr->first] = inParameter.getValue();
+		mParametersMutex.unlock();
+	}
+	else
+	{
+		mParametersMutex.unlock();
+		throw(Exception(Exception::eCodeInvalidParameter, string("Module \"") + getLabel() + string("\" does not have a parameter named \"") + inParameter.getName().c_str() + string("\"")));
+	}
+}
+
+/*! All values are verified before any is set: if one of them is invalid, an exception is thrown and no parameter
+    changes.  When the %Module is started or paused, the values are kept until the next call to process() (or stop()),
+    and then set together, so processFunction() never sees only part of them.  Otherwise, they are set right away.
+    In both cases, the parameters version is incremented only once for the whole set, and updateParametersFunction()
+    is run once the set is applied if one of its parameters has dependent parameters.  A set accepted here is always
+    applied: it is not verified again.
+*/
+void Module::setParameterValues(const ParameterList& inParameters)
+{
+	Module::State lState = getState();
+	string lVerifyStr;
+	map<string, string> lValues;
+
+	mParametersMutex.lock();
+
+	for(ParameterList::const_iterator lItr = inParameters.begin(); lItr!=inParameters.end(); lItr++)
+	{
+		ParameterMap::iterator lParameterMapItr = mParameters.find(lItr->getName().c_str());
+		if(lParameterMapItr==mParameters.end())
 		{
 			mParametersMutex.unlock();
-			throw(Exception(Exception::eCodeInvalidParameter, string("Parameter \"") + inParameter.getDisplayName().c_str() + string("\" cannot be changed once the module is started") ));
+			throw(Exception(Exception::eCodeInvalidParameter, string("Module \"") + getLabel() + string("\" does not have a parameter named \"") + lItr->getName().c_str() + string("\"")));
 		}
 
-		lPossibleValues = lParameterMapItr->second.getPossibleValues();
-		if(lPossibleValues.size() && lPossibleValues.find(inParameter.getValue())==lPossibleValues.end())
+		Parameter lTmpParameter(lParameterMapItr->second);
+		lTmpParameter.setValueStr(lItr->getValue());
+
+		lVerifyStr = checkParameterValue(lParameterMapItr->second, lTmpParameter, lState);
+		if(!lVerifyStr.empty())
 		{
 			mParametersMutex.unlock();
-			throw(Exception(Exception::eCodeInvalidParameter, string("Value \"") + inParameter.getValue().c_str() + string("\" is not valid for parameter ") + inParameter.getDisplayName().c_str() + string("\"") ));
+			throw(Exception(Exception::eCodeInvalidParameter, lVerifyStr.c_str()));
 		}
 
-		lParameterMapItr->second.setValueStr(inParameter.getValue());
-		mParametersMutex.unlock();
+		lValues[lItr->getName()] = lItr->getValue();
 	}
-	else
+
+	if(lState==Module::eStateStarted || lState==Module::eStatePaused)
 	{
+		for(map<string, string>::const_iterator lItr = lValues.begin(); lItr!=lValues.end(); lItr++)
+			mPendingParameterValues[lItr->first] = lItr->second;
+	}
+	else if(!lValues.empty())
+	{
+		for(map<string, string>::const_iterator lItr = lValues.begin(); lItr!=lValues.end(); lItr++)
+			mParameters.find(lItr->first)->second.setValueStr(lItr->second);
+		incrementParametersVersion();
 		mParametersMutex.unlock();
-		throw(Exception(Exception::eCodeInvalidParameter, string("Module \"") + getLabel() + string("\" does not have a parameter named \"") + inParameter.getName().c_str() + string("\"")));
+		updateDependentParameters(lValues);
+		return;
+	}
+
+	mParametersMutex.unlock();
+}
+
+/*! Values waiting for the next frame are set by the next call to process() or stop().
+*/
+bool Module::hasPendingParameterValues() const throw()
+{
+	mParametersMutex.lock();
+	bool lPending = !mPendingParameterValues.empty();
+	mParametersMutex.unlock();
+	return lPending;
+}
+
+/*! The version is incremented once for each parameter value set on its own, and once for each set of values applied
+    together.  Comparing it with a version read before tells if any parameter changed in between.
+*/
+unsigned long Module::getParametersVersion() const throw()
+{
+	// Atomic read with a full barrier, without the parameters mutex: called by modules on each frame
+	return static_cast<unsigned long>(VIPERS_ATOMIC_FETCH_ADD(const_cast<volatile long*>(&mParametersVersion), 0));
+}
+
+/*! \todo
+*/
+string Module::checkParameterValue(const Parameter& inCurrentParameter, const Parameter& inNewParameter, State inState) const throw()
+{
+	string lVerifyStr = verifyParameterFunction(inNewParameter);
+	if(!lVerifyStr.empty())
+		return lVerifyStr;
+
+	if((inState==Module::eStateStarted || inState==Module::eStatePaused) && !inCurrentParameter.getRunTimeChange())
+		return string("Parameter \"") + inNewParameter.getDisplayName().c_str() + string("\" cannot be changed once the module is started");
+
+	const ValueSet& lPossibleValues = inCurrentParameter.getPossibleValues();
+	if(lPossibleValues.size() && lPossibleValues.find(inNewParameter.getValue())==lPossibleValues.end())
+		return string("Value \"") + inNewParameter.getValue().c_str() + string("\" is not valid for parameter ") + inNewParameter.getDisplayName().c_str() + string("\"");
+
+	return "";
+}
+
+/*! The values were verified when they were set, they are all applied together.  Then, dependent parameters are
+    updated (see updateDependentParameters()).
+*/
+void Module::applyPendingParameterValues()
+{
+	map<string, string> lValues;
+
+	mParametersMutex.lock();
+	lValues.swap(mPendingParameterValues);
+	if(!lValues.empty())
+	{
+		for(map<string, string>::const_iterator lItr = lValues.begin(); lItr!=lValues.end(); lItr++)
+			mParameters.find(lItr->first)->second.setValueStr(lItr->second);
+		incrementParametersVersion();
+	}
+	mParametersMutex.unlock();
+
+	if(!lValues.empty())
+		updateDependentParameters(lValues);
+}
+
+/*! Same as updateParameters() after a parameter with dependent parameters is set from the user interface: the
+    %Module enables or disables the parameters that depend on the values just applied.
+*/
+void Module::updateDependentParameters(const map<string, string>& inValues)
+{
+	bool lHasDependents = false;
+
+	mParametersMutex.lock();
+	for(map<string, string>::const_iterator lItr = inValues.begin(); lItr!=inValues.end() && !lHasDependents; lItr++)
+		lHasDependents = !mParameters.find(lItr->first)->second.getDependentParameterNameSet().empty();
+	mParametersMutex.unlock();
+
+	if(lHasDependents)
+	{
+		MemoryAccounting::Scope lMemoryScope(this);
+		updateParametersFunction();
 	}
 }
 
@@ -764,7 +990,7 @@ void Module::incrementModuleSlotUseCount(ModuleSlot::SlotType inSlotType, const
 	else if(inSlotType==ModuleSlot::eSlotTypeOutput)
 	{
 		ModuleSlotMap::iterator lOutputSlotItr = mOutputSlots.find(inSlotName);
-		if(lOutputSlotItr!=mInputSlots.end())
+		if(lOutputSlotItr!=mOutputSlots.end())
 		{
 			lOutputSlotItr->second->incrementUseCount();
 		}
@@ -799,7 +1025,7 @@ void Module::decrementModuleSlotUseCount(ModuleSlot::SlotType inSlotType, const
 	else if(inSlotType==ModuleSlot::eSlotTypeOutput)
 	{
 		ModuleSlotMap::iterator lOutputSlotItr = mOutputSlots.find(inSlotName);
-		if(lOutputSlotItr!=mInputSlots.end())
+		if(lOutputSlotItr!=mOutputSlots.end())
 		{
 			lOutputSlotItr->second->decrementUseCount();
 		}
@@ -950,12 +1176,77 @@ void Module::setFrameRate(double inFrameRate) throw()
 	mFrameRateMutex.unlock();
 }
 
+/*! A %Module with a pointwise kernel computes each row of its outputs only from the same row of its inputs, or from
+    the rows around it when it declares a row halo (see setRowHalo()), and implements beginPointwiseFunction(),
+    processPointwiseFunction() and endPointwiseFunction().  Its processFunction() usually locks its slots and calls the
+    three of them over all the rows.
+*/
+void Module::setPointwiseKernel(bool inPointwiseKernel) throw()
+{
+	mPointwiseKernel = inPointwiseKernel;
+}
+
+/*! A %Module with a row halo computes each row of its outputs from the rows of its inputs that are at most
+    inRowHalo rows away (a 3x3 filter has a halo of 1).  Rows outside the images must be handled by the %Module
+    itself (clamped, mirrored...).  Within a chain, the %Kernel processes such a %Module inRowHalo rows behind the
+    modules it reads from, so the rows it needs are always written; its outputs are never written in place over its
+    inputs.  Modules that need whole images (resizing, distance transforms...) do not declare a pointwise kernel and
+    are processed as full frames between chains.
+*/
+void Module::setRowHalo(unsigned int inRowHalo) throw()
+{
+	mRowHalo = inRowHalo;
+}
+
+/*! A %Module with planned outputs creates the images of its output slots with createPlannedIplImage() (see
+    ImageUtils.hpp) and recreates them when isPlannedIplImageStale() returns true.  It must not read its output images
+    from a previous frame, since other modules use the same memory between two frames.
+*/
+void Module::setPlannedOutputs(bool inPlannedOutputs) throw()
+{
+	mPlannedOutputs = inPlannedOutputs;
+}
+
+/*! Splits the work of a processing function, usually by rows, over the threads of ThreadPool instead of threads
+    of the %Module.  Ranges are run with the %Module as memory owner.  When called from a task of another
+    parallelFor(), or while another %Module uses the pool, the task runs in the calling thread, so modules never use
+    more threads than the pool has.  inGrain is the smallest number of iterations worth giving to a thread.
+*/
+void Module::parallelFor(unsigned int inFirst, unsigned int inEnd, ParallelTask& inTask, unsigned int inGrain) const
+{
+	MemoryAccounting::Scope lMemoryScope(this);
+	ThreadPool::getInstance().parallelFor(inFirst, inEnd, inTask, inGrain);
+}
+
+/*! An output slot is consumed when its use count is not zero: each connected input slot and each attached
+    Monitor uses it.  Modules call this function on each frame to skip the outputs nobody reads, such as
+    visualizations (see ModuleSlot::isUsed()).
+*/
+bool Module::isOutputUsed(const ModuleSlot* inSlot) const throw()
+{
+	return inSlot && inSlot->isUsed();
+}
+
+/*! The timestamp is the current time of the common clock (see FrameMetadata::getCurrentTime()), the source label
+    is the label of this %Module, and the generation counter of the image is incremented.  Processing modules
+    should use Image::propagateMetadata() instead, so the metadata of their inputs is carried to their outputs.
+*/
+void Module::stampFrameMetadata(Image& ioImage, unsigned long inSequenceNumber) const
+{
+	FrameMetadata& lMetadata = ioImage.getMetadata();
+	lMetadata.setTimestamp(FrameMetadata::getCurrentTime());
+	lMetadata.setSequenceNumber(inSequenceNumber);
+	lMetadata.setSourceLabel(getLabel());
+	lMetadata.incrementGeneration();
+}
+
 /*! \todo
 */
 void Module::newParameter(const Parameter& inParameter) throw()
 {
 	mParametersMutex.lock();
 	mParameters.insert( pair<string, Parameter>(inParameter.getName().c_str(), inParameter) );
+	incrementParametersVersion();
 	mParametersMutex.unlock();
 }
 
@@ -992,11 +1283,34 @@ void Module::setLockedParameter(const Parameter& inParameter)
 	if(lParameterMapItr!=mParameters.end())
 	{
 		lParameterMapItr->second = inParameter;
+		incrementParametersVersion();
 	}
 	else
 		throw(Exception(Exception::eCodeBuggyModule, string("Module \"") + getLabel() + string(" does not have a parameter named \"") + inParameter.getName().c_str() + string("\".  This is a module bug.")));
 }
 
+/*! A module keeps the last version it has read, and gets its parameters again only when this function returns true.
+    The version is read atomically, without locking the parameters, so checking it on each frame costs no lock.  A
+    change that happens while the module is reading its parameters is seen on the next call, since the version is
+    always incremented with the change.
+*/
+bool Module::parametersChanged(unsigned long& ioVersion) const throw()
+{
+	unsigned long lVersion = getParametersVersion();
+	if(lVersion==ioVersion)
+		return false;
+	ioVersion = lVersion;
+	return true;
+}
+
+/*! Writers are serialized by the parameters mutex, the increment is atomic so that getParametersVersion() can
+    read the version without it.
+*/
+void Module::incrementParametersVersion() throw()
+{
+	VIPERS_ATOMIC_FETCH_ADD(&mParametersVersion, 1);
+}
+
 /*! \todo
 */
 void Module::setState(State inState) throw()
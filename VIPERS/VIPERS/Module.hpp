@@ -35,10 +35,12 @@
 #define VIPERS_MODULE_HPP
 
 #include "Exception.hpp"
+#include "MemoryAccounting.hpp"
 #include "ModuleSlot.hpp"
 #include "Monitor.hpp"
 #include "Parameter.hpp"
 #include "Property.hpp"
+#include "ThreadPool.hpp"
 #include "PACC/Threading/Mutex.hpp"
 #include <string>
 #include <map>
@@ -98,6 +100,21 @@ namespace VIPERS
 	    //! Resetting the %Module as it was when created
 	    void reset();
 
+	    //! Check if the %Module has a pointwise kernel, so it can be processed by strips of rows
+	    bool hasPointwiseKernel() const throw();
+	    //! Prepare the current frame for processing by strips (slots must be locked by the caller)
+	    void beginPointwise(unsigned int inFrameNumber);
+	    //! Process rows [inFirstRow, inEndRow) of the frame prepared by beginPointwise() (slots must be locked by the caller)
+	    void processPointwise(unsigned int inFirstRow, unsigned int inEndRow);
+	    //! Complete the frame prepared by beginPointwise() (slots must be locked by the caller)
+	    void endPointwise();
+
+	    //! Get the number of rows above and below a strip that the pointwise kernel reads from its inputs
+	    unsigned int getRowHalo() const throw();
+
+	    //! Check if the images of the output slots can be stored in buffers planned by the %Kernel
+	    bool hasPlannedOutputs() const throw();
+
 	    //! Update %Module parameters
 	    ParameterList updateParameters();
 	    //! Verify if %Parameter value is valid without actually changing the value
@@ -133,6 +150,8 @@ namespace VIPERS
 	    unsigned int getMaxNumberFrames() throw();
 	    //! Get the frame rate at which the %Module can process frames
 	    double getFrameRate() throw();
+	    //! Get live and peak image memory allocated by the %Module
+	    MemoryAccounting::Usage getMemoryUsage() const throw();
 
 	    //! Get input slots list
 	    const ModuleSlotMap& getInputSlots() const throw();
@@ -156,10 +175,16 @@ namespace VIPERS
 	    ParameterMap getParameterMap() const throw();
 	    //! Get a parameter by its name
 	    Parameter getParameter(const string& inName) const;
-	    //! Set a parameter value
+	    //! Set a parameter value (with the values waiting for the next frame, if any)
 	    void setParameterValue(const string& inName, const string& inValue);
-	    //! Set a parameter value
+	    //! Set a parameter value (with the values waiting for the next frame, if any)
 	    void setParameterValue(const Parameter& inParameter);
+	    //! Set several parameter values, verified together and applied atomically between two frames
+	    void setParameterValues(const ParameterList& inParameters);
+	    //! Check if parameter values set with setParameterValues() are waiting for the next frame
+	    bool hasPendingParameterValues() const throw();
+	    //! Get parameters version, incremented each time a parameter is set
+	    unsigned long getParametersVersion() const throw();
 
 	    //! Attach a %Monitor
 	    void attachMonitor(Monitor* ioMonitor, bool inAddToMonitor=true) throw();
@@ -209,6 +234,13 @@ namespace VIPERS
 	    //! Resetting the %Module as it was when created (Module specific)
 	    virtual void resetFunction() = 0;
 
+	    //! Check inputs, allocate outputs and read parameters for a frame processed by strips (Module specific, pointwise kernel only)
+	    virtual void beginPointwiseFunction(unsigned int inFrameNumber);
+	    //! Process rows [inFirstRow, inEndRow) of the outputs from rows [inFirstRow-halo, inEndRow+halo) of the inputs (Module specific, pointwise kernel only)
+	    virtual void processPointwiseFunction(unsigned int inFirstRow, unsigned int inEndRow);
+	    //! Complete a frame processed by strips (Module specific, pointwise kernel only)
+	    virtual void endPointwiseFunction();
+
 	    //! Update %Module parameters (Module specific)
 	    virtual void updateParametersFunction() = 0;
 	    //! Verify if Parameter value is valid without actually changing the value (Module specific)
@@ -225,10 +257,24 @@ namespace VIPERS
 	    void setMaxNumberFrames(unsigned int inMaxNbFrames) throw();
 	    //! Set the maximum number of frame (for %Module development)
 	    void setFrameRate(double inFrameRate) throw();
+	    //! Declare that the %Module implements the pointwise kernel functions (for %Module development)
+	    void setPointwiseKernel(bool inPointwiseKernel) throw();
+	    //! Declare the number of input rows read above and below each strip by the pointwise kernel (for %Module development)
+	    void setRowHalo(unsigned int inRowHalo) throw();
+	    //! Declare that the %Module creates its output images over the planned buffers of its slots (for %Module development)
+	    void setPlannedOutputs(bool inPlannedOutputs) throw();
+
+	    //! Run a task over iterations [inFirst, inEnd) on the process-wide thread pool (for %Module development)
+	    void parallelFor(unsigned int inFirst, unsigned int inEnd, ParallelTask& inTask, unsigned int inGrain = 1) const;
+	    //! Check if an output slot is consumed, by a connected input slot or an attached monitor (for %Module development)
+	    bool isOutputUsed(const ModuleSlot* inSlot) const throw();
 
 	    //! Define a new parameter (for %Module development)
 	    void newParameter(const Parameter& inParameter) throw();
 
+	    //! Set metadata of a frame produced by a source %Module (for %Module development)
+	    void stampFrameMetadata(Image& ioImage, unsigned long inSequenceNumber) const;
+
 	    //! Lock access to parameters (for %Module development)
 	    void lockParameters() const;
 	    //! Unlock access to parameters (for %Module development)
@@ -237,6 +283,8 @@ namespace VIPERS
 	    Parameter getLockedParameter(const string& inName) const;
 	    //! Get a parameter (for %Module development)
 	    void setLockedParameter(const Parameter& inParameter);
+	    //! Check if parameters changed since the given version, and update it (for %Module development, parameters unlocked)
+	    bool parametersChanged(unsigned long& ioVersion) const throw();
 
 	    string mShortDescription; //!< %Module short description
 	    string mLongDescription; //!< %Module long description
@@ -250,6 +298,14 @@ namespace VIPERS
 	    void operator=(const Module&);
 	    //! Set Module state
 	    void setState(State inState) throw();
+	    //! Verify a new value for a parameter, return an error message if it cannot be set (parameters must be locked)
+	    string checkParameterValue(const Parameter& inCurrentParameter, const Parameter& inNewParameter, State inState) const throw();
+	    //! Apply together the parameter values set with setParameterValues() while the %Module was processing
+	    void applyPendingParameterValues();
+	    //! Run updateParametersFunction() if one of the parameters of a set just applied has dependent parameters
+	    void updateDependentParameters(const map<string, string>& inValues);
+	    //! Atomically increment the parameters version (parameters must be locked)
+	    void incrementParametersVersion() throw();
 
 
 	    string mName; //!< %Module unique name
@@ -265,11 +321,16 @@ namespace VIPERS
 
 	    ParameterMap mParameters; //!< List of parameters for the %Module
 	    Threading::Mutex mParametersMutex; //!< Mutex used to protect access to parameters
+	    volatile long mParametersVersion; //!< Incremented each time a parameter is set (written with mParametersMutex locked, read atomically without it)
+	    map<string, string> mPendingParameterValues; //!< Values waiting for the next frame, by parameter name (protected by mParametersMutex)
 
 	    unsigned int mMaxNumberFrame; //!< Maximum number of frame that can be processed
 	    Threading::Mutex mMaxNumberFramesMutex; //!< Mutex used to protect access to mMaxNumberFrame variable
 
 	    double mFrameRate; //!< Frame rate at which the %Module can process frames
+	    bool mPointwiseKernel; //!< %Module implements the pointwise kernel functions (set by the constructor of the %Module only)
+	    unsigned int mRowHalo; //!< Number of input rows read above and below a strip by the pointwise kernel (set by the constructor of the %Module only)
+	    bool mPlannedOutputs; //!< %Module creates its output images over planned buffers (set by the constructor of the %Module only)
 	    Threading::Mutex mFrameRateMutex; //!< Mutex used to protect access to mFrameRate variable
 
 	    MonitorSet mMonitorSet; //!< Set of attached monitors
@@ -46,6 +46,15 @@ ModuleSlot::ModuleSlot(const Module* inModule, const string& inName, const strin
 	mType = eSlotTypeInput;
 	mDescription = inDescription.c_str();
     mImagePtr = NULL;
+    mMutexPtr = NULL;
+    mOwnImagePtr = NULL;
+    mOwnMutexPtr = NULL;
+    mAlias = NULL;
+    mPlannedBuffer = NULL;
+    mPlannedBufferSize = 0;
+    mPlannedBufferRequest = 0;
+    mInPlaceInput = NULL;
+    mInPlace = false;
     mConnected = false;
     if(!inModule)
 		throw(Exception(Exception::eCodeBuggyModule, "Input slot \"" + mName + "\" created with a NULL module pointer"));
@@ -76,6 +85,14 @@ ModuleSlot::ModuleSlot(const Module* inModule, const string& inName, const strin
 	mModule = inModule;
 
     mMutexPtr = new Threading::Mutex();
+    mOwnImagePtr = mImagePtr;
+    mOwnMutexPtr = mMutexPtr;
+    mAlias = NULL;
+    mPlannedBuffer = NULL;
+    mPlannedBufferSize = 0;
+    mPlannedBufferRequest = 0;
+    mInPlaceInput = NULL;
+    mInPlace = false;
     mUseCount = 0;
 }
 
@@ -85,7 +102,7 @@ ModuleSlot::~ModuleSlot()
 {
 	disconnectAll();
     if(mType == eSlotTypeOutput)
-        delete mMutexPtr;
+        delete mOwnMutexPtr;
 }
 
 /*! \todo
@@ -399,9 +416,207 @@ unsigned int ModuleSlot::getUseCount() const throw()
 	return lResult;
 }
 
+/*! Modules check their optional outputs on each frame: a connection or a monitor added or removed while a frame is
+    processed is seen on the next call.
+*/
+bool ModuleSlot::isUsed() const throw()
+{
+	bool lResult;
+	mUseCountMutex.lock();
+	lResult = (mUseCount!=0);
+	mUseCountMutex.unlock();
+	return lResult;
+}
+
 /*! \todo
 */
 const Module* ModuleSlot::getModule() const throw()
 {
 	return mModule;
 }
+
+/*! Only managed images are counted: views, outputs written in place over the image of their producer and
+    planned buffers of the kernel arena do not own their data.  The slot is locked while its image is read.
+*/
+unsigned long ModuleSlot::getMemoryUsage() const throw()
+{
+	if(mType!=eSlotTypeOutput || mAlias || !mImagePtr)
+		return 0;
+
+	unsigned long lSizeBytes = 0;
+	try
+	{
+		lock();
+	}
+	catch(...)
+	{
+		return 0;
+	}
+
+	const Image* lImage = *mImagePtr;
+	if(lImage && !lImage->isView())
+	{
+		if(lImage->isManaged())
+			lSizeBytes = lImage->getSizeBytes();
+		else
+		{
+			// Unmanaged image over a buffer, counted only if the module allocated it (e.g. with createIplImage()),
+			// not if it is borrowed from another module, a planned buffer or a capture device
+			lSizeBytes = MemoryAccounting::getBlockSize(lImage->getData(), mModule);
+		}
+	}
+
+	try
+	{
+		unlock();
+	}
+	catch(...)
+	{
+	}
+
+	return lSizeBytes;
+}
+
+/*! Used by the %Kernel to feed the consumers of a duplicate %Module from the %Module it has been merged into.
+    Both mutexes are locked while the pointers are swapped, so a consumer or a %Monitor never reads an image being
+    written.  The other output slot must outlive the alias: clearAlias() must be called before it is deleted.
+*/
+void ModuleSlot::setAlias(const ModuleSlot* inModuleSlot)
+{
+	ModuleSlotSet::iterator lSlotItr;
+
+	if(mType!=eSlotTypeOutput || !inModuleSlot || inModuleSlot->mType!=eSlotTypeOutput)
+		throw(Exception(Exception::eCodeInvalidSlot, "Slot " + string(*this) + " can only be an alias of an output slot"));
+	if(inModuleSlot->mAlias)
+		inModuleSlot = inModuleSlot->mAlias;
+	if(inModuleSlot==this || inModuleSlot==mAlias)
+		return;
+
+	Threading::Mutex* lOldMutexPtr = mMutexPtr;
+	lOldMutexPtr->lock();
+	inModuleSlot->mOwnMutexPtr->lock();
+
+	mImagePtr = inModuleSlot->mOwnImagePtr;
+	mMutexPtr = inModuleSlot->mOwnMutexPtr;
+	mAlias = inModuleSlot;
+	for(lSlotItr = mModuleSlots.begin(); lSlotItr != mModuleSlots.end(); lSlotItr++)
+	{
+		(*lSlotItr)->mImagePtr = mImagePtr;
+		(*lSlotItr)->mMutexPtr = mMutexPtr;
+	}
+
+	inModuleSlot->mOwnMutexPtr->unlock();
+	lOldMutexPtr->unlock();
+}
+
+/*! \todo
+*/
+void ModuleSlot::clearAlias() throw()
+{
+	ModuleSlotSet::iterator lSlotItr;
+
+	if(!mAlias)
+		return;
+
+	Threading::Mutex* lOldMutexPtr = mMutexPtr;
+	lOldMutexPtr->lock();
+	mOwnMutexPtr->lock();
+
+	mImagePtr = mOwnImagePtr;
+	mMutexPtr = mOwnMutexPtr;
+	mAlias = NULL;
+	for(lSlotItr = mModuleSlots.begin(); lSlotItr != mModuleSlots.end(); lSlotItr++)
+	{
+		(*lSlotItr)->mImagePtr = mImagePtr;
+		(*lSlotItr)->mMutexPtr = mMutexPtr;
+	}
+
+	mOwnMutexPtr->unlock();
+	lOldMutexPtr->unlock();
+}
+
+/*! \todo
+*/
+const ModuleSlot* ModuleSlot::getAlias() const throw()
+{
+	return mAlias;
+}
+
+/*! Used by the %Kernel when it plans the memory of intermediate images (see Kernel::setBufferPlanning()).  The buffer
+    is only valid from the time the %Module processes a frame until the last %Module reading the slot processed it:
+    other modules use the same memory the rest of the time.
+*/
+void ModuleSlot::setPlannedBuffer(char* inData, unsigned long inSizeBytes) throw()
+{
+	mPlannedBufferMutex.lock();
+	mPlannedBuffer = inData;
+	mPlannedBufferSize = inData ? inSizeBytes : 0;
+	mPlannedBufferMutex.unlock();
+}
+
+/*! Called by a %Module with planned outputs each time it checks or creates the image of the slot, so the %Kernel
+    knows the size to plan for the next frames.
+*/
+char* ModuleSlot::getPlannedBuffer(unsigned long inSizeBytes) throw()
+{
+	char* lData = NULL;
+	mPlannedBufferMutex.lock();
+	mPlannedBufferRequest = inSizeBytes;
+	if(mPlannedBuffer && mPlannedBufferSize>=inSizeBytes)
+		lData = mPlannedBuffer;
+	mPlannedBufferMutex.unlock();
+	return lData;
+}
+
+/*! \todo
+*/
+unsigned long ModuleSlot::getPlannedBufferRequest() const throw()
+{
+	unsigned long lRequest;
+	mPlannedBufferMutex.lock();
+	lRequest = mPlannedBufferRequest;
+	mPlannedBufferMutex.unlock();
+	return lRequest;
+}
+
+/*! A %Module declares this in its constructor when it can compute its output over the memory of the input image,
+    each output row being written over the same row of the input.  The %Kernel decides at each frame if the output is
+    written in place (see isInPlace()).
+*/
+void ModuleSlot::setInPlaceInput(const ModuleSlot* inModuleSlot)
+{
+	if(mType!=eSlotTypeOutput)
+		throw(Exception(Exception::eCodeBuggyModule, "Slot \"" + getFullName() + "\" is not an output slot and cannot be written in place"));
+	if(inModuleSlot && (inModuleSlot->mType!=eSlotTypeInput || inModuleSlot->mModule!=mModule))
+		throw(Exception(Exception::eCodeBuggyModule, "Slot \"" + getFullName() + "\" can only be written in place over an input slot of the same module"));
+	mInPlaceInput = inModuleSlot;
+}
+
+/*! \todo
+*/
+const ModuleSlot* ModuleSlot::getInPlaceInput() const throw()
+{
+	return mInPlaceInput;
+}
+
+/*! \todo
+*/
+void ModuleSlot::setInPlace(bool inInPlace) throw()
+{
+	mInPlaceMutex.lock();
+	mInPlace = inInPlace && mInPlaceInput;
+	mInPlaceMutex.unlock();
+}
+
+/*! When true, the %Module publishes the image of its in-place input slot, or an image over the same data, as the
+    image of the output slot, instead of an image of its own.  The %Kernel only allows it when the %Module is the
+    only reader of that input image.
+*/
+bool ModuleSlot::isInPlace() const throw()
+{
+	bool lInPlace;
+	mInPlaceMutex.lock();
+	lInPlace = mInPlace;
+	mInPlaceMutex.unlock();
+	return lInPlace;
+}
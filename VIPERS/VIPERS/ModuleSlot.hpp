@@ -122,9 +122,34 @@ namespace VIPERS
       void decrementUseCount() throw();
       //! Get use count for the slot
       unsigned int getUseCount() const throw();
+      //! Check if the slot is used (use count not zero)
+      bool isUsed() const throw();
 
       //! Get a pointer to the %Module owning the %ModuleSlot
       const Module* getModule() const throw();
+      //! Get the size in bytes of the image owned by an output slot (0 for input slots, aliases and images it does not own)
+      unsigned long getMemoryUsage() const throw();
+
+      //! Make an output slot, and the input slots connected to it, use the image and mutex of another output slot
+      void setAlias(const ModuleSlot* inModuleSlot);
+      //! Make an output slot, and the input slots connected to it, use the image and mutex of the output slot again
+      void clearAlias() throw();
+      //! Get the output slot whose image and mutex are used by an output slot (NULL if it uses its own)
+      const ModuleSlot* getAlias() const throw();
+      //! Set the buffer planned by the %Kernel for the image of an output slot (NULL if none)
+      void setPlannedBuffer(char* inData, unsigned long inSizeBytes) throw();
+      //! Get the buffer planned for the image of an output slot, if it holds the given number of bytes (NULL otherwise)
+      char* getPlannedBuffer(unsigned long inSizeBytes) throw();
+      //! Get the number of bytes last asked for with getPlannedBuffer() (0 if never asked)
+      unsigned long getPlannedBufferRequest() const throw();
+      //! Declare that the image of an output slot can be written over the image of an input slot of the same %Module (for %Module development)
+      void setInPlaceInput(const ModuleSlot* inModuleSlot);
+      //! Get the input slot whose image can hold the image of an output slot (NULL if none)
+      const ModuleSlot* getInPlaceInput() const throw();
+      //! Allow or forbid an output slot to write its image over the image of its in-place input slot (set by the %Kernel)
+      void setInPlace(bool inInPlace) throw();
+      //! Check if an output slot must write its image over the image of its in-place input slot
+      bool isInPlace() const throw();
 
     private:
 
@@ -142,7 +167,18 @@ namespace VIPERS
       Image** mImagePtr; //!< Image structure pointer reference for the slot
       Threading::Mutex* mMutexPtr; //!< Slot %Mutex pointer
 
-      unsigned int mUseCount; //!< Hold the count of the slot's use
+      Image** mOwnImagePtr; //!< Image structure pointer reference of the output slot itself, used when it is not an alias
+      Threading::Mutex* mOwnMutexPtr; //!< %Mutex of the output slot itself, used when it is not an alias
+      const ModuleSlot* mAlias; //!< Output slot whose image and mutex are used instead of the own ones (NULL if none)
+      char* mPlannedBuffer; //!< Buffer planned for the image of the output slot (NULL if none)
+      unsigned long mPlannedBufferSize; //!< Size in bytes of the planned buffer
+      unsigned long mPlannedBufferRequest; //!< Number of bytes last asked for the planned buffer
+      mutable Threading::Mutex mPlannedBufferMutex; //!< %Mutex for planned buffer
+      const ModuleSlot* mInPlaceInput; //!< Input slot whose image can hold the image of the output slot (NULL if none)
+      bool mInPlace; //!< Image of the output slot is written over the image of its in-place input slot
+      mutable Threading::Mutex mInPlaceMutex; //!< %Mutex for in-place flag
+
+      unsigned int mUseCount; //!< Hold the count of the slot's use (accessed with mUseCountMutex locked)
       Threading::Mutex mUseCountMutex; //!< %Mutex for use count
 
       ModuleSlotSet mModuleSlots; //!< List of connected slots
@@ -0,0 +1,1016 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/NumberConversion.cpp
+ * \brief Number to string and string to number conversion functions definition.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#include "NumberConversion.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+using namespace VIPERS;
+using namespace std;
+
+namespace
+{
+
+  bool isSpace(char inChar)
+  {
+    return inChar==' ' || (inChar>='\t' && inChar<='\r');
+  }
+
+  bool isDigit(char inChar)
+  {
+    return inChar>='0' && inChar<='9';
+  }
+
+  // Write the digits of an unsigned integer at the end of a buffer, and return a pointer to the first one
+  char* writeDigits(unsigned long inValue, char* inEnd)
+  {
+    char* lPtr = inEnd;
+    do
+    {
+      *--lPtr = char('0' + inValue%10);
+      inValue /= 10;
+    } while(inValue);
+    return lPtr;
+  }
+
+  // Read an optional sign and the digits of an integer, as an istream does
+  bool readInteger(const string& inStr, bool& outNegative, unsigned long& outMagnitude, bool& outOverflow)
+  {
+    const char* lPtr = inStr.c_str();
+    const unsigned long lMax = numeric_limits<unsigned long>::max();
+
+    while(isSpace(*lPtr))
+      lPtr++;
+    outNegative = false;
+    if(*lPtr=='+' || *lPtr=='-')
+      outNegative = (*lPtr++=='-');
+    if(!isDigit(*lPtr))
+      return false;
+
+    outMagnitude = 0;
+    outOverflow = false;
+    for(; isDigit(*lPtr); lPtr++)
+    {
+      unsigned long lDigit = *lPtr - '0';
+      if(outMagnitude > (lMax-lDigit)/10)
+        outOverflow = true;
+      else
+        outMagnitude = outMagnitude*10 + lDigit;
+    }
+    return true;
+  }
+
+  template<class T> bool readSigned(const string& inStr, T& outValue)
+  {
+    bool lNegative;
+    bool lOverflow;
+    unsigned long lMagnitude;
+
+    outValue = 0;
+    if(!readInteger(inStr, lNegative, lMagnitude, lOverflow))
+      return false;
+
+    const unsigned long lMax = static_cast<unsigned long>(numeric_limits<T>::max());
+    if(lNegative)
+    {
+      if(lOverflow || lMagnitude > lMax+1)
+      {
+        outValue = numeric_limits<T>::min();
+        return false;
+      }
+      outValue = (lMagnitude==lMax+1) ? numeric_limits<T>::min() : static_cast<T>(-static_cast<T>(lMagnitude));
+    }
+    else
+    {
+      if(lOverflow || lMagnitude > lMax)
+      {
+        outValue = numeric_limits<T>::max();
+        return false;
+      }
+      outValue = static_cast<T>(lMagnitude);
+    }
+    return true;
+  }
+
+  template<class T> bool readUnsigned(const string& inStr, T& outValue)
+  {
+    bool lNegative;
+    bool lOverflow;
+    unsigned long lMagnitude;
+
+    outValue = 0;
+    if(!readInteger(inStr, lNegative, lMagnitude, lOverflow))
+      return false;
+
+    if(lOverflow || lMagnitude > static_cast<unsigned long>(numeric_limits<T>::max()))
+    {
+      outValue = numeric_limits<T>::max();
+      return false;
+    }
+    // Like an istream, a negative value wraps around
+    outValue = lNegative ? static_cast<T>(0-lMagnitude) : static_cast<T>(lMagnitude);
+    return true;
+  }
+
+  // Format of a binary floating point type: bits of the significand, and exponents of the least significant bit of
+  // the smallest subnormal and of the largest finite value
+  struct FloatFormat
+  {
+    int mNbBits;
+    int mMinExponent;
+    int mMaxExponent;
+  };
+
+  const FloatFormat cFloatFormat = {24, -149, 104};
+  const FloatFormat cDoubleFormat = {53, -1074, 971};
+
+  // Significant digits kept when reading a number, more than the 767 a value halfway between two doubles can need
+  #define NUMBER_CONVERSION_MAX_DIGITS 780
+  // Values of 10^310 and more overflow, values below 10^-325 round to 0, for floats and doubles
+  #define NUMBER_CONVERSION_MAX_ORDER 310
+  #define NUMBER_CONVERSION_MIN_ORDER -325
+  // Enough limbs for the exact values of all doubles and of the decimal numbers read, at the scale used
+  #define NUMBER_CONVERSION_NB_LIMBS 128
+
+  const unsigned int cPowersOf10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+  // Unsigned integer of up to NUMBER_CONVERSION_NB_LIMBS*32 bits, for exact conversions
+  class BigInteger
+  {
+    public:
+      explicit BigInteger(unsigned long long inValue = 0) : mSize(0)
+      {
+        for(; inValue; inValue >>= 32)
+          mLimbs[mSize++] = static_cast<unsigned int>(inValue);
+      }
+
+      bool isZero() const
+      {
+        return mSize==0;
+      }
+
+      unsigned int getBitLength() const
+      {
+        if(!mSize)
+          return 0;
+        unsigned int lLength = (mSize-1)*32;
+        for(unsigned int lTop = mLimbs[mSize-1]; lTop; lTop >>= 1)
+          lLength++;
+        return lLength;
+      }
+
+      // Get bits [64*inIndex, 64*inIndex+64)
+      unsigned long long getLow64(unsigned int inIndex = 0) const
+      {
+        unsigned long long lValue = 0;
+        if(2*inIndex+1<mSize)
+          lValue = static_cast<unsigned long long>(mLimbs[2*inIndex+1]) << 32;
+        if(2*inIndex<mSize)
+          lValue |= mLimbs[2*inIndex];
+        return lValue;
+      }
+
+      void multiplyAdd(unsigned int inFactor, unsigned int inAddend)
+      {
+        unsigned long long lCarry = inAddend;
+        for(unsigned int i=0; i<mSize; i++)
+        {
+          lCarry += static_cast<unsigned long long>(mLimbs[i])*inFactor;
+          mLimbs[i] = static_cast<unsigned int>(lCarry);
+          lCarry >>= 32;
+        }
+        if(lCarry)
+          mLimbs[mSize++] = static_cast<unsigned int>(lCarry);
+      }
+
+      // Divide, truncating the quotient
+      void divide(unsigned int inDivisor)
+      {
+        unsigned long long lRemainder = 0;
+        for(int i=mSize-1; i>=0; i--)
+        {
+          unsigned long long lValue = (lRemainder << 32) | mLimbs[i];
+          mLimbs[i] = static_cast<unsigned int>(lValue/inDivisor);
+          lRemainder = lValue%inDivisor;
+        }
+        trim();
+      }
+
+      void multiplyPow10(unsigned int inExponent)
+      {
+        for(; inExponent>=9; inExponent-=9)
+          multiplyAdd(cPowersOf10[9], 0);
+        if(inExponent)
+          multiplyAdd(cPowersOf10[inExponent], 0);
+      }
+
+      void shiftLeft(unsigned int inNbBits)
+      {
+        if(!mSize)
+          return;
+        unsigned int lLimbShift = inNbBits/32;
+        unsigned int lBitShift = inNbBits%32;
+        mLimbs[mSize+lLimbShift] = 0;
+        for(int i=mSize-1; i>=0; i--)
+        {
+          if(lBitShift)
+            mLimbs[i+lLimbShift+1] |= mLimbs[i] >> (32-lBitShift);
+          mLimbs[i+lLimbShift] = mLimbs[i] << lBitShift;
+        }
+        for(unsigned int i=0; i<lLimbShift; i++)
+          mLimbs[i] = 0;
+        mSize += lLimbShift+1;
+        trim();
+      }
+
+      // Shift right, and return true if bits shifted out were not all 0
+      bool shiftRight(unsigned int inNbBits)
+      {
+        unsigned int lLimbShift = inNbBits/32;
+        unsigned int lBitShift = inNbBits%32;
+        bool lLost = false;
+        if(lLimbShift>=mSize)
+        {
+          lLost = !isZero();
+          mSize = 0;
+          return lLost;
+        }
+        for(unsigned int i=0; i<lLimbShift; i++)
+          lLost = lLost || mLimbs[i];
+        if(lBitShift)
+          lLost = lLost || (mLimbs[lLimbShift] & ((1U << lBitShift)-1));
+        for(unsigned int i=0; i+lLimbShift<mSize; i++)
+        {
+          mLimbs[i] = mLimbs[i+lLimbShift] >> lBitShift;
+          if(lBitShift && i+lLimbShift+1<mSize)
+            mLimbs[i] |= mLimbs[i+lLimbShift+1] << (32-lBitShift);
+        }
+        mSize -= lLimbShift;
+        trim();
+        return lLost;
+      }
+
+      int compare(const BigInteger& inValue) const
+      {
+        if(mSize!=inValue.mSize)
+          return (mSize<inValue.mSize) ? -1 : 1;
+        for(int i=mSize-1; i>=0; i--)
+        {
+          if(mLimbs[i]!=inValue.mLimbs[i])
+            return (mLimbs[i]<inValue.mLimbs[i]) ? -1 : 1;
+        }
+        return 0;
+      }
+
+      // Subtract a value that is not greater
+      void subtract(const BigInteger& inValue)
+      {
+        unsigned long long lBorrow = 0;
+        for(unsigned int i=0; i<mSize; i++)
+        {
+          unsigned long long lDifference = static_cast<unsigned long long>(mLimbs[i]) - (i<inValue.mSize ? inValue.mLimbs[i] : 0) - lBorrow;
+          mLimbs[i] = static_cast<unsigned int>(lDifference);
+          lBorrow = (lDifference >> 32) & 1;
+        }
+        trim();
+      }
+
+    private:
+
+      void trim()
+      {
+        while(mSize && !mLimbs[mSize-1])
+          mSize--;
+      }
+
+      unsigned int mLimbs[NUMBER_CONVERSION_NB_LIMBS+1];
+      unsigned int mSize;
+  };
+
+  unsigned int getBitLength(unsigned long long inValue)
+  {
+    unsigned int lLength = 0;
+    for(; inValue; inValue >>= 1)
+      lLength++;
+    return lLength;
+  }
+
+  // Approximation of a power of 10 by mHigh*2^64 + mLow (bit 127 set) times 2^mExponent, within one unit of mLow
+  struct PowerOf10
+  {
+    unsigned long long mHigh;
+    unsigned long long mLow;
+    int mExponent;
+  };
+
+  // Powers used by readFloat() for 19 digits (down to 10^-344), and by getDecimalDigitsFast() (up to 10^341)
+  #define NUMBER_CONVERSION_MIN_POWER -344
+  #define NUMBER_CONVERSION_MAX_POWER 341
+
+  class PowersOf10
+  {
+    public:
+      PowersOf10()
+      {
+        // Positive powers from their exact values, rounded to 128 bits
+        BigInteger lPower(1);
+        for(int i=0; i<=NUMBER_CONVERSION_MAX_POWER; i++)
+        {
+          set(i, lPower, 0);
+          lPower.multiplyAdd(10, 0);
+        }
+        // Negative powers by successive divisions of a 320 bits value, whose truncation errors stay far below 128 bits
+        BigInteger lReciprocal(1);
+        lReciprocal.shiftLeft(319);
+        int lExponent = -319;
+        for(int i=-1; i>=NUMBER_CONVERSION_MIN_POWER; i--)
+        {
+          lReciprocal.divide(10);
+          int lShift = 320 - static_cast<int>(lReciprocal.getBitLength());
+          lReciprocal.shiftLeft(lShift);
+          lExponent -= lShift;
+          set(i, lReciprocal, lExponent);
+        }
+      }
+
+      const PowerOf10& operator[](int inExponent) const
+      {
+        return mPowers[inExponent-NUMBER_CONVERSION_MIN_POWER];
+      }
+
+    private:
+
+      // Round inValue*2^inExponent to 128 bits
+      void set(int inIndex, BigInteger inValue, int inExponent)
+      {
+        PowerOf10& lPower = mPowers[inIndex-NUMBER_CONVERSION_MIN_POWER];
+        int lShift = static_cast<int>(inValue.getBitLength()) - 128;
+        bool lRoundUp = false;
+        if(lShift>0)
+        {
+          inValue.shiftRight(lShift-1);
+          lRoundUp = (inValue.getLow64() & 1)!=0;
+          inValue.shiftRight(1);
+        }
+        else
+          inValue.shiftLeft(-lShift);
+        lPower.mHigh = inValue.getLow64(1);
+        lPower.mLow = inValue.getLow64(0);
+        lPower.mExponent = inExponent + lShift;
+        if(lRoundUp && ++lPower.mLow==0 && ++lPower.mHigh==0)
+        {
+          lPower.mHigh = 1ULL << 63;
+          lPower.mExponent++;
+        }
+      }
+
+      PowerOf10 mPowers[NUMBER_CONVERSION_MAX_POWER-NUMBER_CONVERSION_MIN_POWER+1];
+  };
+
+  // Constructed on first use and never destroyed, so that numbers are converted during static initialization too
+  const PowersOf10& getPowersOf10()
+  {
+    static const PowersOf10* sPowers = new PowersOf10;
+    return *sPowers;
+  }
+
+  void multiply64(unsigned long long inA, unsigned long long inB, unsigned long long& outHigh, unsigned long long& outLow)
+  {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 UInt128;
+    UInt128 lProduct = static_cast<UInt128>(inA)*inB;
+    outHigh = static_cast<unsigned long long>(lProduct >> 64);
+    outLow = static_cast<unsigned long long>(lProduct);
+#else
+    unsigned long long lA0 = inA & 0xFFFFFFFFULL, lA1 = inA >> 32;
+    unsigned long long lB0 = inB & 0xFFFFFFFFULL, lB1 = inB >> 32;
+    unsigned long long lLow = lA0*lB0;
+    unsigned long long lMiddle1 = lA1*lB0 + (lLow >> 32);
+    unsigned long long lMiddle2 = lA0*lB1 + (lMiddle1 & 0xFFFFFFFFULL);
+    outHigh = lA1*lB1 + (lMiddle1 >> 32) + (lMiddle2 >> 32);
+    outLow = (lMiddle2 << 32) | (lLow & 0xFFFFFFFFULL);
+#endif
+  }
+
+  // 192 bits product of a value and a power of 10, least significant 64 bits first
+  void multiplyPower(unsigned long long inValue, const PowerOf10& inPower, unsigned long long outProduct[3])
+  {
+    unsigned long long lLowHigh;
+    unsigned long long lHighLow;
+    multiply64(inValue, inPower.mLow, lLowHigh, outProduct[0]);
+    multiply64(inValue, inPower.mHigh, outProduct[2], lHighLow);
+    outProduct[1] = lHighLow + lLowHigh;
+    if(outProduct[1]<lHighLow)
+      outProduct[2]++;
+  }
+
+  // Get bits [inFirst, inFirst+64) of a 192 bits value
+  unsigned long long getBits(const unsigned long long inValue[3], unsigned int inFirst)
+  {
+    unsigned int lIndex = inFirst/64;
+    unsigned int lShift = inFirst%64;
+    unsigned long long lBits = (lIndex<3) ? inValue[lIndex] >> lShift : 0;
+    if(lShift && lIndex+1<3)
+      lBits |= inValue[lIndex+1] << (64-lShift);
+    return lBits;
+  }
+
+  // Check if bits [0, inEnd) of a 192 bits value are not all 0
+  bool hasBitsBelow(const unsigned long long inValue[3], unsigned int inEnd)
+  {
+    for(unsigned int i=0; i<3 && inEnd; i++)
+    {
+      unsigned int lNbBits = (inEnd<64) ? inEnd : 64;
+      if(lNbBits<64 ? (inValue[i] << (64-lNbBits))!=0 : inValue[i]!=0)
+        return true;
+      inEnd -= lNbBits;
+    }
+    return false;
+  }
+
+  // Largest finite value of a format
+  double getLargest(const FloatFormat& inFormat)
+  {
+    return ldexp(static_cast<double>((1ULL << inFormat.mNbBits)-1), inFormat.mMaxExponent);
+  }
+
+  // Exponent of the least significant bit of inBits*2^inExponent rounded to the format (inBits is not 0)
+  int getRoundedExponent(unsigned long long inBits, int inExponent, const FloatFormat& inFormat)
+  {
+    int lExponent = inExponent + static_cast<int>(getBitLength(inBits)) - inFormat.mNbBits;
+    return (lExponent<inFormat.mMinExponent) ? inFormat.mMinExponent : lExponent;
+  }
+
+  // Check if an error of one unit on inBits could change how roundBinary() rounds it
+  bool isRoundingAmbiguous(unsigned long long inBits, int inExponent, const FloatFormat& inFormat)
+  {
+    int lShift = getRoundedExponent(inBits, inExponent, inFormat) - inExponent;
+    if(lShift<=0 || lShift>64)
+      return lShift<=0;
+    unsigned long long lHalf = 1ULL << (lShift-1);
+    unsigned long long lDropped = (lShift==64) ? inBits : inBits & ((1ULL << lShift)-1);
+    return lDropped+1>=lHalf && lDropped<=lHalf+1;
+  }
+
+  /* Round (inBits + f) * 2^inExponent to the nearest value of the format, ties to even, where 0 <= f < 1 and f is
+     not 0 when inSticky is set.  inBits is not 0.  Return false if the value overflows, set to the largest value.
+  */
+  bool roundBinary(unsigned long long inBits, int inExponent, bool inSticky, const FloatFormat& inFormat, double& outValue)
+  {
+    int lExponent = getRoundedExponent(inBits, inExponent, inFormat);
+    int lShift = lExponent - inExponent;
+    unsigned long long lMantissa = 0;
+    if(lShift<=0)
+      lMantissa = inBits << -lShift;
+    else if(lShift<=64)
+    {
+      // Below a shift of 64, the value is less than half the smallest subnormal and rounds to 0
+      unsigned long long lRemainder = inBits;
+      if(lShift<64)
+      {
+        lMantissa = inBits >> lShift;
+        lRemainder = inBits & ((1ULL << lShift)-1);
+      }
+      unsigned long long lHalf = 1ULL << (lShift-1);
+      if(lRemainder>lHalf || (lRemainder==lHalf && (inSticky || (lMantissa & 1))))
+        lMantissa++;
+    }
+
+    if(lMantissa >> inFormat.mNbBits)
+    {
+      lMantissa >>= 1;
+      lExponent++;
+    }
+    if(lExponent>inFormat.mMaxExponent)
+    {
+      outValue = getLargest(inFormat);
+      return false;
+    }
+    outValue = ldexp(static_cast<double>(lMantissa), lExponent);
+    return true;
+  }
+
+  /* Round inDigits * 10^inExponent to the nearest value of the format, where inDigits has inNbDigits significant
+     digits and is slightly greater when inSticky is set (digits were dropped).
+  */
+  bool roundDecimal(const BigInteger& inDigits, unsigned int inNbDigits, long inExponent, bool inSticky, const FloatFormat& inFormat, double& outValue)
+  {
+    outValue = 0;
+    if(inDigits.isZero())
+      return true;
+
+    long lOrder = static_cast<long>(inNbDigits) + inExponent;
+    if(lOrder>NUMBER_CONVERSION_MAX_ORDER)
+    {
+      outValue = getLargest(inFormat);
+      return false;
+    }
+    if(lOrder<NUMBER_CONVERSION_MIN_ORDER)
+      return true;
+
+    // Up to 19 digits, the 192 bits product by the 128 bits power of 10 is within one unit of its 64 high bits, which
+    // round correctly unless the bits they drop are within one unit of half
+    if(inNbDigits<=19 && !inSticky)
+    {
+      unsigned long long lDigits = inDigits.getLow64();
+      unsigned int lLeadingZeros = 64 - getBitLength(lDigits);
+      const PowerOf10& lPower = getPowersOf10()[inExponent];
+      unsigned long long lProduct[3];
+      multiplyPower(lDigits << lLeadingZeros, lPower, lProduct);
+      int lExponent = 128 + lPower.mExponent - static_cast<int>(lLeadingZeros);
+      if(!isRoundingAmbiguous(lProduct[2], lExponent, inFormat))
+        return roundBinary(lProduct[2], lExponent, (lProduct[1] | lProduct[0])!=0, inFormat, outValue);
+    }
+
+    BigInteger lNumerator(inDigits);
+    unsigned long long lBits;
+    int lBinaryExponent;
+    bool lSticky = inSticky;
+    if(inExponent>=0)
+    {
+      lNumerator.multiplyPow10(inExponent);
+      unsigned int lLength = lNumerator.getBitLength();
+      lBinaryExponent = (lLength>64) ? lLength-64 : 0;
+      if(lNumerator.shiftRight(lBinaryExponent))
+        lSticky = true;
+      lBits = lNumerator.getLow64();
+    }
+    else
+    {
+      // 64 bits of quotient, by long division of the scaled digits by 10^-inExponent
+      BigInteger lDenominator(1);
+      lDenominator.multiplyPow10(-inExponent);
+      int lShift = 63 + static_cast<int>(lDenominator.getBitLength()) - static_cast<int>(lNumerator.getBitLength());
+      if(lShift>0)
+        lNumerator.shiftLeft(lShift);
+      else
+        lDenominator.shiftLeft(-lShift);
+      lDenominator.shiftLeft(63);
+      lBits = 0;
+      for(int i=63; i>=0; i--)
+      {
+        if(lNumerator.compare(lDenominator)>=0)
+        {
+          lNumerator.subtract(lDenominator);
+          lBits |= 1ULL << i;
+        }
+        lDenominator.shiftRight(1);
+      }
+      if(!lNumerator.isZero())
+        lSticky = true;
+      lBinaryExponent = -lShift;
+    }
+    return roundBinary(lBits, lBinaryExponent, lSticky, inFormat, outValue);
+  }
+
+  /* Read a floating point number, as an istream does, rounded once to the nearest value of the format, without
+     depending on the locale.  The value is returned as a double, exact for both formats.
+  */
+  bool readFloat(const string& inStr, const FloatFormat& inFormat, double& outValue)
+  {
+    const char* lPtr = inStr.c_str();
+    outValue = 0;
+
+    while(isSpace(*lPtr))
+      lPtr++;
+    bool lNegative = false;
+    if(*lPtr=='+' || *lPtr=='-')
+      lNegative = (*lPtr++=='-');
+
+    // [digits] [. digits], significant digits are gathered by 9 in lChunk
+    BigInteger lDigits;
+    unsigned int lChunk = 0;
+    unsigned int lChunkSize = 0;
+    unsigned int lNbKept = 0;
+    unsigned int lNbDigits = 0;
+    long lExponent = 0;
+    bool lSticky = false;
+    bool lPoint = false;
+    for(;; lPtr++)
+    {
+      if(*lPtr=='.' && !lPoint)
+      {
+        lPoint = true;
+        continue;
+      }
+      if(!isDigit(*lPtr))
+        break;
+      lNbDigits++;
+      if(!lNbKept && *lPtr=='0')
+      {
+        if(lPoint)
+          lExponent--;
+      }
+      else if(lNbKept<NUMBER_CONVERSION_MAX_DIGITS)
+      {
+        lChunk = lChunk*10 + (*lPtr-'0');
+        if(++lChunkSize==9)
+        {
+          lDigits.multiplyAdd(cPowersOf10[9], lChunk);
+          lChunk = 0;
+          lChunkSize = 0;
+        }
+        lNbKept++;
+        if(lPoint)
+          lExponent--;
+      }
+      else
+      {
+        if(*lPtr!='0')
+          lSticky = true;
+        if(!lPoint)
+          lExponent++;
+      }
+    }
+    if(!lNbDigits)
+      return false;
+    if(lChunkSize)
+      lDigits.multiplyAdd(cPowersOf10[lChunkSize], lChunk);
+
+    if(*lPtr=='e' || *lPtr=='E')
+    {
+      lPtr++;
+      bool lNegativeExponent = false;
+      if(*lPtr=='+' || *lPtr=='-')
+        lNegativeExponent = (*lPtr++=='-');
+      // Like an istream, an exponent without digits makes the number invalid
+      if(!isDigit(*lPtr))
+        return false;
+      long lValue = 0;
+      for(; isDigit(*lPtr); lPtr++)
+      {
+        if(lValue<100000)
+          lValue = lValue*10 + (*lPtr-'0');
+      }
+      lExponent += lNegativeExponent ? -lValue : lValue;
+    }
+
+    bool lValid = roundDecimal(lDigits, lNbKept, lExponent, lSticky, inFormat, outValue);
+    if(lNegative)
+      outValue = -outValue;
+    return lValid;
+  }
+
+  /* Write the first inNbDigits decimal digits of the exact expansion of inMantissa*2^inExponent (not 0), its decimal
+     exponent, and whether the digits that follow are not all 0.
+  */
+  void getDecimalDigits(unsigned long long inMantissa, int inExponent, char* outDigits, unsigned int inNbDigits, int& outExponent, bool& outSticky)
+  {
+    BigInteger lNumerator(inMantissa);
+    BigInteger lDenominator(1);
+    if(inExponent>=0)
+      lNumerator.shiftLeft(inExponent);
+    else
+      lDenominator.shiftLeft(-inExponent);
+
+    // 2^(lLength-1) <= value < 2^lLength, so the decimal exponent is the estimate or the next one
+    int lLength = static_cast<int>(getBitLength(inMantissa)) + inExponent;
+    outExponent = static_cast<int>(floor((lLength-1)*0.30102999566398119521));
+    if(outExponent>=0)
+      lDenominator.multiplyPow10(outExponent);
+    else
+      lNumerator.multiplyPow10(-outExponent);
+    BigInteger lNextDenominator(lDenominator);
+    lNextDenominator.multiplyAdd(10, 0);
+    if(lNumerator.compare(lNextDenominator)>=0)
+    {
+      lDenominator = lNextDenominator;
+      outExponent++;
+    }
+
+    for(unsigned int i=0; i<inNbDigits; i++)
+    {
+      char lDigit = '0';
+      while(lNumerator.compare(lDenominator)>=0)
+      {
+        lNumerator.subtract(lDenominator);
+        lDigit++;
+      }
+      outDigits[i] = lDigit;
+      lNumerator.multiplyAdd(10, 0);
+    }
+    outSticky = !lNumerator.isZero();
+  }
+
+  /* Same as getDecimalDigits() with a 128 bits power of 10, for a 53 bits inMantissa: write the 18 or 19 digits of the
+     integer part of the value scaled to [10^17, 10^19).  Return false, for the exact computation, when the product
+     is too close to a tie to round to inFirstDigits..inLastDigits digits.
+  */
+  bool getDecimalDigitsFast(unsigned long long inMantissa, int inExponent, char* outDigits, unsigned int& outNbDigits, int& outExponent, bool& outSticky, unsigned int inFirstDigits, unsigned int inLastDigits)
+  {
+    int lDecimalExponent = static_cast<int>(floor((52+inExponent)*0.30102999566398119521));
+    const PowerOf10& lPower = getPowersOf10()[17-lDecimalExponent];
+    unsigned long long lProduct[3];
+    multiplyPower(inMantissa << 11, lPower, lProduct);
+
+    // Binary point of the product, the error is below one unit of the 64 bits that follow it
+    int lPoint = 11 - inExponent - lPower.mExponent;
+    if(lPoint<64 || lPoint>=192)
+      return false;
+    unsigned long long lInteger = getBits(lProduct, lPoint);
+    unsigned long long lFraction = getBits(lProduct, lPoint-64);
+    if(lInteger<100000000000000000ULL)
+      return false;
+    outSticky = lFraction!=0 || hasBitsBelow(lProduct, lPoint-64);
+
+    outNbDigits = (lInteger>=1000000000000000000ULL) ? 19 : 18;
+    outExponent = lDecimalExponent + outNbDigits - 18;
+    for(int i=outNbDigits-1; i>=0; i--)
+    {
+      outDigits[i] = char('0' + lInteger%10);
+      lInteger /= 10;
+    }
+
+    // The digits dropped by rounding, 50..0 or 49..9, could be a tie or not
+    for(unsigned int lNbDigits = inFirstDigits; lNbDigits<=inLastDigits; lNbDigits++)
+    {
+      unsigned int i = lNbDigits+1;
+      if(outDigits[lNbDigits]=='5' && lFraction<=2)
+      {
+        for(; i<outNbDigits && outDigits[i]=='0'; i++);
+        if(i==outNbDigits)
+          return false;
+      }
+      else if(outDigits[lNbDigits]=='4' && lFraction>=~0ULL-2)
+      {
+        for(; i<outNbDigits && outDigits[i]=='9'; i++);
+        if(i==outNbDigits)
+          return false;
+      }
+    }
+    return true;
+  }
+
+  // Write in scientific notation the digits rounded to inNbDigits, ties to even, given inNbExactDigits exact digits
+  string writeScientific(bool inNegative, const char* inDigits, unsigned int inNbDigits, unsigned int inNbExactDigits, int inExponent, bool inSticky)
+  {
+    char lDigits[32];
+    memcpy(lDigits, inDigits, inNbDigits);
+
+    bool lAbove = inSticky;
+    for(unsigned int i=inNbDigits+1; i<inNbExactDigits && !lAbove; i++)
+      lAbove = (inDigits[i]!='0');
+    char lNext = inDigits[inNbDigits];
+    if(lNext>'5' || (lNext=='5' && (lAbove || ((lDigits[inNbDigits-1]-'0') & 1))))
+    {
+      int i = inNbDigits-1;
+      for(; i>=0 && lDigits[i]=='9'; i--)
+        lDigits[i] = '0';
+      if(i>=0)
+        lDigits[i]++;
+      else
+      {
+        lDigits[0] = '1';
+        inExponent++;
+      }
+    }
+
+    char lBuffer[48];
+    char* lPtr = lBuffer;
+    if(inNegative)
+      *lPtr++ = '-';
+    *lPtr++ = lDigits[0];
+    if(inNbDigits>1)
+    {
+      *lPtr++ = '.';
+      memcpy(lPtr, lDigits+1, inNbDigits-1);
+      lPtr += inNbDigits-1;
+    }
+    *lPtr++ = 'e';
+    *lPtr++ = (inExponent<0) ? '-' : '+';
+    unsigned int lExponent = (inExponent<0) ? -inExponent : inExponent;
+    if(lExponent>=100)
+      *lPtr++ = char('0' + lExponent/100);
+    *lPtr++ = char('0' + lExponent/10%10);
+    *lPtr++ = char('0' + lExponent%10);
+    return string(lBuffer, lPtr);
+  }
+
+  /* Write in scientific notation with the given precision (digits after the point), increased until the value is
+     read back exactly, as printf("%.*e") with the classic locale would.  The exact digits are computed only once.
+  */
+  template<class T> string writeFloatExact(T inValue, int inPrecision, int inMaxPrecision, const FloatFormat& inFormat)
+  {
+    if(inValue!=inValue)
+      return "nan";
+    bool lNegative = (inValue<0) || (inValue==0 && 1/inValue<0);
+    double lMagnitude = lNegative ? -static_cast<double>(inValue) : static_cast<double>(inValue);
+    if(lMagnitude-lMagnitude!=0)
+      return lNegative ? "-inf" : "inf";
+
+    char lDigits[32];
+    unsigned int lNbExactDigits = inMaxPrecision+2;
+    int lExponent = 0;
+    bool lSticky = false;
+    if(lMagnitude==0)
+    {
+      memset(lDigits, '0', lNbExactDigits);
+      inMaxPrecision = inPrecision;
+    }
+    else
+    {
+      int lBinaryExponent;
+      unsigned long long lMantissa = static_cast<unsigned long long>(ldexp(frexp(lMagnitude, &lBinaryExponent), 53));
+      if(!getDecimalDigitsFast(lMantissa, lBinaryExponent-53, lDigits, lNbExactDigits, lExponent, lSticky, inPrecision+1, inMaxPrecision+1))
+      {
+        lNbExactDigits = inMaxPrecision+2;
+        getDecimalDigits(lMantissa, lBinaryExponent-53, lDigits, lNbExactDigits, lExponent, lSticky);
+      }
+    }
+
+    string lStr = writeScientific(lNegative, lDigits, inPrecision+1, lNbExactDigits, lExponent, lSticky);
+    for(int lPrecision = inPrecision+1; lPrecision<=inMaxPrecision; lPrecision++)
+    {
+      double lValue;
+      readFloat(lStr, inFormat, lValue);
+      if(lValue==static_cast<double>(inValue))
+        break;
+      lStr = writeScientific(lNegative, lDigits, lPrecision+1, lNbExactDigits, lExponent, lSticky);
+    }
+    return lStr;
+  }
+
+}
+
+/*! \todo
+*/
+string VIPERS::convertNumberToString(bool inValue)
+{
+  return inValue ? "1" : "0";
+}
+
+/*! \todo
+*/
+string VIPERS::convertNumberToString(long inValue)
+{
+  char lBuffer[32];
+  char* lEnd = lBuffer + sizeof(lBuffer);
+  unsigned long lMagnitude = (inValue<0) ? 0UL-static_cast<unsigned long>(inValue) : static_cast<unsigned long>(inValue);
+  char* lPtr = writeDigits(lMagnitude, lEnd);
+  if(inValue<0)
+    *--lPtr = '-';
+  return string(lPtr, lEnd);
+}
+
+/*! \todo
+*/
+string VIPERS::convertNumberToString(unsigned long inValue)
+{
+  char lBuffer[32];
+  char* lEnd = lBuffer + sizeof(lBuffer);
+  return string(writeDigits(inValue, lEnd), lEnd);
+}
+
+/*! \todo
+*/
+string VIPERS::convertNumberToString(float inValue)
+{
+  return writeFloatExact(inValue, 6, 8, cFloatFormat);
+}
+
+/*! \todo
+*/
+string VIPERS::convertNumberToString(double inValue)
+{
+  return writeFloatExact(inValue, 15, 16, cDoubleFormat);
+}
+
+/*! Long double is not supported the same way by all C libraries (some treat it as a double), so it is written by
+    an ostringstream with the classic locale.
+*/
+string VIPERS::convertNumberToString(long double inValue)
+{
+  ostringstream lTmpStr;
+  lTmpStr.imbue(locale::classic());
+  lTmpStr.setf(ios::scientific, ios::floatfield);
+  lTmpStr.precision(19);
+  lTmpStr << inValue;
+  if(inValue==inValue && inValue-inValue==0)
+  {
+    long double lValue;
+    convertStringToNumber(lTmpStr.str(), lValue);
+    if(lValue!=inValue)
+    {
+      lTmpStr.str("");
+      lTmpStr.precision(numeric_limits<long double>::digits10+2);
+      lTmpStr << inValue;
+    }
+  }
+  return lTmpStr.str();
+}
+
+/*! Like an istream, only "0" and "1" are valid booleans.
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, bool& outValue)
+{
+  long lValue;
+  outValue = false;
+  if(!readSigned(inStr, lValue) || (lValue!=0 && lValue!=1))
+    return false;
+  outValue = (lValue==1);
+  return true;
+}
+
+/*! \todo
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, short& outValue)
+{
+  return readSigned(inStr, outValue);
+}
+
+/*! \todo
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, unsigned short& outValue)
+{
+  return readUnsigned(inStr, outValue);
+}
+
+/*! \todo
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, int& outValue)
+{
+  return readSigned(inStr, outValue);
+}
+
+/*! \todo
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, unsigned int& outValue)
+{
+  return readUnsigned(inStr, outValue);
+}
+
+/*! \todo
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, long& outValue)
+{
+  return readSigned(inStr, outValue);
+}
+
+/*! \todo
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, unsigned long& outValue)
+{
+  return readUnsigned(inStr, outValue);
+}
+
+/*! \todo
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, float& outValue)
+{
+  // Read directly as a float, a double rounded to a float could round twice
+  double lValue;
+  bool lValid = readFloat(inStr, cFloatFormat, lValue);
+  outValue = static_cast<float>(lValue);
+  return lValid;
+}
+
+/*! \todo
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, double& outValue)
+{
+  return readFloat(inStr, cDoubleFormat, outValue);
+}
+
+/*! \todo
+*/
+bool VIPERS::convertStringToNumber(const string& inStr, long double& outValue)
+{
+  istringstream lTmpStr(inStr);
+  lTmpStr.imbue(locale::classic());
+  outValue = 0;
+  return (lTmpStr >> outValue) ? true : false;
+}
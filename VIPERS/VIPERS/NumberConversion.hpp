@@ -0,0 +1,92 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/NumberConversion.hpp
+ * \brief Number to string and string to number conversion functions header.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#ifndef VIPERS_NUMBER_CONVERSION_HPP
+#define VIPERS_NUMBER_CONVERSION_HPP
+
+#include <string>
+
+namespace VIPERS
+{
+
+  using namespace std;
+
+  /*
+    Conversions used by Converter and Variable.  They do not depend on the C or C++ locale: the decimal point is
+    always '.', and no thousands separator is used.  Integers and booleans are written as with an ostream.  Floating
+    point values are written in scientific notation with the same precision as before (6, 15 and 19 digits after the
+    point for float, double and long double), extended just enough for the value to be read back exactly.
+
+    Parsing follows istream extraction: leading white spaces are skipped and the number ends at the first character
+    that cannot be part of it.  Floating point values are rounded once, to the nearest float or double (ties to even),
+    without going through the C library.  A function returns false when no number could be read, or when it is out of range
+    for the type, in which case the value is set to 0, or to the nearest limit of the type.
+  */
+
+  //! Convert a boolean to a string ("0" or "1")
+  string convertNumberToString(bool inValue);
+  //! Convert a signed integer to a string
+  string convertNumberToString(long inValue);
+  //! Convert an unsigned integer to a string
+  string convertNumberToString(unsigned long inValue);
+  //! Convert a float to a string that can be read back exactly
+  string convertNumberToString(float inValue);
+  //! Convert a double to a string that can be read back exactly
+  string convertNumberToString(double inValue);
+  //! Convert a long double to a string that can be read back exactly
+  string convertNumberToString(long double inValue);
+
+  //! Convert a string to a boolean (0 or 1)
+  bool convertStringToNumber(const string& inStr, bool& outValue);
+  //! Convert a string to a short
+  bool convertStringToNumber(const string& inStr, short& outValue);
+  //! Convert a string to an unsigned short
+  bool convertStringToNumber(const string& inStr, unsigned short& outValue);
+  //! Convert a string to an int
+  bool convertStringToNumber(const string& inStr, int& outValue);
+  //! Convert a string to an unsigned int
+  bool convertStringToNumber(const string& inStr, unsigned int& outValue);
+  //! Convert a string to a long
+  bool convertStringToNumber(const string& inStr, long& outValue);
+  //! Convert a string to an unsigned long
+  bool convertStringToNumber(const string& inStr, unsigned long& outValue);
+  //! Convert a string to a float
+  bool convertStringToNumber(const string& inStr, float& outValue);
+  //! Convert a string to a double
+  bool convertStringToNumber(const string& inStr, double& outValue);
+  //! Convert a string to a long double
+  bool convertStringToNumber(const string& inStr, long double& outValue);
+
+}
+
+#endif //VIPERS_NUMBER_CONVERSION_HPP
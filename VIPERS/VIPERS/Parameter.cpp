@@ -41,7 +41,7 @@ using namespace std;
 */
 Value::Value()
 {
-
+  mCode = -1;
 }
 
 /*! \todo
@@ -49,6 +49,7 @@ Value::Value()
 Value::Value(const string& inValue)
 {
   mValue = inValue.c_str();
+  mCode = -1;
 }
 
 /*! \todo
@@ -58,6 +59,17 @@ Value::Value(const string& inValue, const string& inDisplayName, const string& i
   mValue = inValue.c_str();
   mDisplayName = inDisplayName.c_str();
   mDescription = inDescription.c_str();
+  mCode = -1;
+}
+
+/*! \todo
+*/
+Value::Value(const string& inValue, const string& inDisplayName, const string& inDescription, int inCode)
+{
+  mValue = inValue.c_str();
+  mDisplayName = inDisplayName.c_str();
+  mDescription = inDescription.c_str();
+  mCode = inCode;
 }
 
 /*! \todo
@@ -67,6 +79,7 @@ Value::Value(const Value& inValue)
   mValue = inValue.mValue.c_str();
   mDisplayName = inValue.mDisplayName.c_str();
   mDescription = inValue.mDescription.c_str();
+  mCode = inValue.mCode;
 }
 
 /*! \todo
@@ -83,6 +96,7 @@ Value& Value::operator=(const Value& inValue)
   mValue = inValue.mValue.c_str();
   mDisplayName = inValue.mDisplayName.c_str();
   mDescription = inValue.mDescription.c_str();
+  mCode = inValue.mCode;
   return *this;
 }
 
@@ -171,6 +185,20 @@ void Value::setDescription(const string& inDescription)
   mDescription = inDescription.c_str();
 }
 
+/*! \todo
+*/
+int Value::getCode() const
+{
+  return mCode;
+}
+
+/*! \todo
+*/
+void Value::setCode(int inCode)
+{
+  mCode = inCode;
+}
+
 /*! \todo
 */
 Parameter::Parameter(const string& inName, VariableType inVarType, const string& inDisplayName, const string& inDescription, bool inRunTimeChange) throw()
@@ -178,6 +206,7 @@ Parameter::Parameter(const string& inName, VariableType inVarType, const string&
 {
 	mEnabled = true;
 	mRunTimeChange = inRunTimeChange;
+	mEnumCode = -1;
 }
 
 /*! \todo
@@ -197,6 +226,7 @@ Parameter::Parameter(const Parameter& inParameter)
 	mMinValue = inParameter.mMinValue.c_str();
 	mMaxValue = inParameter.mMaxValue.c_str();
 	mStepValue = inParameter.mStepValue.c_str();
+	mEnumCode = inParameter.mEnumCode;
 }
 
 /*! \todo
@@ -212,6 +242,7 @@ Parameter& Parameter::operator=(const Parameter& inParameter)
 	mMinValue = inParameter.mMinValue.c_str();
 	mMaxValue = inParameter.mMaxValue.c_str();
 	mStepValue = inParameter.mStepValue.c_str();
+	mEnumCode = inParameter.mEnumCode;
 	return *this;
 }
 
@@ -271,6 +302,31 @@ string Parameter::getStepValue() const throw()
 	return mStepValue.c_str();
 }
 
+/*! The code is the one given to the matching possible %Value, or its position among the possible values when
+    it has no code.  It is computed when the value or the possible values are set, so that modules can switch on it
+    without comparing strings.
+*/
+int Parameter::toEnum() const throw()
+{
+	return mEnumCode;
+}
+
+/*! \todo
+*/
+void Parameter::valueChanged() throw()
+{
+	mEnumCode = -1;
+	int lPosition = 0;
+	for(ValueSet::const_iterator lItr = mPossibleValues.begin(); lItr!=mPossibleValues.end(); lItr++, lPosition++)
+	{
+		if(*lItr==mValue)
+		{
+			mEnumCode = lItr->getCode()>=0 ? lItr->getCode() : lPosition;
+			break;
+		}
+	}
+}
+
 /*! \todo
 */
 NameSet Parameter::getDependentParameterNameSet() const throw()
@@ -294,6 +350,7 @@ void Parameter::setPossibleValues(const ValueSet& inValues) throw()
 {
 	mPossibleValues.clear();
 	mPossibleValues = inValues;
+	valueChanged();
 }
 
 /*! \todo
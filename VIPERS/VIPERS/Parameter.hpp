@@ -57,6 +57,8 @@ namespace VIPERS
       Value(const string& inValue);
 	    //! Constructor members initialization
 	    Value(const string& inValue, const string& inDisplayName, const string& inDescription);
+	    //! Constructor members initialization, with the integer code returned by Parameter::toEnum()
+	    Value(const string& inValue, const string& inDisplayName, const string& inDescription, int inCode);
 	    //! Copy constructor
 	    Value(const Value& inValue);
 	    //! Destructor
@@ -91,12 +93,17 @@ namespace VIPERS
       string getDescription() const;
       //! Set description name for the value
       void setDescription(const string& inVDescription);
+      //! Get integer code of the value (negative if not defined)
+      int getCode() const;
+      //! Set integer code of the value
+      void setCode(int inCode);
 
 	  private:
 
 	    string mValue; //!< The value
 	    string mDisplayName; //!< The value display name
 	    string mDescription; //!< The value description
+	    int mCode; //!< The value integer code
 
 	};
 
@@ -138,6 +145,8 @@ namespace VIPERS
 		string getMaxValue() const throw();
 		//! Get step value
 		string getStepValue() const throw();
+		//! Get integer code of the current value among the possible values
+		int toEnum() const throw();
     //! Get dependent parameter name set
 		NameSet getDependentParameterNameSet() const throw();
 
@@ -156,6 +165,9 @@ namespace VIPERS
 
 		protected:
 
+		//! Update the integer code of the current value
+		virtual void valueChanged() throw();
+
 		bool mEnabled; //!< Is the parameter enabled
 		string mMinValue; //!< Minimum value
 		string mMaxValue; //!< Maximum value
@@ -168,6 +180,7 @@ namespace VIPERS
 
 		bool mMandatory; //!< Is the parameter mandatory
 		bool mRunTimeChange; //!< Can the parameter be changed in runtime
+		int mEnumCode; //!< Integer code of the current value, -1 if it is not a possible value
 
 	};
 
@@ -0,0 +1,1687 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/PixelKernels.cpp
+ * \brief PixelKernels class functions definition.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#include "PixelKernels.hpp"
+
+#include <cstring>
+
+// Vectorized versions are compiled for the instruction sets the compiler can target, whatever the build flags, and
+// only called when the processor supports them
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+  #define PIXEL_KERNELS_X86
+  #define PIXEL_KERNELS_TARGET_SSE2 __attribute__((target("sse2")))
+  #define PIXEL_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+  #define PIXEL_KERNELS_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+  #include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  #define PIXEL_KERNELS_X86
+  #define PIXEL_KERNELS_TARGET_SSE2
+  #define PIXEL_KERNELS_TARGET_AVX2
+  #define PIXEL_KERNELS_TARGET_AVX512
+  #include <intrin.h>
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define PIXEL_KERNELS_NEON
+  #include <arm_neon.h>
+#endif
+
+// Fixed-point luminance weights (ITU-R BT.601, same as OpenCV), scaled by 2^PIXEL_KERNELS_GRAY_SHIFT
+#define PIXEL_KERNELS_GRAY_SHIFT 14
+#define PIXEL_KERNELS_GRAY_RED 4899
+#define PIXEL_KERNELS_GRAY_GREEN 9617
+#define PIXEL_KERNELS_GRAY_BLUE 1868
+
+// Number of bytes of the weights expanded from a mask at a time, so they stay in the L1 cache
+#define PIXEL_KERNELS_CHUNK_BYTES 1024
+
+using namespace VIPERS;
+
+namespace
+{
+  // Rounded division by 255 of a value in [0, 255*255], exact for all of them (round half up)
+  inline unsigned int divide255(unsigned int inValue)
+  {
+    inValue += 128;
+    return (inValue + (inValue >> 8)) >> 8;
+  }
+
+  // outRow = (inA*inWeights + inB*(255-inWeights))/255, byte by byte
+  void blendRowScalar(const unsigned char* inA, const unsigned char* inB, const unsigned char* inWeights, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    for(unsigned int i = 0; i < inNbBytes; i++)
+      outRow[i] = (unsigned char)divide255(inA[i]*inWeights[i] + inB[i]*(255-inWeights[i]));
+  }
+
+  // outRow = inA where inMasks is 255, inB where it is 0, byte by byte
+  void selectRowScalar(const unsigned char* inA, const unsigned char* inB, const unsigned char* inMasks, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    for(unsigned int i = 0; i < inNbBytes; i++)
+      outRow[i] = (unsigned char)((inA[i] & inMasks[i]) | (inB[i] & ~inMasks[i]));
+  }
+
+  // Weight of every byte of a run of pixels: inWeights[0] where the mask is zero, inWeights[1] elsewhere.  The usual
+  // pixel sizes have their own loops, so the bytes of a pixel are stored without calling memset()
+  void expandWeightsScalar(const unsigned char* inMask, unsigned char* outWeights, unsigned int inNbPixels, unsigned int inNbChannels, const unsigned char inWeights[2])
+  {
+    unsigned int i;
+
+    switch(inNbChannels)
+    {
+      case 1:
+        for(i = 0; i < inNbPixels; i++)
+          outWeights[i] = inWeights[inMask[i]!=0];
+        break;
+      case 3:
+        for(i = 0; i < inNbPixels; i++, outWeights += 3)
+          outWeights[0] = outWeights[1] = outWeights[2] = inWeights[inMask[i]!=0];
+        break;
+      case 4:
+        for(i = 0; i < inNbPixels; i++, outWeights += 4)
+          outWeights[0] = outWeights[1] = outWeights[2] = outWeights[3] = inWeights[inMask[i]!=0];
+        break;
+      default:
+        for(i = 0; i < inNbPixels; i++, outWeights += inNbChannels)
+          memset(outWeights, inWeights[inMask[i]!=0], inNbChannels);
+        break;
+    }
+  }
+
+  // Weights of the channels of a pixel for a color layout (the weights of a 3 channels pixel are followed by a zero)
+  void getGrayWeights(PixelKernels::ColorLayout inColorLayout, short outWeights[4])
+  {
+    outWeights[0] = outWeights[1] = outWeights[2] = outWeights[3] = 0;
+    switch(inColorLayout)
+    {
+      case PixelKernels::eColorLayoutRGB:
+      case PixelKernels::eColorLayoutRGBA:
+        outWeights[0] = PIXEL_KERNELS_GRAY_RED;
+        outWeights[1] = PIXEL_KERNELS_GRAY_GREEN;
+        outWeights[2] = PIXEL_KERNELS_GRAY_BLUE;
+        break;
+      case PixelKernels::eColorLayoutBGR:
+      case PixelKernels::eColorLayoutBGRA:
+        outWeights[0] = PIXEL_KERNELS_GRAY_BLUE;
+        outWeights[1] = PIXEL_KERNELS_GRAY_GREEN;
+        outWeights[2] = PIXEL_KERNELS_GRAY_RED;
+        break;
+      case PixelKernels::eColorLayoutYCrCb:
+        outWeights[0] = 1 << PIXEL_KERNELS_GRAY_SHIFT;
+        break;
+    }
+  }
+
+  // outRow[i] = sum of the channels of pixel i weighted by inWeights, rounded
+  void grayRowScalar(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, const short inWeights[4])
+  {
+    for(unsigned int i = 0; i < inNbPixels; i++, inRow += inNbChannels)
+      outRow[i] = (unsigned char)((inRow[0]*inWeights[0] + inRow[1]*inWeights[1] + inRow[2]*inWeights[2] + (1 << (PIXEL_KERNELS_GRAY_SHIFT-1))) >> PIXEL_KERNELS_GRAY_SHIFT);
+  }
+
+  // Largest absolute difference between the channels of two pixels
+  inline unsigned char differencePixel(const unsigned char* inA, const unsigned char* inB, unsigned int inNbChannels)
+  {
+    unsigned char lMax = 0;
+    for(unsigned int c = 0; c < inNbChannels; c++)
+    {
+      unsigned char lDifference = (inA[c]>inB[c]) ? inA[c]-inB[c] : inB[c]-inA[c];
+      if(lDifference>lMax)
+        lMax = lDifference;
+    }
+    return lMax;
+  }
+
+  // outRow[i] = largest difference of pixel i, or 255 if it is greater than inThreshold (when not negative) and 0
+  // otherwise; bit i of outBits (if not NULL) is set where outRow[i] is not zero
+  void differenceRowScalar(const unsigned char* inA, const unsigned char* inB, unsigned char* outRow, unsigned char* outBits, unsigned int inNbPixels, unsigned int inNbChannels, int inThreshold)
+  {
+    unsigned char lBits = 0;
+
+    for(unsigned int i = 0; i < inNbPixels; i++, inA += inNbChannels, inB += inNbChannels)
+    {
+      unsigned char lValue = differencePixel(inA, inB, inNbChannels);
+      if(inThreshold>=0)
+        lValue = (lValue>inThreshold) ? 255 : 0;
+      outRow[i] = lValue;
+      if(lValue)
+        lBits |= (unsigned char)(1 << (i & 7));
+      if(outBits && ((i & 7)==7 || i+1==inNbPixels))
+      {
+        outBits[i >> 3] = lBits;
+        lBits = 0;
+      }
+    }
+  }
+
+  // Age of a motion history stamp, stamps counting from 1 to 65535 then wrapping to 1 (0 marks pixels without motion)
+  inline unsigned int stampAge(unsigned short inStamp, unsigned short inCurrentStamp)
+  {
+    return (inStamp>inCurrentStamp) ? inCurrentStamp+65535u-inStamp : inCurrentStamp-inStamp;
+  }
+
+  // ioStamps[i] = inStamp where inMask[i] is not zero, 0 where the stamp is older than inDuration; outGray[i] (if not
+  // NULL) = (((inDuration-age) << inShift)*inScale) >> 16 for the stamps kept, 0 elsewhere
+  void historyRowScalar(const unsigned char* inMask, unsigned short* ioStamps, unsigned char* outGray, unsigned int inNbPixels, unsigned short inStamp, unsigned short inDuration, unsigned int inShift, unsigned int inScale)
+  {
+    for(unsigned int i = 0; i < inNbPixels; i++)
+    {
+      unsigned short lStamp = ioStamps[i];
+      unsigned int lAge = stampAge(lStamp, inStamp);
+      if(inMask[i])
+      {
+        lStamp = inStamp;
+        lAge = 0;
+      }
+      else if(lAge>inDuration)
+        lStamp = 0;
+      ioStamps[i] = lStamp;
+      if(outGray)
+        outGray[i] = lStamp ? (unsigned char)((((inDuration-lAge) << inShift)*inScale) >> 16) : 0;
+    }
+  }
+
+  // outRow[i] = rounded average of the inFactor x inFactor block of pixels i of inRows, channel by channel
+  void boxRowScalar(const unsigned char* const* inRows, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    unsigned int lArea = inFactor*inFactor;
+
+    for(unsigned int i = 0; i < inNbPixels; i++)
+      for(unsigned int c = 0; c < inNbChannels; c++)
+      {
+        unsigned int lSum = lArea/2;
+        for(unsigned int r = 0; r < inFactor; r++)
+          for(unsigned int j = 0; j < inFactor; j++)
+            lSum += inRows[r][(i*inFactor+j)*inNbChannels+c];
+        outRow[i*inNbChannels+c] = (unsigned char)(lSum/lArea);
+      }
+  }
+
+  // Pixels i*inFactor to (i+1)*inFactor-1 of outRow = pixel i of inRow
+  void nearestRowScalar(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    for(unsigned int i = 0; i < inNbPixels; i++, inRow += inNbChannels)
+      for(unsigned int j = 0; j < inFactor; j++, outRow += inNbChannels)
+        for(unsigned int c = 0; c < inNbChannels; c++)
+          outRow[c] = inRow[c];
+  }
+
+  // Sum of the absolute differences between the pixels of two blocks of 1 channel pixels, returned as soon as it
+  // reaches inLimit at the end of a row (the partial sum is then at least inLimit)
+  unsigned int sadBlockScalar(const unsigned char* inA, unsigned int inStrideA, const unsigned char* inB, unsigned int inStrideB, unsigned int inWidth, unsigned int inHeight, unsigned int inLimit)
+  {
+    unsigned int lSum = 0;
+
+    for(unsigned int r = 0; r < inHeight && lSum < inLimit; r++, inA += inStrideA, inB += inStrideB)
+      for(unsigned int i = 0; i < inWidth; i++)
+        lSum += (inA[i]>inB[i]) ? inA[i]-inB[i] : inB[i]-inA[i];
+    return lSum;
+  }
+
+#ifdef PIXEL_KERNELS_X86
+
+  PIXEL_KERNELS_TARGET_SSE2 inline __m128i blendSSE2(__m128i inA, __m128i inB, __m128i inWeights, __m128i inInvWeights)
+  {
+    const __m128i l128 = _mm_set1_epi16(128);
+    __m128i lValue = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(inA, inWeights), _mm_mullo_epi16(inB, inInvWeights)), l128);
+    return _mm_srli_epi16(_mm_add_epi16(lValue, _mm_srli_epi16(lValue, 8)), 8);
+  }
+
+  PIXEL_KERNELS_TARGET_SSE2 void blendRowSSE2(const unsigned char* inA, const unsigned char* inB, const unsigned char* inWeights, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    const __m128i lZero = _mm_setzero_si128();
+    const __m128i l255 = _mm_set1_epi8((char)255);
+    unsigned int i = 0;
+
+    for(; i+16 <= inNbBytes; i += 16)
+    {
+      __m128i lA = _mm_loadu_si128((const __m128i*)(inA+i));
+      __m128i lB = _mm_loadu_si128((const __m128i*)(inB+i));
+      __m128i lWeights = _mm_loadu_si128((const __m128i*)(inWeights+i));
+      __m128i lInvWeights = _mm_sub_epi8(l255, lWeights);
+      __m128i lLow = blendSSE2(_mm_unpacklo_epi8(lA, lZero), _mm_unpacklo_epi8(lB, lZero), _mm_unpacklo_epi8(lWeights, lZero), _mm_unpacklo_epi8(lInvWeights, lZero));
+      __m128i lHigh = blendSSE2(_mm_unpackhi_epi8(lA, lZero), _mm_unpackhi_epi8(lB, lZero), _mm_unpackhi_epi8(lWeights, lZero), _mm_unpackhi_epi8(lInvWeights, lZero));
+      _mm_storeu_si128((__m128i*)(outRow+i), _mm_packus_epi16(lLow, lHigh));
+    }
+    blendRowScalar(inA+i, inB+i, inWeights+i, outRow+i, inNbBytes-i);
+  }
+
+  PIXEL_KERNELS_TARGET_SSE2 void selectRowSSE2(const unsigned char* inA, const unsigned char* inB, const unsigned char* inMasks, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    unsigned int i = 0;
+
+    for(; i+16 <= inNbBytes; i += 16)
+    {
+      __m128i lMasks = _mm_loadu_si128((const __m128i*)(inMasks+i));
+      __m128i lA = _mm_and_si128(_mm_loadu_si128((const __m128i*)(inA+i)), lMasks);
+      __m128i lB = _mm_andnot_si128(lMasks, _mm_loadu_si128((const __m128i*)(inB+i)));
+      _mm_storeu_si128((__m128i*)(outRow+i), _mm_or_si128(lA, lB));
+    }
+    selectRowScalar(inA+i, inB+i, inMasks+i, outRow+i, inNbBytes-i);
+  }
+
+  PIXEL_KERNELS_TARGET_AVX2 inline __m256i blendAVX2(__m256i inA, __m256i inB, __m256i inWeights, __m256i inInvWeights)
+  {
+    const __m256i l128 = _mm256_set1_epi16(128);
+    __m256i lValue = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(inA, inWeights), _mm256_mullo_epi16(inB, inInvWeights)), l128);
+    return _mm256_srli_epi16(_mm256_add_epi16(lValue, _mm256_srli_epi16(lValue, 8)), 8);
+  }
+
+  // Unpacking and packing work within 128 bits lanes, so the bytes come out in order
+  PIXEL_KERNELS_TARGET_AVX2 void blendRowAVX2(const unsigned char* inA, const unsigned char* inB, const unsigned char* inWeights, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    const __m256i lZero = _mm256_setzero_si256();
+    const __m256i l255 = _mm256_set1_epi8((char)255);
+    unsigned int i = 0;
+
+    for(; i+32 <= inNbBytes; i += 32)
+    {
+      __m256i lA = _mm256_loadu_si256((const __m256i*)(inA+i));
+      __m256i lB = _mm256_loadu_si256((const __m256i*)(inB+i));
+      __m256i lWeights = _mm256_loadu_si256((const __m256i*)(inWeights+i));
+      __m256i lInvWeights = _mm256_sub_epi8(l255, lWeights);
+      __m256i lLow = blendAVX2(_mm256_unpacklo_epi8(lA, lZero), _mm256_unpacklo_epi8(lB, lZero), _mm256_unpacklo_epi8(lWeights, lZero), _mm256_unpacklo_epi8(lInvWeights, lZero));
+      __m256i lHigh = blendAVX2(_mm256_unpackhi_epi8(lA, lZero), _mm256_unpackhi_epi8(lB, lZero), _mm256_unpackhi_epi8(lWeights, lZero), _mm256_unpackhi_epi8(lInvWeights, lZero));
+      _mm256_storeu_si256((__m256i*)(outRow+i), _mm256_packus_epi16(lLow, lHigh));
+    }
+    blendRowSSE2(inA+i, inB+i, inWeights+i, outRow+i, inNbBytes-i);
+  }
+
+  PIXEL_KERNELS_TARGET_AVX2 void selectRowAVX2(const unsigned char* inA, const unsigned char* inB, const unsigned char* inMasks, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    unsigned int i = 0;
+
+    for(; i+32 <= inNbBytes; i += 32)
+    {
+      __m256i lMasks = _mm256_loadu_si256((const __m256i*)(inMasks+i));
+      __m256i lA = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(inA+i)), lMasks);
+      __m256i lB = _mm256_andnot_si256(lMasks, _mm256_loadu_si256((const __m256i*)(inB+i)));
+      _mm256_storeu_si256((__m256i*)(outRow+i), _mm256_or_si256(lA, lB));
+    }
+    selectRowSSE2(inA+i, inB+i, inMasks+i, outRow+i, inNbBytes-i);
+  }
+
+  // Weights of 16 pixels at a time, spread over the bytes of the pixels by byte shuffles
+  PIXEL_KERNELS_TARGET_AVX2 void expandWeightsAVX2(const unsigned char* inMask, unsigned char* outWeights, unsigned int inNbPixels, unsigned int inNbChannels, const unsigned char inWeights[2])
+  {
+    const __m128i lZero = _mm_setzero_si128();
+    const __m128i lNotSelected = _mm_set1_epi8((char)inWeights[0]);
+    const __m128i lSelected = _mm_set1_epi8((char)inWeights[1]);
+    const __m128i lSpread3[3] = {_mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5), _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10), _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15)};
+    unsigned int i = 0;
+
+    if(inNbChannels==1 || inNbChannels==3 || inNbChannels==4)
+    {
+      for(; i+16 <= inNbPixels; i += 16, outWeights += 16*inNbChannels)
+      {
+        __m128i lNotSet = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(inMask+i)), lZero);
+        __m128i lWeights = _mm_or_si128(_mm_and_si128(lNotSet, lNotSelected), _mm_andnot_si128(lNotSet, lSelected));
+        if(inNbChannels==1)
+          _mm_storeu_si128((__m128i*)outWeights, lWeights);
+        else if(inNbChannels==3)
+        {
+          _mm_storeu_si128((__m128i*)outWeights, _mm_shuffle_epi8(lWeights, lSpread3[0]));
+          _mm_storeu_si128((__m128i*)(outWeights+16), _mm_shuffle_epi8(lWeights, lSpread3[1]));
+          _mm_storeu_si128((__m128i*)(outWeights+32), _mm_shuffle_epi8(lWeights, lSpread3[2]));
+        }
+        else
+        {
+          __m128i lLow = _mm_unpacklo_epi8(lWeights, lWeights);
+          __m128i lHigh = _mm_unpackhi_epi8(lWeights, lWeights);
+          _mm_storeu_si128((__m128i*)outWeights, _mm_unpacklo_epi16(lLow, lLow));
+          _mm_storeu_si128((__m128i*)(outWeights+16), _mm_unpackhi_epi16(lLow, lLow));
+          _mm_storeu_si128((__m128i*)(outWeights+32), _mm_unpacklo_epi16(lHigh, lHigh));
+          _mm_storeu_si128((__m128i*)(outWeights+48), _mm_unpackhi_epi16(lHigh, lHigh));
+        }
+      }
+    }
+    expandWeightsScalar(inMask+i, outWeights, inNbPixels-i, inNbChannels, inWeights);
+  }
+
+  // Luminance of 4 pixels of 4 bytes, as 32 bits integers
+  PIXEL_KERNELS_TARGET_SSE2 inline __m128i grayPixelsSSE2(__m128i inPixels, __m128i inWeights)
+  {
+    const __m128i lZero = _mm_setzero_si128();
+    __m128 lLow = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(inPixels, lZero), inWeights));
+    __m128 lHigh = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(inPixels, lZero), inWeights));
+    __m128i lSum = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(lLow, lHigh, _MM_SHUFFLE(2,0,2,0))), _mm_castps_si128(_mm_shuffle_ps(lLow, lHigh, _MM_SHUFFLE(3,1,3,1))));
+    return _mm_srli_epi32(_mm_add_epi32(lSum, _mm_set1_epi32(1 << (PIXEL_KERNELS_GRAY_SHIFT-1))), PIXEL_KERNELS_GRAY_SHIFT);
+  }
+
+  // 4 pixels of 3 bytes spread to 4 bytes each (the fourth byte has a zero weight), from a 16 bytes load
+  PIXEL_KERNELS_TARGET_SSE2 inline __m128i spreadPixelsSSE2(const unsigned char* inRow)
+  {
+    __m128i lData = _mm_loadu_si128((const __m128i*)inRow);
+    __m128i l01 = _mm_unpacklo_epi32(lData, _mm_srli_si128(lData, 3));
+    __m128i l23 = _mm_unpacklo_epi32(_mm_srli_si128(lData, 6), _mm_srli_si128(lData, 9));
+    return _mm_unpacklo_epi64(l01, l23);
+  }
+
+  // Each block of 16 pixels is read before its gray pixels are written, so rows can be converted in place
+  PIXEL_KERNELS_TARGET_SSE2 void grayRowSSE2(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, const short inWeights[4])
+  {
+    const __m128i lWeights = _mm_set_epi16(inWeights[3], inWeights[2], inWeights[1], inWeights[0], inWeights[3], inWeights[2], inWeights[1], inWeights[0]);
+    unsigned int i = 0;
+
+    // The last load of a block of 3 bytes pixels reads 4 bytes past it
+    for(; i+16 <= inNbPixels && (inNbChannels==4 || (i+16)*3+4 <= inNbPixels*3); i += 16)
+    {
+      __m128i lPixels[4];
+      for(unsigned int j = 0; j < 4; j++)
+        lPixels[j] = (inNbChannels==4) ? _mm_loadu_si128((const __m128i*)(inRow+(i+4*j)*4)) : spreadPixelsSSE2(inRow+(i+4*j)*3);
+      __m128i lLow = _mm_packs_epi32(grayPixelsSSE2(lPixels[0], lWeights), grayPixelsSSE2(lPixels[1], lWeights));
+      __m128i lHigh = _mm_packs_epi32(grayPixelsSSE2(lPixels[2], lWeights), grayPixelsSSE2(lPixels[3], lWeights));
+      _mm_storeu_si128((__m128i*)(outRow+i), _mm_packus_epi16(lLow, lHigh));
+    }
+    grayRowScalar(inRow+i*inNbChannels, outRow+i, inNbPixels-i, inNbChannels, inWeights);
+  }
+
+  // Luminance of 8 pixels of 4 bytes, as 32 bits integers in order (unpacking and shuffling stay within 128 bits lanes)
+  PIXEL_KERNELS_TARGET_AVX2 inline __m256i grayPixelsAVX2(__m256i inPixels, __m256i inWeights)
+  {
+    const __m256i lZero = _mm256_setzero_si256();
+    __m256 lLow = _mm256_castsi256_ps(_mm256_madd_epi16(_mm256_unpacklo_epi8(inPixels, lZero), inWeights));
+    __m256 lHigh = _mm256_castsi256_ps(_mm256_madd_epi16(_mm256_unpackhi_epi8(inPixels, lZero), inWeights));
+    __m256i lSum = _mm256_add_epi32(_mm256_castps_si256(_mm256_shuffle_ps(lLow, lHigh, _MM_SHUFFLE(2,0,2,0))), _mm256_castps_si256(_mm256_shuffle_ps(lLow, lHigh, _MM_SHUFFLE(3,1,3,1))));
+    return _mm256_srli_epi32(_mm256_add_epi32(lSum, _mm256_set1_epi32(1 << (PIXEL_KERNELS_GRAY_SHIFT-1))), PIXEL_KERNELS_GRAY_SHIFT);
+  }
+
+  PIXEL_KERNELS_TARGET_AVX2 void grayRowAVX2(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, const short inWeights[4])
+  {
+    const __m256i lWeights = _mm256_set_epi16(inWeights[3], inWeights[2], inWeights[1], inWeights[0], inWeights[3], inWeights[2], inWeights[1], inWeights[0], inWeights[3], inWeights[2], inWeights[1], inWeights[0], inWeights[3], inWeights[2], inWeights[1], inWeights[0]);
+    const __m256i lSpread = _mm256_setr_epi8(0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,-1, 0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,-1);
+    const __m256i lOrder = _mm256_setr_epi32(0,4,1,5,2,6,3,7);
+    unsigned int i = 0;
+
+    // The last load of a block of 3 bytes pixels reads 4 bytes past it
+    for(; i+32 <= inNbPixels && (inNbChannels==4 || (i+32)*3+4 <= inNbPixels*3); i += 32)
+    {
+      __m256i lGray[4];
+      for(unsigned int j = 0; j < 4; j++)
+      {
+        __m256i lPixels;
+        if(inNbChannels==4)
+          lPixels = _mm256_loadu_si256((const __m256i*)(inRow+(i+8*j)*4));
+        else
+        {
+          const unsigned char* lRow = inRow+(i+8*j)*3;
+          lPixels = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)lRow)), _mm_loadu_si128((const __m128i*)(lRow+12)), 1);
+          lPixels = _mm256_shuffle_epi8(lPixels, lSpread);
+        }
+        lGray[j] = grayPixelsAVX2(lPixels, lWeights);
+      }
+      // Packing works within lanes: 4 pixels of each block per lane, put back in order
+      __m256i lPacked = _mm256_packus_epi16(_mm256_packs_epi32(lGray[0], lGray[1]), _mm256_packs_epi32(lGray[2], lGray[3]));
+      _mm256_storeu_si256((__m256i*)(outRow+i), _mm256_permutevar8x32_epi32(lPacked, lOrder));
+    }
+    grayRowSSE2(inRow+i*inNbChannels, outRow+i, inNbPixels-i, inNbChannels, inWeights);
+  }
+
+  // Luminance of 16 pixels of 4 bytes, as 32 bits integers in order
+  PIXEL_KERNELS_TARGET_AVX512 inline __m512i grayPixelsAVX512(__m512i inPixels, __m512i inWeights)
+  {
+    const __m512i lZero = _mm512_setzero_si512();
+    __m512 lLow = _mm512_castsi512_ps(_mm512_madd_epi16(_mm512_unpacklo_epi8(inPixels, lZero), inWeights));
+    __m512 lHigh = _mm512_castsi512_ps(_mm512_madd_epi16(_mm512_unpackhi_epi8(inPixels, lZero), inWeights));
+    __m512i lSum = _mm512_add_epi32(_mm512_castps_si512(_mm512_shuffle_ps(lLow, lHigh, _MM_SHUFFLE(2,0,2,0))), _mm512_castps_si512(_mm512_shuffle_ps(lLow, lHigh, _MM_SHUFFLE(3,1,3,1))));
+    return _mm512_srli_epi32(_mm512_add_epi32(lSum, _mm512_set1_epi32(1 << (PIXEL_KERNELS_GRAY_SHIFT-1))), PIXEL_KERNELS_GRAY_SHIFT);
+  }
+
+  PIXEL_KERNELS_TARGET_AVX512 void grayRowAVX512(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, const short inWeights[4])
+  {
+    const __m512i lWeights = _mm512_set1_epi64(((long long)(unsigned short)inWeights[3] << 48) | ((long long)(unsigned short)inWeights[2] << 32) | ((long long)(unsigned short)inWeights[1] << 16) | (unsigned short)inWeights[0]);
+    const __m512i lSpread = _mm512_broadcast_i32x4(_mm_setr_epi8(0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,-1));
+    const __m512i lOrder = _mm512_setr_epi32(0,4,8,12,1,5,9,13,2,6,10,14,3,7,11,15);
+    unsigned int i = 0;
+
+    // The last load of a block of 3 bytes pixels reads 4 bytes past it
+    for(; i+64 <= inNbPixels && (inNbChannels==4 || (i+64)*3+4 <= inNbPixels*3); i += 64)
+    {
+      __m512i lGray[4];
+      for(unsigned int j = 0; j < 4; j++)
+      {
+        __m512i lPixels;
+        if(inNbChannels==4)
+          lPixels = _mm512_loadu_si512((const void*)(inRow+(i+16*j)*4));
+        else
+        {
+          const unsigned char* lRow = inRow+(i+16*j)*3;
+          lPixels = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)lRow));
+          lPixels = _mm512_inserti32x4(lPixels, _mm_loadu_si128((const __m128i*)(lRow+12)), 1);
+          lPixels = _mm512_inserti32x4(lPixels, _mm_loadu_si128((const __m128i*)(lRow+24)), 2);
+          lPixels = _mm512_inserti32x4(lPixels, _mm_loadu_si128((const __m128i*)(lRow+36)), 3);
+          lPixels = _mm512_shuffle_epi8(lPixels, lSpread);
+        }
+        lGray[j] = grayPixelsAVX512(lPixels, lWeights);
+      }
+      // Packing works within lanes: 4 pixels of each block per lane, put back in order
+      __m512i lPacked = _mm512_packus_epi16(_mm512_packs_epi32(lGray[0], lGray[1]), _mm512_packs_epi32(lGray[2], lGray[3]));
+      _mm512_storeu_si512((void*)(outRow+i), _mm512_permutexvar_epi32(lOrder, lPacked));
+    }
+    grayRowAVX2(inRow+i*inNbChannels, outRow+i, inNbPixels-i, inNbChannels, inWeights);
+  }
+
+  // Largest absolute difference between the channels of 4 pixels of 4 bytes, as 32 bits integers
+  PIXEL_KERNELS_TARGET_SSE2 inline __m128i differencePixelsSSE2(__m128i inA, __m128i inB)
+  {
+    __m128i lDifference = _mm_or_si128(_mm_subs_epu8(inA, inB), _mm_subs_epu8(inB, inA));
+    lDifference = _mm_max_epu8(lDifference, _mm_srli_epi32(lDifference, 8));
+    lDifference = _mm_max_epu8(lDifference, _mm_srli_epi32(lDifference, 16));
+    return _mm_and_si128(lDifference, _mm_set1_epi32(255));
+  }
+
+  PIXEL_KERNELS_TARGET_SSE2 void differenceRowSSE2(const unsigned char* inA, const unsigned char* inB, unsigned char* outRow, unsigned char* outBits, unsigned int inNbPixels, unsigned int inNbChannels, int inThreshold)
+  {
+    const __m128i lZero = _mm_setzero_si128();
+    const __m128i lOnes = _mm_set1_epi8((char)255);
+    const __m128i lThreshold = _mm_set1_epi8((char)inThreshold);
+    const __m128i lThreeBytes = _mm_set1_epi32(0x00FFFFFF);
+    unsigned int i = 0;
+
+    // The last load of a block of 3 bytes pixels reads 4 bytes past it
+    for(; i+16 <= inNbPixels && (inNbChannels!=3 || (i+16)*3+4 <= inNbPixels*3); i += 16)
+    {
+      __m128i lDifference;
+      if(inNbChannels==1)
+      {
+        __m128i lA = _mm_loadu_si128((const __m128i*)(inA+i));
+        __m128i lB = _mm_loadu_si128((const __m128i*)(inB+i));
+        lDifference = _mm_or_si128(_mm_subs_epu8(lA, lB), _mm_subs_epu8(lB, lA));
+      }
+      else
+      {
+        __m128i lPixels[4];
+        for(unsigned int j = 0; j < 4; j++)
+        {
+          if(inNbChannels==4)
+            lPixels[j] = differencePixelsSSE2(_mm_loadu_si128((const __m128i*)(inA+(i+4*j)*4)), _mm_loadu_si128((const __m128i*)(inB+(i+4*j)*4)));
+          else
+            lPixels[j] = differencePixelsSSE2(_mm_and_si128(spreadPixelsSSE2(inA+(i+4*j)*3), lThreeBytes), _mm_and_si128(spreadPixelsSSE2(inB+(i+4*j)*3), lThreeBytes));
+        }
+        lDifference = _mm_packus_epi16(_mm_packs_epi32(lPixels[0], lPixels[1]), _mm_packs_epi32(lPixels[2], lPixels[3]));
+      }
+      if(inThreshold>=0)
+        lDifference = _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(lDifference, lThreshold), lZero), lOnes);
+      _mm_storeu_si128((__m128i*)(outRow+i), lDifference);
+      if(outBits)
+      {
+        int lBits = _mm_movemask_epi8(_mm_cmpeq_epi8(lDifference, lZero)) ^ 0xFFFF;
+        outBits[i >> 3] = (unsigned char)lBits;
+        outBits[(i >> 3)+1] = (unsigned char)(lBits >> 8);
+      }
+    }
+    differenceRowScalar(inA+i*inNbChannels, inB+i*inNbChannels, outRow+i, outBits ? outBits+(i >> 3) : NULL, inNbPixels-i, inNbChannels, inThreshold);
+  }
+
+  // Largest absolute difference between the channels of 8 pixels of 4 bytes, as 32 bits integers
+  PIXEL_KERNELS_TARGET_AVX2 inline __m256i differencePixelsAVX2(__m256i inA, __m256i inB)
+  {
+    __m256i lDifference = _mm256_or_si256(_mm256_subs_epu8(inA, inB), _mm256_subs_epu8(inB, inA));
+    lDifference = _mm256_max_epu8(lDifference, _mm256_srli_epi32(lDifference, 8));
+    lDifference = _mm256_max_epu8(lDifference, _mm256_srli_epi32(lDifference, 16));
+    return _mm256_and_si256(lDifference, _mm256_set1_epi32(255));
+  }
+
+  PIXEL_KERNELS_TARGET_AVX2 void differenceRowAVX2(const unsigned char* inA, const unsigned char* inB, unsigned char* outRow, unsigned char* outBits, unsigned int inNbPixels, unsigned int inNbChannels, int inThreshold)
+  {
+    const __m256i lZero = _mm256_setzero_si256();
+    const __m256i lOnes = _mm256_set1_epi8((char)255);
+    const __m256i lThreshold = _mm256_set1_epi8((char)inThreshold);
+    const __m256i lSpread = _mm256_setr_epi8(0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,-1, 0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,-1);
+    const __m256i lOrder = _mm256_setr_epi32(0,4,1,5,2,6,3,7);
+    unsigned int i = 0;
+
+    // The last load of a block of 3 bytes pixels reads 4 bytes past it
+    for(; i+32 <= inNbPixels && (inNbChannels!=3 || (i+32)*3+4 <= inNbPixels*3); i += 32)
+    {
+      __m256i lDifference;
+      if(inNbChannels==1)
+      {
+        __m256i lA = _mm256_loadu_si256((const __m256i*)(inA+i));
+        __m256i lB = _mm256_loadu_si256((const __m256i*)(inB+i));
+        lDifference = _mm256_or_si256(_mm256_subs_epu8(lA, lB), _mm256_subs_epu8(lB, lA));
+      }
+      else
+      {
+        __m256i lPixels[4];
+        for(unsigned int j = 0; j < 4; j++)
+        {
+          __m256i lA, lB;
+          if(inNbChannels==4)
+          {
+            lA = _mm256_loadu_si256((const __m256i*)(inA+(i+8*j)*4));
+            lB = _mm256_loadu_si256((const __m256i*)(inB+(i+8*j)*4));
+          }
+          else
+          {
+            const unsigned char* lRowA = inA+(i+8*j)*3;
+            const unsigned char* lRowB = inB+(i+8*j)*3;
+            lA = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)lRowA)), _mm_loadu_si128((const __m128i*)(lRowA+12)), 1), lSpread);
+            lB = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)lRowB)), _mm_loadu_si128((const __m128i*)(lRowB+12)), 1), lSpread);
+          }
+          lPixels[j] = differencePixelsAVX2(lA, lB);
+        }
+        // Packing works within lanes: 4 pixels of each block per lane, put back in order
+        lDifference = _mm256_packus_epi16(_mm256_packs_epi32(lPixels[0], lPixels[1]), _mm256_packs_epi32(lPixels[2], lPixels[3]));
+        lDifference = _mm256_permutevar8x32_epi32(lDifference, lOrder);
+      }
+      if(inThreshold>=0)
+        lDifference = _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(lDifference, lThreshold), lZero), lOnes);
+      _mm256_storeu_si256((__m256i*)(outRow+i), lDifference);
+      if(outBits)
+      {
+        unsigned int lBits = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lDifference, lZero));
+        for(unsigned int j = 0; j < 4; j++)
+          outBits[(i >> 3)+j] = (unsigned char)(lBits >> (8*j));
+      }
+    }
+    differenceRowSSE2(inA+i*inNbChannels, inB+i*inNbChannels, outRow+i, outBits ? outBits+(i >> 3) : NULL, inNbPixels-i, inNbChannels, inThreshold);
+  }
+
+  // Update 8 stamps (inMotion is 0xFFFF where the mask is not zero) and return their gray levels as 16 bits integers
+  PIXEL_KERNELS_TARGET_SSE2 inline __m128i historyPixelsSSE2(__m128i inMotion, __m128i& ioStamps, __m128i inStamp, __m128i inDuration, __m128i inShift, __m128i inScale)
+  {
+    const __m128i lZero = _mm_setzero_si128();
+    const __m128i lSign = _mm_set1_epi16((short)0x8000);
+    // Unsigned comparison through signed one, then one less for stamps that wrapped (0 is skipped)
+    __m128i lWrapped = _mm_cmpgt_epi16(_mm_xor_si128(ioStamps, lSign), _mm_xor_si128(inStamp, lSign));
+    __m128i lAge = _mm_add_epi16(_mm_sub_epi16(inStamp, ioStamps), lWrapped);
+    __m128i lKept = _mm_andnot_si128(_mm_cmpeq_epi16(ioStamps, lZero), _mm_cmpeq_epi16(_mm_subs_epu16(lAge, inDuration), lZero));
+    ioStamps = _mm_or_si128(_mm_and_si128(inMotion, inStamp), _mm_andnot_si128(inMotion, _mm_and_si128(lKept, ioStamps)));
+    lAge = _mm_andnot_si128(inMotion, lAge);
+    __m128i lGray = _mm_mulhi_epu16(_mm_sll_epi16(_mm_subs_epu16(inDuration, lAge), inShift), inScale);
+    return _mm_and_si128(lGray, _mm_or_si128(inMotion, lKept));
+  }
+
+  PIXEL_KERNELS_TARGET_SSE2 void historyRowSSE2(const unsigned char* inMask, unsigned short* ioStamps, unsigned char* outGray, unsigned int inNbPixels, unsigned short inStamp, unsigned short inDuration, unsigned int inShift, unsigned int inScale)
+  {
+    const __m128i lZero = _mm_setzero_si128();
+    const __m128i lOnes = _mm_set1_epi8((char)255);
+    const __m128i lStamp = _mm_set1_epi16((short)inStamp);
+    const __m128i lDuration = _mm_set1_epi16((short)inDuration);
+    const __m128i lShift = _mm_cvtsi32_si128((int)inShift);
+    const __m128i lScale = _mm_set1_epi16((short)inScale);
+    unsigned int i = 0;
+
+    for(; i+16 <= inNbPixels; i += 16)
+    {
+      __m128i lMotion = _mm_xor_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(inMask+i)), lZero), lOnes);
+      __m128i lLowStamps = _mm_loadu_si128((const __m128i*)(ioStamps+i));
+      __m128i lHighStamps = _mm_loadu_si128((const __m128i*)(ioStamps+i+8));
+      __m128i lLowGray = historyPixelsSSE2(_mm_unpacklo_epi8(lMotion, lMotion), lLowStamps, lStamp, lDuration, lShift, lScale);
+      __m128i lHighGray = historyPixelsSSE2(_mm_unpackhi_epi8(lMotion, lMotion), lHighStamps, lStamp, lDuration, lShift, lScale);
+      _mm_storeu_si128((__m128i*)(ioStamps+i), lLowStamps);
+      _mm_storeu_si128((__m128i*)(ioStamps+i+8), lHighStamps);
+      if(outGray)
+        _mm_storeu_si128((__m128i*)(outGray+i), _mm_packus_epi16(lLowGray, lHighGray));
+    }
+    historyRowScalar(inMask+i, ioStamps+i, outGray ? outGray+i : NULL, inNbPixels-i, inStamp, inDuration, inShift, inScale);
+  }
+
+  // Update 16 stamps (inMotion is 0xFFFF where the mask is not zero) and return their gray levels as 16 bits integers
+  PIXEL_KERNELS_TARGET_AVX2 inline __m256i historyPixelsAVX2(__m256i inMotion, __m256i& ioStamps, __m256i inStamp, __m256i inDuration, __m128i inShift, __m256i inScale)
+  {
+    const __m256i lZero = _mm256_setzero_si256();
+    const __m256i lSign = _mm256_set1_epi16((short)0x8000);
+    // Unsigned comparison through signed one, then one less for stamps that wrapped (0 is skipped)
+    __m256i lWrapped = _mm256_cmpgt_epi16(_mm256_xor_si256(ioStamps, lSign), _mm256_xor_si256(inStamp, lSign));
+    __m256i lAge = _mm256_add_epi16(_mm256_sub_epi16(inStamp, ioStamps), lWrapped);
+    __m256i lKept = _mm256_andnot_si256(_mm256_cmpeq_epi16(ioStamps, lZero), _mm256_cmpeq_epi16(_mm256_subs_epu16(lAge, inDuration), lZero));
+    ioStamps = _mm256_or_si256(_mm256_and_si256(inMotion, inStamp), _mm256_andnot_si256(inMotion, _mm256_and_si256(lKept, ioStamps)));
+    lAge = _mm256_andnot_si256(inMotion, lAge);
+    __m256i lGray = _mm256_mulhi_epu16(_mm256_sll_epi16(_mm256_subs_epu16(inDuration, lAge), inShift), inScale);
+    return _mm256_and_si256(lGray, _mm256_or_si256(inMotion, lKept));
+  }
+
+  PIXEL_KERNELS_TARGET_AVX2 void historyRowAVX2(const unsigned char* inMask, unsigned short* ioStamps, unsigned char* outGray, unsigned int inNbPixels, unsigned short inStamp, unsigned short inDuration, unsigned int inShift, unsigned int inScale)
+  {
+    const __m256i lZero = _mm256_setzero_si256();
+    const __m256i lOnes = _mm256_set1_epi8((char)255);
+    const __m256i lStamp = _mm256_set1_epi16((short)inStamp);
+    const __m256i lDuration = _mm256_set1_epi16((short)inDuration);
+    const __m128i lShift = _mm_cvtsi32_si128((int)inShift);
+    const __m256i lScale = _mm256_set1_epi16((short)inScale);
+    unsigned int i = 0;
+
+    // Mask bytes are widened to 16 bits in order, so the gray levels of a block are packed from its two halves
+    for(; i+16 <= inNbPixels; i += 16)
+    {
+      __m256i lMotion = _mm256_xor_si256(_mm256_cmpeq_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(inMask+i))), lZero), lOnes);
+      __m256i lStamps = _mm256_loadu_si256((const __m256i*)(ioStamps+i));
+      __m256i lGray = historyPixelsAVX2(lMotion, lStamps, lStamp, lDuration, lShift, lScale);
+      _mm256_storeu_si256((__m256i*)(ioStamps+i), lStamps);
+      if(outGray)
+        _mm_storeu_si128((__m128i*)(outGray+i), _mm_packus_epi16(_mm256_castsi256_si128(lGray), _mm256_extracti128_si256(lGray, 1)));
+    }
+    historyRowScalar(inMask+i, ioStamps+i, outGray ? outGray+i : NULL, inNbPixels-i, inStamp, inDuration, inShift, inScale);
+  }
+
+  // Sums of the pairs of bytes of the rows of a 2x2 block of 1 channel pixels, as 16 bits integers
+  PIXEL_KERNELS_TARGET_SSE2 inline __m128i sumPairsSSE2(__m128i inA, __m128i inB)
+  {
+    const __m128i lLowBytes = _mm_set1_epi16(255);
+    return _mm_add_epi16(_mm_add_epi16(_mm_and_si128(inA, lLowBytes), _mm_srli_epi16(inA, 8)), _mm_add_epi16(_mm_and_si128(inB, lLowBytes), _mm_srli_epi16(inB, 8)));
+  }
+
+  // Sums of the channels of the 2 pixels of 4 bytes of each half of a 2 rows block, as 16 bits integers
+  PIXEL_KERNELS_TARGET_SSE2 inline __m128i sumQuadPixelsSSE2(__m128i inA, __m128i inB)
+  {
+    const __m128i lZero = _mm_setzero_si128();
+    __m128i lLow = _mm_add_epi16(_mm_unpacklo_epi8(inA, lZero), _mm_unpacklo_epi8(inB, lZero));
+    __m128i lHigh = _mm_add_epi16(_mm_unpackhi_epi8(inA, lZero), _mm_unpackhi_epi8(inB, lZero));
+    lLow = _mm_add_epi16(lLow, _mm_srli_si128(lLow, 8));
+    lHigh = _mm_add_epi16(lHigh, _mm_srli_si128(lHigh, 8));
+    return _mm_unpacklo_epi64(lLow, lHigh);
+  }
+
+  // Blocks of 2x2 or 4x4 pixels of 1 or 4 channels, other blocks use the scalar version (3 channels blocks need the byte shuffles of the AVX2 version)
+  PIXEL_KERNELS_TARGET_SSE2 void boxRowSSE2(const unsigned char* const* inRows, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    const __m128i lOnes = _mm_set1_epi16(1);
+    unsigned int i = 0;
+
+    if(inNbChannels==1 && inFactor==2)
+    {
+      const __m128i lRound = _mm_set1_epi16(2);
+      for(; i+16 <= inNbPixels; i += 16)
+      {
+        __m128i lLow = sumPairsSSE2(_mm_loadu_si128((const __m128i*)(inRows[0]+2*i)), _mm_loadu_si128((const __m128i*)(inRows[1]+2*i)));
+        __m128i lHigh = sumPairsSSE2(_mm_loadu_si128((const __m128i*)(inRows[0]+2*i+16)), _mm_loadu_si128((const __m128i*)(inRows[1]+2*i+16)));
+        _mm_storeu_si128((__m128i*)(outRow+i), _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(lLow, lRound), 2), _mm_srli_epi16(_mm_add_epi16(lHigh, lRound), 2)));
+      }
+    }
+    else if(inNbChannels==1 && inFactor==4)
+    {
+      const __m128i lRound = _mm_set1_epi32(8);
+      for(; i+16 <= inNbPixels; i += 16)
+      {
+        __m128i lSums[4];
+        for(unsigned int j = 0; j < 4; j++)
+        {
+          // Pairs of the 4 rows, then pairs of pairs
+          __m128i lPairs = _mm_add_epi16(sumPairsSSE2(_mm_loadu_si128((const __m128i*)(inRows[0]+4*i+16*j)), _mm_loadu_si128((const __m128i*)(inRows[1]+4*i+16*j))), sumPairsSSE2(_mm_loadu_si128((const __m128i*)(inRows[2]+4*i+16*j)), _mm_loadu_si128((const __m128i*)(inRows[3]+4*i+16*j))));
+          lSums[j] = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(lPairs, lOnes), lRound), 4);
+        }
+        _mm_storeu_si128((__m128i*)(outRow+i), _mm_packus_epi16(_mm_packs_epi32(lSums[0], lSums[1]), _mm_packs_epi32(lSums[2], lSums[3])));
+      }
+    }
+    else if(inNbChannels==4 && inFactor==2)
+    {
+      const __m128i lRound = _mm_set1_epi16(2);
+      for(; i+4 <= inNbPixels; i += 4)
+      {
+        __m128i lLow = sumQuadPixelsSSE2(_mm_loadu_si128((const __m128i*)(inRows[0]+8*i)), _mm_loadu_si128((const __m128i*)(inRows[1]+8*i)));
+        __m128i lHigh = sumQuadPixelsSSE2(_mm_loadu_si128((const __m128i*)(inRows[0]+8*i+16)), _mm_loadu_si128((const __m128i*)(inRows[1]+8*i+16)));
+        _mm_storeu_si128((__m128i*)(outRow+4*i), _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(lLow, lRound), 2), _mm_srli_epi16(_mm_add_epi16(lHigh, lRound), 2)));
+      }
+    }
+    else if(inNbChannels==4 && inFactor==4)
+    {
+      const __m128i lRound = _mm_set1_epi16(8);
+      for(; i+4 <= inNbPixels; i += 4)
+      {
+        __m128i lSums[2];
+        for(unsigned int j = 0; j < 2; j++)
+        {
+          // Each 16 bytes of a row hold the 4 pixels of a block: pixels 0+1 and 2+3 of the rows, then the two halves
+          __m128i lFirst = sumQuadPixelsSSE2(_mm_loadu_si128((const __m128i*)(inRows[0]+16*(i+2*j))), _mm_loadu_si128((const __m128i*)(inRows[1]+16*(i+2*j))));
+          __m128i lSecond = sumQuadPixelsSSE2(_mm_loadu_si128((const __m128i*)(inRows[0]+16*(i+2*j+1))), _mm_loadu_si128((const __m128i*)(inRows[1]+16*(i+2*j+1))));
+          lFirst = _mm_add_epi16(lFirst, sumQuadPixelsSSE2(_mm_loadu_si128((const __m128i*)(inRows[2]+16*(i+2*j))), _mm_loadu_si128((const __m128i*)(inRows[3]+16*(i+2*j)))));
+          lSecond = _mm_add_epi16(lSecond, sumQuadPixelsSSE2(_mm_loadu_si128((const __m128i*)(inRows[2]+16*(i+2*j+1))), _mm_loadu_si128((const __m128i*)(inRows[3]+16*(i+2*j+1)))));
+          __m128i lBlocks = _mm_add_epi16(_mm_unpacklo_epi64(lFirst, lSecond), _mm_unpackhi_epi64(lFirst, lSecond));
+          lSums[j] = _mm_srli_epi16(_mm_add_epi16(lBlocks, lRound), 4);
+        }
+        _mm_storeu_si128((__m128i*)(outRow+4*i), _mm_packus_epi16(lSums[0], lSums[1]));
+      }
+    }
+
+    if(i<inNbPixels)
+    {
+      const unsigned char* lRows[4];
+      const unsigned char* const* lRemainingRows = inRows;
+      if(i>0)
+      {
+        for(unsigned int r = 0; r < inFactor; r++)
+          lRows[r] = inRows[r]+i*inFactor*inNbChannels;
+        lRemainingRows = lRows;
+      }
+      boxRowScalar(lRemainingRows, outRow+i*inNbChannels, inNbPixels-i, inNbChannels, inFactor);
+    }
+  }
+
+  // Pixels of 1 or 4 channels repeated 2 or 4 times, other pixels use the scalar version (3 channels pixels need the byte shuffles of the AVX2 version)
+  PIXEL_KERNELS_TARGET_SSE2 void nearestRowSSE2(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    unsigned int lBytes = inNbChannels*inFactor;
+    unsigned int i = 0;
+
+    if((inNbChannels==1 || inNbChannels==4) && (inFactor==2 || inFactor==4))
+    {
+      for(; (i+16/inNbChannels) <= inNbPixels; i += 16/inNbChannels)
+      {
+        __m128i lPixels = _mm_loadu_si128((const __m128i*)(inRow+i*inNbChannels));
+        __m128i lRepeated[4];
+        if(inNbChannels==1)
+        {
+          lRepeated[0] = _mm_unpacklo_epi8(lPixels, lPixels);
+          lRepeated[1] = _mm_unpackhi_epi8(lPixels, lPixels);
+          if(inFactor==4)
+          {
+            lRepeated[3] = _mm_unpackhi_epi16(lRepeated[1], lRepeated[1]);
+            lRepeated[2] = _mm_unpacklo_epi16(lRepeated[1], lRepeated[1]);
+            lRepeated[1] = _mm_unpackhi_epi16(lRepeated[0], lRepeated[0]);
+            lRepeated[0] = _mm_unpacklo_epi16(lRepeated[0], lRepeated[0]);
+          }
+        }
+        else if(inFactor==2)
+        {
+          lRepeated[0] = _mm_unpacklo_epi32(lPixels, lPixels);
+          lRepeated[1] = _mm_unpackhi_epi32(lPixels, lPixels);
+        }
+        else
+        {
+          lRepeated[0] = _mm_shuffle_epi32(lPixels, _MM_SHUFFLE(0,0,0,0));
+          lRepeated[1] = _mm_shuffle_epi32(lPixels, _MM_SHUFFLE(1,1,1,1));
+          lRepeated[2] = _mm_shuffle_epi32(lPixels, _MM_SHUFFLE(2,2,2,2));
+          lRepeated[3] = _mm_shuffle_epi32(lPixels, _MM_SHUFFLE(3,3,3,3));
+        }
+        for(unsigned int j = 0; j < inFactor; j++)
+          _mm_storeu_si128((__m128i*)(outRow+i*lBytes+16*j), lRepeated[j]);
+      }
+    }
+    nearestRowScalar(inRow+i*inNbChannels, outRow+i*lBytes, inNbPixels-i, inNbChannels, inFactor);
+  }
+
+  // Blocks of 2x2 or 4x4 pixels of 3 channels, whose bytes are gathered by byte shuffles, other blocks use the SSE2 version
+  PIXEL_KERNELS_TARGET_AVX2 void boxRowAVX2(const unsigned char* const* inRows, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    if(inNbChannels!=3 || (inFactor!=2 && inFactor!=4))
+    {
+      boxRowSSE2(inRows, outRow, inNbPixels, inNbChannels, inFactor);
+      return;
+    }
+
+    const __m128i lOnes = _mm_set1_epi16(1);
+    unsigned int i = 0;
+
+    // 16 bytes are stored for 4 pixels of 3 bytes, the 4 last ones are overwritten by the next pixels
+
+    if(inFactor==2)
+    {
+      // Channels of the 2 pixels of a block side by side, from the bytes 0 to 11 and 12 to 23 of 8 pixels
+      const __m128i lPairs[2] = {_mm_setr_epi8(0, 3, 1, 4, 2, 5, 6, 9, 7, 10, 8, 11, -1, -1, -1, -1), _mm_setr_epi8(4, 7, 5, 8, 6, 9, 10, 13, 11, 14, 12, 15, -1, -1, -1, -1)};
+      const __m128i lPack = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+      const __m128i lRound = _mm_set1_epi16(2);
+      for(; i+6 <= inNbPixels; i += 4)
+      {
+        __m128i lSums[2];
+        for(unsigned int j = 0; j < 2; j++)
+        {
+          __m128i lA = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(inRows[0]+6*i+8*j)), lPairs[j]);
+          __m128i lB = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(inRows[1]+6*i+8*j)), lPairs[j]);
+          lSums[j] = _mm_srli_epi16(_mm_add_epi16(sumPairsSSE2(lA, lB), lRound), 2);
+        }
+        // Both halves hold the 6 bytes of 2 pixels followed by 2 zeros
+        _mm_storeu_si128((__m128i*)(outRow+3*i), _mm_shuffle_epi8(_mm_packus_epi16(lSums[0], lSums[1]), lPack));
+      }
+    }
+    else
+    {
+      // Channels of the 4 pixels of a block side by side, from the 12 bytes of the block
+      const __m128i lQuads = _mm_setr_epi8(0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1);
+      // The sums of the channels are 4 channels pixels whose last channel is 0
+      const __m128i lPack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+      const __m128i lRound = _mm_set1_epi32(8);
+      for(; i+6 <= inNbPixels; i += 4)
+      {
+        __m128i lSums[4];
+        for(unsigned int j = 0; j < 4; j++)
+        {
+          __m128i lPairs = _mm_setzero_si128();
+          for(unsigned int r = 0; r < 4; r += 2)
+            lPairs = _mm_add_epi16(lPairs, sumPairsSSE2(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(inRows[r]+12*(i+j))), lQuads), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(inRows[r+1]+12*(i+j))), lQuads)));
+          lSums[j] = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(lPairs, lOnes), lRound), 4);
+        }
+        _mm_storeu_si128((__m128i*)(outRow+3*i), _mm_shuffle_epi8(_mm_packus_epi16(_mm_packs_epi32(lSums[0], lSums[1]), _mm_packs_epi32(lSums[2], lSums[3])), lPack));
+      }
+    }
+
+    if(i<inNbPixels)
+    {
+      const unsigned char* lRows[4];
+      const unsigned char* const* lRemainingRows = inRows;
+      if(i>0)
+      {
+        for(unsigned int r = 0; r < inFactor; r++)
+          lRows[r] = inRows[r]+i*inFactor*inNbChannels;
+        lRemainingRows = lRows;
+      }
+      boxRowScalar(lRemainingRows, outRow+i*inNbChannels, inNbPixels-i, inNbChannels, inFactor);
+    }
+  }
+
+  // Pixels of 3 channels repeated 2 or 4 times by byte shuffles, 48 bytes at a time, other pixels use the SSE2 version
+  PIXEL_KERNELS_TARGET_AVX2 void nearestRowAVX2(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    if(inNbChannels!=3 || (inFactor!=2 && inFactor!=4))
+    {
+      nearestRowSSE2(inRow, outRow, inNbPixels, inNbChannels, inFactor);
+      return;
+    }
+
+    unsigned int i = 0;
+
+    if(inFactor==2)
+    {
+      // 8 pixels give 48 bytes, each 16 of them taken from the bytes 0, 6 and 8 of the pixels
+      const __m128i lRepeat[3] = {_mm_setr_epi8(0, 1, 2, 0, 1, 2, 3, 4, 5, 3, 4, 5, 6, 7, 8, 6), _mm_setr_epi8(1, 2, 3, 4, 5, 3, 4, 5, 6, 7, 8, 6, 7, 8, 9, 10), _mm_setr_epi8(9, 7, 8, 9, 10, 11, 12, 10, 11, 12, 13, 14, 15, 13, 14, 15)};
+      const unsigned int lOffsets[3] = {0, 6, 8};
+      for(; i+8 <= inNbPixels; i += 8)
+      {
+        for(unsigned int j = 0; j < 3; j++)
+          _mm_storeu_si128((__m128i*)(outRow+6*i+16*j), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(inRow+3*i+lOffsets[j])), lRepeat[j]));
+      }
+    }
+    else
+    {
+      // 4 pixels give 48 bytes, read with 4 more bytes that belong to the next pixels
+      const __m128i lRepeat[3] = {_mm_setr_epi8(0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 3, 4, 5, 3), _mm_setr_epi8(4, 5, 3, 4, 5, 3, 4, 5, 6, 7, 8, 6, 7, 8, 6, 7), _mm_setr_epi8(8, 6, 7, 8, 9, 10, 11, 9, 10, 11, 9, 10, 11, 9, 10, 11)};
+      for(; i+6 <= inNbPixels; i += 4)
+      {
+        __m128i lPixels = _mm_loadu_si128((const __m128i*)(inRow+3*i));
+        for(unsigned int j = 0; j < 3; j++)
+          _mm_storeu_si128((__m128i*)(outRow+12*i+16*j), _mm_shuffle_epi8(lPixels, lRepeat[j]));
+      }
+    }
+    nearestRowScalar(inRow+i*inNbChannels, outRow+i*inNbChannels*inFactor, inNbPixels-i, inNbChannels, inFactor);
+  }
+
+  // Sum of the absolute differences of the bytes of a row, 16 then 8 bytes at a time with psadbw
+  PIXEL_KERNELS_TARGET_SSE2 inline unsigned int sadRowSSE2(const unsigned char* inA, const unsigned char* inB, unsigned int inWidth)
+  {
+    __m128i lSum = _mm_setzero_si128();
+    unsigned int i = 0;
+
+    for(; i+16 <= inWidth; i += 16)
+      lSum = _mm_add_epi64(lSum, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(inA+i)), _mm_loadu_si128((const __m128i*)(inB+i))));
+    if(i+8 <= inWidth)
+    {
+      lSum = _mm_add_epi64(lSum, _mm_sad_epu8(_mm_loadl_epi64((const __m128i*)(inA+i)), _mm_loadl_epi64((const __m128i*)(inB+i))));
+      i += 8;
+    }
+    return (unsigned int)(_mm_cvtsi128_si32(lSum) + _mm_cvtsi128_si32(_mm_srli_si128(lSum, 8))) + sadBlockScalar(inA+i, 0, inB+i, 0, inWidth-i, 1, 0xFFFFFFFF);
+  }
+
+  PIXEL_KERNELS_TARGET_SSE2 unsigned int sadBlockSSE2(const unsigned char* inA, unsigned int inStrideA, const unsigned char* inB, unsigned int inStrideB, unsigned int inWidth, unsigned int inHeight, unsigned int inLimit)
+  {
+    unsigned int lSum = 0;
+
+    for(unsigned int r = 0; r < inHeight && lSum < inLimit; r++, inA += inStrideA, inB += inStrideB)
+      lSum += sadRowSSE2(inA, inB, inWidth);
+    return lSum;
+  }
+
+  // Rows of 32 bytes or more start with _mm256_sad_epu8, narrower blocks of 16 bytes are compared two rows at a time
+  PIXEL_KERNELS_TARGET_AVX2 unsigned int sadBlockAVX2(const unsigned char* inA, unsigned int inStrideA, const unsigned char* inB, unsigned int inStrideB, unsigned int inWidth, unsigned int inHeight, unsigned int inLimit)
+  {
+    unsigned int lSum = 0;
+    unsigned int r = 0;
+
+    if(inWidth==16)
+    {
+      for(; r+2 <= inHeight && lSum < inLimit; r += 2, inA += 2*inStrideA, inB += 2*inStrideB)
+      {
+        __m256i lA = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)inA)), _mm_loadu_si128((const __m128i*)(inA+inStrideA)), 1);
+        __m256i lB = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)inB)), _mm_loadu_si128((const __m128i*)(inB+inStrideB)), 1);
+        __m256i lSad = _mm256_sad_epu8(lA, lB);
+        __m128i lHalves = _mm_add_epi64(_mm256_castsi256_si128(lSad), _mm256_extracti128_si256(lSad, 1));
+        lSum += (unsigned int)(_mm_cvtsi128_si32(lHalves) + _mm_cvtsi128_si32(_mm_srli_si128(lHalves, 8)));
+      }
+    }
+    for(; r < inHeight && lSum < inLimit; r++, inA += inStrideA, inB += inStrideB)
+    {
+      unsigned int i = 0;
+      if(inWidth >= 32)
+      {
+        __m256i lRow = _mm256_setzero_si256();
+        for(; i+32 <= inWidth; i += 32)
+          lRow = _mm256_add_epi64(lRow, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(inA+i)), _mm256_loadu_si256((const __m256i*)(inB+i))));
+        __m128i lHalves = _mm_add_epi64(_mm256_castsi256_si128(lRow), _mm256_extracti128_si256(lRow, 1));
+        lSum += (unsigned int)(_mm_cvtsi128_si32(lHalves) + _mm_cvtsi128_si32(_mm_srli_si128(lHalves, 8)));
+      }
+      lSum += sadRowSSE2(inA+i, inB+i, inWidth-i);
+    }
+    return lSum;
+  }
+
+  PixelKernels::InstructionSet detectInstructionSet()
+  {
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+      return PixelKernels::eInstructionSetAVX512;
+    if(__builtin_cpu_supports("avx2"))
+      return PixelKernels::eInstructionSetAVX2;
+    if(__builtin_cpu_supports("sse2"))
+      return PixelKernels::eInstructionSetSSE2;
+#else
+    int lInfo[4];
+    __cpuid(lInfo, 0);
+    int lMaxLeaf = lInfo[0];
+    __cpuid(lInfo, 1);
+    bool lSSE2 = (lInfo[3] & (1<<26))!=0;
+    bool lOSXSave = (lInfo[2] & (1<<27))!=0;
+    if(lMaxLeaf>=7 && lOSXSave && (_xgetbv(0) & 6)==6)
+    {
+      __cpuidex(lInfo, 7, 0);
+      // AVX-512 F and BW, with the opmask and upper ZMM registers saved by the system
+      if((lInfo[1] & (1<<16)) && (lInfo[1] & (1<<30)) && (_xgetbv(0) & 0xE6)==0xE6)
+        return PixelKernels::eInstructionSetAVX512;
+      if(lInfo[1] & (1<<5))
+        return PixelKernels::eInstructionSetAVX2;
+    }
+    if(lSSE2)
+      return PixelKernels::eInstructionSetSSE2;
+#endif
+    return PixelKernels::eInstructionSetScalar;
+  }
+
+#elif defined(PIXEL_KERNELS_NEON)
+
+  inline uint8x8_t blendNEON(uint8x8_t inA, uint8x8_t inB, uint8x8_t inWeights)
+  {
+    uint16x8_t lValue = vmlal_u8(vmull_u8(inA, inWeights), inB, vmvn_u8(inWeights));
+    lValue = vaddq_u16(lValue, vdupq_n_u16(128));
+    return vshrn_n_u16(vaddq_u16(lValue, vshrq_n_u16(lValue, 8)), 8);
+  }
+
+  void blendRowNEON(const unsigned char* inA, const unsigned char* inB, const unsigned char* inWeights, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    unsigned int i = 0;
+
+    for(; i+16 <= inNbBytes; i += 16)
+    {
+      uint8x16_t lA = vld1q_u8(inA+i);
+      uint8x16_t lB = vld1q_u8(inB+i);
+      uint8x16_t lWeights = vld1q_u8(inWeights+i);
+      uint8x8_t lLow = blendNEON(vget_low_u8(lA), vget_low_u8(lB), vget_low_u8(lWeights));
+      uint8x8_t lHigh = blendNEON(vget_high_u8(lA), vget_high_u8(lB), vget_high_u8(lWeights));
+      vst1q_u8(outRow+i, vcombine_u8(lLow, lHigh));
+    }
+
+  // Weights of 16 pixels at a time, the bytes of the pixels stored interleaved
+  void expandWeightsNEON(const unsigned char* inMask, unsigned char* outWeights, unsigned int inNbPixels, unsigned int inNbChannels, const unsigned char inWeights[2])
+  {
+    uint8x16_t lNotSelected = vdupq_n_u8(inWeights[0]);
+    uint8x16_t lSelected = vdupq_n_u8(inWeights[1]);
+    unsigned int i = 0;
+
+    if(inNbChannels==1 || inNbChannels==3 || inNbChannels==4)
+    {
+      for(; i+16 <= inNbPixels; i += 16, outWeights += 16*inNbChannels)
+      {
+        uint8x16_t lWeights = vbslq_u8(vceqq_u8(vld1q_u8(inMask+i), vdupq_n_u8(0)), lNotSelected, lSelected);
+        if(inNbChannels==1)
+          vst1q_u8(outWeights, lWeights);
+        else if(inNbChannels==3)
+        {
+          uint8x16x3_t lPixels = {{lWeights, lWeights, lWeights}};
+          vst3q_u8(outWeights, lPixels);
+        }
+        else
+        {
+          uint8x16x4_t lPixels = {{lWeights, lWeights, lWeights, lWeights}};
+          vst4q_u8(outWeights, lPixels);
+        }
+      }
+    }
+    expandWeightsScalar(inMask+i, outWeights, inNbPixels-i, inNbChannels, inWeights);
+  }
+
+  void selectRowNEON(const unsigned char* inA, const unsigned char* inB, const unsigned char* inMasks, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    unsigned int i = 0;
+
+    for(; i+16 <= inNbBytes; i += 16)
+      vst1q_u8(outRow+i, vbslq_u8(vld1q_u8(inMasks+i), vld1q_u8(inA+i), vld1q_u8(inB+i)));
+    selectRowScalar(inA+i, inB+i, inMasks+i, outRow+i, inNbBytes-i);
+  }
+    blendRowScalar(inA+i, inB+i, inWeights+i, outRow+i, inNbBytes-i);
+  }
+
+  // Each block of 8 pixels is read before its gray pixels are written, so rows can be converted in place
+  void grayRowNEON(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, const short inWeights[4])
+  {
+    const uint16x4_t lWeight0 = vdup_n_u16(inWeights[0]);
+    const uint16x4_t lWeight1 = vdup_n_u16(inWeights[1]);
+    const uint16x4_t lWeight2 = vdup_n_u16(inWeights[2]);
+    const uint32x4_t lRound = vdupq_n_u32(1 << (PIXEL_KERNELS_GRAY_SHIFT-1));
+    unsigned int i = 0;
+
+    for(; i+8 <= inNbPixels; i += 8)
+    {
+      uint8x8_t lChannels[3];
+      if(inNbChannels==4)
+      {
+        uint8x8x4_t lPixels = vld4_u8(inRow+i*4);
+        lChannels[0] = lPixels.val[0]; lChannels[1] = lPixels.val[1]; lChannels[2] = lPixels.val[2];
+      }
+      else
+      {
+        uint8x8x3_t lPixels = vld3_u8(inRow+i*3);
+        lChannels[0] = lPixels.val[0]; lChannels[1] = lPixels.val[1]; lChannels[2] = lPixels.val[2];
+      }
+      uint16x8_t l0 = vmovl_u8(lChannels[0]);
+      uint16x8_t l1 = vmovl_u8(lChannels[1]);
+      uint16x8_t l2 = vmovl_u8(lChannels[2]);
+      uint32x4_t lLow = vmlal_u16(vmlal_u16(vmlal_u16(lRound, vget_low_u16(l0), lWeight0), vget_low_u16(l1), lWeight1), vget_low_u16(l2), lWeight2);
+      uint32x4_t lHigh = vmlal_u16(vmlal_u16(vmlal_u16(lRound, vget_high_u16(l0), lWeight0), vget_high_u16(l1), lWeight1), vget_high_u16(l2), lWeight2);
+      vst1_u8(outRow+i, vmovn_u16(vcombine_u16(vshrn_n_u32(lLow, PIXEL_KERNELS_GRAY_SHIFT), vshrn_n_u32(lHigh, PIXEL_KERNELS_GRAY_SHIFT))));
+    }
+    grayRowScalar(inRow+i*inNbChannels, outRow+i, inNbPixels-i, inNbChannels, inWeights);
+  }
+
+  void differenceRowNEON(const unsigned char* inA, const unsigned char* inB, unsigned char* outRow, unsigned char* outBits, unsigned int inNbPixels, unsigned int inNbChannels, int inThreshold)
+  {
+    static const unsigned char sBitWeights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t lBitWeights = vld1q_u8(sBitWeights);
+    const uint8x16_t lThreshold = vdupq_n_u8((unsigned char)inThreshold);
+    unsigned int i = 0;
+
+    for(; i+16 <= inNbPixels; i += 16)
+    {
+      uint8x16_t lDifference;
+      if(inNbChannels==1)
+        lDifference = vabdq_u8(vld1q_u8(inA+i), vld1q_u8(inB+i));
+      else if(inNbChannels==3)
+      {
+        uint8x16x3_t lA = vld3q_u8(inA+i*3);
+        uint8x16x3_t lB = vld3q_u8(inB+i*3);
+        lDifference = vmaxq_u8(vmaxq_u8(vabdq_u8(lA.val[0], lB.val[0]), vabdq_u8(lA.val[1], lB.val[1])), vabdq_u8(lA.val[2], lB.val[2]));
+      }
+      else
+      {
+        uint8x16x4_t lA = vld4q_u8(inA+i*4);
+        uint8x16x4_t lB = vld4q_u8(inB+i*4);
+        lDifference = vmaxq_u8(vmaxq_u8(vabdq_u8(lA.val[0], lB.val[0]), vabdq_u8(lA.val[1], lB.val[1])), vmaxq_u8(vabdq_u8(lA.val[2], lB.val[2]), vabdq_u8(lA.val[3], lB.val[3])));
+      }
+      if(inThreshold>=0)
+        lDifference = vcgtq_u8(lDifference, lThreshold);
+      vst1q_u8(outRow+i, lDifference);
+      if(outBits)
+      {
+        // Sum the weights of the non zero bytes of each half by pairwise additions
+        uint8x16_t lBits = vandq_u8(vtstq_u8(lDifference, lDifference), lBitWeights);
+        uint8x8_t lSum = vpadd_u8(vget_low_u8(lBits), vget_high_u8(lBits));
+        lSum = vpadd_u8(lSum, lSum);
+        lSum = vpadd_u8(lSum, lSum);
+        outBits[i >> 3] = vget_lane_u8(lSum, 0);
+        outBits[(i >> 3)+1] = vget_lane_u8(lSum, 1);
+      }
+    }
+    differenceRowScalar(inA+i*inNbChannels, inB+i*inNbChannels, outRow+i, outBits ? outBits+(i >> 3) : NULL, inNbPixels-i, inNbChannels, inThreshold);
+  }
+
+  void historyRowNEON(const unsigned char* inMask, unsigned short* ioStamps, unsigned char* outGray, unsigned int inNbPixels, unsigned short inStamp, unsigned short inDuration, unsigned int inShift, unsigned int inScale)
+  {
+    const uint16x8_t lStamp = vdupq_n_u16(inStamp);
+    const uint16x8_t lDuration = vdupq_n_u16(inDuration);
+    const int16x8_t lShift = vdupq_n_s16((short)inShift);
+    const uint16x4_t lScale = vdup_n_u16((unsigned short)inScale);
+    unsigned int i = 0;
+
+    for(; i+8 <= inNbPixels; i += 8)
+    {
+      uint8x8_t lMask = vld1_u8(inMask+i);
+      // Sign extension turns 0xFF into 0xFFFF
+      uint16x8_t lMotion = vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(vtst_u8(lMask, lMask))));
+      uint16x8_t lStamps = vld1q_u16(ioStamps+i);
+      // One less for stamps that wrapped (0 is skipped)
+      uint16x8_t lAge = vaddq_u16(vsubq_u16(lStamp, lStamps), vcgtq_u16(lStamps, lStamp));
+      uint16x8_t lKept = vandq_u16(vtstq_u16(lStamps, lStamps), vcleq_u16(lAge, lDuration));
+      vst1q_u16(ioStamps+i, vbslq_u16(lMotion, lStamp, vandq_u16(lKept, lStamps)));
+      if(outGray)
+      {
+        uint16x8_t lLevel = vshlq_u16(vqsubq_u16(lDuration, vbicq_u16(lAge, lMotion)), lShift);
+        uint16x8_t lGray = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(lLevel), lScale), 16), vshrn_n_u32(vmull_u16(vget_high_u16(lLevel), lScale), 16));
+        vst1_u8(outGray+i, vmovn_u16(vandq_u16(lGray, vorrq_u16(lMotion, lKept))));
+      }
+    }
+    historyRowScalar(inMask+i, ioStamps+i, outGray ? outGray+i : NULL, inNbPixels-i, inStamp, inDuration, inShift, inScale);
+  }
+
+  // Blocks of 2x2 pixels of 1, 3 or 4 channels, other blocks use the scalar version
+  void boxRowNEON(const unsigned char* const* inRows, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    unsigned int i = 0;
+
+    if(inFactor==2)
+    {
+      // Channels are deinterleaved, then each one is summed by pairs of bytes
+      for(; i+8 <= inNbPixels; i += 8)
+      {
+        const unsigned char* lRow0 = inRows[0]+2*i*inNbChannels;
+        const unsigned char* lRow1 = inRows[1]+2*i*inNbChannels;
+        if(inNbChannels==1)
+          vst1_u8(outRow+i, vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(vld1q_u8(lRow0)), vld1q_u8(lRow1)), 2));
+        else if(inNbChannels==3)
+        {
+          uint8x16x3_t lA = vld3q_u8(lRow0);
+          uint8x16x3_t lB = vld3q_u8(lRow1);
+          uint8x8x3_t lResult;
+          for(unsigned int c = 0; c < 3; c++)
+            lResult.val[c] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(lA.val[c]), lB.val[c]), 2);
+          vst3_u8(outRow+i*3, lResult);
+        }
+        else if(inNbChannels==4)
+        {
+          uint8x16x4_t lA = vld4q_u8(lRow0);
+          uint8x16x4_t lB = vld4q_u8(lRow1);
+          uint8x8x4_t lResult;
+          for(unsigned int c = 0; c < 4; c++)
+            lResult.val[c] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(lA.val[c]), lB.val[c]), 2);
+          vst4_u8(outRow+i*4, lResult);
+        }
+        else
+          break;
+      }
+    }
+
+    if(i<inNbPixels)
+    {
+      const unsigned char* lRows[2];
+      const unsigned char* const* lRemainingRows = inRows;
+      if(i>0)
+      {
+        for(unsigned int r = 0; r < inFactor; r++)
+          lRows[r] = inRows[r]+i*inFactor*inNbChannels;
+        lRemainingRows = lRows;
+      }
+      boxRowScalar(lRemainingRows, outRow+i*inNbChannels, inNbPixels-i, inNbChannels, inFactor);
+    }
+  }
+
+  // Pixels of 1 channel repeated 2 or 4 times, other pixels use the scalar version
+  void nearestRowNEON(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    unsigned int i = 0;
+
+    if(inNbChannels==1 && (inFactor==2 || inFactor==4))
+    {
+      for(; i+16 <= inNbPixels; i += 16)
+      {
+        uint8x16_t lPixels = vld1q_u8(inRow+i);
+        uint8x16x2_t lTwice = vzipq_u8(lPixels, lPixels);
+        if(inFactor==2)
+        {
+          vst1q_u8(outRow+2*i, lTwice.val[0]);
+          vst1q_u8(outRow+2*i+16, lTwice.val[1]);
+        }
+        else
+        {
+          // Pairs of bytes repeated twice
+          uint16x8x2_t lLow = vzipq_u16(vreinterpretq_u16_u8(lTwice.val[0]), vreinterpretq_u16_u8(lTwice.val[0]));
+          uint16x8x2_t lHigh = vzipq_u16(vreinterpretq_u16_u8(lTwice.val[1]), vreinterpretq_u16_u8(lTwice.val[1]));
+          vst1q_u8(outRow+4*i, vreinterpretq_u8_u16(lLow.val[0]));
+          vst1q_u8(outRow+4*i+16, vreinterpretq_u8_u16(lLow.val[1]));
+          vst1q_u8(outRow+4*i+32, vreinterpretq_u8_u16(lHigh.val[0]));
+          vst1q_u8(outRow+4*i+48, vreinterpretq_u8_u16(lHigh.val[1]));
+        }
+      }
+    }
+    nearestRowScalar(inRow+i*inNbChannels, outRow+i*inNbChannels*inFactor, inNbPixels-i, inNbChannels, inFactor);
+  }
+
+  unsigned int sadBlockNEON(const unsigned char* inA, unsigned int inStrideA, const unsigned char* inB, unsigned int inStrideB, unsigned int inWidth, unsigned int inHeight, unsigned int inLimit)
+  {
+    unsigned int lSum = 0;
+
+    for(unsigned int r = 0; r < inHeight && lSum < inLimit; r++, inA += inStrideA, inB += inStrideB)
+    {
+      uint32x4_t lRow = vdupq_n_u32(0);
+      unsigned int i = 0;
+      for(; i+16 <= inWidth; i += 16)
+        lRow = vpadalq_u16(lRow, vpaddlq_u8(vabdq_u8(vld1q_u8(inA+i), vld1q_u8(inB+i))));
+      if(i+8 <= inWidth)
+      {
+        lRow = vaddw_u16(lRow, vpaddl_u8(vabd_u8(vld1_u8(inA+i), vld1_u8(inB+i))));
+        i += 8;
+      }
+      uint64x2_t lHalves = vpaddlq_u32(lRow);
+      lSum += (unsigned int)(vgetq_lane_u64(lHalves, 0) + vgetq_lane_u64(lHalves, 1)) + sadBlockScalar(inA+i, 0, inB+i, 0, inWidth-i, 1, 0xFFFFFFFF);
+    }
+    return lSum;
+  }
+
+  PixelKernels::InstructionSet detectInstructionSet()
+  {
+    return PixelKernels::eInstructionSetNEON;
+  }
+
+#else
+
+  PixelKernels::InstructionSet detectInstructionSet()
+  {
+    return PixelKernels::eInstructionSetScalar;
+  }
+
+#endif
+
+  // Instruction set used by the kernels, detected when the library is loaded
+  PixelKernels::InstructionSet sInstructionSet = PixelKernels::getSupportedInstructionSet();
+
+  void blendRow(const unsigned char* inA, const unsigned char* inB, const unsigned char* inWeights, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    switch(sInstructionSet)
+    {
+#ifdef PIXEL_KERNELS_X86
+      case PixelKernels::eInstructionSetAVX512:
+      case PixelKernels::eInstructionSetAVX2:
+        blendRowAVX2(inA, inB, inWeights, outRow, inNbBytes);
+        break;
+      case PixelKernels::eInstructionSetSSE2:
+        blendRowSSE2(inA, inB, inWeights, outRow, inNbBytes);
+        break;
+#endif
+#ifdef PIXEL_KERNELS_NEON
+      case PixelKernels::eInstructionSetNEON:
+        blendRowNEON(inA, inB, inWeights, outRow, inNbBytes);
+        break;
+#endif
+      default:
+        blendRowScalar(inA, inB, inWeights, outRow, inNbBytes);
+        break;
+    }
+  }
+
+  void selectRow(const unsigned char* inA, const unsigned char* inB, const unsigned char* inMasks, unsigned char* outRow, unsigned int inNbBytes)
+  {
+    switch(sInstructionSet)
+    {
+#ifdef PIXEL_KERNELS_X86
+      case PixelKernels::eInstructionSetAVX512:
+      case PixelKernels::eInstructionSetAVX2:
+        selectRowAVX2(inA, inB, inMasks, outRow, inNbBytes);
+        break;
+      case PixelKernels::eInstructionSetSSE2:
+        selectRowSSE2(inA, inB, inMasks, outRow, inNbBytes);
+        break;
+#endif
+#ifdef PIXEL_KERNELS_NEON
+      case PixelKernels::eInstructionSetNEON:
+        selectRowNEON(inA, inB, inMasks, outRow, inNbBytes);
+        break;
+#endif
+      default:
+        selectRowScalar(inA, inB, inMasks, outRow, inNbBytes);
+        break;
+    }
+  }
+
+  void expandWeights(const unsigned char* inMask, unsigned char* outWeights, unsigned int inNbPixels, unsigned int inNbChannels, const unsigned char inWeights[2])
+  {
+    switch(sInstructionSet)
+    {
+#ifdef PIXEL_KERNELS_X86
+      case PixelKernels::eInstructionSetAVX512:
+      case PixelKernels::eInstructionSetAVX2:
+        expandWeightsAVX2(inMask, outWeights, inNbPixels, inNbChannels, inWeights);
+        break;
+#endif
+#ifdef PIXEL_KERNELS_NEON
+      case PixelKernels::eInstructionSetNEON:
+        expandWeightsNEON(inMask, outWeights, inNbPixels, inNbChannels, inWeights);
+        break;
+#endif
+      default:
+        expandWeightsScalar(inMask, outWeights, inNbPixels, inNbChannels, inWeights);
+        break;
+    }
+  }
+
+  void grayRow(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, const short inWeights[4])
+  {
+    switch(sInstructionSet)
+    {
+#ifdef PIXEL_KERNELS_X86
+      case PixelKernels::eInstructionSetAVX512:
+        grayRowAVX512(inRow, outRow, inNbPixels, inNbChannels, inWeights);
+        break;
+      case PixelKernels::eInstructionSetAVX2:
+        grayRowAVX2(inRow, outRow, inNbPixels, inNbChannels, inWeights);
+        break;
+      case PixelKernels::eInstructionSetSSE2:
+        grayRowSSE2(inRow, outRow, inNbPixels, inNbChannels, inWeights);
+        break;
+#endif
+#ifdef PIXEL_KERNELS_NEON
+      case PixelKernels::eInstructionSetNEON:
+        grayRowNEON(inRow, outRow, inNbPixels, inNbChannels, inWeights);
+        break;
+#endif
+      default:
+        grayRowScalar(inRow, outRow, inNbPixels, inNbChannels, inWeights);
+        break;
+    }
+  }
+  void differenceRow(const unsigned char* inA, const unsigned char* inB, unsigned char* outRow, unsigned char* outBits, unsigned int inNbPixels, unsigned int inNbChannels, int inThreshold)
+  {
+    // Vectorized versions handle 1, 3 and 4 channels pixels
+    PixelKernels::InstructionSet lInstructionSet = (inNbChannels==1 || inNbChannels==3 || inNbChannels==4) ? sInstructionSet : PixelKernels::eInstructionSetScalar;
+
+    switch(lInstructionSet)
+    {
+#ifdef PIXEL_KERNELS_X86
+      case PixelKernels::eInstructionSetAVX512:
+      case PixelKernels::eInstructionSetAVX2:
+        differenceRowAVX2(inA, inB, outRow, outBits, inNbPixels, inNbChannels, inThreshold);
+        break;
+      case PixelKernels::eInstructionSetSSE2:
+        differenceRowSSE2(inA, inB, outRow, outBits, inNbPixels, inNbChannels, inThreshold);
+        break;
+#endif
+#ifdef PIXEL_KERNELS_NEON
+      case PixelKernels::eInstructionSetNEON:
+        differenceRowNEON(inA, inB, outRow, outBits, inNbPixels, inNbChannels, inThreshold);
+        break;
+#endif
+      default:
+        differenceRowScalar(inA, inB, outRow, outBits, inNbPixels, inNbChannels, inThreshold);
+        break;
+    }
+  }
+  void historyRow(const unsigned char* inMask, unsigned short* ioStamps, unsigned char* outGray, unsigned int inNbPixels, unsigned short inStamp, unsigned short inDuration, unsigned int inShift, unsigned int inScale)
+  {
+    switch(sInstructionSet)
+    {
+#ifdef PIXEL_KERNELS_X86
+      case PixelKernels::eInstructionSetAVX512:
+      case PixelKernels::eInstructionSetAVX2:
+        historyRowAVX2(inMask, ioStamps, outGray, inNbPixels, inStamp, inDuration, inShift, inScale);
+        break;
+      case PixelKernels::eInstructionSetSSE2:
+        historyRowSSE2(inMask, ioStamps, outGray, inNbPixels, inStamp, inDuration, inShift, inScale);
+        break;
+#endif
+#ifdef PIXEL_KERNELS_NEON
+      case PixelKernels::eInstructionSetNEON:
+        historyRowNEON(inMask, ioStamps, outGray, inNbPixels, inStamp, inDuration, inShift, inScale);
+        break;
+#endif
+      default:
+        historyRowScalar(inMask, ioStamps, outGray, inNbPixels, inStamp, inDuration, inShift, inScale);
+        break;
+    }
+  }
+  void boxRow(const unsigned char* const* inRows, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    switch(sInstructionSet)
+    {
+#ifdef PIXEL_KERNELS_X86
+      case PixelKernels::eInstructionSetAVX512:
+      case PixelKernels::eInstructionSetAVX2:
+        boxRowAVX2(inRows, outRow, inNbPixels, inNbChannels, inFactor);
+        break;
+      case PixelKernels::eInstructionSetSSE2:
+        boxRowSSE2(inRows, outRow, inNbPixels, inNbChannels, inFactor);
+        break;
+#endif
+#ifdef PIXEL_KERNELS_NEON
+      case PixelKernels::eInstructionSetNEON:
+        boxRowNEON(inRows, outRow, inNbPixels, inNbChannels, inFactor);
+        break;
+#endif
+      default:
+        boxRowScalar(inRows, outRow, inNbPixels, inNbChannels, inFactor);
+        break;
+    }
+  }
+
+  void nearestRow(const unsigned char* inRow, unsigned char* outRow, unsigned int inNbPixels, unsigned int inNbChannels, unsigned int inFactor)
+  {
+    switch(sInstructionSet)
+    {
+#ifdef PIXEL_KERNELS_X86
+      case PixelKernels::eInstructionSetAVX512:
+      case PixelKernels::eInstructionSetAVX2:
+        nearestRowAVX2(inRow, outRow, inNbPixels, inNbChannels, inFactor);
+        break;
+      case PixelKernels::eInstructionSetSSE2:
+        nearestRowSSE2(inRow, outRow, inNbPixels, inNbChannels, inFactor);
+        break;
+#endif
+#ifdef PIXEL_KERNELS_NEON
+      case PixelKernels::eInstructionSetNEON:
+        nearestRowNEON(inRow, outRow, inNbPixels, inNbChannels, inFactor);
+        break;
+#endif
+      default:
+        nearestRowScalar(inRow, outRow, inNbPixels, inNbChannels, inFactor);
+        break;
+    }
+  }
+
+  unsigned int sadBlock(const unsigned char* inA, unsigned int inStrideA, const unsigned char* inB, unsigned int inStrideB, unsigned int inWidth, unsigned int inHeight, unsigned int inLimit)
+  {
+    switch(sInstructionSet)
+    {
+#ifdef PIXEL_KERNELS_X86
+      case PixelKernels::eInstructionSetAVX512:
+      case PixelKernels::eInstructionSetAVX2:
+        return sadBlockAVX2(inA, inStrideA, inB, inStrideB, inWidth, inHeight, inLimit);
+      case PixelKernels::eInstructionSetSSE2:
+        return sadBlockSSE2(inA, inStrideA, inB, inStrideB, inWidth, inHeight, inLimit);
+#endif
+#ifdef PIXEL_KERNELS_NEON
+      case PixelKernels::eInstructionSetNEON:
+        return sadBlockNEON(inA, inStrideA, inB, inStrideB, inWidth, inHeight, inLimit);
+#endif
+      default:
+        return sadBlockScalar(inA, inStrideA, inB, inStrideB, inWidth, inHeight, inLimit);
+    }
+  }
+}
+
+/*! \todo
+*/
+PixelKernels::InstructionSet PixelKernels::getSupportedInstructionSet() throw()
+{
+	static InstructionSet sSupportedInstructionSet = detectInstructionSet();
+	return sSupportedInstructionSet;
+}
+
+/*! \todo
+*/
+PixelKernels::InstructionSet PixelKernels::getInstructionSet() throw()
+{
+	return sInstructionSet;
+}
+
+/*! Mostly useful to compare the versions of a kernel.  Must not be called while kernels are running.
+*/
+void PixelKernels::setInstructionSet(InstructionSet inInstructionSet) throw()
+{
+	InstructionSet lSupportedInstructionSet = getSupportedInstructionSet();
+
+	// x86 instruction sets are listed from the oldest to the newest, each one supported by processors supporting a newer one
+	if(inInstructionSet==eInstructionSetScalar || inInstructionSet==lSupportedInstructionSet)
+		sInstructionSet = inInstructionSet;
+	else if(inInstructionSet!=eInstructionSetNEON && lSupportedInstructionSet!=eInstructionSetNEON && inInstructionSet<lSupportedInstructionSet)
+		sInstructionSet = inInstructionSet;
+	else
+		sInstructionSet = lSupportedInstructionSet;
+}
+
+/*! Each channel of a pixel is (background*(255-mask) + foreground*mask)/255, rounded to the nearest integer, so a
+    mask value of 255 gives the foreground; inInvert swaps the two weights.  The rows are read and written once:
+    the mask is expanded to the channels of a few pixels at a time in a small buffer that stays in cache.
+*/
+void PixelKernels::blendAlphaMask(const unsigned char* inBackground, const unsigned char* inForeground, const unsigned char* inMask, unsigned char* outRow, unsigned int inWidth, unsigned int inNbChannels, bool inInvert) throw()
+{
+	unsigned char lWeights[PIXEL_KERNELS_CHUNK_BYTES];
+	unsigned char lInvert = inInvert ? 255 : 0;
+	unsigned int lChunkPixels = PIXEL_KERNELS_CHUNK_BYTES/inNbChannels;
+
+	if(lChunkPixels==0)
+	{
+		for(unsigned int i = 0; i < inWidth*inNbChannels; i++)
+			outRow[i] = (unsigned char)divide255(inForeground[i]*(inMask[i/inNbChannels]^lInvert) + inBackground[i]*(255-(inMask[i/inNbChannels]^lInvert)));
+		return;
+	}
+
+	for(unsigned int lFirst = 0; lFirst < inWidth; lFirst += lChunkPixels)
+	{
+		unsigned int lNbPixels = (inWidth-lFirst>lChunkPixels) ? lChunkPixels : inWidth-lFirst;
+		unsigned int lOffset = lFirst*inNbChannels;
+
+		// Weight of the foreground for every byte
+		for(unsigned int i = 0, j = 0; i < lNbPixels; i++)
+			for(unsigned int c = 0; c < inNbChannels; c++)
+				lWeights[j++] = inMask[lFirst+i]^lInvert;
+
+		blendRow(inForeground+lOffset, inBackground+lOffset, lWeights, outRow+lOffset, lNbPixels*inNbChannels);
+	}
+}
+
+/*! Where the mask is non zero (zero if inInvert is true), each channel of a pixel is
+    (background*(255-inForegroundWeight) + foreground*inForegroundWeight)/255, rounded to the nearest integer; the
+    other pixels are the background.  With a weight of 255, pixels are copied exactly, so images of any depth can be
+    composed by giving the number of bytes of a pixel as number of channels.  The rows are read and written once.
+
+    The weight of every byte, inForegroundWeight or 0, is expanded from the mask for a few pixels at a time in a small
+    buffer that stays in cache, then the whole chunk is blended, vectorized whatever the runs of the mask.  With a
+    weight of 255, the weights are byte masks and each byte is selected from the foreground or the background.
+*/
+void PixelKernels::composeMask(const unsigned char* inBackground, const unsigned char* inForeground, const unsigned char* inMask, unsigned char* outRow, unsigned int inWidth, unsigned int inNbChannels, unsigned char inForegroundWeight, bool inInvert) throw()
+{
+	unsigned char lWeights[PIXEL_KERNELS_CHUNK_BYTES];
+	unsigned char lMaskWeights[2];
+	unsigned int lChunkPixels = PIXEL_KERNELS_CHUNK_BYTES/inNbChannels;
+
+	// Weights where the mask is zero and where it is not
+	lMaskWeights[0] = inInvert ? inForegroundWeight : 0;
+	lMaskWeights[1] = inInvert ? 0 : inForegroundWeight;
+
+	if(lChunkPixels==0)
+	{
+		for(unsigned int i = 0; i < inWidth*inNbChannels; i++)
+		{
+			unsigned char lWeight = lMaskWeights[inMask[i/inNbChannels]!=0];
+			outRow[i] = (unsigned char)divide255(inForeground[i]*lWeight + inBackground[i]*(255-lWeight));
+		}
+		return;
+	}
+
+	for(unsigned int lFirst = 0; lFirst < inWidth; lFirst += lChunkPixels)
+	{
+		unsigned int lNbPixels = (inWidth-lFirst>lChunkPixels) ? lChunkPixels : inWidth-lFirst;
+		unsigned int lOffset = lFirst*inNbChannels;
+
+		expandWeights(inMask+lFirst, lWeights, lNbPixels, inNbChannels, lMaskWeights);
+		if(inForegroundWeight==255)
+			selectRow(inForeground+lOffset, inBackground+lOffset, lWeights, outRow+lOffset, lNbPixels*inNbChannels);
+		else
+			blendRow(inForeground+lOffset, inBackground+lOffset, lWeights, outRow+lOffset, lNbPixels*inNbChannels);
+	}
+}
+
+/*! Luminance is 0.299*red + 0.587*green + 0.114*blue with weights in fixed point on 14 bits, rounded as OpenCV
+    does, so results are the same as cvCvtColor().  For YCrCb pixels, it is the Y channel.  The row may be converted
+    in place (outRow equal to inRow), since the gray pixels of a block are written after its color pixels are read.
+*/
+void PixelKernels::convertToGray(const unsigned char* inRow, unsigned char* outRow, unsigned int inWidth, ColorLayout inColorLayout) throw()
+{
+	short lWeights[4];
+	unsigned int lNbChannels = (inColorLayout==eColorLayoutRGBA || inColorLayout==eColorLayoutBGRA) ? 4 : 3;
+
+	getGrayWeights(inColorLayout, lWeights);
+	grayRow(inRow, outRow, inWidth, lNbChannels, lWeights);
+}
+
+/*! Each pixel of the output row is the largest absolute difference between the channels of the pixels of the two
+    rows, so color images need no conversion to gray.  If inThreshold is not negative, it is instead 255 where that
+    difference is greater than inThreshold and 0 elsewhere, computed in the same pass.  If outBits is not NULL, it
+    receives one bit per pixel, set where the output pixel is not zero: 8 pixels per byte, the first one in the least
+    significant bit, and the unused bits of the last byte are zero.
+*/
+void PixelKernels::differenceMask(const unsigned char* inA, const unsigned char* inB, unsigned char* outRow, unsigned char* outBits, unsigned int inWidth, unsigned int inNbChannels, int inThreshold) throw()
+{
+	differenceRow(inA, inB, outRow, outBits, inWidth, inNbChannels, (inThreshold>255) ? 255 : inThreshold);
+}
+
+/*! Stamps count from 1 to 65535, then wrap to 1; a stamp of 0 marks a pixel without motion.  The stamp of the
+    pixels where the mask is not zero is set to inStamp, and the stamp of the other pixels is cleared if it is older
+    than inDuration (which must be at least 1).  Kept stamps are at most inDuration old, so the stamp may advance by
+    up to 65534-inDuration between two updates of a row.  If outGray is not NULL, it receives the gray visualization
+    in the same pass: 255 for the pixels stamped now, decreasing linearly with age to 0 for a stamp as old as the
+    duration, and 0 for pixels without motion.
+*/
+void PixelKernels::updateMotionHistory(const unsigned char* inMask, unsigned short* ioStamps, unsigned char* outGray, unsigned int inWidth, unsigned short inStamp, unsigned short inDuration) throw()
+{
+	// (duration-age) is scaled up to 16 bits, so the gray level is a 16x16 bits multiplication keeping the high half,
+	// with a scale rounded up to give exactly 255 for an age of 0
+	unsigned int lShift = 0;
+	while((unsigned int)inDuration << (lShift+1) <= 65535)
+		lShift++;
+	unsigned int lLevel = (unsigned int)inDuration << lShift;
+	unsigned int lScale = (255*65536 + lLevel-1)/lLevel;
+
+	historyRow(inMask, ioStamps, outGray, inWidth, inStamp, inDuration, lShift, lScale);
+}
+
+/*! Each channel of output pixel i is the average of the channel over the block of inFactor x inFactor pixels
+    starting at pixel i*inFactor of the inFactor rows of inRows, rounded to the nearest integer (half up), as an area
+    resize by an integer factor.  Blocks of 2x2 and 4x4 pixels are vectorized.
+*/
+void PixelKernels::downscaleBox(const unsigned char* const* inRows, unsigned char* outRow, unsigned int inWidth, unsigned int inNbChannels, unsigned int inFactor) throw()
+{
+	boxRow(inRows, outRow, inWidth, inNbChannels, inFactor);
+}
+
+/*! Each pixel of the input row is written inFactor times in a row, as a nearest neighbor resize by an integer factor.
+    Factors of 2 and 4 are vectorized.
+*/
+void PixelKernels::upscaleNearest(const unsigned char* inRow, unsigned char* outRow, unsigned int inWidth, unsigned int inNbChannels, unsigned int inFactor) throw()
+{
+	nearestRow(inRow, outRow, inWidth, inNbChannels, inFactor);
+}
+
+/*! Sum of the absolute differences between the pixels of a block of inWidth x inHeight 1 channel pixels of image A
+    and a block of the same size of image B, the rows of each block being inStrideA and inStrideB bytes apart.  The
+    sum is checked as the rows go: once it reaches inLimit, the remaining rows are skipped and inLimit is returned,
+    so a search for the best block can pass the best sum found so far.
+*/
+unsigned int PixelKernels::blockSad(const unsigned char* inA, unsigned int inStrideA, const unsigned char* inB, unsigned int inStrideB, unsigned int inWidth, unsigned int inHeight, unsigned int inLimit) throw()
+{
+	// The versions check the limit after different numbers of rows, so their partial sums differ
+	unsigned int lSum = sadBlock(inA, inStrideA, inB, inStrideB, inWidth, inHeight, inLimit);
+	return (lSum<inLimit) ? lSum : inLimit;
+}
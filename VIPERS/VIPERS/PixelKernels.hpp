@@ -0,0 +1,109 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/PixelKernels.hpp
+ * \brief PixelKernels class header.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#ifndef VIPERS_PIXEL_KERNELS_HPP
+#define VIPERS_PIXEL_KERNELS_HPP
+
+namespace VIPERS
+{
+
+  /*! \brief %PixelKernels class.
+    \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+
+    Native row kernels shared by modules, each processing one row of 8 bits images (or of 16 bits stamps) in a
+    single pass, and block kernels comparing blocks of rows.  Every kernel has a scalar version and vectorized
+    versions, selected at run time from the instructions supported by the processor.  All the versions use the same
+    integer arithmetic, so they give exactly the same results.  A kernel without a version for the selected
+    instruction set uses the best version it has below it.
+  */
+  class PixelKernels
+  {
+    public:
+
+      /*! \brief Instruction sets the kernels are vectorized for
+        \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+      */
+      enum InstructionSet
+      {
+        eInstructionSetScalar, //!< No vector instructions
+        eInstructionSetSSE2, //!< x86 SSE2
+        eInstructionSetAVX2, //!< x86 AVX2
+        eInstructionSetAVX512, //!< x86 AVX-512 (F and BW)
+        eInstructionSetNEON //!< ARM NEON
+      };
+
+      /*! \brief Order of the channels of 8 bits color pixels
+        \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+      */
+      enum ColorLayout
+      {
+        eColorLayoutRGB, //!< Red Green Blue
+        eColorLayoutBGR, //!< Blue Green Red
+        eColorLayoutRGBA, //!< Red Green Blue Alpha
+        eColorLayoutBGRA, //!< Blue Green Red Alpha
+        eColorLayoutYCrCb //!< Luminance (Y) Chroma Red (Cr) Chroma Blue (Cb)
+      };
+
+      //! Get the best instruction set supported by the processor and the compiler
+      static InstructionSet getSupportedInstructionSet() throw();
+      //! Get the instruction set used by the kernels
+      static InstructionSet getInstructionSet() throw();
+      //! Set the instruction set used by the kernels (limited to the supported one)
+      static void setInstructionSet(InstructionSet inInstructionSet) throw();
+
+      //! Blend a foreground row over a background row with the weights of an alpha mask row
+      static void blendAlphaMask(const unsigned char* inBackground, const unsigned char* inForeground, const unsigned char* inMask, unsigned char* outRow, unsigned int inWidth, unsigned int inNbChannels, bool inInvert) throw();
+      //! Blend a foreground row over a background row with a constant weight where a mask row is non zero, copy the background elsewhere
+      static void composeMask(const unsigned char* inBackground, const unsigned char* inForeground, const unsigned char* inMask, unsigned char* outRow, unsigned int inWidth, unsigned int inNbChannels, unsigned char inForegroundWeight, bool inInvert) throw();
+      //! Convert a row of color pixels to luminance
+      static void convertToGray(const unsigned char* inRow, unsigned char* outRow, unsigned int inWidth, ColorLayout inColorLayout) throw();
+      //! Compute the largest difference over the channels of the pixels of two rows, optionally thresholded, and pack it as motion bits
+      static void differenceMask(const unsigned char* inA, const unsigned char* inB, unsigned char* outRow, unsigned char* outBits, unsigned int inWidth, unsigned int inNbChannels, int inThreshold) throw();
+      //! Stamp the pixels of a motion mask row in a row of 16 bits motion history stamps, clear the old ones and compute their gray visualization
+      static void updateMotionHistory(const unsigned char* inMask, unsigned short* ioStamps, unsigned char* outGray, unsigned int inWidth, unsigned short inStamp, unsigned short inDuration) throw();
+      //! Average blocks of pixels of inFactor rows into one row (area resize by an integer factor)
+      static void downscaleBox(const unsigned char* const* inRows, unsigned char* outRow, unsigned int inWidth, unsigned int inNbChannels, unsigned int inFactor) throw();
+      //! Repeat each pixel of a row inFactor times (nearest neighbor resize by an integer factor)
+      static void upscaleNearest(const unsigned char* inRow, unsigned char* outRow, unsigned int inWidth, unsigned int inNbChannels, unsigned int inFactor) throw();
+      //! Sum the absolute differences between two blocks of 1 channel pixels, stopping early once the sum reaches a limit
+      static unsigned int blockSad(const unsigned char* inA, unsigned int inStrideA, const unsigned char* inB, unsigned int inStrideB, unsigned int inWidth, unsigned int inHeight, unsigned int inLimit) throw();
+
+    private:
+
+      //! Restrict (disable) constructor
+      PixelKernels();
+  };
+
+}
+
+#endif //VIPERS_PIXEL_KERNELS_HPP
@@ -43,6 +43,8 @@ SequentialKernel::SequentialKernel()
 {
 	mThreadCommandChanged = false;
 	mThreadCommand = eThreadCommandNone;
+	mBufferPlanningActive = false;
+	mInPlaceProcessingActive = false;
 	run();
 }
 
@@ -268,6 +270,13 @@ void SequentialKernel::initFunction()
   SortedLevelModuleMap::iterator lSortedLevelModuleMapItr;
 
   mSortedLevelModuleMap.clear();
+  mModuleChainMap.clear();
+  mChainedModuleSet.clear();
+  unmergeModules();
+  releaseBuffers();
+  clearInPlaceOutputs();
+  mBufferPlanningActive = isBufferPlanningEnabled();
+  mInPlaceProcessingActive = isInPlaceProcessingEnabled();
   lState.setFrame(0);
 
   // Get module levels
@@ -279,6 +288,18 @@ void SequentialKernel::initFunction()
     for(lSortedLevelModuleMapItr = mSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != mSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
       lSortedLevelModuleMapItr->second->init();
 
+    // Merge duplicate modules, which will not be processed
+    if(isModuleMergingEnabled())
+      mergeModules(computeDuplicateModules(mSortedLevelModuleMap));
+
+    // Find chains of modules that will be processed by strips
+    if(isOperatorFusionEnabled())
+    {
+      mModuleChainMap = computeFusedModuleChains(mSortedLevelModuleMap);
+      for(ModuleChainMap::const_iterator lModuleChainMapItr = mModuleChainMap.begin(); lModuleChainMapItr != mModuleChainMap.end(); lModuleChainMapItr++)
+        mChainedModuleSet.insert(lModuleChainMapItr->second.begin()+1, lModuleChainMapItr->second.end());
+    }
+
     // Set state to frame 0 and process state initialized
     lState.setState(KernelState::eStateInitialized);
   }
@@ -458,12 +479,20 @@ void SequentialKernel::startFunction()
     try
     {
 
+      checkMergedModules();
+      // Buffers written in place live longer: plan them again before the frame if any output slot changed
+      if((mInPlaceProcessingActive || !mModuleChainMap.empty()) && updateInPlaceOutputs(mSortedLevelModuleMap, mModuleChainMap, !mInPlaceProcessingActive) && mBufferPlanningActive)
+        planBuffers(mSortedLevelModuleMap, mModuleChainMap);
+
       //Loop on modules (sorted by level)
       for(lSortedLevelModuleMapItr = mSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != mSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
       {
-        lSortedLevelModuleMapItr->second->process(lCurrentFrameNumber);
+        processModule(lSortedLevelModuleMapItr->second, lCurrentFrameNumber);
       }
 
+      if(mBufferPlanningActive)
+        planBuffers(mSortedLevelModuleMap, mModuleChainMap);
+
     }
     catch(Exception& inException)
     {
@@ -599,9 +628,16 @@ void SequentialKernel::refreshFunction()
   // Get module levels
   try
   {
+    checkMergedModules();
+    if((mInPlaceProcessingActive || !mModuleChainMap.empty()) && updateInPlaceOutputs(mSortedLevelModuleMap, mModuleChainMap, !mInPlaceProcessingActive) && mBufferPlanningActive)
+      planBuffers(mSortedLevelModuleMap, mModuleChainMap);
+
     //Loop on modules (sorted by level)
     for(lSortedLevelModuleMapItr = mSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != mSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
-      lSortedLevelModuleMapItr->second->process(lState.getFrame());
+      processModule(lSortedLevelModuleMapItr->second, lState.getFrame());
+
+    if(mBufferPlanningActive)
+      planBuffers(mSortedLevelModuleMap, mModuleChainMap);
   }
   catch(Exception inException)
   {
@@ -629,13 +665,24 @@ void SequentialKernel::stepFunction()
   {
     try
     {
-      //Loop on modules (sorted by level)
+      // Modules are all started before the frame, since a chain processes its modules together
       for(lSortedLevelModuleMapItr = mSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != mSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
-      {
         lSortedLevelModuleMapItr->second->start();
-        lSortedLevelModuleMapItr->second->process(lCurrentFrame+1);
+
+      checkMergedModules();
+      // Buffers written in place live longer: plan them again before the frame if any output slot changed
+      if((mInPlaceProcessingActive || !mModuleChainMap.empty()) && updateInPlaceOutputs(mSortedLevelModuleMap, mModuleChainMap, !mInPlaceProcessingActive) && mBufferPlanningActive)
+        planBuffers(mSortedLevelModuleMap, mModuleChainMap);
+
+      //Loop on modules (sorted by level)
+      for(lSortedLevelModuleMapItr = mSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != mSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
+        processModule(lSortedLevelModuleMapItr->second, lCurrentFrame+1);
+
+      for(lSortedLevelModuleMapItr = mSortedLevelModuleMap.begin(); lSortedLevelModuleMapItr != mSortedLevelModuleMap.end(); lSortedLevelModuleMapItr++)
         lSortedLevelModuleMapItr->second->pause();
-      }
+
+      if(mBufferPlanningActive)
+        planBuffers(mSortedLevelModuleMap, mModuleChainMap);
     }
     catch(Exception inException)
     {
@@ -662,6 +709,8 @@ void SequentialKernel::resetFunction()
    SortedLevelModuleMap::iterator lSortedLevelModuleMapItr;
    KernelState lState = getState();
 
+   unmergeModules();
+
    // Get module levels
    try
    {
@@ -682,9 +731,25 @@ void SequentialKernel::resetFunction()
      return;
    }
 
+   // Modules released their images, the arena can go
+   releaseBuffers();
+   clearInPlaceOutputs();
+
    // Set state to frame 0 and state to uninitialized
    lState.setFrame(0);
    lState.setState(KernelState::eStateUninitialized);
    setState(lState);
 }
 
+/*! Modules that are part of a chain, except the first one, are processed with the chain and skipped here.  Merged
+    modules are skipped as well.
+*/
+void SequentialKernel::processModule(Module* inModule, unsigned int inFrameNumber)
+{
+  ModuleChainMap::const_iterator lModuleChainMapItr = mModuleChainMap.find(inModule);
+
+  if(lModuleChainMapItr != mModuleChainMap.end())
+    processModuleChain(lModuleChainMapItr->second, inFrameNumber);
+  else if(mChainedModuleSet.find(inModule) == mChainedModuleSet.end() && !isModuleMerged(inModule))
+    inModule->process(inFrameNumber);
+}
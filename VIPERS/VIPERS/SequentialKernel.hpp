@@ -119,12 +119,18 @@ namespace VIPERS
     void stepFunction();
     //! Thread reset modules function
     void resetFunction();
+    //! Process one frame of a module, or of the fused chain it starts
+    void processModule(Module* inModule, unsigned int inFrameNumber);
 
     ThreadCommand mThreadCommand; //!< Command
     bool mThreadCommandChanged;
     Threading::Condition mThreadCommandCondition; //!< Condition to notify thread of new commands
 
     SortedLevelModuleMap mSortedLevelModuleMap;
+    ModuleChainMap mModuleChainMap; //!< Chains of modules processed by strips, by first module
+    ModuleSet mChainedModuleSet; //!< Modules processed with the chain they belong to, except the first ones
+    bool mBufferPlanningActive; //!< Output images are planned after each frame (planning was enabled when modules were initialized)
+    bool mInPlaceProcessingActive; //!< In-place outputs are decided before each frame (in-place processing was enabled when modules were initialized)
 
   };
 
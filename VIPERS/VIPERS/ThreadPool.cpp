@@ -0,0 +1,349 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/ThreadPool.cpp
+ * \brief ThreadPool class functions definition.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#include "ThreadPool.hpp"
+#include "MemoryAccounting.hpp"
+#include "VIPERSConfig.hpp"
+
+#include <exception>
+
+#ifdef VIPERS_OS_WINDOWS
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+  #define VIPERS_THREAD_LOCAL __declspec(thread)
+#else
+  #define VIPERS_THREAD_LOCAL __thread
+#endif
+
+// Number of ranges per thread a parallelFor() is split in, so that threads finishing early take more ranges
+#define THREAD_POOL_RANGES_PER_THREAD 4
+
+using namespace VIPERS;
+
+namespace
+{
+  // Set while the calling thread runs a range of a task, so that nested parallelFor() run in the calling thread
+  VIPERS_THREAD_LOCAL bool sInParallelFor = false;
+
+  class InParallelForScope
+  {
+    public:
+      InParallelForScope() : mPrevious(sInParallelFor) {sInParallelFor = true;}
+      ~InParallelForScope() {sInParallelFor = mPrevious;}
+    private:
+      bool mPrevious;
+  };
+}
+
+/*! The pool is created on first use.  Its workers are started by the first parallelFor() that needs them.
+*/
+ThreadPool& ThreadPool::getInstance()
+{
+	static ThreadPool sThreadPool;
+	return sThreadPool;
+}
+
+/*! \todo
+*/
+unsigned int ThreadPool::getNumberProcessors() throw()
+{
+	long lNbProcessors = 1;
+#ifdef VIPERS_OS_WINDOWS
+	SYSTEM_INFO lSystemInfo;
+	GetSystemInfo(&lSystemInfo);
+	lNbProcessors = lSystemInfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	lNbProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return (lNbProcessors>0) ? (unsigned int)lNbProcessors : 1;
+}
+
+/*! \todo
+*/
+ThreadPool::ThreadPool()
+{
+	mNbThreads = 0;
+	mNbRequestedThreads = 0;
+	mTask = NULL;
+	mOwner = NULL;
+	mNext = 0;
+	mEnd = 0;
+	mRangeSize = 1;
+	mNbRunning = 0;
+	mException = NULL;
+	mExit = false;
+}
+
+/*! \todo
+*/
+ThreadPool::~ThreadPool()
+{
+	mJobMutex.lock();
+	stopWorkers();
+	mJobMutex.unlock();
+}
+
+/*! The iterations are split in ranges of at least inGrain iterations, given to the threads as they become free, and
+    the calling thread runs ranges too.  Tasks are run with the memory owner of the calling thread (see
+    MemoryAccounting), so images allocated by a task are attributed to the %Module calling parallelFor().  If a task
+    raises an exception, no more ranges are started and the first exception is raised again in the calling thread
+    once all the running ranges are done.
+*/
+void ThreadPool::parallelFor(unsigned int inFirst, unsigned int inEnd, ParallelTask& inTask, unsigned int inGrain)
+{
+	if(inFirst>=inEnd)
+		return;
+	if(inGrain==0)
+		inGrain = 1;
+
+	// Nested or concurrent calls run in the calling thread, the processors are already busy
+	if(sInParallelFor || inEnd-inFirst<=inGrain || !mJobMutex.tryLock())
+	{
+		InParallelForScope lInParallelForScope;
+		inTask.run(inFirst, inEnd);
+		return;
+	}
+
+	try
+	{
+		if(mNbThreads==0)
+			startWorkers();
+	}
+	catch(...)
+	{
+		mJobMutex.unlock();
+		throw;
+	}
+
+	if(mNbThreads<=1)
+	{
+		mJobMutex.unlock();
+		InParallelForScope lInParallelForScope;
+		inTask.run(inFirst, inEnd);
+		return;
+	}
+
+	unsigned int lRangeSize = (inEnd-inFirst+mNbThreads*THREAD_POOL_RANGES_PER_THREAD-1)/(mNbThreads*THREAD_POOL_RANGES_PER_THREAD);
+
+	mCondition.lock();
+	mTask = &inTask;
+	mOwner = MemoryAccounting::getCurrentOwner();
+	mNext = inFirst;
+	mEnd = inEnd;
+	mRangeSize = (lRangeSize>inGrain) ? lRangeSize : inGrain;
+	mCondition.broadcast();
+	mCondition.unlock();
+
+	runRanges();
+
+	mCondition.lock();
+	while(mNbRunning>0)
+		mCondition.wait();
+	Exception* lException = mException;
+	mException = NULL;
+	mTask = NULL;
+	mNext = mEnd = 0;
+	mCondition.unlock();
+
+	mJobMutex.unlock();
+
+	if(lException)
+	{
+		Exception lCopy(*lException);
+		delete lException;
+		throw(lCopy);
+	}
+}
+
+/*! Takes effect at the next parallelFor() that is not nested in another one.
+*/
+void ThreadPool::setNumberThreads(unsigned int inNbThreads)
+{
+	mJobMutex.lock();
+	mCondition.lock();
+	mNbRequestedThreads = inNbThreads;
+	mCondition.unlock();
+	stopWorkers();
+	mJobMutex.unlock();
+}
+
+/*! \todo
+*/
+unsigned int ThreadPool::getNumberThreads() const throw()
+{
+	unsigned int lNbThreads;
+	mCondition.lock();
+	lNbThreads = (mNbRequestedThreads>0) ? mNbRequestedThreads : getNumberProcessors();
+	mCondition.unlock();
+	return lNbThreads;
+}
+
+/*! \todo
+*/
+void ThreadPool::startWorkers()
+{
+	unsigned int lNbThreads = (mNbRequestedThreads>0) ? mNbRequestedThreads : getNumberProcessors();
+
+	mCondition.lock();
+	mExit = false;
+	mCondition.unlock();
+
+	try
+	{
+		while(mWorkers.size()+1 < lNbThreads)
+			mWorkers.push_back(new Worker(this));
+	}
+	catch(...)
+	{
+		stopWorkers();
+		throw(Exception(Exception::eCodeUndefined, "Cannot start the threads of the thread pool"));
+	}
+	mNbThreads = lNbThreads;
+}
+
+/*! \todo
+*/
+void ThreadPool::stopWorkers() throw()
+{
+	mCondition.lock();
+	mExit = true;
+	mCondition.broadcast();
+	mCondition.unlock();
+
+	for(unsigned int i = 0; i < mWorkers.size(); i++)
+		delete mWorkers[i];
+	mWorkers.clear();
+	mNbThreads = 0;
+}
+
+/*! \todo
+*/
+void ThreadPool::runWorker()
+{
+	InParallelForScope lInParallelForScope;
+
+	mCondition.lock();
+	while(!mExit)
+	{
+		if(mNext<mEnd && !mException)
+		{
+			mCondition.unlock();
+			runRanges();
+			mCondition.lock();
+		}
+		else
+			mCondition.wait();
+	}
+	mCondition.unlock();
+}
+
+/*! The range and the task are taken together while the condition is locked, and parallelFor() waits for all the
+    running ranges before returning, so a range is never run once its task is done.
+*/
+void ThreadPool::runRanges()
+{
+	InParallelForScope lInParallelForScope;
+
+	mCondition.lock();
+	while(mNext<mEnd && !mException)
+	{
+		unsigned int lFirst = mNext;
+		unsigned int lEnd = (mEnd-mNext>mRangeSize) ? mNext+mRangeSize : mEnd;
+		ParallelTask* lTask = mTask;
+		const void* lOwner = mOwner;
+		mNext = lEnd;
+		mNbRunning++;
+		mCondition.unlock();
+
+		try
+		{
+			MemoryAccounting::Scope lMemoryScope(lOwner);
+			lTask->run(lFirst, lEnd);
+			mCondition.lock();
+		}
+		catch(Exception& inException)
+		{
+			mCondition.lock();
+			keepException(inException);
+		}
+		catch(std::exception& inException)
+		{
+			mCondition.lock();
+			keepException(Exception(Exception::eCodeUndefined, inException.what()));
+		}
+		catch(...)
+		{
+			mCondition.lock();
+			keepException(Exception(Exception::eCodeUndefined, "Unknown exception raised by a parallel task"));
+		}
+
+		mNbRunning--;
+		if(mNbRunning==0)
+			mCondition.broadcast();
+	}
+	mCondition.unlock();
+}
+
+/*! \todo
+*/
+void ThreadPool::keepException(const Exception& inException) throw()
+{
+	if(!mException)
+		mException = new Exception(inException);
+}
+
+/*! \todo
+*/
+ThreadPool::Worker::Worker(ThreadPool* inThreadPool)
+{
+	mThreadPool = inThreadPool;
+	run();
+}
+
+/*! \todo
+*/
+ThreadPool::Worker::~Worker()
+{
+	wait();
+}
+
+/*! \todo
+*/
+void ThreadPool::Worker::main()
+{
+	mThreadPool->runWorker();
+}
@@ -0,0 +1,149 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/ThreadPool.hpp
+ * \brief ThreadPool class header.
+ * \author Frederic Jean
+ * $Revision$
+ * $Date$
+ */
+
+#ifndef VIPERS_THREAD_POOL_HPP
+#define VIPERS_THREAD_POOL_HPP
+
+#include "Exception.hpp"
+#include "PACC/Threading/Condition.hpp"
+#include "PACC/Threading/Thread.hpp"
+
+#include <vector>
+
+namespace VIPERS
+{
+
+  using namespace std;
+  using namespace PACC;
+
+  /*! \brief %ParallelTask class.
+    \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+
+    Work split by ThreadPool::parallelFor().  run() is called with disjoint ranges of iterations (rows of an image for
+    instance), possibly at the same time from several threads, so it must only write data of its own range.
+  */
+  class ParallelTask
+  {
+    public:
+
+      //! Virtual destructor
+      virtual ~ParallelTask() {}
+
+      //! Process iterations [inFirst, inEnd)
+      virtual void run(unsigned int inFirst, unsigned int inEnd) = 0;
+  };
+
+  /*! \brief %ThreadPool class.
+    \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+
+    Process-wide pool of threads shared by all the modules (see Module::parallelFor()), so that modules do not create
+    threads of their own and compete for the processors.  The calling thread takes part in the work, so a pool of N
+    threads has N-1 worker threads.  Only one parallelFor() uses the workers at a time: a parallelFor() called while
+    another one is running, from a task or from another thread, runs its iterations in the calling thread, so nested
+    parallelism never uses more threads than the pool has.
+  */
+  class ThreadPool
+  {
+    public:
+
+      //! Get the process-wide pool
+      static ThreadPool& getInstance();
+      //! Get the number of processors available to the process
+      static unsigned int getNumberProcessors() throw();
+
+      //! Run a task over iterations [inFirst, inEnd), split in ranges of at least inGrain iterations, and wait for it
+      void parallelFor(unsigned int inFirst, unsigned int inEnd, ParallelTask& inTask, unsigned int inGrain = 1);
+
+      //! Set the number of threads used by parallelFor(), including the calling thread (0 for one per processor)
+      void setNumberThreads(unsigned int inNbThreads);
+      //! Get the number of threads used by parallelFor(), including the calling thread
+      unsigned int getNumberThreads() const throw();
+
+    private:
+
+      /*! \brief Worker thread of the pool
+        \author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+      */
+      class Worker: public Threading::Thread
+      {
+        public:
+          //! Explicit constructor, start the thread
+          explicit Worker(ThreadPool* inThreadPool);
+          //! Destructor, wait for the thread to terminate
+          ~Worker();
+        protected:
+          //! Main thread function
+          void main();
+        private:
+          ThreadPool* mThreadPool; //!< Pool of the worker
+      };
+
+      //! Default constructor
+      ThreadPool();
+      //! Destructor, stop the workers
+      ~ThreadPool();
+      //! Restrict (disable) copy constructor
+      ThreadPool(const ThreadPool&);
+      //! Restrict (disable) assignment operator
+      void operator=(const ThreadPool&);
+
+      //! Start the workers of the pool (mJobMutex must be locked)
+      void startWorkers();
+      //! Stop the workers of the pool (mJobMutex must be locked)
+      void stopWorkers() throw();
+      //! Wait for ranges of the current task and run them (main function of workers)
+      void runWorker();
+      //! Run ranges of the current task until there is none left
+      void runRanges();
+      //! Keep the first exception raised by the current task (mCondition must be locked)
+      void keepException(const Exception& inException) throw();
+
+      unsigned int mNbThreads; //!< Number of threads including the calling thread (0 until the workers are started)
+      unsigned int mNbRequestedThreads; //!< Number of threads requested, 0 for one per processor (mJobMutex and mCondition must be locked to change it)
+      vector<Worker*> mWorkers; //!< Worker threads
+      Threading::Mutex mJobMutex; //!< Mutex held by the parallelFor() using the workers
+
+      Threading::Condition mCondition; //!< Condition for the current task, signaled when ranges are available or done
+      ParallelTask* mTask; //!< Current task (NULL if there is none)
+      const void* mOwner; //!< Memory owner of the thread that called parallelFor() (see MemoryAccounting)
+      unsigned int mNext; //!< First iteration not yet given to a thread
+      unsigned int mEnd; //!< End of the iterations of the current task
+      unsigned int mRangeSize; //!< Number of iterations given to a thread at a time
+      unsigned int mNbRunning; //!< Number of threads running a range of the current task
+      Exception* mException; //!< First exception raised by the current task (NULL if there is none)
+      bool mExit; //!< Workers must terminate
+  };
+
+}
+
+#endif //VIPERS_THREAD_POOL_HPP
@@ -0,0 +1,117 @@
+/*
+ *  Video and Image Processing Environment for Real-time Systems (VIPERS)
+ *  Copyright (C) 2009 by Frederic Jean
+ *
+ *  VIPERS is a free library: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License,
+ *  or (at your option) any later version.
+ *
+ *  VIPERS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with VIPERS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contact:
+ *  Computer Vision and Systems Laboratory
+ *  Department of Electrical and Computer Engineering
+ *  Universite Laval, Quebec, Canada, G1V 0A6
+ *  http://vision.gel.ulaval.ca
+ *
+ */
+
+/*!
+ * \file VIPERS/VIPERSConfig.cpp
+ * \brief Function for configuration of the library.  This file is updated by Cmake.
+ * \author Frederic Jean
+ * $Revision: 255 $
+ * $Date: 2009-10-17 19:58:59 -0400 (Sat, 17 Oct 2009) $
+ */
+
+#include "VIPERSConfig.hpp"
+
+namespace VIPERS
+{
+	using namespace std;
+
+	/*! \todo
+	*/
+	string getVersion()
+	{
+  	return "0.8.0";
+	}
+
+	/*! \todo
+	*/
+	unsigned int getVersionMajorNumber()
+	{
+  	return 0;
+	}
+
+	/*! \todo
+	*/
+	unsigned int getVersionMinorNumber()
+	{
+  	return 8;
+	}
+
+	/*! \todo
+	*/
+	unsigned int getVersionPatchNumber()
+	{  
+  	return 0;
+	}
+
+	/*! \todo
+	*/
+	string getSOVersion()
+	{
+  	return "1.0.0";
+	}
+
+	/*! \todo
+	*/
+	unsigned int getSOVersionCurrentNumber()
+	{
+  	return 1;
+	}
+
+	/*! \todo
+	*/
+	unsigned int getSOVersionRevisionNumber()
+	{
+  	return 0;
+	}
+
+	/*! \todo
+	*/
+	unsigned int getSOVersionAgeNumber()
+	{
+  	return 0;
+	}
+
+	/*! \todo
+	*/
+	unsigned int getRevisionNumber()
+	{
+  	return 0;
+	}
+
+	/*! \todo
+	*/
+	string getVersionRevision()
+	{
+  	return "0.8.0";
+	}
+
+	/*! \todo
+	*/
+	string getModulesDefaultPath()
+	{
+	  return "/usr/local/share/VIPERS/modules";
+	}
+
+};
@@ -32,6 +32,7 @@
  */
 
 #include "Variable.hpp"
+#include "NumberConversion.hpp"
 #include <sstream>
 
 using namespace VIPERS;
@@ -45,6 +46,7 @@ Variable::Variable(const string& inName, VariableType inVariableType, const stri
 	mVariableType = inVariableType;
 	mDisplayName = inDisplayName.c_str();
 	mDescription = inDescription.c_str();
+	updateTypedValue();
 }
 
 /*! \todo
@@ -56,6 +58,8 @@ Variable::Variable(const Variable& inVariable)
 	mVariableType = inVariable.mVariableType;
 	mDescription = inVariable.mDescription.c_str();
 	mValue = inVariable.mValue.c_str();
+	mTypedKind = inVariable.mTypedKind;
+	mTypedValue = inVariable.mTypedValue;
 }
 
 /*! \todo
@@ -63,6 +67,14 @@ Variable::Variable(const Variable& inVariable)
 Variable& Variable::operator=(const Variable& inVariable) throw()
 {
 	mValue = inVariable.mValue.c_str();
+	if(mVariableType==inVariable.mVariableType)
+	{
+		mTypedKind = inVariable.mTypedKind;
+		mTypedValue = inVariable.mTypedValue;
+		valueChanged();
+	}
+	else
+		updateTypedValue();
 	return *this;
 }
 
@@ -80,6 +92,54 @@ bool Variable::operator!=(const Variable& inVariable) const throw()
 	return mValue!=inVariable.mValue;
 }
 
+/*! Parse the string value once, according to the variable type, so that the to*() functions of the same
+    kind of type do not need to parse it again.  Values that cannot be parsed are left to the to*() functions.
+*/
+void Variable::updateTypedValue() throw()
+{
+	mTypedKind = eTypedKindNone;
+
+	switch(mVariableType)
+	{
+		case eVariableTypeBool:
+			if(convertStringToNumber(mValue, mTypedValue.mBool))
+				mTypedKind = eTypedKindBool;
+			break;
+		case eVariableTypeShort:
+		case eVariableTypeInt:
+		case eVariableTypeLong:
+			if(convertStringToNumber(mValue, mTypedValue.mLong))
+				mTypedKind = eTypedKindSigned;
+			break;
+		case eVariableTypeUShort:
+		case eVariableTypeUInt:
+		case eVariableTypeULong:
+			if(convertStringToNumber(mValue, mTypedValue.mULong))
+				mTypedKind = eTypedKindUnsigned;
+			break;
+		case eVariableTypeFloat:
+		case eVariableTypeDouble:
+			if(convertStringToNumber(mValue, mTypedValue.mDouble))
+				mTypedKind = eTypedKindDouble;
+			break;
+		case eVariableTypeLDouble:
+			if(convertStringToNumber(mValue, mTypedValue.mLDouble))
+				mTypedKind = eTypedKindLDouble;
+			break;
+		default:
+			break;
+	}
+
+	valueChanged();
+}
+
+/*! \todo
+*/
+void Variable::valueChanged() throw()
+{
+
+}
+
 /*! \todo
 */
 Variable::~Variable()
@@ -120,15 +180,15 @@ Variable::VariableType Variable::getVariableType() const throw()
 void Variable::setValueStr(const string& inValueStr) throw()
 {
 	mValue = inValueStr.c_str();
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(bool inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 }
 
 /*! \todo
@@ -138,6 +198,7 @@ void Variable::setValue(char inValue) throw()
 	ostringstream lTmpStr;
 	lTmpStr << inValue;
 	mValue = lTmpStr.str().c_str();
+	updateTypedValue();
 }
 
 /*! \todo
@@ -147,93 +208,79 @@ void Variable::setValue(unsigned char inValue) throw()
 	ostringstream lTmpStr;
 	lTmpStr << inValue;
 	mValue = lTmpStr.str().c_str();
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(short inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(static_cast<long>(inValue));
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(unsigned short inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(static_cast<unsigned long>(inValue));
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(int inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(static_cast<long>(inValue));
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(unsigned int inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(static_cast<unsigned long>(inValue));
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(long inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(unsigned long inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(float inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr.precision(6);
-	lTmpStr.setf(ios::scientific, ios::floatfield);
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(double inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr.precision(15);
-	lTmpStr.setf(ios::scientific, ios::floatfield);
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 }
 
 /*! \todo
 */
 void Variable::setValue(long double inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr.precision(19);
-	lTmpStr.setf(ios::scientific, ios::floatfield);
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 }
 
 /*! \todo
@@ -241,6 +288,7 @@ void Variable::setValue(long double inValue) throw()
 void Variable::setValue(const Color& inValue) throw()
 {
 	mValue = inValue.getString();
+	updateTypedValue();
 }
 
 /*! \todo
@@ -248,6 +296,7 @@ void Variable::setValue(const Color& inValue) throw()
 void Variable::setValue(const Size& inValue) throw()
 {
 	mValue = inValue.getString();
+	updateTypedValue();
 }
 
 /*! \todo
@@ -255,6 +304,7 @@ void Variable::setValue(const Size& inValue) throw()
 Variable& Variable::operator=(const string& inValueStr) throw()
 {
 	mValue = inValueStr.c_str();
+	updateTypedValue();
 	return *this;
 }
 
@@ -262,9 +312,8 @@ Variable& Variable::operator=(const string& inValueStr) throw()
 */
 Variable& Variable::operator=(bool inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 	return *this;
 }
 
@@ -275,6 +324,7 @@ Variable& Variable::operator=(char inValue) throw()
 	ostringstream lTmpStr;
 	lTmpStr << inValue;
 	mValue = lTmpStr.str().c_str();
+	updateTypedValue();
 	return *this;
 }
 
@@ -285,6 +335,7 @@ Variable& Variable::operator=(unsigned char inValue) throw()
 	ostringstream lTmpStr;
 	lTmpStr << inValue;
 	mValue = lTmpStr.str().c_str();
+	updateTypedValue();
 	return *this;
 }
 
@@ -292,9 +343,8 @@ Variable& Variable::operator=(unsigned char inValue) throw()
 */
 Variable& Variable::operator=(short inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(static_cast<long>(inValue));
+	updateTypedValue();
 	return *this;
 }
 
@@ -302,9 +352,8 @@ Variable& Variable::operator=(short inValue) throw()
 */
 Variable& Variable::operator=(unsigned short inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(static_cast<unsigned long>(inValue));
+	updateTypedValue();
 	return *this;
 }
 
@@ -312,9 +361,8 @@ Variable& Variable::operator=(unsigned short inValue) throw()
 */
 Variable& Variable::operator=(int inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(static_cast<long>(inValue));
+	updateTypedValue();
 	return *this;
 }
 
@@ -322,9 +370,8 @@ Variable& Variable::operator=(int inValue) throw()
 */
 Variable& Variable::operator=(unsigned int inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(static_cast<unsigned long>(inValue));
+	updateTypedValue();
 	return *this;
 }
 
@@ -332,9 +379,8 @@ Variable& Variable::operator=(unsigned int inValue) throw()
 */
 Variable& Variable::operator=(long inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 	return *this;
 }
 
@@ -342,9 +388,8 @@ Variable& Variable::operator=(long inValue) throw()
 */
 Variable& Variable::operator=(unsigned long inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 	return *this;
 }
 
@@ -352,11 +397,8 @@ Variable& Variable::operator=(unsigned long inValue) throw()
 */
 Variable& Variable::operator=(float inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr.precision(6);
-	lTmpStr.setf(ios::scientific, ios::floatfield);
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 	return *this;
 }
 
@@ -364,11 +406,8 @@ Variable& Variable::operator=(float inValue) throw()
 */
 Variable& Variable::operator=(double inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr.precision(15);
-	lTmpStr.setf(ios::scientific, ios::floatfield);
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 	return *this;
 }
 
@@ -376,11 +415,8 @@ Variable& Variable::operator=(double inValue) throw()
 */
 Variable& Variable::operator=(long double inValue) throw()
 {
-	ostringstream lTmpStr;
-	lTmpStr.precision(19);
-	lTmpStr.setf(ios::scientific, ios::floatfield);
-	lTmpStr << inValue;
-	mValue = lTmpStr.str().c_str();
+	mValue = convertNumberToString(inValue);
+	updateTypedValue();
 	return *this;
 }
 
@@ -389,6 +425,7 @@ Variable& Variable::operator=(long double inValue) throw()
 Variable& Variable::operator=(const Size& inValue) throw()
 {
 	mValue = inValue.getString();
+	updateTypedValue();
 	return *this;
 }
 
@@ -397,6 +434,7 @@ Variable& Variable::operator=(const Size& inValue) throw()
 Variable& Variable::operator=(const Color& inValue) throw()
 {
 	mValue = inValue.getString();
+	updateTypedValue();
 	return *this;
 }
 
@@ -418,9 +456,10 @@ string Variable::toString() const throw()
 */
 bool Variable::toBool() const throw()
 {
+	if(mTypedKind==eTypedKindBool)
+		return mTypedValue.mBool;
 	bool lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -448,9 +487,12 @@ unsigned char Variable::toUChar() const throw()
 */
 short Variable::toShort() const throw()
 {
+	if(mTypedKind==eTypedKindSigned)
+		return static_cast<short>(mTypedValue.mLong);
+	if(mTypedKind==eTypedKindUnsigned)
+		return static_cast<short>(mTypedValue.mULong);
 	short lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -458,9 +500,12 @@ short Variable::toShort() const throw()
 */
 unsigned short Variable::toUShort() const throw()
 {
+	if(mTypedKind==eTypedKindSigned)
+		return static_cast<unsigned short>(mTypedValue.mLong);
+	if(mTypedKind==eTypedKindUnsigned)
+		return static_cast<unsigned short>(mTypedValue.mULong);
 	unsigned short lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -468,9 +513,12 @@ unsigned short Variable::toUShort() const throw()
 */
 int Variable::toInt() const throw()
 {
+	if(mTypedKind==eTypedKindSigned)
+		return static_cast<int>(mTypedValue.mLong);
+	if(mTypedKind==eTypedKindUnsigned)
+		return static_cast<int>(mTypedValue.mULong);
 	int lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -478,9 +526,12 @@ int Variable::toInt() const throw()
 */
 unsigned int Variable::toUInt() const throw()
 {
+	if(mTypedKind==eTypedKindSigned)
+		return static_cast<unsigned int>(mTypedValue.mLong);
+	if(mTypedKind==eTypedKindUnsigned)
+		return static_cast<unsigned int>(mTypedValue.mULong);
 	unsigned int lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -488,9 +539,12 @@ unsigned int Variable::toUInt() const throw()
 */
 long Variable::toLong() const throw()
 {
+	if(mTypedKind==eTypedKindSigned)
+		return static_cast<long>(mTypedValue.mLong);
+	if(mTypedKind==eTypedKindUnsigned)
+		return static_cast<long>(mTypedValue.mULong);
 	long lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -498,9 +552,12 @@ long Variable::toLong() const throw()
 */
 unsigned long Variable::toULong() const throw()
 {
+	if(mTypedKind==eTypedKindSigned)
+		return static_cast<unsigned long>(mTypedValue.mLong);
+	if(mTypedKind==eTypedKindUnsigned)
+		return static_cast<unsigned long>(mTypedValue.mULong);
 	unsigned long lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -508,9 +565,10 @@ unsigned long Variable::toULong() const throw()
 */
 float Variable::toFloat() const throw()
 {
+	if(mTypedKind==eTypedKindDouble)
+		return static_cast<float>(mTypedValue.mDouble);
 	float lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -518,9 +576,10 @@ float Variable::toFloat() const throw()
 */
 double Variable::toDouble() const throw()
 {
+	if(mTypedKind==eTypedKindDouble)
+		return mTypedValue.mDouble;
 	double lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -528,9 +587,10 @@ double Variable::toDouble() const throw()
 */
 long double Variable::toLDouble() const throw()
 {
+	if(mTypedKind==eTypedKindLDouble)
+		return mTypedValue.mLDouble;
 	long double lValue;
-	istringstream lTmpStr(mValue);
-	lTmpStr >> lValue;
+	convertStringToNumber(mValue, lValue);
 	return lValue;
 }
 
@@ -260,10 +260,42 @@ namespace VIPERS
 
 		protected:
 
+		//! Called each time the value changes (does nothing by default)
+		virtual void valueChanged() throw();
+
 		string mValue; //! The current value
 
 		private:
 
+		/*! \brief Kind of the parsed value
+		\author Fr&eacute;d&eacute;ric Jean, Computer Vision and Systems Laboratory, Laval University, QC, Canada
+		*/
+		enum TypedKind
+		{
+			eTypedKindNone, //!< No parsed value (non numeric type, or value that cannot be parsed)
+			eTypedKindBool, //!< Boolean
+			eTypedKindSigned, //!< Signed integer
+			eTypedKindUnsigned, //!< Unsigned integer
+			eTypedKindDouble, //!< Float or double
+			eTypedKindLDouble //!< Long double
+		};
+
+		//! Parsed value
+		union TypedValue
+		{
+			bool mBool; //!< Boolean value
+			long mLong; //!< Signed integer value
+			unsigned long mULong; //!< Unsigned integer value
+			double mDouble; //!< Float or double value
+			long double mLDouble; //!< Long double value
+		};
+
+		//! Parse the string value into the typed value
+		void updateTypedValue() throw();
+
+		TypedKind mTypedKind; //!< Kind of the parsed value
+		TypedValue mTypedValue; //!< Value parsed when it is set, according to the variable type
+
 		string mName; //!< Unique name of the variable
 		string mDisplayName; //!< Display name
 		string mDescription; //!< Description
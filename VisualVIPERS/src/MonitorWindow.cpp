@@ -27,6 +27,7 @@
 #include "VisualVipersConfig.hpp"
 
 #include <Module.hpp>
+#include <ImageConversion.hpp>
 
 #include <QAction>
 #include <QImage>
@@ -267,6 +268,7 @@ void MonitorWindow::updateImage()
           lBuffDest += 4;
           lBuffSrc += 4;
         }
+        lBuffSrc += lImage->getRowLengthBytes() - 4*mImageWidth;
       }
 
     }
@@ -298,6 +300,35 @@ void MonitorWindow::updateImage()
       lBuffSrc += lImage->getRowLengthBytes() / sizeof(uint16_t) - mImageWidth;
     }
 
+  }
+  // 16 bpp float, 1 channel
+  else if(mImageDepth==Image::eDepth16F && lImage->getNbChannels()==Image::eChannel1 && (lImage->getModel()==Image::eModelUndefined || lImage->getModel()==Image::eModelGray))
+  {
+    lImageToShow = true;
+    if(!mImageTmp)
+    {
+      mImageTmpData = new uchar[mImageWidth*mImageHeight];
+      mImageTmp = new QImage(mImageTmpData, mImageWidth, mImageHeight, QImage::Format_Indexed8);
+      QVector<QRgb> lColorTable;
+      for(int i = 0; i < 256; i++)
+        lColorTable.push_back(qRgb(i, i, i));
+      mImageTmp->setColorTable(lColorTable);
+    }
+
+    const uint16_t* lBuffSrc = (const uint16_t*)(lImage->getData());
+    uchar* lBuffDest = mImageTmpData;
+
+    for(unsigned int lY = 0; lY < mImageHeight; ++lY)
+    {
+      for(unsigned int lX = 0; lX < mImageWidth; ++lX)
+      {
+        float lValue = 255 * convertHalfToFloat(*lBuffSrc++);
+        // NaN fails both comparisons and is shown as 0, out of range values are saturated
+        *lBuffDest++ = (lValue >= 255) ? 255 : ((lValue > 0) ? (uchar)lValue : 0);
+      }
+      lBuffSrc += lImage->getRowLengthBytes() / sizeof(uint16_t) - mImageWidth;
+    }
+
   }
   // 32 bpp, 1 channel
   else if(mImageDepth==Image::eDepth32F && lImage->getNbChannels()==Image::eChannel1 && (lImage->getModel()==Image::eModelUndefined || lImage->getModel()==Image::eModelGray))